@@ -205,6 +205,7 @@ ClangdServer::Options::operator TUScheduler::Options() const {
   Opts.AsyncThreadsCount = AsyncThreadsCount;
   Opts.RetentionPolicy = RetentionPolicy;
   Opts.StorePreamblesInMemory = StorePreamblesInMemory;
+  Opts.SharePreambles = SharePreambles;
   Opts.UpdateDebounce = UpdateDebounce;
   Opts.ContextProvider = ContextProvider;
   Opts.PreambleThrottler = PreambleThrottler;
@@ -224,6 +225,7 @@ ClangdServer::ClangdServer(const GlobalCompilationDatabase &CDB,
       LineFoldingOnly(Opts.LineFoldingOnly),
       PreambleParseForwardingFunctions(Opts.PreambleParseForwardingFunctions),
       ImportInsertions(Opts.ImportInsertions),
+      ChainPreambles(Opts.ChainPreambles),
       PublishInactiveRegions(Opts.PublishInactiveRegions),
       WorkspaceRoot(Opts.WorkspaceRoot),
       Transient(Opts.ImplicitCancellation ? TUScheduler::InvalidateOnUpdate
@@ -301,6 +303,7 @@ void ClangdServer::addDocument(PathRef File, llvm::StringRef Contents,
   ParseOptions Opts;
   Opts.PreambleParseForwardingFunctions = PreambleParseForwardingFunctions;
   Opts.ImportInsertions = ImportInsertions;
+  Opts.ChainPreambles = ChainPreambles;
 
   // Compile command is set asynchronously during update, as it can be slow.
   ParseInputs Inputs;
@@ -416,6 +419,8 @@ ClangdServer::createConfiguredContextProvider(const config::Provider *Provider,
 void ClangdServer::removeDocument(PathRef File) {
   DraftMgr.removeDraft(File);
   WorkScheduler->remove(File);
+  std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
+  CachedCompletionsByFile.erase(File);
 }
 
 void ClangdServer::codeComplete(PathRef File, Position Pos,
@@ -434,6 +439,11 @@ void ClangdServer::codeComplete(PathRef File, Position Pos,
       return CB(llvm::make_error<CancelledError>(Reason));
 
     std::optional<SpeculativeFuzzyFind> SpecFuzzyFind;
+    CompletionRefilterCache RefilterCache;
+    if (IP->Preamble) {
+      std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
+      RefilterCache.Cached = CachedCompletionsByFile.lookup(File);
+    }
     if (!IP->Preamble) {
       // No speculation in Fallback mode, as it's supposed to be much faster
       // without compiling.
@@ -459,7 +469,7 @@ void ClangdServer::codeComplete(PathRef File, Position Pos,
     // both the old and the new version in case only one of them matches.
     CodeCompleteResult Result = clangd::codeComplete(
         File, Pos, IP->Preamble, ParseInput, CodeCompleteOpts,
-        SpecFuzzyFind ? &*SpecFuzzyFind : nullptr);
+        SpecFuzzyFind ? &*SpecFuzzyFind : nullptr, &RefilterCache);
     {
       clang::clangd::trace::Span Tracer("Completion results callback");
       CB(std::move(Result));
@@ -468,6 +478,12 @@ void ClangdServer::codeComplete(PathRef File, Position Pos,
       std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
       CachedCompletionFuzzyFindRequestByFile[File] = *SpecFuzzyFind->NewReq;
     }
+    if (RefilterCache.New != RefilterCache.Cached) {
+      std::lock_guard<std::mutex> Lock(CachedCompletionFuzzyFindRequestMutex);
+      // Don't bring back the snapshot of a file closed in the meantime.
+      if (DraftMgr.getDraft(File))
+        CachedCompletionsByFile[File] = std::move(RefilterCache.New);
+    }
     // SpecFuzzyFind is only destroyed after speculative fuzzy find finishes.
     // We don't want `codeComplete` to wait for the async call if it doesn't use
     // the result (e.g. non-index completion, speculation fails), so that `CB`
@@ -110,6 +110,10 @@ public:
     /// Cached preambles are potentially large. If false, store them on disk.
     bool StorePreamblesInMemory = true;
 
+    /// If true, files with the same preamble region and compile flags share a
+    /// single preamble.
+    bool SharePreambles = false;
+
     /// Call hierarchy's outgoing calls feature requires additional index
     /// serving structures which increase memory usage. If false, these are
     /// not created and the feature is not enabled.
@@ -190,6 +194,11 @@ public:
     /// instead of #include.
     bool ImportInsertions = false;
 
+    /// If true, preamble rebuilds that only append to the preamble region
+    /// reuse the previous preamble as a prefix and only parse the new part.
+    /// Requires preambles to be stored on disk.
+    bool ChainPreambles = false;
+
     /// Whether to collect and publish information about inactive preprocessor
     /// regions in the document.
     bool PublishInactiveRegions = false;
@@ -505,11 +514,16 @@ private:
 
   bool ImportInsertions = false;
 
+  bool ChainPreambles = false;
+
   bool PublishInactiveRegions = false;
 
   // GUARDED_BY(CachedCompletionFuzzyFindRequestMutex)
   llvm::StringMap<std::optional<FuzzyFindRequest>>
       CachedCompletionFuzzyFindRequestByFile;
+  // GUARDED_BY(CachedCompletionFuzzyFindRequestMutex)
+  llvm::StringMap<std::shared_ptr<const CompletionRefilterCache::Snapshot>>
+      CachedCompletionsByFile;
   mutable std::mutex CachedCompletionFuzzyFindRequestMutex;
 
   std::optional<std::string> WorkspaceRoot;
@@ -67,6 +67,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/ScopedPrinter.h"
+#include "llvm/Support/xxhash.h"
 #include <algorithm>
 #include <iterator>
 #include <limits>
@@ -317,6 +318,10 @@ struct CompletionCandidate {
 };
 using ScoredBundle =
     std::pair<CompletionCandidate::Bundle, CodeCompletion::Scores>;
+// Completions with more matching candidates are not kept for refiltering, as
+// all of them have to be rendered upfront.
+constexpr size_t MaxRefilterCandidates = 1000;
+
 struct ScoredBundleGreater {
   bool operator()(const ScoredBundle &L, const ScoredBundle &R) {
     if (L.second.Total != R.second.Total)
@@ -1589,6 +1594,9 @@ class CodeCompleteFlow {
   IncludeStructure Includes;           // Complete once the compiler runs.
   SpeculativeFuzzyFind *SpecFuzzyFind; // Can be nullptr.
   const CodeCompleteOptions &Opts;
+  // Set to all matching candidates if they can be refiltered later.
+  // Can be nullptr.
+  std::optional<CompletionRefilterCache::Snapshot> *Snapshot;
 
   // Sema takes ownership of Recorder. Recorder is valid until Sema cleanup.
   CompletionRecorder *Recorder = nullptr;
@@ -1624,11 +1632,12 @@ class CodeCompleteFlow {
 
 public:
   // A CodeCompleteFlow object is only useful for calling run() exactly once.
-  CodeCompleteFlow(PathRef FileName, const IncludeStructure &Includes,
-                   SpeculativeFuzzyFind *SpecFuzzyFind,
-                   const CodeCompleteOptions &Opts)
+  CodeCompleteFlow(
+      PathRef FileName, const IncludeStructure &Includes,
+      SpeculativeFuzzyFind *SpecFuzzyFind, const CodeCompleteOptions &Opts,
+      std::optional<CompletionRefilterCache::Snapshot> *Snapshot = nullptr)
       : FileName(FileName), Includes(Includes), SpecFuzzyFind(SpecFuzzyFind),
-        Opts(Opts) {}
+        Opts(Opts), Snapshot(Snapshot) {}
 
   CodeCompleteResult run(const SemaCompleteInput &SemaCCInput) && {
     trace::Span Tracer("CodeCompleteFlow");
@@ -1856,12 +1865,49 @@ private:
                             ? queryIndex()
                             : SymbolSlab();
     trace::Span Tracer("Populate CodeCompleteResult");
+    // The candidates can be refiltered for a longer filter if we know all of
+    // them, i.e. the index returned everything it had.
+    if (Snapshot && !Incomplete && Filter->pattern() == HeuristicPrefix.Name)
+      return snapshotAndTruncate(mergeResults(
+          Recorder->Results, IndexResults, /*Identifiers*/ {},
+          /*Limit=*/std::numeric_limits<size_t>::max()));
     // Merge Sema and Index results, score them, and pick the winners.
     auto Top =
         mergeResults(Recorder->Results, IndexResults, /*Identifiers*/ {});
     return toCodeCompleteResult(Top);
   }
 
+  // Renders all of \p Scored into the snapshot, and returns the top results.
+  CodeCompleteResult snapshotAndTruncate(std::vector<ScoredBundle> Scored) {
+    size_t Matches = Scored.size();
+    if (Matches > MaxRefilterCandidates) {
+      if (Opts.Limit && Matches > Opts.Limit) {
+        Scored.erase(Scored.begin() + Opts.Limit, Scored.end());
+        Incomplete = true;
+      }
+      return toCodeCompleteResult(Scored);
+    }
+
+    auto &S = Snapshot->emplace();
+    for (const auto &C : Scored) {
+      const CompletionCandidate &First = C.first.front();
+      bool IsMacro =
+          (First.SemaResult &&
+           First.SemaResult->Kind == CodeCompletionResult::RK_Macro) ||
+          (First.IndexResult &&
+           First.IndexResult->SymInfo.Kind == index::SymbolKind::Macro);
+      S.Candidates.emplace_back(First.Name.str(), IsMacro);
+    }
+    S.Result = toCodeCompleteResult(Scored);
+
+    CodeCompleteResult Output = S.Result;
+    if (Opts.Limit && Matches > Opts.Limit) {
+      Output.Completions.resize(Opts.Limit);
+      Output.HasMore = true;
+    }
+    return Output;
+  }
+
   CodeCompleteResult
   toCodeCompleteResult(const std::vector<ScoredBundle> &Scored) {
     CodeCompleteResult Output;
@@ -1953,7 +1999,8 @@ private:
   std::vector<ScoredBundle>
   mergeResults(const std::vector<CodeCompletionResult> &SemaResults,
                const SymbolSlab &IndexResults,
-               const std::vector<RawIdentifier> &IdentifierResults) {
+               const std::vector<RawIdentifier> &IdentifierResults,
+               std::optional<size_t> Limit = std::nullopt) {
     trace::Span Tracer("Merge and score results");
     std::vector<CompletionCandidate::Bundle> Bundles;
     llvm::DenseMap<size_t, size_t> BundleLookup;
@@ -2012,8 +2059,9 @@ private:
     for (const auto &Ident : IdentifierResults)
       AddToBundles(/*SemaResult=*/nullptr, /*IndexResult=*/nullptr, &Ident);
     // We only keep the best N results at any time, in "native" format.
+    size_t N = Limit.value_or(Opts.Limit);
     TopN<ScoredBundle, ScoredBundleGreater> Top(
-        Opts.Limit == 0 ? std::numeric_limits<size_t>::max() : Opts.Limit);
+        N == 0 ? std::numeric_limits<size_t>::max() : N);
     for (auto &Bundle : Bundles)
       addCandidate(Top, std::move(Bundle));
     return std::move(Top).items();
@@ -2257,11 +2305,73 @@ maybeFunctionArgumentCommentStart(llvm::StringRef Content) {
   return std::nullopt;
 }
 
+static uint64_t hashContents(llvm::StringRef Contents) {
+  return llvm::xxh3_64bits(Contents);
+}
+
+// Serves a completion from a snapshot of a past one, if the user only typed
+// more characters of the same identifier since. Repeated requests at the same
+// point run the full completion, so that they pick up index changes.
+static std::optional<CodeCompleteResult>
+refilterCompletions(const CompletionRefilterCache::Snapshot &S,
+                    const PreambleData &Preamble, llvm::StringRef Contents,
+                    unsigned Offset, const CodeCompleteOptions &Opts) {
+  if (S.Limit != Opts.Limit || S.PreambleBuild.lock() != Preamble.StatCache)
+    return std::nullopt;
+  auto Prefix = guessCompletionPrefix(Contents, Offset);
+  if (size_t(Prefix.Name.begin() - Contents.begin()) != S.FilterStart ||
+      Prefix.Name.size() <= S.Filter.size() ||
+      !Prefix.Name.starts_with(S.Filter) ||
+      (Offset < Contents.size() && isAsciiIdentifierContinue(Contents[Offset])))
+    return std::nullopt;
+  if (hashContents(Contents.take_front(S.FilterStart)) != S.PrefixHash ||
+      hashContents(Contents.drop_front(Offset)) != S.SuffixHash)
+    return std::nullopt;
+
+  trace::Span Tracer("RefilterCompletions");
+  FuzzyMatcher Filter(Prefix.Name);
+  std::vector<std::pair<float, size_t>> Matches;
+  for (size_t I = 0; I < S.Candidates.size(); ++I) {
+    const auto &[Name, IsMacro] = S.Candidates[I];
+    if (IsMacro && !llvm::StringRef(Name).starts_with_insensitive(Prefix.Name))
+      continue;
+    if (auto NameMatch = Filter.match(Name))
+      Matches.emplace_back(
+          S.Result.Completions[I].Score.ExcludingName * *NameMatch, I);
+  }
+  // Same order as ScoredBundleGreater.
+  llvm::sort(Matches, [&](const auto &L, const auto &R) {
+    if (L.first != R.first)
+      return L.first > R.first;
+    return S.Candidates[L.second].first < S.Candidates[R.second].first;
+  });
+
+  CodeCompleteResult Output;
+  Output.Context = S.Result.Context;
+  Output.CompletionRange = S.Result.CompletionRange;
+  if (Output.CompletionRange)
+    Output.CompletionRange->end = offsetToPosition(Contents, Offset);
+  Output.HasMore = Opts.Limit && Matches.size() > Opts.Limit;
+  if (Output.HasMore)
+    Matches.resize(Opts.Limit);
+  for (const auto &[Total, I] : Matches) {
+    Output.Completions.push_back(S.Result.Completions[I]);
+    CodeCompletion &C = Output.Completions.back();
+    C.Score.Total = Total;
+    if (Output.CompletionRange)
+      C.CompletionTokenRange = *Output.CompletionRange;
+  }
+  SPAN_ATTACH(Tracer, "candidates", int64_t(S.Candidates.size()));
+  SPAN_ATTACH(Tracer, "returned_results", int64_t(Output.Completions.size()));
+  return Output;
+}
+
 CodeCompleteResult codeComplete(PathRef FileName, Position Pos,
                                 const PreambleData *Preamble,
                                 const ParseInputs &ParseInput,
                                 CodeCompleteOptions Opts,
-                                SpeculativeFuzzyFind *SpecFuzzyFind) {
+                                SpeculativeFuzzyFind *SpecFuzzyFind,
+                                CompletionRefilterCache *RefilterCache) {
   auto Offset = positionToOffset(ParseInput.Contents, Pos);
   if (!Offset) {
     elog("Code completion position was invalid {0}", Offset.takeError());
@@ -2280,17 +2390,45 @@ CodeCompleteResult codeComplete(PathRef FileName, Position Pos,
                                Preamble, ParseInput);
   }
 
-  auto Flow = CodeCompleteFlow(
-      FileName, Preamble ? Preamble->Includes : IncludeStructure(),
-      SpecFuzzyFind, Opts);
-  return (!Preamble || Opts.RunParser == CodeCompleteOptions::NeverParse)
-             ? std::move(Flow).runWithoutSema(ParseInput.Contents, *Offset,
-                                              *ParseInput.TFS)
-             : std::move(Flow).run({FileName, *Offset, *Preamble,
-                                    /*PreamblePatch=*/
-                                    PreamblePatch::createMacroPatch(
-                                        FileName, ParseInput, *Preamble),
-                                    ParseInput});
+  if (!Preamble || Opts.RunParser == CodeCompleteOptions::NeverParse)
+    return CodeCompleteFlow(FileName, IncludeStructure(), SpecFuzzyFind, Opts)
+        .runWithoutSema(ParseInput.Contents, *Offset, *ParseInput.TFS);
+
+  if (RefilterCache && RefilterCache->Cached) {
+    if (auto Result = refilterCompletions(*RefilterCache->Cached, *Preamble,
+                                          ParseInput.Contents, *Offset, Opts)) {
+      vlog("Code complete: refiltered {0} cached candidates",
+           RefilterCache->Cached->Candidates.size());
+      RefilterCache->New = RefilterCache->Cached;
+      return std::move(*Result);
+    }
+  }
+
+  std::optional<CompletionRefilterCache::Snapshot> Snapshot;
+  auto Result =
+      CodeCompleteFlow(FileName, Preamble->Includes, SpecFuzzyFind, Opts,
+                       RefilterCache ? &Snapshot : nullptr)
+          .run({FileName, *Offset, *Preamble,
+                /*PreamblePatch=*/
+                PreamblePatch::createMacroPatch(FileName, ParseInput,
+                                                *Preamble),
+                ParseInput});
+  if (Snapshot && !(*Offset < ParseInput.Contents.size() &&
+                    isAsciiIdentifierContinue(ParseInput.Contents[*Offset]))) {
+    llvm::StringRef Contents = ParseInput.Contents;
+    auto Prefix = guessCompletionPrefix(Contents, *Offset);
+    Snapshot->PreambleBuild = Preamble->StatCache;
+    Snapshot->FilterStart = Prefix.Name.begin() - Contents.begin();
+    Snapshot->Filter = Prefix.Name.str();
+    Snapshot->PrefixHash =
+        hashContents(Contents.take_front(Snapshot->FilterStart));
+    Snapshot->SuffixHash = hashContents(Contents.drop_front(*Offset));
+    Snapshot->Limit = Opts.Limit;
+    RefilterCache->New =
+        std::make_shared<const CompletionRefilterCache::Snapshot>(
+            std::move(*Snapshot));
+  }
+  return Result;
 }
 
 SignatureHelp signatureHelp(PathRef FileName, Position Pos,
@@ -29,8 +29,10 @@
 #include "clang/Sema/CodeCompleteOptions.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include <cstdint>
 #include <functional>
 #include <future>
+#include <memory>
 #include <optional>
 #include <utility>
 
@@ -278,6 +280,39 @@ struct SpeculativeFuzzyFind {
   std::future<std::pair<bool /*Incomplete*/, SymbolSlab>> Result;
 };
 
+class PreambleFileStatusCache;
+
+/// Completion candidates of a past completion, that completions at the same
+/// point can refilter instead of running Sema again. This applies while the
+/// user keeps typing the identifier being completed: candidates matching the
+/// longer filter are a subset of those matching the shorter one, and their
+/// scores only differ by the name match (see CodeCompletion::Scores).
+struct CompletionRefilterCache {
+  struct Snapshot {
+    /// The preamble build the candidates were computed with.
+    std::weak_ptr<const PreambleFileStatusCache> PreambleBuild;
+    /// Offset of the identifier being completed, and its part before the
+    /// cursor.
+    size_t FilterStart = 0;
+    std::string Filter;
+    /// Hashes of the contents before the identifier and after the cursor.
+    uint64_t PrefixHash = 0;
+    uint64_t SuffixHash = 0;
+    size_t Limit = 0;
+    /// Every candidate that matched Filter, best first.
+    CodeCompleteResult Result;
+    /// For each of Result.Completions, the name that is matched against the
+    /// filter and whether it is a macro (which only match by prefix).
+    std::vector<std::pair<std::string, bool /*IsMacro*/>> Candidates;
+  };
+  /// A snapshot from a past completion in the same file.
+  /// Set by caller of `codeComplete()`.
+  std::shared_ptr<const Snapshot> Cached;
+  /// A snapshot that later completions at the same point can use.
+  /// Set by `codeComplete()`. This can be used by callers to update cache.
+  std::shared_ptr<const Snapshot> New;
+};
+
 /// Gets code completions at a specified \p Pos in \p FileName.
 ///
 /// If \p Preamble is nullptr, this runs code completion without compiling the
@@ -288,11 +323,14 @@ struct SpeculativeFuzzyFind {
 /// the speculative result is used by code completion (e.g. speculation failed),
 /// the speculative result is not consumed, and `SpecFuzzyFind` is only
 /// destroyed when the async request finishes.
-CodeCompleteResult codeComplete(PathRef FileName, Position Pos,
-                                const PreambleData *Preamble,
-                                const ParseInputs &ParseInput,
-                                CodeCompleteOptions Opts,
-                                SpeculativeFuzzyFind *SpecFuzzyFind = nullptr);
+///
+/// If \p RefilterCache is set and its cached snapshot was taken at the same
+/// completion point, the completion is served by refiltering the snapshot.
+CodeCompleteResult
+codeComplete(PathRef FileName, Position Pos, const PreambleData *Preamble,
+             const ParseInputs &ParseInput, CodeCompleteOptions Opts,
+             SpeculativeFuzzyFind *SpecFuzzyFind = nullptr,
+             CompletionRefilterCache *RefilterCache = nullptr);
 
 /// Get signature help at a specified \p Pos in \p FileName.
 SignatureHelp signatureHelp(PathRef FileName, Position Pos,
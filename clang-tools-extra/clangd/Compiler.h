@@ -43,6 +43,10 @@ struct ParseOptions {
   bool PreambleParseForwardingFunctions = false;
 
   bool ImportInsertions = false;
+
+  // Build new preambles on top of the previous one when it covers an
+  // unchanged prefix of the preamble region.
+  bool ChainPreambles = false;
 };
 
 /// Information required to run clang, e.g. to parse AST or do code completion.
@@ -178,6 +178,9 @@ llvm::SmallVector<SymbolInclude, 1> getRankedIncludes(const Symbol &Sym) {
 void IncludeStructure::collect(const CompilerInstance &CI) {
   auto &SM = CI.getSourceManager();
   MainFileEntry = SM.getFileEntryForID(SM.getMainFileID());
+  // The structure may have been copied from a preamble built for another file.
+  if (MainFileEntry && !MainFileEntry->tryGetRealPathName().empty())
+    RealPathNames.front() = MainFileEntry->tryGetRealPathName().str();
   auto Collector = std::make_unique<RecordHeaders>(CI, this);
   CI.getPreprocessor().addPPCallbacks(std::move(Collector));
 
@@ -252,6 +255,41 @@ IncludeStructure::includeDepth(HeaderID Root) const {
   return Result;
 }
 
+void IncludeStructure::mergeIncludeGraph(const IncludeStructure &Other) {
+  // Translate Other's HeaderIDs into ours. The main file is HeaderID 0 in both.
+  std::vector<HeaderID> Translated(Other.RealPathNames.size(), MainFileID);
+  for (const auto &[UID, OtherID] : Other.UIDToIndex) {
+    auto R = UIDToIndex.try_emplace(
+        UID, static_cast<IncludeStructure::HeaderID>(RealPathNames.size()));
+    if (R.second)
+      RealPathNames.emplace_back();
+    std::string &RealPathName =
+        RealPathNames[static_cast<unsigned>(R.first->second)];
+    if (RealPathName.empty())
+      RealPathName = Other.getRealPath(OtherID).str();
+    Translated[static_cast<unsigned>(OtherID)] = R.first->second;
+  }
+  if (RealPathNames.front().empty())
+    RealPathNames.front() = Other.RealPathNames.front();
+
+  for (const auto &[Parent, Children] : Other.IncludeChildren) {
+    auto &Merged = IncludeChildren[Translated[static_cast<unsigned>(Parent)]];
+    for (HeaderID Child : Children) {
+      HeaderID ID = Translated[static_cast<unsigned>(Child)];
+      if (!llvm::is_contained(Merged, ID))
+        Merged.push_back(ID);
+    }
+  }
+  for (const auto &[Header, IDs] : Other.StdlibHeaders) {
+    auto &Merged = StdlibHeaders[Header];
+    for (HeaderID OtherID : IDs) {
+      HeaderID ID = Translated[static_cast<unsigned>(OtherID)];
+      if (!llvm::is_contained(Merged, ID))
+        Merged.push_back(ID);
+    }
+  }
+}
+
 llvm::SmallVector<const Inclusion *>
 IncludeStructure::mainFileIncludesWithSpelling(llvm::StringRef Spelling) const {
   llvm::SmallVector<const Inclusion *> Includes;
@@ -167,6 +167,11 @@ public:
   llvm::DenseMap<HeaderID, unsigned>
   includeDepth(HeaderID Root = MainFileID) const;
 
+  // Adds the include graph and stdlib headers recorded in \p Other, e.g. by a
+  // preamble this one was chained on. HeaderIDs are matched by UniqueID.
+  // MainFileIncludes are not merged.
+  void mergeIncludeGraph(const IncludeStructure &Other);
+
   // Maps HeaderID to the ids of the files included from it.
   llvm::DenseMap<HeaderID, SmallVector<HeaderID>> IncludeChildren;
 
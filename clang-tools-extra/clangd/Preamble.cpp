@@ -108,6 +108,8 @@ public:
 
   bool isMainFileIncludeGuarded() const { return IsMainFileIncludeGuarded; }
 
+  bool includesAreGuarded() const { return IncludesAreGuarded; }
+
   void AfterExecute(CompilerInstance &CI) override {
     // As part of the Preamble compilation, ASTConsumer
     // PrecompilePreambleConsumer/PCHGenerator is setup. This would be called
@@ -123,9 +125,15 @@ public:
 
     const SourceManager &SM = CI.getSourceManager();
     OptionalFileEntryRef MainFE = SM.getFileEntryRefForID(SM.getMainFileID());
-    IsMainFileIncludeGuarded =
-        CI.getPreprocessor().getHeaderSearchInfo().isFileMultipleIncludeGuarded(
-            *MainFE);
+    HeaderSearch &HS = CI.getPreprocessor().getHeaderSearchInfo();
+    IsMainFileIncludeGuarded = HS.isFileMultipleIncludeGuarded(*MainFE);
+    IncludesAreGuarded = llvm::all_of(
+        Includes.MainFileIncludes, [&](const Inclusion &Inc) {
+          if (Inc.Resolved.empty() || Inc.Directive == tok::pp_import)
+            return true;
+          auto FE = CI.getFileManager().getOptionalFileRef(Inc.Resolved);
+          return FE && HS.isFileMultipleIncludeGuarded(*FE);
+        });
 
     if (Stats) {
       const ASTContext &AST = CI.getASTContext();
@@ -219,6 +227,7 @@ private:
   MainFileMacros Macros;
   std::vector<PragmaMark> Marks;
   bool IsMainFileIncludeGuarded = false;
+  bool IncludesAreGuarded = false;
   const clang::LangOptions *LangOpts = nullptr;
   const SourceManager *SourceMgr = nullptr;
   const Preprocessor *PP = nullptr;
@@ -585,13 +594,55 @@ public:
     return NewD;
   }
 };
+
+// Chaining re-parses the whole preamble region on top of the baseline PCH, and
+// relies on include guards to skip the headers that PCH already contains. Keep
+// chains short, every link is an extra PCH to load.
+constexpr unsigned MaxPreambleChainLength = 4;
+
+bool canChainPreamble(const PreambleData &Base, const CompilerInvocation &CI,
+                      const ParseInputs &Inputs,
+                      const llvm::MemoryBuffer &Contents,
+                      const PreambleBounds &Bounds, llvm::vfs::FileSystem &VFS,
+                      bool StoreInMemory) {
+  // In-memory preambles all live at the same path, and a chained PCH refers to
+  // its base by path.
+  if (StoreInMemory || Base.ChainLength >= MaxPreambleChainLength ||
+      !Base.IncludesAreGuarded || Base.RequiredModules)
+    return false;
+  const auto &PPOpts = CI.getPreprocessorOpts();
+  if (!PPOpts.Includes.empty() || !PPOpts.ImplicitPCHInclude.empty())
+    return false;
+  auto BaseBounds = Base.Preamble.getBounds();
+  return BaseBounds.PreambleEndsAtStartOfLine &&
+         BaseBounds.Size < Bounds.Size &&
+         compileCommandsAreEqual(Inputs.CompileCommand, Base.CompileCommand) &&
+         Base.Preamble.CanReuse(CI, Contents, BaseBounds, VFS);
+}
+
+// Diagnostics coming from headers of the base preamble are not reproduced when
+// building on top of it, carry them over.
+std::vector<Diag> mergeChainedDiags(llvm::ArrayRef<Diag> BaseDiags,
+                                    std::vector<Diag> Diags) {
+  std::vector<Diag> Result;
+  Result.reserve(BaseDiags.size() + Diags.size());
+  for (const Diag &D : BaseDiags) {
+    if (llvm::none_of(Diags, [&](const Diag &Other) {
+          return D.Range == Other.Range && D.Message == Other.Message;
+        }))
+      Result.push_back(D);
+  }
+  llvm::append_range(Result, std::move(Diags));
+  return Result;
+}
 } // namespace
 
 std::shared_ptr<const PreambleData>
 buildPreamble(PathRef FileName, CompilerInvocation CI,
               const ParseInputs &Inputs, bool StoreInMemory,
               PreambleParsedCallback PreambleCallback,
-              PreambleBuildStats *Stats) {
+              PreambleBuildStats *Stats,
+              std::shared_ptr<const PreambleData> Baseline) {
   // Note that we don't need to copy the input contents, preamble can live
   // without those.
   auto ContentsBuffer =
@@ -646,6 +697,32 @@ buildPreamble(PathRef FileName, CompilerInvocation CI,
   // to read back. We rely on dynamic index for the comments instead.
   CI.getPreprocessorOpts().WriteCommentListToPCH = false;
 
+  // Build on top of the baseline preamble if it covers a prefix of ours. The
+  // PCH we produce is then chained on the baseline PCH and only contains the
+  // declarations of the headers that are new.
+  std::shared_ptr<const PreambleData> ChainedBase;
+  if (Baseline && Inputs.Opts.ChainPreambles &&
+      canChainPreamble(*Baseline, CI, Inputs, *ContentsBuffer, Bounds, *VFS,
+                       StoreInMemory)) {
+    CompilerInvocation BaseCI(CI);
+    auto BaseVFS = VFS;
+    auto MainBuffer =
+        llvm::MemoryBuffer::getMemBufferCopy(Inputs.Contents, FileName);
+    Baseline->Preamble.AddImplicitPreamble(BaseCI, BaseVFS, MainBuffer.get());
+    // The preamble is going to be used with the VFS from ParseInputs, the base
+    // PCH must be visible through it without an overlay.
+    if (BaseVFS == VFS) {
+      auto &PPOpts = CI.getPreprocessorOpts();
+      const auto &BasePPOpts = BaseCI.getPreprocessorOpts();
+      PPOpts.ImplicitPCHInclude = BasePPOpts.ImplicitPCHInclude;
+      PPOpts.DisablePCHOrModuleValidation =
+          BasePPOpts.DisablePCHOrModuleValidation;
+      ChainedBase = std::move(Baseline);
+      vlog("Chaining preamble for {0} version {1} on version {2}", FileName,
+           Inputs.Version, ChainedBase->Version);
+    }
+  }
+
   CppFilePreambleCallbacks CapturedInfo(
       FileName, Stats, Inputs.Opts.PreambleParseForwardingFunctions,
       [&ASTListeners](CompilerInstance &CI) {
@@ -695,6 +772,18 @@ buildPreamble(PathRef FileName, CompilerInvocation CI,
     Result->CompileCommand = Inputs.CompileCommand;
     Result->Diags = std::move(Diags);
     Result->Includes = CapturedInfo.takeIncludes();
+    Result->IncludesAreGuarded = CapturedInfo.includesAreGuarded();
+    if (ChainedBase) {
+      // Headers of the base preamble were skipped, take their include graph
+      // and diagnostics from it.
+      // FIXME: IWYU pragmas in those headers are not recorded again.
+      Result->Includes.mergeIncludeGraph(ChainedBase->Includes);
+      Result->Diags =
+          mergeChainedDiags(ChainedBase->Diags, std::move(Result->Diags));
+      Result->IncludesAreGuarded &= ChainedBase->IncludesAreGuarded;
+      Result->ChainLength = ChainedBase->ChainLength + 1;
+      Result->ChainedBase = std::move(ChainedBase);
+    }
     Result->Pragmas = std::make_shared<const include_cleaner::PragmaIncludes>(
         CapturedInfo.takePragmaIncludes());
 
@@ -742,6 +831,26 @@ buildPreamble(PathRef FileName, CompilerInvocation CI,
   return nullptr;
 }
 
+// Checks that the preamble region is unchanged and none of the headers it
+// depends on changed.
+static bool canReusePreamble(const PreambleData &Preamble,
+                             const CompilerInvocation &CI,
+                             const llvm::MemoryBuffer &Contents,
+                             const PreambleBounds &Bounds,
+                             llvm::vfs::FileSystem &VFS) {
+  if (!Preamble.Preamble.CanReuse(CI, Contents, Bounds, VFS))
+    return false;
+  // A chained preamble only tracks the headers it parsed itself, the ones it
+  // skipped are dependencies of its bases.
+  for (const PreambleData *Base = Preamble.ChainedBase.get(); Base;
+       Base = Base->ChainedBase.get()) {
+    if (!Base->Preamble.CanReuse(CI, Contents, Base->Preamble.getBounds(),
+                                 VFS))
+      return false;
+  }
+  return true;
+}
+
 bool isPreambleCompatible(const PreambleData &Preamble,
                           const ParseInputs &Inputs, PathRef FileName,
                           const CompilerInvocation &CI) {
@@ -751,11 +860,31 @@ bool isPreambleCompatible(const PreambleData &Preamble,
   auto VFS = Inputs.TFS->view(Inputs.CompileCommand.Directory);
   return compileCommandsAreEqual(Inputs.CompileCommand,
                                  Preamble.CompileCommand) &&
-         Preamble.Preamble.CanReuse(CI, *ContentsBuffer, Bounds, *VFS) &&
+         canReusePreamble(Preamble, CI, *ContentsBuffer, Bounds, *VFS) &&
          (!Preamble.RequiredModules ||
           Preamble.RequiredModules->canReuse(CI, VFS));
 }
 
+bool isPreambleShareable(const PreambleData &Preamble) {
+  // Locations of anything declared in the preamble region point into the file
+  // the preamble was built for, only share preambles where that can't be
+  // observed: no diagnostics, macro definitions or pragma marks.
+  return Preamble.Diags.empty() && Preamble.Macros.Names.empty() &&
+         Preamble.Marks.empty() && !Preamble.RequiredModules;
+}
+
+bool isSharedPreambleCompatible(const PreambleData &Preamble,
+                                const ParseInputs &Inputs, PathRef FileName,
+                                const CompilerInvocation &CI) {
+  if (!isPreambleShareable(Preamble))
+    return false;
+  auto ContentsBuffer =
+      llvm::MemoryBuffer::getMemBuffer(Inputs.Contents, FileName);
+  auto Bounds = ComputePreambleBounds(CI.getLangOpts(), *ContentsBuffer, 0);
+  auto VFS = Inputs.TFS->view(Inputs.CompileCommand.Directory);
+  return canReusePreamble(Preamble, CI, *ContentsBuffer, Bounds, *VFS);
+}
+
 void escapeBackslashAndQuotes(llvm::StringRef Text, llvm::raw_ostream &OS) {
   for (char C : Text) {
     switch (C) {
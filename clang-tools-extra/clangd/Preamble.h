@@ -125,6 +125,14 @@ struct PreambleData {
   // Whether there was a (possibly-incomplete) include-guard on the main file.
   // We need to propagate this information "by hand" to subsequent parses.
   bool MainIsIncludeGuarded = false;
+  // Whether every header included from the preamble region is include-guarded,
+  // so that re-parsing the region on top of this preamble skips them.
+  bool IncludesAreGuarded = false;
+  // The preamble this one was chained on, if any. The PCH of this preamble
+  // refers to the PCH of ChainedBase, which must be kept alive.
+  std::shared_ptr<const PreambleData> ChainedBase;
+  // Number of PCHs in the chain, including this one.
+  unsigned ChainLength = 1;
 };
 
 using PreambleParsedCallback =
@@ -153,11 +161,16 @@ struct PreambleBuildStats {
 /// If \p PreambleCallback is set, it will be run on top of the AST while
 /// building the preamble.
 /// If Stats is not non-null, build statistics will be exported there.
+/// If \p Baseline is set and Inputs.Opts.ChainPreambles is true, the new
+/// preamble is built on top of Baseline when the preamble region of Baseline
+/// is an unchanged prefix of the new one. Only the remaining directives are
+/// parsed and serialized then.
 std::shared_ptr<const PreambleData>
 buildPreamble(PathRef FileName, CompilerInvocation CI,
               const ParseInputs &Inputs, bool StoreInMemory,
               PreambleParsedCallback PreambleCallback,
-              PreambleBuildStats *Stats = nullptr);
+              PreambleBuildStats *Stats = nullptr,
+              std::shared_ptr<const PreambleData> Baseline = nullptr);
 
 /// Returns true if \p Preamble is reusable for \p Inputs. Note that it will
 /// return true when some missing headers are now available.
@@ -167,6 +180,18 @@ bool isPreambleCompatible(const PreambleData &Preamble,
                           const ParseInputs &Inputs, PathRef FileName,
                           const CompilerInvocation &CI);
 
+/// Returns true if \p Preamble can be used as is by other files that have the
+/// same preamble region and compile flags, i.e. it holds nothing specific to
+/// the file it was built for.
+bool isPreambleShareable(const PreambleData &Preamble);
+
+/// Returns true if \p Preamble, built for a file with the same preamble region
+/// and compile flags as \p FileName, can be used for \p Inputs. The caller is
+/// responsible for matching the compile flags.
+bool isSharedPreambleCompatible(const PreambleData &Preamble,
+                                const ParseInputs &Inputs, PathRef FileName,
+                                const CompilerInvocation &CI);
+
 /// Stores information required to parse a TU using a (possibly stale) Baseline
 /// preamble. Later on this information can be injected into the main file by
 /// updating compiler invocation with \c apply. This injected section
@@ -77,6 +77,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -343,6 +344,74 @@ public:
   }
 };
 
+/// Preambles of open files, keyed by a hash of their preamble region, compile
+/// command and directory. Files that would build the same preamble use the one
+/// in the cache instead.
+///
+/// The cache doesn't own the preambles: an entry lives as long as some file
+/// uses its preamble, and is dropped once all of them moved on to another one
+/// or were closed.
+///
+/// All methods are threadsafe, update() and get() are called from preamble
+/// threads.
+class TUScheduler::SharedPreambleCache {
+public:
+  /// Identifies the preamble that would be built for \p Inputs.
+  static std::string key(PathRef FileName, const ParseInputs &Inputs,
+                         const CompilerInvocation &CI) {
+    const tooling::CompileCommand &Cmd = Inputs.CompileCommand;
+    llvm::SHA1 Hasher;
+    auto Add = [&](llvm::StringRef S) {
+      Hasher.update(S);
+      Hasher.update(llvm::ArrayRef<uint8_t>{0});
+    };
+    Add(Cmd.Directory);
+    // Quoted includes are looked up next to the including file first.
+    Add(llvm::sys::path::parent_path(FileName));
+    // The language depends on the extension unless it is spelled out.
+    Add(llvm::sys::path::extension(FileName));
+    for (size_t I = 0, E = Cmd.CommandLine.size(); I < E; ++I) {
+      llvm::StringRef Arg = Cmd.CommandLine[I];
+      // The output and the file itself differ between otherwise identical
+      // commands.
+      if (Arg == "-o") {
+        ++I;
+        continue;
+      }
+      Add(Arg == Cmd.Filename || Arg == FileName ? "<main-file>" : Arg);
+    }
+    auto Contents = llvm::MemoryBuffer::getMemBuffer(Inputs.Contents, FileName);
+    auto Bounds = ComputePreambleBounds(CI.getLangOpts(), *Contents, 0);
+    Add(llvm::StringRef(Inputs.Contents).take_front(Bounds.Size));
+    Add(Bounds.PreambleEndsAtStartOfLine ? "1" : "0");
+    return llvm::toHex(Hasher.result());
+  }
+
+  std::shared_ptr<const PreambleData> get(llvm::StringRef Key) const {
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto It = Preambles.find(Key);
+    if (It == Preambles.end())
+      return nullptr;
+    return It->second.lock();
+  }
+
+  void update(llvm::StringRef Key,
+              std::shared_ptr<const PreambleData> Preamble) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    // Forget the preambles no file uses anymore.
+    for (auto It = Preambles.begin(), E = Preambles.end(); It != E;) {
+      auto Current = It++;
+      if (Current->second.expired())
+        Preambles.erase(Current);
+    }
+    Preambles[Key] = std::move(Preamble);
+  }
+
+private:
+  llvm::StringMap<std::weak_ptr<const PreambleData>> Preambles;
+  mutable std::mutex Mu;
+};
+
 namespace {
 
 bool isReliable(const tooling::CompileCommand &Cmd) {
@@ -431,11 +500,12 @@ public:
                  bool StorePreambleInMemory, bool RunSync,
                  PreambleThrottler *Throttler, SynchronizedTUStatus &Status,
                  TUScheduler::HeaderIncluderCache &HeaderIncluders,
+                 TUScheduler::SharedPreambleCache *SharedPreambles,
                  ASTWorker &AW)
       : FileName(FileName), Callbacks(Callbacks),
         StoreInMemory(StorePreambleInMemory), RunSync(RunSync),
         Throttler(Throttler), Status(Status), ASTPeer(AW),
-        HeaderIncluders(HeaderIncluders) {}
+        HeaderIncluders(HeaderIncluders), SharedPreambles(SharedPreambles) {}
 
   /// It isn't guaranteed that each requested version will be built. If there
   /// are multiple update requests while building a preamble, only the last one
@@ -589,6 +659,7 @@ private:
   SynchronizedTUStatus &Status;
   ASTWorker &ASTPeer;
   TUScheduler::HeaderIncluderCache &HeaderIncluders;
+  TUScheduler::SharedPreambleCache *SharedPreambles; // nullptr if disabled
 };
 
 class ASTWorkerHandle;
@@ -608,6 +679,7 @@ class ASTWorker {
   ASTWorker(PathRef FileName, const GlobalCompilationDatabase &CDB,
             TUScheduler::ASTCache &LRUCache,
             TUScheduler::HeaderIncluderCache &HeaderIncluders,
+            TUScheduler::SharedPreambleCache *SharedPreambles,
             Semaphore &Barrier, bool RunSync, const TUScheduler::Options &Opts,
             ParsingCallbacks &Callbacks);
 
@@ -621,6 +693,7 @@ public:
   create(PathRef FileName, const GlobalCompilationDatabase &CDB,
          TUScheduler::ASTCache &IdleASTs,
          TUScheduler::HeaderIncluderCache &HeaderIncluders,
+         TUScheduler::SharedPreambleCache *SharedPreambles,
          AsyncTaskRunner *Tasks, Semaphore &Barrier,
          const TUScheduler::Options &Opts, ParsingCallbacks &Callbacks);
   ~ASTWorker();
@@ -815,12 +888,13 @@ ASTWorkerHandle
 ASTWorker::create(PathRef FileName, const GlobalCompilationDatabase &CDB,
                   TUScheduler::ASTCache &IdleASTs,
                   TUScheduler::HeaderIncluderCache &HeaderIncluders,
+                  TUScheduler::SharedPreambleCache *SharedPreambles,
                   AsyncTaskRunner *Tasks, Semaphore &Barrier,
                   const TUScheduler::Options &Opts,
                   ParsingCallbacks &Callbacks) {
   std::shared_ptr<ASTWorker> Worker(
-      new ASTWorker(FileName, CDB, IdleASTs, HeaderIncluders, Barrier,
-                    /*RunSync=*/!Tasks, Opts, Callbacks));
+      new ASTWorker(FileName, CDB, IdleASTs, HeaderIncluders, SharedPreambles,
+                    Barrier, /*RunSync=*/!Tasks, Opts, Callbacks));
   if (Tasks) {
     Tasks->runAsync("ASTWorker:" + llvm::sys::path::filename(FileName),
                     [Worker]() { Worker->run(); });
@@ -834,6 +908,7 @@ ASTWorker::create(PathRef FileName, const GlobalCompilationDatabase &CDB,
 ASTWorker::ASTWorker(PathRef FileName, const GlobalCompilationDatabase &CDB,
                      TUScheduler::ASTCache &LRUCache,
                      TUScheduler::HeaderIncluderCache &HeaderIncluders,
+                     TUScheduler::SharedPreambleCache *SharedPreambles,
                      Semaphore &Barrier, bool RunSync,
                      const TUScheduler::Options &Opts,
                      ParsingCallbacks &Callbacks)
@@ -842,7 +917,8 @@ ASTWorker::ASTWorker(PathRef FileName, const GlobalCompilationDatabase &CDB,
       ContextProvider(Opts.ContextProvider), CDB(CDB), Callbacks(Callbacks),
       Barrier(Barrier), Done(false), Status(FileName, Callbacks),
       PreamblePeer(FileName, Callbacks, Opts.StorePreamblesInMemory, RunSync,
-                   Opts.PreambleThrottler, Status, HeaderIncluders, *this) {
+                   Opts.PreambleThrottler, Status, HeaderIncluders,
+                   SharedPreambles, *this) {
   // Set a fallback command because compile command can be accessed before
   // `Inputs` is initialized. Other fields are only used after initialization
   // from client inputs.
@@ -1079,6 +1155,28 @@ void PreambleThread::build(Request Req) {
          FileName, Inputs.Version, LatestBuild->Version);
   }
 
+  std::string SharedKey;
+  if (SharedPreambles) {
+    SharedKey =
+        TUScheduler::SharedPreambleCache::key(FileName, Inputs, *Req.CI);
+    std::shared_ptr<const PreambleData> Shared;
+    if (!Inputs.ForceRebuild)
+      Shared = SharedPreambles->get(SharedKey);
+    if (Shared &&
+        isSharedPreambleCompatible(*Shared, Inputs, FileName, *Req.CI)) {
+      vlog("Using preamble version {0} of {1} for version {2} of {3}",
+           Shared->Version, Shared->CompileCommand.Filename, Inputs.Version,
+           FileName);
+      ReusedPreamble = Shared == LatestBuild;
+      LatestBuild = std::move(Shared);
+      // The first entry is the file the preamble was built for.
+      if (!ReusedPreamble && isReliable(Inputs.CompileCommand))
+        HeaderIncluders.update(FileName,
+                               LatestBuild->Includes.allHeaders().drop_front());
+      return;
+    }
+  }
+
   ThreadCrashReporter ScopedReporter([&Inputs]() {
     llvm::errs() << "Signalled while building preamble\n";
     crashDumpParseInputs(llvm::errs(), Inputs);
@@ -1093,12 +1191,14 @@ void PreambleThread::build(Request Req) {
         Callbacks.onPreambleAST(FileName, Inputs.Version, std::move(ASTCtx),
                                 std::move(PI));
       },
-      &Stats);
+      &Stats, Inputs.ForceRebuild ? nullptr : LatestBuild);
   if (!LatestBuild)
     return;
   reportPreambleBuild(Stats, IsFirstPreamble);
   if (isReliable(LatestBuild->CompileCommand))
     HeaderIncluders.update(FileName, LatestBuild->Includes.allHeaders());
+  if (SharedPreambles && isPreambleShareable(*LatestBuild))
+    SharedPreambles->update(SharedKey, LatestBuild);
 }
 
 void ASTWorker::updatePreamble(std::unique_ptr<CompilerInvocation> CI,
@@ -1637,7 +1737,10 @@ TUScheduler::TUScheduler(const GlobalCompilationDatabase &CDB,
       Barrier(Opts.AsyncThreadsCount), QuickRunBarrier(Opts.AsyncThreadsCount),
       IdleASTs(
           std::make_unique<ASTCache>(Opts.RetentionPolicy.MaxRetainedASTs)),
-      HeaderIncluders(std::make_unique<HeaderIncluderCache>()) {
+      HeaderIncluders(std::make_unique<HeaderIncluderCache>()),
+      SharedPreambles(Opts.SharePreambles
+                          ? std::make_unique<SharedPreambleCache>()
+                          : nullptr) {
   // Avoid null checks everywhere.
   if (!Opts.ContextProvider) {
     this->Opts.ContextProvider = [](llvm::StringRef) {
@@ -1679,7 +1782,7 @@ bool TUScheduler::update(PathRef File, ParseInputs Inputs,
   if (!FD) {
     // Create a new worker to process the AST-related tasks.
     ASTWorkerHandle Worker = ASTWorker::create(
-        File, CDB, *IdleASTs, *HeaderIncluders,
+        File, CDB, *IdleASTs, *HeaderIncluders, SharedPreambles.get(),
         WorkerThreads ? &*WorkerThreads : nullptr, Barrier, Opts, *Callbacks);
     FD = std::unique_ptr<FileData>(
         new FileData{Inputs.Contents, std::move(Worker)});
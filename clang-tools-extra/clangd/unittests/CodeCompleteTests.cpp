@@ -2953,6 +2953,54 @@ TEST(CompletionTest, EnableSpeculativeIndexRequest) {
   ASSERT_EQ(Reqs3.size(), 2u);
 }
 
+TEST(CompletionTest, RefilterCachedCompletions) {
+  MockFS FS;
+  auto TU = TestTU::withCode("");
+  auto Inputs = TU.inputs(FS);
+  IgnoreDiagnostics Diags;
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  ASSERT_TRUE(CI);
+  auto Preamble = buildPreamble(testPath(TU.Filename), *CI, Inputs,
+                                /*InMemory=*/true, /*Callback=*/nullptr);
+  ASSERT_TRUE(Preamble);
+
+  CompletionRefilterCache Cache;
+  auto CompleteAt = [&](llvm::StringRef Text) {
+    Annotations Test(Text);
+    Inputs.Contents = Test.code().str();
+    Cache.New = nullptr;
+    auto Result = codeComplete(testPath(TU.Filename), Test.point(),
+                               Preamble.get(), Inputs, {}, nullptr, &Cache);
+    return Result.Completions;
+  };
+
+  EXPECT_THAT(CompleteAt(R"cpp(
+      int fooBar, fooBaz, fooQux;
+      int x = fo^;
+  )cpp"),
+              UnorderedElementsAre(named("fooBar"), named("fooBaz"),
+                                   named("fooQux")));
+  ASSERT_TRUE(Cache.New);
+  Cache.Cached = Cache.New;
+
+  // Typing more of the identifier refilters the snapshot.
+  EXPECT_THAT(CompleteAt(R"cpp(
+      int fooBar, fooBaz, fooQux;
+      int x = fooba^;
+  )cpp"),
+              UnorderedElementsAre(named("fooBar"), named("fooBaz")));
+  EXPECT_EQ(Cache.New, Cache.Cached);
+
+  // Edits outside of the identifier run a full completion.
+  EXPECT_THAT(CompleteAt(R"cpp(
+      int fooBar, fooBaz, fooQux, fooBat;
+      int x = fooba^;
+  )cpp"),
+              UnorderedElementsAre(named("fooBar"), named("fooBaz"),
+                                   named("fooBat")));
+  EXPECT_NE(Cache.New, Cache.Cached);
+}
+
 TEST(CompletionTest, InsertTheMostPopularHeader) {
   std::string DeclFile = URI::create(testPath("foo")).toString();
   Symbol Sym = func("Func");
@@ -20,14 +20,18 @@
 #include "TestTU.h"
 #include "XRefs.h"
 #include "support/Context.h"
+#include "support/ThreadsafeFS.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Format/Format.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Frontend/PrecompiledPreamble.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/ScopedPrinter.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Testing/Annotations/Annotations.h"
@@ -897,6 +901,76 @@ TEST(PreamblePatch, PatchFileEntry) {
   }
 }
 
+TEST(PreambleTest, ChainsOnBaseline) {
+  // Chained PCHs refer to their base by path, so they need to be on disk.
+  llvm::SmallString<128> Dir;
+  ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("preamble-chain", Dir));
+  auto Cleanup =
+      llvm::make_scope_exit([&] { llvm::sys::fs::remove_directories(Dir); });
+  auto WriteFile = [&](llvm::StringRef Name, llvm::StringRef Contents) {
+    llvm::SmallString<128> Path(Dir);
+    llvm::sys::path::append(Path, Name);
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Path, EC);
+    ASSERT_FALSE(EC);
+    OS << Contents;
+  };
+  WriteFile("a.h", "#pragma once\nint a();\n");
+  WriteFile("b.h", "#ifndef B_H\n#define B_H\nint b();\n#endif\n");
+  WriteFile("c.h", "int c();\n");
+  llvm::SmallString<128> MainFile(Dir);
+  llvm::sys::path::append(MainFile, "main.cpp");
+
+  RealThreadsafeFS FS;
+  ParseInputs Inputs;
+  Inputs.TFS = &FS;
+  Inputs.CompileCommand.Directory = Dir.str().str();
+  Inputs.CompileCommand.Filename = MainFile.str().str();
+  Inputs.CompileCommand.CommandLine = {"clang", MainFile.str().str()};
+  Inputs.Opts.ChainPreambles = true;
+  IgnoreDiagnostics Diags;
+  auto Build = [&](llvm::StringRef Contents,
+                   std::shared_ptr<const PreambleData> Baseline) {
+    Inputs.Contents = Contents.str();
+    auto CI = buildCompilerInvocation(Inputs, Diags);
+    EXPECT_TRUE(CI);
+    return buildPreamble(MainFile, *CI, Inputs, /*StoreInMemory=*/false,
+                         /*PreambleCallback=*/nullptr, /*Stats=*/nullptr,
+                         std::move(Baseline));
+  };
+
+  auto Base = Build("#include \"a.h\"\nint x = a();\n", nullptr);
+  ASSERT_TRUE(Base);
+  EXPECT_FALSE(Base->ChainedBase);
+  EXPECT_TRUE(Base->IncludesAreGuarded);
+
+  llvm::StringLiteral Appended =
+      "#include \"a.h\"\n#include \"b.h\"\nint x = a() + b();\n";
+  auto Chained = Build(Appended, Base);
+  ASSERT_TRUE(Chained);
+  EXPECT_EQ(Chained->ChainedBase, Base);
+  EXPECT_EQ(Chained->ChainLength, 2u);
+  EXPECT_THAT(Chained->Includes.MainFileIncludes,
+              ElementsAre(Field(&Inclusion::Written, "\"a.h\""),
+                          Field(&Inclusion::Written, "\"b.h\"")));
+  EXPECT_TRUE(isPreambleCompatible(*Chained, Inputs, MainFile,
+                                   *buildCompilerInvocation(Inputs, Diags)));
+
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  auto AST = ParsedAST::build(MainFile, Inputs, std::move(CI), {}, Chained);
+  ASSERT_TRUE(AST);
+  EXPECT_THAT(AST->getDiagnostics(), IsEmpty());
+
+  // Changing the prefix, or including unguarded headers, builds from scratch.
+  EXPECT_FALSE(Build("#include \"b.h\"\n#include \"a.h\"\n", Base)
+                   ->ChainedBase);
+  auto Unguarded = Build("#include \"c.h\"\n", nullptr);
+  ASSERT_TRUE(Unguarded);
+  EXPECT_FALSE(Unguarded->IncludesAreGuarded);
+  EXPECT_FALSE(
+      Build("#include \"c.h\"\n#include \"a.h\"\n", Unguarded)->ChainedBase);
+}
+
 } // namespace
 } // namespace clangd
 } // namespace clang
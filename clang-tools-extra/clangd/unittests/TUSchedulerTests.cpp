@@ -713,6 +713,93 @@ TEST_F(TUSchedulerTests, EmptyPreamble) {
       });
 }
 
+TEST_F(TUSchedulerTests, SharedPreamble) {
+  auto Opts = optsForTest();
+  Opts.SharePreambles = true;
+  TUScheduler S(CDB, Opts, captureDiags());
+
+  auto Foo = testPath("foo.cpp");
+  auto Bar = testPath("bar.cpp");
+  auto Baz = testPath("baz.cpp");
+  auto Qux = testPath("sub/qux.cpp");
+  FS.Files[testPath("foo.h")] = "void foo();";
+  FS.Files[testPath("bar.h")] = "void bar();";
+  FS.Files[testPath("sub/foo.h")] = "void subFoo();";
+  // Run every compile from the same directory, so that only the directory of
+  // the file tells Qux apart from Foo.
+  auto Inputs = [&](PathRef File, std::string Contents) {
+    ParseInputs Result = getInputs(File, std::move(Contents));
+    Result.CompileCommand.Directory = testRoot();
+    return Result;
+  };
+  auto GetPreamble = [&](PathRef File) {
+    const PreambleData *Result = nullptr;
+    S.runWithPreamble("GetPreamble", File, TUScheduler::Consistent,
+                      [&](Expected<InputsAndPreamble> IP) {
+                        ASSERT_TRUE(bool(IP));
+                        Result = IP->Preamble;
+                      });
+    EXPECT_TRUE(S.blockUntilIdle(timeoutSeconds(60)));
+    return Result;
+  };
+  auto TopLevelDecls = [&](PathRef File) {
+    std::vector<std::string> Names;
+    S.runWithAST("TopLevelDecls", File, [&](Expected<InputsAndAST> AST) {
+      ASSERT_TRUE(bool(AST));
+      for (const Decl *D : AST->AST.getLocalTopLevelDecls())
+        if (const auto *ND = dyn_cast<NamedDecl>(D))
+          Names.push_back(ND->getNameAsString());
+    });
+    EXPECT_TRUE(S.blockUntilIdle(timeoutSeconds(60)));
+    return Names;
+  };
+
+  S.update(Foo, Inputs(Foo, "#include \"foo.h\"\nint x = 1;"),
+           WantDiagnostics::Auto);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(60)));
+  std::atomic<size_t> DiagCount(0);
+  // Bar's AST is built on Foo's preamble, and its own diagnostics are
+  // reported.
+  updateWithDiags(S, Bar,
+                  Inputs(Bar, "#include \"foo.h\"\nint y = 2;\n"
+                              "void g() { foo(); bar(); }"),
+                  WantDiagnostics::Yes, [&](std::vector<Diag> Diags) {
+                    ++DiagCount;
+                    EXPECT_THAT(Diags,
+                                ElementsAre(Field(
+                                    &Diag::Message,
+                                    "use of undeclared identifier 'bar'")));
+                  });
+  S.update(Baz, Inputs(Baz, "#include \"bar.h\"\nint z = 3;"),
+           WantDiagnostics::Auto);
+  // Qux has the same preamble text and command as Foo, but its quoted include
+  // finds sub/foo.h.
+  updateWithDiags(S, Qux,
+                  Inputs(Qux, "#include \"foo.h\"\nint x = 1;\n"
+                              "void h() { subFoo(); }"),
+                  WantDiagnostics::Yes, [&](std::vector<Diag> Diags) {
+                    ++DiagCount;
+                    EXPECT_THAT(Diags, IsEmpty());
+                  });
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(60)));
+  EXPECT_EQ(DiagCount, 2U);
+
+  const PreambleData *FooPreamble = GetPreamble(Foo);
+  ASSERT_TRUE(FooPreamble);
+  EXPECT_EQ(GetPreamble(Bar), FooPreamble);
+  EXPECT_NE(GetPreamble(Baz), FooPreamble);
+  EXPECT_NE(GetPreamble(Qux), FooPreamble);
+  EXPECT_THAT(TopLevelDecls(Bar), ElementsAre("y", "g"));
+  EXPECT_THAT(TopLevelDecls(Qux), ElementsAre("x", "h"));
+
+  // Once Foo moves on, Bar keeps the preamble alive.
+  S.update(Foo, Inputs(Foo, "#include \"bar.h\"\nint x = 1;"),
+           WantDiagnostics::Auto);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(60)));
+  EXPECT_EQ(GetPreamble(Bar), FooPreamble);
+  EXPECT_EQ(GetPreamble(Foo), GetPreamble(Baz));
+}
+
 TEST_F(TUSchedulerTests, ASTSignalsSmokeTests) {
   TUScheduler S(CDB, optsForTest());
   auto Foo = testPath("foo.cpp");
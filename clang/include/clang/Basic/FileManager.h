@@ -24,6 +24,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
@@ -101,6 +102,12 @@ class FileManager : public RefCountedBase<FileManager> {
   std::unique_ptr<llvm::StringMap<llvm::ErrorOr<FileEntryRef::MapValue>>>
       SeenBypassFileEntries;
 
+  /// The lowercased names of the entries of each real directory whose listing
+  /// has been read, or null if the directory could not be listed. Only used
+  /// when FileSystemOptions::CacheDirectoryListings is set.
+  llvm::DenseMap<const DirectoryEntry *, std::unique_ptr<llvm::StringSet<>>>
+      DirListings;
+
   /// The file entry for stdin, if it has been accessed through the FileManager.
   OptionalFileEntryRef STDIN;
 
@@ -119,6 +126,8 @@ class FileManager : public RefCountedBase<FileManager> {
   unsigned NumFileLookups = 0;
   unsigned NumDirCacheMisses = 0;
   unsigned NumFileCacheMisses = 0;
+  unsigned NumDirListings = 0;
+  unsigned NumListingMisses = 0;
 
   // Caching.
   std::unique_ptr<FileSystemStatCache> StatCache;
@@ -134,6 +143,15 @@ class FileManager : public RefCountedBase<FileManager> {
   /// Fills the RealPathName in file entry.
   void fillRealPathName(FileEntry *UFE, llvm::StringRef FileName);
 
+  /// Returns the listing of \p Dir, reading it if \p Read is true and it has
+  /// not been read yet. Returns null if there is no usable listing.
+  const llvm::StringSet<> *getDirListing(DirectoryEntryRef Dir, bool Read);
+
+  /// Returns true if the listing of \p Dir shows that it has no entry named
+  /// \p Name, so that looking it up can skip the stat call.
+  bool isMissingFromDirListing(DirectoryEntryRef Dir, StringRef Name,
+                               bool Read);
+
 public:
   /// Construct a file manager, optionally with a custom VFS.
   ///
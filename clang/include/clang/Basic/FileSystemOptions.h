@@ -24,6 +24,16 @@ public:
   /// If set, paths are resolved as if the working directory was
   /// set to the value of WorkingDir.
   std::string WorkingDir;
+
+  /// If set, the FileManager reads the listing of a directory the first time
+  /// it looks up a file in it, and answers later lookups of files that are
+  /// not listed without a stat call.
+  bool CacheDirectoryListings = false;
+
+  /// If non-empty, directory listings are also stored in this directory and
+  /// reused by other compilations until the listed directory's modification
+  /// time changes.
+  std::string DirectoryListingCachePath;
 };
 
 } // end namespace clang
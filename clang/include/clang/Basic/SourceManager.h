@@ -720,6 +720,18 @@ class SourceManager : public RefCountedBase<SourceManager> {
   /// expansion.
   SmallVector<SrcMgr::SLocEntry, 0> LocalSLocEntryTable;
 
+  /// The local SLoc address space is split into pages of
+  /// 2^LocalSLocPageBits offsets.
+  static constexpr unsigned LocalSLocPageBits = 10;
+
+  /// For each page of the local SLoc address space, the index of the
+  /// LocalSLocEntryTable entry that contains the start of the page.
+  ///
+  /// The entries containing an offset in page P are the ones between
+  /// LocalSLocPageIndex[P] and LocalSLocPageIndex[P + 1], so getFileIDLocal
+  /// only has to search those.
+  SmallVector<unsigned, 0> LocalSLocPageIndex;
+
   /// The table of SLocEntries that are loaded from other modules.
   ///
   /// Negative FileIDs are indexes into this table. To get from ID to an index,
@@ -1982,6 +1994,10 @@ private:
                                          SourceLocation ExpansionLoc,
                                          unsigned ExpansionLength) const;
   void updateSlocUsageStats() const;
+
+  /// Adds the pages that start in the last local SLocEntry to
+  /// LocalSLocPageIndex.
+  void indexLastLocalSLocEntry();
 };
 
 /// Comparison function object.
@@ -132,6 +132,18 @@ class Compilation {
   /// Whether to keep temporary files regardless of -save-temps.
   bool ForceKeepTempFiles = false;
 
+  /// Print \p C if requested by -v or CC_PRINT_OPTIONS.
+  /// \return false if the CC_PRINT_OPTIONS log could not be opened.
+  bool LogCommand(const Command &C) const;
+
+  /// Execute \p Jobs on up to \p NumThreads threads. A job starts once the
+  /// jobs it depends on have succeeded, and the output of each job is printed
+  /// in one piece, in job order.
+  void ExecuteJobsInParallel(
+      const JobList &Jobs,
+      SmallVectorImpl<std::pair<int, const Command *>> &FailingCommands,
+      unsigned NumThreads) const;
+
 public:
   Compilation(const Driver &D, const ToolChain &DefaultToolChain,
               llvm::opt::InputArgList *Args,
@@ -315,6 +327,8 @@ public:
 
   /// ExecuteJob - Execute a single job.
   ///
+  /// Independent jobs run concurrently when -fparallel-jobs= allows it.
+  ///
   /// \param FailingCommands - For non-zero results, this will be a vector of
   /// failing commands and their associated result code.
   /// \param LogOnly - When true, only tries to log the command, not actually
@@ -298,6 +298,10 @@ public:
   LLVM_PREFERRED_TYPE(bool)
   unsigned CCPrintInternalStats : 1;
 
+  /// The number of jobs the compilation may run concurrently, as set by
+  /// -fparallel-jobs=.
+  unsigned NumParallelJobs = 1;
+
   /// Pointer to the ExecuteCC1Tool function, if available.
   /// When the clangDriver lib is used through clang.exe, this provides a
   /// shortcut for executing the -cc1 command-line directly, in the same
@@ -29,6 +29,7 @@ namespace llvm {
 namespace orc {
 class LLJIT;
 class LLJITBuilder;
+class LLLazyJITBuilder;
 class ThreadSafeContext;
 } // namespace orc
 } // namespace llvm
@@ -79,6 +80,18 @@ private:
   llvm::StringRef CudaSDKPath;
 };
 
+/// Configures the JIT that executes the incremental inputs.
+struct JITConfig {
+  /// Compile functions on their first call instead of when the PTU defining
+  /// them is executed. This only applies to the JIT the interpreter creates
+  /// by default, not to one from a user-provided \c LLJITBuilder.
+  bool LazyCompilation = false;
+
+  /// The number of threads that compile lazily-called functions. If zero,
+  /// functions are compiled on the thread that calls them first.
+  unsigned NumCompileThreads = 0;
+};
+
 class IncrementalAction;
 class InProcessPrintingASTConsumer;
 
@@ -123,7 +136,8 @@ protected:
   // Derived classes can use an extended interface of the Interpreter.
   Interpreter(std::unique_ptr<CompilerInstance> Instance, llvm::Error &Err,
               std::unique_ptr<llvm::orc::LLJITBuilder> JITBuilder = nullptr,
-              std::unique_ptr<clang::ASTConsumer> Consumer = nullptr);
+              std::unique_ptr<clang::ASTConsumer> Consumer = nullptr,
+              JITConfig Config = {});
 
   // Create the internal IncrementalExecutor, or re-create it after calling
   // ResetExecutor().
@@ -136,7 +150,7 @@ protected:
 public:
   virtual ~Interpreter();
   static llvm::Expected<std::unique_ptr<Interpreter>>
-  create(std::unique_ptr<CompilerInstance> CI);
+  create(std::unique_ptr<CompilerInstance> CI, JITConfig Config = {});
   static llvm::Expected<std::unique_ptr<Interpreter>>
   createWithCUDA(std::unique_ptr<CompilerInstance> CI,
                  std::unique_ptr<CompilerInstance> DCI);
@@ -195,6 +209,10 @@ private:
   llvm::SmallVector<Expr *, 4> ValuePrintingInfo;
 
   std::unique_ptr<llvm::orc::LLJITBuilder> JITBuilder;
+
+  JITConfig JITConf;
+  /// Set instead of JITBuilder if the default JIT compiles lazily.
+  std::unique_ptr<llvm::orc::LLLazyJITBuilder> LazyJITBuilder;
 };
 } // namespace clang
 
@@ -23,11 +23,13 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <climits>
 #include <cstdint>
 #include <cstdlib>
@@ -176,6 +178,24 @@ FileManager::getDirectoryRef(StringRef DirName, bool CacheFailure) {
   // SeenDirEntries map.
   StringRef InterndDirName = NamedDirEnt.first();
 
+  // A directory missing from the listing of its parent cannot exist. Only use
+  // listings that have already been read; reading one for every ancestor
+  // would cost more than it saves.
+  if (CacheFailure && FileSystemOpts.CacheDirectoryListings &&
+      llvm::sys::path::has_parent_path(InterndDirName)) {
+    auto Parent =
+        SeenDirEntries.find(llvm::sys::path::parent_path(InterndDirName));
+    if (Parent != SeenDirEntries.end() && Parent->second &&
+        isMissingFromDirListing(DirectoryEntryRef(*Parent),
+                                llvm::sys::path::filename(InterndDirName),
+                                /*Read=*/false)) {
+      std::error_code Err =
+          make_error_code(std::errc::no_such_file_or_directory);
+      NamedDirEnt.second = Err;
+      return llvm::errorCodeToError(Err);
+    }
+  }
+
   // Check to see if the directory exists.
   llvm::vfs::Status Status;
   auto statError = getStatValue(InterndDirName, Status, false,
@@ -254,8 +274,16 @@ llvm::Expected<FileEntryRef> FileManager::getFileRef(StringRef Filename,
   }
   DirectoryEntryRef DirInfo = *DirInfoOrErr;
 
-  // FIXME: Use the directory info to prune this, before doing the stat syscall.
-  // FIXME: This will reduce the # syscalls.
+  // If the directory's listing shows that the file is not there, skip the
+  // stat. The listing does not see files created after it was read, so only
+  // use it for lookups whose failure would be cached anyway.
+  if (CacheFailure && FileSystemOpts.CacheDirectoryListings &&
+      isMissingFromDirListing(DirInfo, llvm::sys::path::filename(Filename),
+                              /*Read=*/true)) {
+    std::error_code Err = make_error_code(std::errc::no_such_file_or_directory);
+    NamedFileEnt->second = Err;
+    return llvm::errorCodeToError(Err);
+  }
 
   // Check to see if the file exists.
   std::unique_ptr<llvm::vfs::File> F;
@@ -577,6 +605,118 @@ FileManager::getBufferForFileImpl(StringRef Filename, int64_t FileSize,
                               isVolatile, IsText);
 }
 
+/// Reads the listing stored in \p CacheFile, if it was stored when the listed
+/// directory had the modification time \p ModTime.
+static std::unique_ptr<llvm::StringSet<>>
+readCachedDirListing(StringRef CacheFile, uint64_t ModTime) {
+  auto Buffer = llvm::MemoryBuffer::getFile(CacheFile);
+  if (!Buffer)
+    return nullptr;
+  auto [Header, Rest] = (*Buffer)->getBuffer().split('\n');
+  uint64_t CachedModTime;
+  if (!Header.consume_front("clang-dirlist-v1 ") ||
+      Header.getAsInteger(10, CachedModTime) || CachedModTime != ModTime)
+    return nullptr;
+  auto Listing = std::make_unique<llvm::StringSet<>>();
+  while (!Rest.empty()) {
+    StringRef Name;
+    std::tie(Name, Rest) = Rest.split('\n');
+    Listing->insert(Name);
+  }
+  return Listing;
+}
+
+static void writeCachedDirListing(StringRef CacheFile, uint64_t ModTime,
+                                  const llvm::StringSet<> &Listing) {
+  // Names are stored one per line.
+  if (llvm::any_of(Listing.keys(),
+                   [](StringRef Name) { return Name.contains('\n'); }))
+    return;
+  llvm::sys::fs::create_directories(llvm::sys::path::parent_path(CacheFile));
+  llvm::consumeError(
+      llvm::writeToOutput(CacheFile, [&](llvm::raw_ostream &OS) {
+        OS << "clang-dirlist-v1 " << ModTime << '\n';
+        for (StringRef Name : Listing.keys())
+          OS << Name << '\n';
+        return llvm::Error::success();
+      }));
+}
+
+const llvm::StringSet<> *FileManager::getDirListing(DirectoryEntryRef Dir,
+                                                    bool Read) {
+  auto Known = DirListings.find(&Dir.getDirEntry());
+  if (Known != DirListings.end())
+    return Known->second.get();
+  if (!Read)
+    return nullptr;
+  std::unique_ptr<llvm::StringSet<>> &Listing =
+      DirListings[&Dir.getDirEntry()];
+
+  SmallString<128> DirPath(Dir.getName());
+  FixupRelativePath(DirPath);
+
+  // Listings shared through the cache directory are keyed by the absolute
+  // path of the directory and valid as long as its modification time is.
+  SmallString<128> CacheFile;
+  std::optional<llvm::sys::TimePoint<>> ModTime;
+  if (!FileSystemOpts.DirectoryListingCachePath.empty()) {
+    llvm::ErrorOr<llvm::vfs::Status> Status = FS->status(DirPath);
+    if (!Status || !Status->isDirectory())
+      return nullptr;
+    ModTime = Status->getLastModificationTime();
+
+    SmallString<128> AbsPath(DirPath);
+    FS->makeAbsolute(AbsPath);
+    llvm::MD5 Hash;
+    Hash.update(AbsPath);
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    CacheFile = FileSystemOpts.DirectoryListingCachePath;
+    llvm::sys::path::append(CacheFile, Result.digest() + ".dirlist");
+
+    Listing =
+        readCachedDirListing(CacheFile, ModTime->time_since_epoch().count());
+    if (Listing) {
+      ++NumDirListings;
+      return Listing.get();
+    }
+  }
+
+  // Lookups may differ in case from the listing on case-insensitive file
+  // systems, so names are compared case-insensitively. A false match only
+  // costs the stat the listing would have saved.
+  auto Names = std::make_unique<llvm::StringSet<>>();
+  std::error_code EC;
+  for (llvm::vfs::directory_iterator I = FS->dir_begin(DirPath, EC), E;
+       !EC && I != E; I.increment(EC))
+    Names->insert(llvm::sys::path::filename(I->path()).lower());
+  if (EC)
+    return nullptr;
+  ++NumDirListings;
+
+  // A directory modified in the last moments may still gain entries without
+  // its modification time changing, so do not share its listing yet.
+  if (ModTime && std::chrono::system_clock::now() - *ModTime >
+                     std::chrono::seconds(2))
+    writeCachedDirListing(CacheFile, ModTime->time_since_epoch().count(),
+                          *Names);
+
+  Listing = std::move(Names);
+  return Listing.get();
+}
+
+bool FileManager::isMissingFromDirListing(DirectoryEntryRef Dir,
+                                          StringRef Name, bool Read) {
+  // Listings do not contain the "." and ".." entries.
+  if (Name.empty() || Name == "." || Name == "..")
+    return false;
+  const llvm::StringSet<> *Listing = getDirListing(Dir, Read);
+  if (!Listing || Listing->contains(Name.lower()))
+    return false;
+  ++NumListingMisses;
+  return true;
+}
+
 /// getStatValue - Get the 'stat' information for the specified path,
 /// using the cache to accelerate it if possible.  This returns true
 /// if the path points to a virtual file or does not exist, or returns
@@ -683,6 +823,8 @@ void FileManager::AddStats(const FileManager &Other) {
   NumFileLookups += Other.NumFileLookups;
   NumDirCacheMisses += Other.NumDirCacheMisses;
   NumFileCacheMisses += Other.NumFileCacheMisses;
+  NumDirListings += Other.NumDirListings;
+  NumListingMisses += Other.NumListingMisses;
 }
 
 void FileManager::PrintStats() const {
@@ -695,6 +837,9 @@ void FileManager::PrintStats() const {
                << NumDirCacheMisses << " dir cache misses.\n";
   llvm::errs() << NumFileLookups << " file lookups, "
                << NumFileCacheMisses << " file cache misses.\n";
+  if (FileSystemOpts.CacheDirectoryListings)
+    llvm::errs() << NumDirListings << " dir listings read, "
+                 << NumListingMisses << " lookups answered by listings.\n";
 
   getVirtualFileSystem().visit([](llvm::vfs::FileSystem &VFS) {
     if (auto *T = dyn_cast_or_null<llvm::vfs::TracingFileSystem>(&VFS))
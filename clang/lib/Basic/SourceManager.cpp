@@ -332,6 +332,7 @@ SourceManager::~SourceManager() {
 void SourceManager::clearIDTables() {
   MainFileID = FileID();
   LocalSLocEntryTable.clear();
+  LocalSLocPageIndex.clear();
   LoadedSLocEntryTable.clear();
   SLocEntryLoaded.clear();
   SLocEntryOffsetLoaded.clear();
@@ -643,6 +644,7 @@ FileID SourceManager::createFileIDImpl(ContentCache &File, StringRef Filename,
   // We do a +1 here because we want a SourceLocation that means "the end of the
   // file", e.g. for the "no newline at the end of the file" diagnostic.
   NextLocalOffset += FileSize + 1;
+  indexLastLocalSLocEntry();
   updateSlocUsageStats();
 
   // Set LastFileIDLookup to the newly created file.  The next getFileID call is
@@ -704,6 +706,7 @@ SourceManager::createExpansionLocImpl(const ExpansionInfo &Info,
   }
   // See createFileID for that +1.
   NextLocalOffset += Length + 1;
+  indexLastLocalSLocEntry();
   updateSlocUsageStats();
   return SourceLocation::getMacroLoc(NextLocalOffset - (Length + 1));
 }
@@ -818,20 +821,24 @@ FileID SourceManager::getFileIDLocal(SourceLocation::UIntTy SLocOffset) const {
   // location or are "near" the cached expansion location. 2) others are just
   // completely random and may be a very long way away.
   //
-  // To handle this, we do a linear search for up to 8 steps to catch #1 quickly
-  // then we fall back to a less cache efficient, but more scalable, binary
+  // To handle this, the page index first narrows the search down to the
+  // entries overlapping the page of SLocOffset. Within those, we do a linear
+  // search for up to 8 steps to catch #1 quickly then we fall back to a binary
   // search to find the location.
 
-  // See if this is near the file point - worst case we start scanning from the
-  // most newly created FileID.
-
   // LessIndex - This is the lower bound of the range that we're searching.
   // We know that the offset corresponding to the FileID is less than
   // SLocOffset.
-  unsigned LessIndex = 0;
-  // upper bound of the search range.
-  unsigned GreaterIndex = LocalSLocEntryTable.size();
-  if (LastFileIDLookup.ID >= 0) {
+  unsigned Page = SLocOffset >> LocalSLocPageBits;
+  assert(Page < LocalSLocPageIndex.size() && "Page index out of sync");
+  unsigned LessIndex = LocalSLocPageIndex[Page];
+  // upper bound of the search range. The entry containing the start of the
+  // next page may still start before SLocOffset.
+  unsigned GreaterIndex = Page + 1 < LocalSLocPageIndex.size()
+                              ? LocalSLocPageIndex[Page + 1] + 1
+                              : LocalSLocEntryTable.size();
+  if (LastFileIDLookup.ID >= 0 && unsigned(LastFileIDLookup.ID) > LessIndex &&
+      unsigned(LastFileIDLookup.ID) < GreaterIndex) {
     // Use the LastFileIDLookup to prune the search space.
     if (LocalSLocEntryTable[LastFileIDLookup.ID].getOffset() < SLocOffset)
       LessIndex = LastFileIDLookup.ID;
@@ -1875,6 +1882,15 @@ void SourceManager::updateSlocUsageStats() const {
   MaxUsedSLocBytes.updateMax(UsedBytes);
 }
 
+void SourceManager::indexLastLocalSLocEntry() {
+  // The pages that start before NextLocalOffset and were not indexed yet all
+  // start within the last entry.
+  unsigned Index = LocalSLocEntryTable.size() - 1;
+  SourceLocation::UIntTy LastPage = (NextLocalOffset - 1) >> LocalSLocPageBits;
+  if (LocalSLocPageIndex.size() <= LastPage)
+    LocalSLocPageIndex.resize(LastPage + 1, Index);
+}
+
 /// If \arg Loc points inside a function macro argument, the returned
 /// location will be the macro location in which the argument was expanded.
 /// If a macro argument is used multiple times, the expanded location will
@@ -2370,6 +2386,7 @@ SourceManager::MemoryBufferSizes SourceManager::getMemoryBufferSizes() const {
 size_t SourceManager::getDataStructureSizes() const {
   size_t size = llvm::capacity_in_bytes(MemBufferInfos) +
                 llvm::capacity_in_bytes(LocalSLocEntryTable) +
+                llvm::capacity_in_bytes(LocalSLocPageIndex) +
                 llvm::capacity_in_bytes(LoadedSLocEntryTable) +
                 llvm::capacity_in_bytes(SLocEntryLoaded) +
                 llvm::capacity_in_bytes(FileInfos);
@@ -18,9 +18,15 @@
 #include "llvm/Option/OptSpecifier.h"
 #include "llvm/Option/Option.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TargetParser/Triple.h"
 #include <cassert>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <system_error>
 #include <utility>
@@ -157,9 +163,7 @@ bool Compilation::CleanupFileMap(const ArgStringMap &Files,
   return Success;
 }
 
-int Compilation::ExecuteCommand(const Command &C,
-                                const Command *&FailingCommand,
-                                bool LogOnly) const {
+bool Compilation::LogCommand(const Command &C) const {
   if ((getDriver().CCPrintOptions ||
        getArgs().hasArg(options::OPT_v)) && !getDriver().CCGenDiagnostics) {
     raw_ostream *OS = &llvm::errs();
@@ -176,8 +180,7 @@ int Compilation::ExecuteCommand(const Command &C,
       if (EC) {
         getDriver().Diag(diag::err_drv_cc_print_options_failure)
             << EC.message();
-        FailingCommand = &C;
-        return 1;
+        return false;
       }
       OS = OwnedStream.get();
     }
@@ -187,6 +190,16 @@ int Compilation::ExecuteCommand(const Command &C,
 
     C.Print(*OS, "\n", /*Quote=*/getDriver().CCPrintOptions);
   }
+  return true;
+}
+
+int Compilation::ExecuteCommand(const Command &C,
+                                const Command *&FailingCommand,
+                                bool LogOnly) const {
+  if (!LogCommand(C)) {
+    FailingCommand = &C;
+    return 1;
+  }
 
   if (LogOnly)
     return 0;
@@ -237,9 +250,160 @@ static bool InputsOk(const Command &C,
   return !ActionFailed(&C.getSource(), FailingCommands);
 }
 
+/// Whether \p Consumer was built from the result of \p Producer.
+static bool ActionDependsOn(const Action *Consumer, const Action *Producer) {
+  for (const auto *AI : Consumer->inputs())
+    if (AI == Producer || ActionDependsOn(AI, Producer))
+      return true;
+  return false;
+}
+
+/// Whether \p Job has to wait for \p Earlier, which precedes it in the job
+/// list.
+static bool JobDependsOn(const Command &Job, const Command &Earlier) {
+  if (&Job.getSource() == &Earlier.getSource() ||
+      ActionDependsOn(&Job.getSource(), &Earlier.getSource()))
+    return true;
+
+  // Some jobs read another job's output without being built from its action,
+  // e.g. compiles loading a precompiled header that the toolchain builds for
+  // them.
+  for (const std::string &Output : Earlier.getOutputFilenames())
+    for (const char *Arg : Job.getArguments())
+      if (Output == Arg)
+        return true;
+  return false;
+}
+
+namespace {
+/// The state of a job while a job list runs in parallel.
+struct ParallelJob {
+  const Command *Cmd = nullptr;
+  /// The jobs waiting for this one.
+  SmallVector<unsigned, 4> Dependents;
+  /// The number of jobs this one still waits for.
+  unsigned PendingInputs = 0;
+  /// Set if a job this one waits for failed or was skipped.
+  bool Skipped = false;
+  bool Finished = false;
+  int Res = 0;
+  const Command *FailingCommand = nullptr;
+  /// The captured stdout and stderr of the job, and any execution error.
+  std::string Stdout, Stderr, Error;
+};
+} // namespace
+
+void Compilation::ExecuteJobsInParallel(const JobList &Jobs,
+                                        FailingCommandList &FailingCommands,
+                                        unsigned NumThreads) const {
+  std::vector<ParallelJob> State;
+  for (const auto &Job : Jobs) {
+    ParallelJob &J = State.emplace_back();
+    J.Cmd = &Job;
+    for (unsigned I = 0, E = State.size() - 1; I != E; ++I) {
+      if (JobDependsOn(Job, *State[I].Cmd)) {
+        State[I].Dependents.push_back(E);
+        ++J.PendingInputs;
+      }
+    }
+  }
+
+  // Guards State, the driver diagnostics and the driver's own output.
+  std::mutex Lock;
+  unsigned NextToPrint = 0;
+  llvm::DefaultThreadPool Pool(
+      llvm::heavyweight_hardware_concurrency(NumThreads));
+
+  std::function<void(unsigned)> Run = [&](unsigned Index) {
+    ParallelJob &J = State[Index];
+    bool Logged = true;
+    if (!J.Skipped) {
+      std::lock_guard<std::mutex> Guard(Lock);
+      Logged = LogCommand(*J.Cmd);
+    }
+
+    if (!J.Skipped && Logged) {
+      // Send the job's stdout and stderr to temporary files, unless the
+      // compilation redirects them already, so that each job's output can be
+      // printed in one piece.
+      std::optional<StringRef> JobRedirects[3];
+      for (unsigned FD = 0; FD != 3 && FD < Redirects.size(); ++FD)
+        JobRedirects[FD] = Redirects[FD];
+      SmallString<128> CapturePaths[3];
+      for (unsigned FD : {1, 2}) {
+        if (JobRedirects[FD] ||
+            llvm::sys::fs::createTemporaryFile("clang-job", "txt",
+                                               CapturePaths[FD]))
+          continue;
+        JobRedirects[FD] = CapturePaths[FD].str();
+      }
+
+      bool ExecutionFailed;
+      int Res = J.Cmd->Execute(JobRedirects, &J.Error, &ExecutionFailed);
+
+      for (unsigned FD : {1, 2}) {
+        if (CapturePaths[FD].empty())
+          continue;
+        if (auto Buffer = llvm::MemoryBuffer::getFile(CapturePaths[FD]))
+          (FD == 1 ? J.Stdout : J.Stderr) = (*Buffer)->getBuffer().str();
+        llvm::sys::fs::remove(CapturePaths[FD]);
+      }
+
+      std::lock_guard<std::mutex> Guard(Lock);
+      if (PostCallback)
+        PostCallback(*J.Cmd, Res);
+      if (Res)
+        J.FailingCommand = J.Cmd;
+      J.Res = ExecutionFailed ? 1 : Res;
+    } else if (!Logged) {
+      J.FailingCommand = J.Cmd;
+      J.Res = 1;
+    }
+
+    std::lock_guard<std::mutex> Guard(Lock);
+    J.Finished = true;
+
+    // Print output in job order, so that it reads as if the jobs had run one
+    // after the other.
+    while (NextToPrint != State.size() && State[NextToPrint].Finished) {
+      const ParallelJob &P = State[NextToPrint++];
+      llvm::outs() << P.Stdout;
+      llvm::outs().flush();
+      llvm::errs() << P.Stderr;
+      if (!P.Error.empty()) {
+        assert(P.Res && "Error string set with 0 result code!");
+        getDriver().Diag(diag::err_drv_command_failure) << P.Error;
+      }
+    }
+
+    for (unsigned D : J.Dependents) {
+      State[D].Skipped |= J.Skipped || J.Res;
+      if (--State[D].PendingInputs == 0)
+        Pool.async([&Run, D] { Run(D); });
+    }
+  };
+
+  for (unsigned I = 0, E = State.size(); I != E; ++I)
+    if (!State[I].PendingInputs)
+      Pool.async([&Run, I] { Run(I); });
+  Pool.wait();
+
+  for (const ParallelJob &J : State)
+    if (J.Res)
+      FailingCommands.push_back(std::make_pair(J.Res, J.FailingCommand));
+}
+
 void Compilation::ExecuteJobs(const JobList &Jobs,
                               FailingCommandList &FailingCommands,
                               bool LogOnly) const {
+  // Run independent jobs concurrently if requested. cl mode stops at the first
+  // failure and diagnostic compilations rerun jobs for a crash report, so both
+  // keep running jobs one at a time.
+  if (!LogOnly && TheDriver.NumParallelJobs > 1 && Jobs.size() > 1 &&
+      !TheDriver.IsCLMode() && !ForDiagnostics)
+    return ExecuteJobsInParallel(Jobs, FailingCommands,
+                                 TheDriver.NumParallelJobs);
+
   // According to UNIX standard, driver need to continue compiling all the
   // inputs on the command line even one of them failed.
   // In all but CLMode, execute all the jobs unless the necessary inputs for the
@@ -92,6 +92,7 @@
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/StringSaver.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TargetParser/Host.h"
@@ -1521,6 +1522,18 @@ Compilation *Driver::BuildCompilation(ArrayRef<const char *> ArgList) {
   if (Args.hasArg(options::OPT_fproc_stat_report))
     CCPrintProcessStats = true;
 
+  // Process -fparallel-jobs=.
+  if (const Arg *A = Args.getLastArg(options::OPT_fparallel_jobs_EQ)) {
+    StringRef Value = A->getValue();
+    unsigned N;
+    if (Value.getAsInteger(10, N))
+      Diag(diag::err_drv_invalid_int_value) << A->getAsString(Args) << Value;
+    else
+      NumParallelJobs =
+          N ? N
+            : llvm::heavyweight_hardware_concurrency().compute_thread_count();
+  }
+
   // FIXME: TargetTriple is used by the target-prefixed calls to as/ld
   // and getToolChain is const.
   if (IsCLMode()) {
@@ -23,6 +23,7 @@
 #include "CommonArgs.h"
 #include "Hexagon.h"
 #include "MSP430.h"
+#include "MacOSClassic.h"
 #include "PS4CPU.h"
 #include "SYCL.h"
 #include "clang/Basic/CLWarnings.h"
@@ -1170,6 +1171,14 @@ void Clang::AddPreprocessingOptions(Compilation &C, const JobAction &JA,
   }
 
   bool RenderedImplicitInclude = false;
+
+  // Classic Mac OS compiles may load the Universal Interfaces prefix from a
+  // cached precompiled header.
+  if (getToolChain().getTriple().isMacOSClassic())
+    RenderedImplicitInclude =
+        static_cast<const toolchains::MacOSClassic &>(getToolChain())
+            .addPrefixPCHArgs(C, JA, *this, Inputs, Args, CmdArgs);
+
   for (const Arg *A : Args.filtered(options::OPT_clang_i_Group)) {
     if (A->getOption().matches(options::OPT_include) &&
         D.getProbePrecompiled()) {
@@ -4315,6 +4324,9 @@ static bool RenderModulesOptions(Compilation &C, const Driver &D,
   if (Args.hasArg(options::OPT_fmodules_embed_all_files))
     CmdArgs.push_back("-fmodules-embed-all-files");
 
+  Args.addOptInFlag(CmdArgs, options::OPT_fcompress_modules,
+                    options::OPT_fno_compress_modules);
+
   return HaveModules;
 }
 
@@ -6448,6 +6460,9 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   CmdArgs.push_back(D.ResourceDir.c_str());
 
   Args.AddLastArg(CmdArgs, options::OPT_working_directory);
+  Args.addOptInFlag(CmdArgs, options::OPT_fcache_directory_listings,
+                    options::OPT_fno_cache_directory_listings);
+  Args.AddLastArg(CmdArgs, options::OPT_fdirectory_listing_cache_path_EQ);
 
   RenderARCMigrateToolOptions(D, Args, CmdArgs);
 
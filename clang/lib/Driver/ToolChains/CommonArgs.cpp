@@ -2779,10 +2779,12 @@ void tools::addMachineOutlinerArgs(const Driver &D,
   if (Arg *A = Args.getLastArg(options::OPT_moutline,
                                options::OPT_mno_outline)) {
     if (A->getOption().matches(options::OPT_moutline)) {
-      // We only support -moutline in AArch64 and ARM targets right now. If
-      // we're not compiling for these, emit a warning and ignore the flag.
-      // Otherwise, add the proper mllvm flags.
-      if (!(Triple.isARM() || Triple.isThumb() || Triple.isAArch64())) {
+      // We only support -moutline in AArch64, ARM, 32-bit PowerPC and M68k
+      // targets right now. If we're not compiling for these, emit a warning
+      // and ignore the flag. Otherwise, add the proper mllvm flags.
+      if (!(Triple.isARM() || Triple.isThumb() || Triple.isAArch64() ||
+            (Triple.isPPC32() && !Triple.isOSAIX()) ||
+            Triple.getArch() == llvm::Triple::m68k)) {
         D.Diag(diag::warn_drv_moutline_unsupported_opt) << Triple.getArchName();
       } else {
         addArg(Twine("-enable-machine-outliner"));
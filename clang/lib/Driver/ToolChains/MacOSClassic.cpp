@@ -13,16 +13,20 @@
 
 #include "MacOSClassic.h"
 #include "CommonArgs.h"
+#include "clang/Basic/Version.h"
 #include "clang/Config/config.h"
 #include "clang/Driver/Compilation.h"
 #include "clang/Driver/Driver.h"
 #include "clang/Driver/InputInfo.h"
 #include "clang/Driver/Options.h"
 #include "clang/Driver/Types.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Option/ArgList.h"
+#include "llvm/Support/Chrono.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/VirtualFileSystem.h"
 
 using namespace clang::driver;
 using namespace clang::driver::toolchains;
@@ -102,6 +106,13 @@ void Linker::ConstructJob(Compilation &C, const JobAction &JA,
   TC.AddFilePathLibArgs(Args, CmdArgs);
   Args.addAllArgs(CmdArgs, {options::OPT_l, options::OPT_T_Group});
 
+  // Merge the codegen data recorded in the objects into the given file.
+  if (auto *CodeGenDataGenArg =
+          Args.getLastArg(options::OPT_fcodegen_data_generate_EQ))
+    CmdArgs.push_back(
+        Args.MakeArgString(Twine("--codegen-data-generate-path=") +
+                           CodeGenDataGenArg->getValue()));
+
   // Output file
   CmdArgs.push_back("-o");
   CmdArgs.push_back(Output.getFilename());
@@ -201,7 +212,9 @@ void MacOSClassic::AddClangSystemIncludeArgs(const ArgList &DriverArgs,
 
   // Automatically include MacHeadersCompat.h before any other headers
   // This provides compatibility shims for Classic Mac OS Universal Interfaces
-  // The header is installed in the clang resource directory
+  // The header is installed in the clang resource directory. When the compile
+  // loads the prefix PCH, which starts with this header, its include guard
+  // turns the textual include into a no-op.
   SmallString<128> CompatHeader(getDriver().ResourceDir);
   llvm::sys::path::append(CompatHeader, "include", "MacHeadersCompat.h");
 
@@ -218,6 +231,164 @@ void MacOSClassic::AddClangSystemIncludeArgs(const ArgList &DriverArgs,
   }
 }
 
+/// Whether \p A only concerns the particular inputs, outputs or driver
+/// action of a compile, rather than how its source is parsed. The user's own
+/// -include headers belong to the compile too, not to the prefix PCH.
+static bool isPerInputArg(const Arg *A) {
+  const llvm::opt::Option &O = A->getOption();
+  return O.matches(options::OPT_INPUT) || O.matches(options::OPT_o) ||
+         O.matches(options::OPT_include) ||
+         O.matches(options::OPT_M_Group) ||
+         O.matches(options::OPT_Action_Group) ||
+         O.matches(options::OPT__serialize_diags) ||
+         O.matches(options::OPT__HASH_HASH_HASH);
+}
+
+void MacOSClassic::hashSysRootHeaders(llvm::MD5 &Hash) const {
+  SmallString<128> Dir(computeSysRoot());
+  if (Dir.empty())
+    return;
+  llvm::sys::path::append(Dir, "include");
+
+  // Universal Interfaces ship as a single flat CIncludes directory, so a
+  // non-recursive listing covers every header the prefix can pull in.
+  llvm::vfs::FileSystem &VFS = getVFS();
+  std::vector<llvm::vfs::Status> Headers;
+  std::error_code EC;
+  for (llvm::vfs::directory_iterator I = VFS.dir_begin(Dir, EC), E;
+       !EC && I != E; I.increment(EC)) {
+    if (llvm::ErrorOr<llvm::vfs::Status> S = VFS.status(I->path()))
+      Headers.push_back(*S);
+  }
+
+  // Directory iteration order is unspecified.
+  llvm::sort(Headers, [](const llvm::vfs::Status &LHS,
+                         const llvm::vfs::Status &RHS) {
+    return LHS.getName() < RHS.getName();
+  });
+  for (const llvm::vfs::Status &S : Headers)
+    Hash.update((Twine(llvm::sys::path::filename(S.getName())) + ":" +
+                 Twine(S.getSize()) + ":" +
+                 Twine(llvm::sys::toTimeT(S.getLastModificationTime())) + "\n")
+                    .str());
+}
+
+std::string MacOSClassic::getPrefixPCHPath(const ArgList &DriverArgs,
+                                           types::ID HeaderType) const {
+  SmallString<128> CacheDir;
+  if (const Arg *A =
+          DriverArgs.getLastArg(options::OPT_fclassic_mac_pch_cache_path_EQ))
+    CacheDir = A->getValue();
+  else if (llvm::sys::path::cache_directory(CacheDir))
+    llvm::sys::path::append(CacheDir, "clang", "ClassicMacPCH");
+  else
+    return std::string();
+
+  // Key the entry on everything that shapes the PCH: the compiler, the
+  // sysroot headers, the input language (which also selects the C or C++
+  // flavor of the Toolbox headers) and every option of the compile apart
+  // from its inputs and outputs. Target CPU and macros come in through the
+  // options.
+  llvm::MD5 Hash;
+  Hash.update(getClangFullVersion());
+  Hash.update(getDriver().ResourceDir);
+  Hash.update(getTripleString());
+  Hash.update(types::getTypeName(HeaderType));
+  hashSysRootHeaders(Hash);
+  for (const Arg *A : DriverArgs)
+    if (!isPerInputArg(A))
+      Hash.update(A->getAsString(DriverArgs) + "\n");
+
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  llvm::sys::path::append(CacheDir,
+                          Twine("MacHeaders-") + Result.digest() + ".pch");
+  return std::string(CacheDir);
+}
+
+bool MacOSClassic::addPrefixPCHArgs(Compilation &C, const JobAction &JA,
+                                    const Tool &Clang,
+                                    const InputInfoList &Inputs,
+                                    const ArgList &DriverArgs,
+                                    ArgStringList &CC1Args) const {
+  if (DriverArgs.hasArg(options::OPT_nostdinc, options::OPT_nostdlibinc))
+    return false;
+
+  // Only plain compiles load the prefix PCH; preprocessing keeps the textual
+  // include, and a compile can't take a second PCH next to the user's own.
+  if (!DriverArgs.hasFlag(options::OPT_fclassic_mac_pch,
+                          options::OPT_fno_classic_mac_pch, false) ||
+      isa<PreprocessJobAction>(JA) || isa<PrecompileJobAction>(JA) ||
+      DriverArgs.hasArg(options::OPT_include_pch))
+    return false;
+
+  types::ID HeaderType;
+  switch (Inputs[0].getType()) {
+  case types::TY_C:
+    HeaderType = types::TY_CHeader;
+    break;
+  case types::TY_CXX:
+    HeaderType = types::TY_CXXHeader;
+    break;
+  case types::TY_ObjC:
+    HeaderType = types::TY_ObjCHeader;
+    break;
+  case types::TY_ObjCXX:
+    HeaderType = types::TY_ObjCXXHeader;
+    break;
+  default:
+    return false;
+  }
+
+  std::string PCHPath = getPrefixPCHPath(DriverArgs, HeaderType);
+  if (PCHPath.empty())
+    return false;
+
+  // Schedule the PCH build ahead of the first compile that needs it, unless
+  // an earlier compilation already left it in the cache. Concurrent builds of
+  // the same entry are harmless: cc1 writes its output through a temporary
+  // file and renames it into place.
+  if (!getVFS().exists(PCHPath) && PrefixPCHJobs.insert(PCHPath).second) {
+    // cc1 doesn't create missing output directories for -emit-pch. Without a
+    // cache directory, stay with the textual include. A dry run leaves the
+    // filesystem alone.
+    if (!C.getArgs().hasArg(options::OPT__HASH_HASH_HASH) &&
+        llvm::sys::fs::create_directories(
+            llvm::sys::path::parent_path(PCHPath))) {
+      PrefixPCHJobs.erase(PCHPath);
+      return false;
+    }
+
+    // Build from this compile's own options, less its inputs and outputs, so
+    // that the PCH's language options match the compiles that load it.
+    auto PCHArgs = std::make_unique<DerivedArgList>(C.getInputArgs());
+    for (Arg *A : DriverArgs)
+      if (!isPerInputArg(A))
+        PCHArgs->append(A);
+
+    SmallString<128> PrefixHeader(getDriver().ResourceDir);
+    llvm::sys::path::append(PrefixHeader, "include", "MacHeaders.h");
+    Arg *HeaderArg = PCHArgs->MakePositionalArg(
+        nullptr, getDriver().getOpts().getOption(options::OPT_INPUT),
+        PrefixHeader);
+
+    Action *HeaderInput = C.MakeAction<InputAction>(*HeaderArg, HeaderType);
+    auto *PCHAction =
+        C.MakeAction<PrecompileJobAction>(HeaderInput, types::TY_PCH);
+    InputInfo PCHOutput(types::TY_PCH, C.getArgs().MakeArgString(PCHPath),
+                        HeaderArg->getValue());
+    InputInfoList PCHInputs = {
+        InputInfo(HeaderType, HeaderArg->getValue(), HeaderArg->getValue())};
+    Clang.ConstructJob(C, *PCHAction, PCHOutput, PCHInputs, *PCHArgs,
+                       /*LinkingOutput=*/nullptr);
+    PrefixPCHArgs.push_back(std::move(PCHArgs));
+  }
+
+  CC1Args.push_back("-include-pch");
+  CC1Args.push_back(DriverArgs.MakeArgString(PCHPath));
+  return true;
+}
+
 std::string MacOSClassic::GetLinkerPath(bool *LinkerIsLLD) const {
   // Default to using lld for Mac OS Classic (PEF format support)
   if (LinkerIsLLD)
@@ -14,8 +14,16 @@
 #ifndef LLVM_CLANG_LIB_DRIVER_TOOLCHAINS_MACOSCLASSIC_H
 #define LLVM_CLANG_LIB_DRIVER_TOOLCHAINS_MACOSCLASSIC_H
 
+#include "clang/Driver/Compilation.h"
 #include "clang/Driver/Driver.h"
+#include "clang/Driver/InputInfo.h"
+#include "clang/Driver/Tool.h"
 #include "clang/Driver/ToolChain.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/MD5.h"
+#include <memory>
+#include <vector>
 
 namespace clang {
 namespace driver {
@@ -81,12 +89,38 @@ public:
   // Compute sysroot path (following BareMetal pattern)
   std::string computeSysRoot() const override;
 
+  /// With -fclassic-mac-pch, add an -include-pch of the cached MacHeaders.h
+  /// PCH to a cc1 command line, scheduling a job to build it first when the
+  /// cache has no entry for the current sysroot and compile options.
+  /// MacHeadersCompat.h is still force-included by AddClangSystemIncludeArgs.
+  /// \returns true if the precompiled header was added.
+  bool addPrefixPCHArgs(Compilation &C, const JobAction &JA,
+                        const Tool &Clang, const InputInfoList &Inputs,
+                        const llvm::opt::ArgList &DriverArgs,
+                        llvm::opt::ArgStringList &CC1Args) const;
+
 protected:
   Tool *buildLinker() const override;
   Tool *buildAssembler() const override;
 
 private:
+  /// Return the cache file for the prefix PCH used by a compile of
+  /// \p HeaderType inputs, or an empty string if there is no cache directory.
+  std::string getPrefixPCHPath(const llvm::opt::ArgList &DriverArgs,
+                               types::ID HeaderType) const;
+
+  /// Hash the name, size and modification time of each sysroot header, so
+  /// that cached prefix PCHs are not reused across interface updates.
+  void hashSysRootHeaders(llvm::MD5 &Hash) const;
+
   std::string SysRoot;
+
+  /// Prefix PCHs already scheduled for building in this compilation.
+  mutable llvm::StringSet<> PrefixPCHJobs;
+
+  /// Argument lists backing the prefix PCH build jobs.
+  mutable std::vector<std::unique_ptr<llvm::opt::DerivedArgList>>
+      PrefixPCHArgs;
 };
 
 } // end namespace toolchains
@@ -0,0 +1,90 @@
+/**
+ * MacHeaders.h - Prefix header for Classic Mac OS Universal Interfaces
+ *
+ * This header pulls in MacHeadersCompat.h followed by the commonly used
+ * Toolbox headers. It is what the MacOSClassic toolchain precompiles and
+ * caches when -fclassic-mac-pch is given, so that each translation unit loads
+ * the Universal Interfaces from a PCH instead of re-parsing them.
+ *
+ * Headers missing from the sysroot are skipped, so the prefix also works with
+ * trimmed-down interface sets.
+ *
+ * Part of the LLVM PEF Linker project for Classic Mac OS PowerPC.
+ */
+
+#ifndef __MACHEADERS_H__
+#define __MACHEADERS_H__
+
+#include <MacHeadersCompat.h>
+
+#if __has_include(<MacTypes.h>)
+#include <MacTypes.h>
+#endif
+#if __has_include(<MixedMode.h>)
+#include <MixedMode.h>
+#endif
+#if __has_include(<MacErrors.h>)
+#include <MacErrors.h>
+#endif
+#if __has_include(<MacMemory.h>)
+#include <MacMemory.h>
+#endif
+#if __has_include(<OSUtils.h>)
+#include <OSUtils.h>
+#endif
+#if __has_include(<Files.h>)
+#include <Files.h>
+#endif
+#if __has_include(<Resources.h>)
+#include <Resources.h>
+#endif
+#if __has_include(<Quickdraw.h>)
+#include <Quickdraw.h>
+#endif
+#if __has_include(<QuickdrawText.h>)
+#include <QuickdrawText.h>
+#endif
+#if __has_include(<Fonts.h>)
+#include <Fonts.h>
+#endif
+#if __has_include(<Events.h>)
+#include <Events.h>
+#endif
+#if __has_include(<MacWindows.h>)
+#include <MacWindows.h>
+#endif
+#if __has_include(<Menus.h>)
+#include <Menus.h>
+#endif
+#if __has_include(<Controls.h>)
+#include <Controls.h>
+#endif
+#if __has_include(<Dialogs.h>)
+#include <Dialogs.h>
+#endif
+#if __has_include(<TextEdit.h>)
+#include <TextEdit.h>
+#endif
+#if __has_include(<Lists.h>)
+#include <Lists.h>
+#endif
+#if __has_include(<Scrap.h>)
+#include <Scrap.h>
+#endif
+#if __has_include(<ToolUtils.h>)
+#include <ToolUtils.h>
+#endif
+#if __has_include(<Processes.h>)
+#include <Processes.h>
+#endif
+#if __has_include(<Devices.h>)
+#include <Devices.h>
+#endif
+#if __has_include(<Gestalt.h>)
+#include <Gestalt.h>
+#endif
+#if __has_include(<Sound.h>)
+#include <Sound.h>
+#endif
+
+#endif /* __MACHEADERS_H__ */
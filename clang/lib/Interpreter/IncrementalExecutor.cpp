@@ -16,6 +16,7 @@
 #include "clang/Basic/TargetOptions.h"
 #include "clang/Interpreter/PartialTranslationUnit.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/Debugging/DebuggerSupport.h"
 #include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
@@ -53,6 +54,19 @@ IncrementalExecutor::createDefaultJITBuilder(
   return std::move(JITBuilder);
 }
 
+llvm::Expected<std::unique_ptr<llvm::orc::LLLazyJITBuilder>>
+IncrementalExecutor::createDefaultLazyJITBuilder(
+    llvm::orc::JITTargetMachineBuilder JTMB, unsigned NumCompileThreads) {
+  auto JITBuilder = std::make_unique<llvm::orc::LLLazyJITBuilder>();
+  JITBuilder->setJITTargetMachineBuilder(std::move(JTMB));
+  JITBuilder->setNumCompileThreads(NumCompileThreads);
+  JITBuilder->setPrePlatformSetup([](llvm::orc::LLJIT &J) {
+    consumeError(llvm::orc::enableDebuggerSupport(J));
+    return llvm::Error::success();
+  });
+  return std::move(JITBuilder);
+}
+
 IncrementalExecutor::IncrementalExecutor(llvm::orc::ThreadSafeContext &TSC,
                                          llvm::orc::LLJITBuilder &JITBuilder,
                                          llvm::Error &Err)
@@ -68,6 +82,22 @@ IncrementalExecutor::IncrementalExecutor(llvm::orc::ThreadSafeContext &TSC,
   }
 }
 
+IncrementalExecutor::IncrementalExecutor(
+    llvm::orc::ThreadSafeContext &TSC, llvm::orc::LLLazyJITBuilder &JITBuilder,
+    llvm::Error &Err)
+    : TSCtx(TSC) {
+  using namespace llvm::orc;
+  llvm::ErrorAsOutParameter EAO(&Err);
+
+  if (auto JitOrErr = JITBuilder.create()) {
+    LazyJit = JitOrErr->get();
+    Jit = std::move(*JitOrErr);
+  } else {
+    Err = JitOrErr.takeError();
+    return;
+  }
+}
+
 IncrementalExecutor::~IncrementalExecutor() {}
 
 llvm::Error IncrementalExecutor::addModule(PartialTranslationUnit &PTU) {
@@ -75,6 +105,15 @@ llvm::Error IncrementalExecutor::addModule(PartialTranslationUnit &PTU) {
       Jit->getMainJITDylib().createResourceTracker();
   ResourceTrackers[&PTU] = RT;
 
+  if (LazyJit) {
+    // The compile-on-demand layer emits stubs for the functions of the module
+    // and only compiles their bodies when they are first called.
+    llvm::Module &M = *PTU.TheModule;
+    if (M.getDataLayout().isDefault())
+      M.setDataLayout(Jit->getDataLayout());
+    return LazyJit->getCompileOnDemandLayer().add(
+        RT, {std::move(PTU.TheModule), TSCtx});
+  }
   return Jit->addIRModule(RT, {std::move(PTU.TheModule), TSCtx});
 }
 
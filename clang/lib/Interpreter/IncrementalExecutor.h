@@ -26,6 +26,8 @@ namespace orc {
 class JITTargetMachineBuilder;
 class LLJIT;
 class LLJITBuilder;
+class LLLazyJIT;
+class LLLazyJITBuilder;
 class ThreadSafeContext;
 } // namespace orc
 } // namespace llvm
@@ -38,6 +40,8 @@ class TargetInfo;
 class IncrementalExecutor {
   using CtorDtorIterator = llvm::orc::CtorDtorIterator;
   std::unique_ptr<llvm::orc::LLJIT> Jit;
+  // Set if Jit compiles function bodies on their first call.
+  llvm::orc::LLLazyJIT *LazyJit = nullptr;
   llvm::orc::ThreadSafeContext &TSCtx;
 
   llvm::DenseMap<const PartialTranslationUnit *, llvm::orc::ResourceTrackerSP>
@@ -51,6 +55,9 @@ public:
 
   IncrementalExecutor(llvm::orc::ThreadSafeContext &TSC,
                       llvm::orc::LLJITBuilder &JITBuilder, llvm::Error &Err);
+  IncrementalExecutor(llvm::orc::ThreadSafeContext &TSC,
+                      llvm::orc::LLLazyJITBuilder &JITBuilder,
+                      llvm::Error &Err);
   virtual ~IncrementalExecutor();
 
   virtual llvm::Error addModule(PartialTranslationUnit &PTU);
@@ -64,6 +71,12 @@ public:
 
   static llvm::Expected<std::unique_ptr<llvm::orc::LLJITBuilder>>
   createDefaultJITBuilder(llvm::orc::JITTargetMachineBuilder JTMB);
+
+  /// Like createDefaultJITBuilder(), but the JIT only compiles functions when
+  /// they are first called, on \p NumCompileThreads threads if non-zero.
+  static llvm::Expected<std::unique_ptr<llvm::orc::LLLazyJITBuilder>>
+  createDefaultLazyJITBuilder(llvm::orc::JITTargetMachineBuilder JTMB,
+                              unsigned NumCompileThreads);
 };
 
 } // end namespace clang
@@ -365,8 +365,9 @@ public:
 Interpreter::Interpreter(std::unique_ptr<CompilerInstance> Instance,
                          llvm::Error &ErrOut,
                          std::unique_ptr<llvm::orc::LLJITBuilder> JITBuilder,
-                         std::unique_ptr<clang::ASTConsumer> Consumer)
-    : JITBuilder(std::move(JITBuilder)) {
+                         std::unique_ptr<clang::ASTConsumer> Consumer,
+                         JITConfig Config)
+    : JITBuilder(std::move(JITBuilder)), JITConf(Config) {
   CI = std::move(Instance);
   llvm::ErrorAsOutParameter EAO(&ErrOut);
   auto LLVMCtx = std::make_unique<llvm::LLVMContext>();
@@ -455,10 +456,11 @@ const char *const Runtimes = R"(
 )";
 
 llvm::Expected<std::unique_ptr<Interpreter>>
-Interpreter::create(std::unique_ptr<CompilerInstance> CI) {
+Interpreter::create(std::unique_ptr<CompilerInstance> CI, JITConfig Config) {
   llvm::Error Err = llvm::Error::success();
-  auto Interp =
-      std::unique_ptr<Interpreter>(new Interpreter(std::move(CI), Err));
+  auto Interp = std::unique_ptr<Interpreter>(
+      new Interpreter(std::move(CI), Err, /*JITBuilder=*/nullptr,
+                      /*Consumer=*/nullptr, Config));
   if (Err)
     return std::move(Err);
 
@@ -626,15 +628,23 @@ llvm::Error Interpreter::CreateExecutor() {
     return llvm::make_error<llvm::StringError>("Operation failed. "
                                                "No code generator available",
                                                std::error_code());
-  if (!JITBuilder) {
+  if (!JITBuilder && !LazyJITBuilder) {
     const std::string &TT = getCompilerInstance()->getTargetOpts().Triple;
     auto JTMB = createJITTargetMachineBuilder(TT);
     if (!JTMB)
       return JTMB.takeError();
-    auto JB = IncrementalExecutor::createDefaultJITBuilder(std::move(*JTMB));
-    if (!JB)
-      return JB.takeError();
-    JITBuilder = std::move(*JB);
+    if (JITConf.LazyCompilation) {
+      auto JB = IncrementalExecutor::createDefaultLazyJITBuilder(
+          std::move(*JTMB), JITConf.NumCompileThreads);
+      if (!JB)
+        return JB.takeError();
+      LazyJITBuilder = std::move(*JB);
+    } else {
+      auto JB = IncrementalExecutor::createDefaultJITBuilder(std::move(*JTMB));
+      if (!JB)
+        return JB.takeError();
+      JITBuilder = std::move(*JB);
+    }
   }
 
   llvm::Error Err = llvm::Error::success();
@@ -642,7 +652,9 @@ llvm::Error Interpreter::CreateExecutor() {
   auto Executor = std::make_unique<WasmIncrementalExecutor>(*TSCtx);
 #else
   auto Executor =
-      std::make_unique<IncrementalExecutor>(*TSCtx, *JITBuilder, Err);
+      LazyJITBuilder
+          ? std::make_unique<IncrementalExecutor>(*TSCtx, *LazyJITBuilder, Err)
+          : std::make_unique<IncrementalExecutor>(*TSCtx, *JITBuilder, Err);
 #endif
   if (!Err)
     IncrExecutor = std::move(Executor);
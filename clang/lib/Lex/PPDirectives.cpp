@@ -43,6 +43,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/ADT/bit.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SaveAndRestore.h"
@@ -53,6 +54,17 @@
 #include <string>
 #include <utility>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(__ALTIVEC__)
+#include <altivec.h>
+// GCC's altivec.h defines these context-sensitive keywords as macros, which
+// would break later uses such as std::vector.
+#undef bool
+#undef vector
+#undef pixel
+#endif
+
 using namespace clang;
 
 //===----------------------------------------------------------------------===//
@@ -491,6 +503,377 @@ void Preprocessor::SuggestTypoedDirective(const Token &Tok,
   }
 }
 
+namespace {
+
+/// Scans the raw text of an excluded conditional block ahead of the lexer,
+/// looking for lines that may start with a directive.
+///
+/// SkipExcludedConditionalBlock only needs to see '#' tokens at the start of a
+/// line, so the scanner tracks just enough of the language to tell which
+/// newlines start a new logical line outside any comment or literal: line
+/// splices, line and block comments, string and character literals, and
+/// digit separators. Whatever it cannot classify cheaply (raw string literals,
+/// comment delimiters split by a line splice, ...) makes it stop at the last
+/// line start it knows to be safe, and the lexer takes over from there.
+class ExcludedBlockScanner {
+  const char *const BufferStart;
+  const char *const BufferEnd;
+  const bool DigitSeparators;
+  const bool Digraphs;
+
+public:
+  /// Where the lexer should continue after a scan.
+  struct Result {
+    /// The start of a line at which the lexer can resume, or null if it should
+    /// stay where it is.
+    const char *LineStart;
+    /// The scanner should not be used again before the lexer has moved past
+    /// this point.
+    const char *ResumeAfter;
+  };
+
+  ExcludedBlockScanner(StringRef Buffer, const LangOptions &LangOpts)
+      : BufferStart(Buffer.begin()), BufferEnd(Buffer.end()),
+        DigitSeparators(LangOpts.CPlusPlus14 || LangOpts.C23),
+        Digraphs(LangOpts.Digraphs) {}
+
+  /// Scan from \p Ptr, a position between two tokens, to the next line that
+  /// may start with a '#'.
+  Result scan(const char *Ptr) const;
+
+private:
+  bool isAtStartOfLine(const char *Ptr) const;
+  const char *findSpecialChar(const char *Ptr) const;
+  unsigned getEscapedNewlineSize(const char *Ptr) const;
+  const char *skipNewline(const char *Ptr) const;
+  const char *skipLineComment(const char *Ptr) const;
+  const char *skipBlockComment(const char *Ptr) const;
+  const char *skipLiteral(const char *Ptr) const;
+  bool isDigitSeparator(const char *Ptr, const char *LastSeparator,
+                        bool &Ambiguous) const;
+};
+
+} // namespace
+
+/// Returns true for the characters that can change the lexer state within a
+/// line: newlines, comment starts, quotes and backslashes.
+static inline bool isExcludedBlockSpecialChar(char C) {
+  switch (C) {
+  case '\n':
+  case '\r':
+  case '/':
+  case '"':
+  case '\'':
+  case '\\':
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool ExcludedBlockScanner::isAtStartOfLine(const char *Ptr) const {
+  while (Ptr != BufferStart && isHorizontalWhitespace(Ptr[-1]))
+    --Ptr;
+  if (Ptr == BufferStart)
+    return true;
+  if (Ptr[-1] != '\n' && Ptr[-1] != '\r')
+    return false;
+  // Treat a newline that might be a line splice as a continuation; the scan
+  // then only reports lines after the next newline.
+  --Ptr;
+  if (Ptr != BufferStart && (Ptr[-1] == '\n' || Ptr[-1] == '\r') &&
+      Ptr[-1] != Ptr[0])
+    --Ptr;
+  while (Ptr != BufferStart && isHorizontalWhitespace(Ptr[-1]))
+    --Ptr;
+  return Ptr == BufferStart || Ptr[-1] != '\\';
+}
+
+const char *ExcludedBlockScanner::findSpecialChar(const char *Ptr) const {
+#ifdef __SSE2__
+  const __m128i Newlines = _mm_set1_epi8('\n');
+  const __m128i Returns = _mm_set1_epi8('\r');
+  const __m128i Slashes = _mm_set1_epi8('/');
+  const __m128i DoubleQuotes = _mm_set1_epi8('"');
+  const __m128i SingleQuotes = _mm_set1_epi8('\'');
+  const __m128i Backslashes = _mm_set1_epi8('\\');
+  while (Ptr + 16 <= BufferEnd) {
+    __m128i Chunk = _mm_loadu_si128((const __m128i *)Ptr);
+    __m128i Special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(Chunk, Newlines),
+                     _mm_cmpeq_epi8(Chunk, Returns)),
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Chunk, Slashes),
+                                  _mm_cmpeq_epi8(Chunk, DoubleQuotes)),
+                     _mm_or_si128(_mm_cmpeq_epi8(Chunk, SingleQuotes),
+                                  _mm_cmpeq_epi8(Chunk, Backslashes))));
+    if (int Mask = _mm_movemask_epi8(Special))
+      return Ptr + llvm::countr_zero<unsigned>(Mask);
+    Ptr += 16;
+  }
+#elif defined(__ALTIVEC__)
+  // AltiVec loads must be aligned, so get there one character at a time.
+  while (Ptr != BufferEnd && (intptr_t)Ptr % 16 != 0) {
+    if (isExcludedBlockSpecialChar(*Ptr))
+      return Ptr;
+    ++Ptr;
+  }
+  const __vector unsigned char Newlines = vec_splats((unsigned char)'\n');
+  const __vector unsigned char Returns = vec_splats((unsigned char)'\r');
+  const __vector unsigned char Slashes = vec_splats((unsigned char)'/');
+  const __vector unsigned char DoubleQuotes = vec_splats((unsigned char)'"');
+  const __vector unsigned char SingleQuotes = vec_splats((unsigned char)'\'');
+  const __vector unsigned char Backslashes = vec_splats((unsigned char)'\\');
+  while (Ptr + 16 <= BufferEnd) {
+    __vector unsigned char Chunk = *(const __vector unsigned char *)Ptr;
+    if (vec_any_eq(Chunk, Newlines) || vec_any_eq(Chunk, Returns) ||
+        vec_any_eq(Chunk, Slashes) || vec_any_eq(Chunk, DoubleQuotes) ||
+        vec_any_eq(Chunk, SingleQuotes) || vec_any_eq(Chunk, Backslashes))
+      break;
+    Ptr += 16;
+  }
+#endif
+  while (Ptr != BufferEnd && !isExcludedBlockSpecialChar(*Ptr))
+    ++Ptr;
+  return Ptr;
+}
+
+/// If \p Ptr points to a backslash that starts a line splice, return the size
+/// of the splice, including any whitespace before the newline.
+unsigned ExcludedBlockScanner::getEscapedNewlineSize(const char *Ptr) const {
+  assert(*Ptr == '\\');
+  const char *Cur = Ptr + 1;
+  while (Cur != BufferEnd && isHorizontalWhitespace(*Cur))
+    ++Cur;
+  if (Cur == BufferEnd || (*Cur != '\n' && *Cur != '\r'))
+    return 0;
+  return skipNewline(Cur) - Ptr;
+}
+
+const char *ExcludedBlockScanner::skipNewline(const char *Ptr) const {
+  assert(*Ptr == '\n' || *Ptr == '\r');
+  // "\r\n" and "\n\r" are a single newline.
+  if (Ptr + 1 != BufferEnd && (Ptr[1] == '\n' || Ptr[1] == '\r') &&
+      Ptr[1] != Ptr[0])
+    return Ptr + 2;
+  return Ptr + 1;
+}
+
+/// Skip a '//' comment, returning the newline that ends it.
+const char *ExcludedBlockScanner::skipLineComment(const char *Ptr) const {
+  const char *Cur = Ptr + 2;
+  while ((Cur = findSpecialChar(Cur)) != BufferEnd) {
+    if (*Cur == '\n' || *Cur == '\r')
+      return Cur;
+    if (*Cur == '\\')
+      if (unsigned Size = getEscapedNewlineSize(Cur)) {
+        Cur += Size;
+        continue;
+      }
+    ++Cur;
+  }
+  return BufferEnd;
+}
+
+/// Skip a '/*' comment, returning the character after it, or null if the end
+/// of the comment cannot be found without the lexer.
+const char *ExcludedBlockScanner::skipBlockComment(const char *Ptr) const {
+  // The '/' of "/*/" does not end the comment.
+  const char *Cur = Ptr + 3;
+  while (Cur < BufferEnd) {
+    Cur = static_cast<const char *>(memchr(Cur, '/', BufferEnd - Cur));
+    if (!Cur)
+      return nullptr;
+    if (Cur[-1] == '*')
+      return Cur + 1;
+    // The '*' may be separated from the '/' by a line splice.
+    if (Cur[-1] == '\n' || Cur[-1] == '\r')
+      return nullptr;
+    ++Cur;
+  }
+  return nullptr;
+}
+
+/// Skip a string or character literal, returning the character after the
+/// closing quote, or the newline that ends an unterminated literal. Returns
+/// null if the literal cannot be skipped without the lexer.
+const char *ExcludedBlockScanner::skipLiteral(const char *Ptr) const {
+  const char Quote = *Ptr;
+  const char *Cur = Ptr + 1;
+  while ((Cur = findSpecialChar(Cur)) != BufferEnd) {
+    char C = *Cur;
+    if (C == Quote)
+      return Cur + 1;
+    if (C == '\n' || C == '\r')
+      return Cur;
+    if (C != '\\') {
+      ++Cur;
+      continue;
+    }
+    if (unsigned Size = getEscapedNewlineSize(Cur)) {
+      Cur += Size;
+      continue;
+    }
+    // An escape sequence whose second character starts a line splice.
+    if (Cur[1] == '\\' && getEscapedNewlineSize(Cur + 1))
+      return nullptr;
+    Cur = std::min(Cur + 2, BufferEnd);
+  }
+  return BufferEnd;
+}
+
+/// Returns true if the quote at \p Ptr is a digit separator, or sets
+/// \p Ambiguous if that cannot be decided without the lexer. \p LastSeparator
+/// is the previous quote this scan classified as a digit separator.
+bool ExcludedBlockScanner::isDigitSeparator(const char *Ptr,
+                                            const char *LastSeparator,
+                                            bool &Ambiguous) const {
+  // Find the run of identifier and number characters before the quote.
+  const char *Begin = Ptr;
+  while (Begin != BufferStart &&
+         (isAsciiIdentifierContinue(Begin[-1], /*AllowDollar=*/true) ||
+          Begin[-1] == '.'))
+    --Begin;
+
+  // Split the run into tokens the way the lexer would; only a number that
+  // reaches the quote can continue past it.
+  bool InNumber = false;
+  if (Begin != BufferStart) {
+    char Prev = Begin[-1];
+    if (Begin - 1 == LastSeparator) {
+      InNumber = true;
+    } else if (Prev == '\'' || Prev == '\\' || Prev == '\n' || Prev == '\r' ||
+               !isASCII(Prev) ||
+               ((Prev == '+' || Prev == '-') && Begin - 1 != BufferStart &&
+                StringRef("eEpP").contains(Begin[-2]))) {
+      // The run may continue a token that starts before it.
+      Ambiguous = true;
+      return false;
+    }
+  }
+  const char *Cur = Begin;
+  while (Cur != Ptr) {
+    if (InNumber || isDigit(*Cur) || (*Cur == '.' && isDigit(Cur[1]))) {
+      // A number stops at a '$', which starts an identifier.
+      Cur = std::find(Cur, Ptr, '$');
+      InNumber = Cur == Ptr;
+      continue;
+    }
+    if (*Cur == '.') {
+      ++Cur;
+      continue;
+    }
+    while (Cur != Ptr && isAsciiIdentifierContinue(*Cur, /*AllowDollar=*/true))
+      ++Cur;
+  }
+  if (!InNumber)
+    return false;
+  if (!isASCII(Ptr[1]) || Ptr[1] == '\\') {
+    Ambiguous = true;
+    return false;
+  }
+  return isAsciiIdentifierContinue(Ptr[1]);
+}
+
+ExcludedBlockScanner::Result
+ExcludedBlockScanner::scan(const char *Ptr) const {
+  bool AtLineStart = isAtStartOfLine(Ptr);
+  // The last line start known to be outside any comment or literal.
+  const char *SafeLine = AtLineStart ? Ptr : nullptr;
+  const char *LastSeparator = nullptr;
+  const char *Cur = Ptr;
+
+  while (true) {
+    if (AtLineStart) {
+      // Comments and line splices before the first token of a line do not
+      // change that it is the first token.
+      while (Cur != BufferEnd && isHorizontalWhitespace(*Cur))
+        ++Cur;
+      if (Cur == BufferEnd)
+        return {SafeLine, BufferEnd};
+      char C = *Cur;
+      // A nul or a non-ASCII character may be whitespace to the lexer.
+      if (C == '#' || (Digraphs && C == '%') || C == '\0' || !isASCII(C))
+        return {SafeLine, Cur};
+      if (C == '\\') {
+        if (unsigned Size = getEscapedNewlineSize(Cur)) {
+          Cur += Size;
+          continue;
+        }
+      } else if (C == '/' && Cur[1] == '*') {
+        const char *End = skipBlockComment(Cur);
+        if (!End)
+          return {SafeLine, Cur};
+        Cur = End;
+        continue;
+      }
+      AtLineStart = false;
+    }
+
+    Cur = findSpecialChar(Cur);
+    if (Cur == BufferEnd)
+      return {SafeLine, BufferEnd};
+
+    switch (*Cur) {
+    case '\n':
+    case '\r':
+      Cur = skipNewline(Cur);
+      SafeLine = Cur;
+      AtLineStart = true;
+      continue;
+    case '\\':
+      if (unsigned Size = getEscapedNewlineSize(Cur)) {
+        Cur += Size;
+        // A literal prefix or a number may continue across the splice.
+        if (Cur != BufferEnd && (*Cur == '"' || *Cur == '\''))
+          return {SafeLine, Cur};
+        continue;
+      }
+      ++Cur;
+      continue;
+    case '/':
+      if (Cur[1] == '/') {
+        Cur = skipLineComment(Cur);
+        continue;
+      }
+      if (Cur[1] == '*') {
+        const char *End = skipBlockComment(Cur);
+        if (!End)
+          return {SafeLine, Cur};
+        Cur = End;
+        continue;
+      }
+      // The comment may start after a line splice.
+      if (Cur[1] == '\\')
+        return {SafeLine, Cur};
+      ++Cur;
+      continue;
+    case '\'':
+      if (DigitSeparators) {
+        bool Ambiguous = false;
+        if (isDigitSeparator(Cur, LastSeparator, Ambiguous)) {
+          LastSeparator = Cur++;
+          continue;
+        }
+        if (Ambiguous)
+          return {SafeLine, Cur};
+      }
+      [[fallthrough]];
+    case '"': {
+      // Raw string literals can span lines and contain anything.
+      if (*Cur == '"' && Cur != BufferStart && Cur[-1] == 'R')
+        return {SafeLine, Cur};
+      const char *End = skipLiteral(Cur);
+      if (!End)
+        return {SafeLine, Cur};
+      Cur = End;
+      continue;
+    }
+    default:
+      llvm_unreachable("unexpected special character");
+    }
+  }
+}
+
 /// SkipExcludedConditionalBlock - We just read a \#if or related directive and
 /// decided that the subsequent tokens are in the \#if'd out portion of the
 /// file.  Lex the rest of the file, until we see an \#endif.  If
@@ -574,12 +957,33 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation HashTokenLoc,
     }
   } SkippingRangeState(*this);
 
+  // Scan ahead of the lexer for directive candidates, unless every token
+  // matters (code completion) or the input uses features the scanner does not
+  // model (trigraphs, assembler comments).
+  std::optional<ExcludedBlockScanner> Scanner;
+  if (!CurLexer->isDependencyDirectivesLexer() && !isCodeCompletionEnabled() &&
+      !LangOpts.Trigraphs && !LangOpts.AsmPreprocessor)
+    Scanner.emplace(CurLexer->getBuffer(), LangOpts);
+
   while (true) {
     if (CurLexer->isDependencyDirectivesLexer()) {
       CurLexer->LexDependencyDirectiveTokenWhileSkipping(Tok);
     } else {
       SkippingRangeState.beginLexPass();
+      const char *ResumeScanAfter = nullptr;
       while (true) {
+        // Let the scanner jump over lines that cannot hold a directive.
+        if (Scanner &&
+            (!ResumeScanAfter ||
+             CurLexer->getBufferLocation() > ResumeScanAfter)) {
+          ExcludedBlockScanner::Result R =
+              Scanner->scan(CurLexer->getBufferLocation());
+          if (R.LineStart)
+            CurLexer->seek(R.LineStart - CurLexer->getBuffer().begin(),
+                           /*IsAtStartOfLine*/ true);
+          ResumeScanAfter = R.ResumeAfter;
+        }
+
         CurLexer->Lex(Tok);
 
         if (Tok.is(tok::code_completion)) {
@@ -16,8 +16,12 @@
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Serialization/ASTDeserializationListener.h"
 #include "clang/Serialization/ModuleFile.h"
+#include "clang/Serialization/PCHContainerOperations.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/DJB.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace clang;
@@ -520,3 +524,96 @@ void serialization::updateModuleTimestamp(StringRef ModuleFilename) {
   OS.close();
   OS.clear_error(); // Avoid triggering a fatal error.
 }
+
+// A compressed AST file starts with this magic, followed by the uncompressed
+// size (64 bits), the chunk size and the number of chunks (32 bits each), the
+// compressed size of each chunk (32 bits each) and the compressed chunks. All
+// integers are little-endian.
+static constexpr StringLiteral CompressedASTFileMagic = "CPCZ";
+static constexpr size_t CompressedASTFileHeaderSize = 4 + 8 + 4 + 4;
+static constexpr uint32_t CompressedASTFileChunkSize = 1 << 20;
+
+bool serialization::compressModuleFile(StringRef Data,
+                                       SmallVectorImpl<char> &Out) {
+  using namespace llvm::support;
+  Out.clear();
+  if (!llvm::compression::zstd::isAvailable())
+    return false;
+
+  uint32_t NumChunks = llvm::divideCeil(Data.size(), CompressedASTFileChunkSize);
+  Out.append(CompressedASTFileMagic.begin(), CompressedASTFileMagic.end());
+  Out.resize(CompressedASTFileHeaderSize + 4 * NumChunks);
+  char *Header = Out.data() + CompressedASTFileMagic.size();
+  endian::write64le(Header, Data.size());
+  endian::write32le(Header + 8, CompressedASTFileChunkSize);
+  endian::write32le(Header + 12, NumChunks);
+
+  SmallVector<uint8_t, 0> Chunk;
+  for (uint32_t I = 0; I != NumChunks; ++I) {
+    Chunk.clear();
+    llvm::compression::zstd::compress(
+        llvm::arrayRefFromStringRef(Data.substr(
+            size_t(I) * CompressedASTFileChunkSize, CompressedASTFileChunkSize)),
+        Chunk);
+    endian::write32le(Out.data() + CompressedASTFileHeaderSize + 4 * I,
+                      Chunk.size());
+    Out.append(Chunk.begin(), Chunk.end());
+  }
+  return true;
+}
+
+llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+serialization::decompressModuleFile(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                                    const PCHContainerReader &PCHContainerRdr) {
+  using namespace llvm::support;
+  StringRef Data = PCHContainerRdr.ExtractPCH(*Buffer);
+  if (!Data.starts_with(CompressedASTFileMagic))
+    return std::move(Buffer);
+
+  auto Malformed = [&] {
+    return llvm::createStringError(std::errc::illegal_byte_sequence,
+                                   "malformed compressed AST file '%s'",
+                                   Buffer->getBufferIdentifier().data());
+  };
+  if (const char *Reason = llvm::compression::getReasonIfUnsupported(
+          llvm::compression::Format::Zstd))
+    return llvm::createStringError(std::errc::not_supported,
+                                   "cannot read compressed AST file '%s': %s",
+                                   Buffer->getBufferIdentifier().data(),
+                                   Reason);
+  if (Data.size() < CompressedASTFileHeaderSize)
+    return Malformed();
+  const char *Header = Data.data() + CompressedASTFileMagic.size();
+  uint64_t Size = endian::read64le(Header);
+  uint32_t ChunkSize = endian::read32le(Header + 8);
+  uint32_t NumChunks = endian::read32le(Header + 12);
+  if (ChunkSize == 0 || NumChunks != llvm::divideCeil(Size, ChunkSize) ||
+      (Data.size() - CompressedASTFileHeaderSize) / 4 < NumChunks)
+    return Malformed();
+
+  auto Out = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(
+      Size, Buffer->getBufferIdentifier());
+  if (!Out)
+    return llvm::createStringError(std::errc::not_enough_memory,
+                                   "cannot allocate memory for AST file '%s'",
+                                   Buffer->getBufferIdentifier().data());
+  size_t Pos = CompressedASTFileHeaderSize + 4 * size_t(NumChunks);
+  for (uint32_t I = 0; I != NumChunks; ++I) {
+    uint32_t CompressedSize = endian::read32le(
+        Data.data() + CompressedASTFileHeaderSize + 4 * size_t(I));
+    if (Data.size() - Pos < CompressedSize)
+      return Malformed();
+    uint64_t Offset = uint64_t(I) * ChunkSize;
+    size_t ExpectedSize = std::min<uint64_t>(ChunkSize, Size - Offset);
+    size_t ChunkOutSize = ExpectedSize;
+    if (llvm::Error E = llvm::compression::zstd::decompress(
+            llvm::arrayRefFromStringRef(Data.substr(Pos, CompressedSize)),
+            reinterpret_cast<uint8_t *>(Out->getBufferStart() + Offset),
+            ChunkOutSize))
+      return std::move(E);
+    if (ChunkOutSize != ExpectedSize)
+      return Malformed();
+    Pos += CompressedSize;
+  }
+  return std::move(Out);
+}
@@ -17,9 +17,12 @@
 #include "clang/AST/DeclFriend.h"
 #include "clang/Basic/LLVM.h"
 #include "clang/Serialization/ASTBitCodes.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 namespace clang {
 
+class PCHContainerReader;
+
 namespace serialization {
 
 enum DeclUpdateKind {
@@ -102,6 +105,19 @@ inline bool isPartOfPerModuleInitializer(const Decl *D) {
 
 void updateModuleTimestamp(StringRef ModuleFilename);
 
+/// Compresses the AST file \p Data for -fcompress-modules into \p Out.
+///
+/// The file is split into fixed-size chunks that are compressed independently
+/// with zstd. Returns false, leaving \p Out empty, if zstd is not available.
+bool compressModuleFile(StringRef Data, SmallVectorImpl<char> &Out);
+
+/// If the AST file in \p Buffer was compressed by compressModuleFile(),
+/// returns a buffer with its decompressed contents. Otherwise returns
+/// \p Buffer itself.
+llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+decompressModuleFile(std::unique_ptr<llvm::MemoryBuffer> Buffer,
+                     const PCHContainerReader &PCHContainerRdr);
+
 } // namespace serialization
 
 } // namespace clang
@@ -5539,9 +5539,16 @@ std::string ASTReader::getOriginalSourceFile(
         << ASTFileName << Buffer.getError().message();
     return std::string();
   }
+  auto Decompressed =
+      serialization::decompressModuleFile(std::move(*Buffer), PCHContainerRdr);
+  if (!Decompressed) {
+    Diags.Report(diag::err_fe_unable_to_read_pch_file)
+        << ASTFileName << llvm::toString(Decompressed.takeError());
+    return std::string();
+  }
 
   // Initialize the stream
-  BitstreamCursor Stream(PCHContainerRdr.ExtractPCH(**Buffer));
+  BitstreamCursor Stream(PCHContainerRdr.ExtractPCH(**Decompressed));
 
   // Sniff for the signature.
   if (llvm::Error Err = doesntStartWithASTFileMagic(Stream)) {
@@ -5667,7 +5674,13 @@ bool ASTReader::readASTFileControlBlock(
     auto BufferOrErr = FileMgr.getBufferForFile(Filename);
     if (!BufferOrErr)
       return true;
-    OwnedBuffer = std::move(*BufferOrErr);
+    auto Decompressed = serialization::decompressModuleFile(
+        std::move(*BufferOrErr), PCHContainerRdr);
+    if (!Decompressed) {
+      consumeError(Decompressed.takeError());
+      return true;
+    }
+    OwnedBuffer = std::move(*Decompressed);
     Buffer = OwnedBuffer.get();
   }
 
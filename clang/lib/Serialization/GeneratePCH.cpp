@@ -11,6 +11,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "ASTCommon.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/Basic/DiagnosticFrontend.h"
 #include "clang/Lex/HeaderSearch.h"
@@ -86,6 +87,15 @@ void PCHGenerator::HandleTranslationUnit(ASTContext &Ctx) {
   Buffer->Signature = Writer.WriteAST(Subject, OutputFile, Module, isysroot,
                                       ShouldCacheASTInMemory);
 
+  // Only the copy that is written out is compressed. The one cached in memory
+  // above stays uncompressed.
+  if (PP.getLangOpts().CompressModules) {
+    SmallVector<char, 0> Compressed;
+    if (serialization::compressModuleFile(
+            StringRef(Buffer->Data.data(), Buffer->Data.size()), Compressed))
+      Buffer->Data = std::move(Compressed);
+  }
+
   Buffer->IsComplete = true;
 }
 
@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Serialization/GlobalModuleIndex.h"
+#include "ASTCommon.h"
 #include "ASTReaderInternals.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Serialization/ASTBitCodes.h"
@@ -524,9 +525,13 @@ llvm::Error GlobalModuleIndexBuilder::loadModuleFile(FileEntryRef File) {
   if (!Buffer)
     return llvm::createStringError(Buffer.getError(),
                                    "failed getting buffer for module file");
+  auto Decompressed =
+      serialization::decompressModuleFile(std::move(*Buffer), PCHContainerRdr);
+  if (!Decompressed)
+    return Decompressed.takeError();
 
   // Initialize the input stream
-  llvm::BitstreamCursor InStream(PCHContainerRdr.ExtractPCH(**Buffer));
+  llvm::BitstreamCursor InStream(PCHContainerRdr.ExtractPCH(**Decompressed));
 
   // Sniff for the signature.
   for (unsigned char C : {'C', 'P', 'C', 'H'})
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Serialization/ModuleManager.h"
+#include "ASTCommon.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/LLVM.h"
 #include "clang/Lex/HeaderSearch.h"
@@ -182,7 +183,14 @@ ModuleManager::addModule(StringRef FileName, ModuleKind Type,
   // Load the contents of the module
   if (std::unique_ptr<llvm::MemoryBuffer> Buffer = lookupBuffer(FileName)) {
     // The buffer was already provided for us.
-    NewModule->Buffer = &ModuleCache->addBuiltPCM(FileName, std::move(Buffer));
+    auto Decompressed =
+        serialization::decompressModuleFile(std::move(Buffer), PCHContainerRdr);
+    if (!Decompressed) {
+      ErrorStr = llvm::toString(Decompressed.takeError());
+      return Missing;
+    }
+    NewModule->Buffer =
+        &ModuleCache->addBuiltPCM(FileName, std::move(*Decompressed));
     // Since the cached buffer is reused, it is safe to close the file
     // descriptor that was opened while stat()ing the PCM in
     // lookupModuleFile() above, it won't be needed any longer.
@@ -213,7 +221,17 @@ ModuleManager::addModule(StringRef FileName, ModuleKind Type,
       return Missing;
     }
 
-    NewModule->Buffer = &getModuleCache().addPCM(FileName, std::move(*Buf));
+    // Compressed module files are decompressed once here, so that the module
+    // cache shares the decompressed contents across compiler instances.
+    auto Decompressed =
+        serialization::decompressModuleFile(std::move(*Buf), PCHContainerRdr);
+    if (!Decompressed) {
+      ErrorStr = llvm::toString(Decompressed.takeError());
+      return Missing;
+    }
+
+    NewModule->Buffer =
+        &getModuleCache().addPCM(FileName, std::move(*Decompressed));
   }
 
   // Initialize the stream.
@@ -0,0 +1,19 @@
+// RUN: %clang -### -c -fcache-directory-listings \
+// RUN:   -fdirectory-listing-cache-path=%t/listings %s 2>&1 | FileCheck %s
+// CHECK: "-cc1"
+// CHECK-SAME: "-fcache-directory-listings"
+// CHECK-SAME: "-fdirectory-listing-cache-path={{[^"]*}}listings"
+
+// RUN: %clang -### -c -fcache-directory-listings -fno-cache-directory-listings \
+// RUN:   %s 2>&1 | FileCheck %s --check-prefix=OFF
+// OFF-NOT: "-fcache-directory-listings"
+
+// Lookups through the include path still find the headers that exist.
+// RUN: rm -rf %t && mkdir -p %t/a %t/b %t/listings
+// RUN: echo 'int from_b;' > %t/b/header.h
+// RUN: %clang_cc1 -fsyntax-only -fcache-directory-listings \
+// RUN:   -fdirectory-listing-cache-path=%t/listings -I%t/a -I%t/b %s
+// RUN: %clang_cc1 -fsyntax-only -fcache-directory-listings \
+// RUN:   -fdirectory-listing-cache-path=%t/listings -I%t/a -I%t/b %s
+#include "header.h"
+int use = from_b;
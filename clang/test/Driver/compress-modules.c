@@ -0,0 +1,7 @@
+// RUN: %clang -### -fcompress-modules -c %s 2>&1 | FileCheck %s
+// CHECK: "-fcompress-modules"
+
+// RUN: %clang -### -fcompress-modules -fno-compress-modules -c %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=NO %s
+// RUN: %clang -### -c %s 2>&1 | FileCheck --check-prefix=NO %s
+// NO-NOT: "-fcompress-modules"
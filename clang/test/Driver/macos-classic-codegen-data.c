@@ -0,0 +1,22 @@
+// Check that codegen data flags reach the backend and the PEF linker for
+// Classic Mac OS.
+
+// RUN: %clang --target=powerpc-apple-classic -fcodegen-data-generate %s -### \
+// RUN:   2>&1 | FileCheck %s --check-prefix=GENERATE
+// GENERATE: "-cc1" {{.*}}"-mllvm" "-codegen-data-generate"
+// GENERATE-NOT: "-codegen-data-generate"
+// GENERATE: "-flavor" "pef" {{.*}}"--codegen-data-generate-path=default.cgdata"
+
+// RUN: %clang --target=powerpc-apple-classic -fcodegen-data-generate=%t.cgdata \
+// RUN:   %s -### 2>&1 | FileCheck %s --check-prefix=GENERATE-PATH
+// GENERATE-PATH: "--codegen-data-generate-path={{.*}}.cgdata"
+
+// RUN: %clang --target=powerpc-apple-classic -fcodegen-data-use=%t.cgdata -c \
+// RUN:   %s -### 2>&1 | FileCheck %s --check-prefix=USE
+// USE: "-cc1" {{.*}}"-mllvm" "-codegen-data-use-path={{.*}}.cgdata"
+// USE-NOT: "-codegen-data-use-path=
+// USE-NOT: "-codegen-data-generate"
+
+// RUN: not %clang --target=powerpc-apple-classic -fcodegen-data-generate \
+// RUN:   -fcodegen-data-use -c %s -### 2>&1 | FileCheck %s --check-prefix=CONFLICT
+// CONFLICT: error: invalid argument '-fcodegen-data-generate={{.*}}' not allowed with '-fcodegen-data-use={{.*}}'
@@ -0,0 +1,62 @@
+// Check that the classic Mac OS toolchain serves the Universal Interfaces
+// prefix from a cached PCH when -fclassic-mac-pch is given.
+
+// RUN: rm -rf %t && mkdir -p %t/sysroot/include
+
+// By default MacHeadersCompat.h is included textually.
+// RUN: %clang -### --target=powerpc-apple-classic --sysroot=%t/sysroot \
+// RUN:   -c %s 2>&1 | FileCheck %s --check-prefix=TEXTUAL
+// RUN: %clang -### --target=powerpc-apple-classic --sysroot=%t/sysroot \
+// RUN:   -fclassic-mac-pch -fclassic-mac-pch-cache-path=%t/cache -E %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=TEXTUAL
+// TEXTUAL: "-cc1"
+// TEXTUAL-NOT: "-include-pch"
+// TEXTUAL-SAME: "-include" "{{[^"]*}}MacHeadersCompat.h"
+// TEXTUAL-NOT: "-include-pch"
+
+// The compat header keeps its place after the user's own -include flags.
+// RUN: %clang -### --target=powerpc-apple-classic --sysroot=%t/sysroot \
+// RUN:   -include user.h -c %s 2>&1 | FileCheck %s --check-prefix=ORDER
+// RUN: %clang -### --target=powerpc-apple-classic --sysroot=%t/sysroot \
+// RUN:   -fclassic-mac-pch -fclassic-mac-pch-cache-path=%t/cache \
+// RUN:   -include user.h -c %s 2>&1 | FileCheck %s --check-prefix=ORDER
+// ORDER: "-cc1"
+// ORDER-SAME: "-include" "user.h"
+// ORDER-SAME: "-include" "{{[^"]*}}MacHeadersCompat.h"
+
+// A missing cache entry is built once per compilation, ahead of the compiles
+// that load it. The driver creates the cache directory for the -emit-pch job,
+// except under -###.
+// RUN: rm -rf %t/cache
+// RUN: %clang -### --target=powerpc-apple-classic --sysroot=%t/sysroot \
+// RUN:   -fclassic-mac-pch -fclassic-mac-pch-cache-path=%t/cache -c %s %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=BUILD
+// BUILD: "-cc1" {{.*}}"-emit-pch"
+// BUILD-SAME: "-o" "[[PCH:[^"]*cache[/\\]MacHeaders-[0-9a-f]+\.pch]]" "-x" "c-header" "{{[^"]*}}MacHeaders.h"
+// BUILD-NOT: "-emit-pch"
+// BUILD: "-cc1" {{.*}}"-include-pch" "[[PCH]]"
+// BUILD-NOT: "-emit-pch"
+// BUILD: "-cc1" {{.*}}"-include-pch" "[[PCH]]"
+// RUN: not test -e %t/cache
+
+// The user's -include headers stay out of the PCH and its cache key.
+// RUN: %clang -### --target=powerpc-apple-classic --sysroot=%t/sysroot \
+// RUN:   -fclassic-mac-pch -fclassic-mac-pch-cache-path=%t/cache -c %s \
+// RUN:   > %t/key.txt 2>&1
+// RUN: %clang -### --target=powerpc-apple-classic --sysroot=%t/sysroot \
+// RUN:   -fclassic-mac-pch -fclassic-mac-pch-cache-path=%t/cache \
+// RUN:   -include user.h -c %s >> %t/key.txt 2>&1
+// RUN: FileCheck %s --check-prefix=KEY < %t/key.txt
+// KEY: "-cc1" {{.*}}"-emit-pch"
+// KEY-SAME: "-o" "[[KEYPCH:[^"]*MacHeaders-[0-9a-f]+\.pch]]"
+// KEY: "-cc1" {{.*}}"-emit-pch"
+// KEY-NOT: "user.h"
+// KEY-SAME: "-o" "[[KEYPCH]]"
+// KEY: "-cc1" {{.*}}"-include" "user.h"
+
+// C++ compiles use their own cache entry.
+// RUN: %clang -### --target=powerpc-apple-classic --sysroot=%t/sysroot \
+// RUN:   -fclassic-mac-pch -fclassic-mac-pch-cache-path=%t/cache -c -x c++ %s \
+// RUN:   2>&1 | FileCheck %s --check-prefix=CXX
+// CXX: "-emit-pch" {{.*}}"-x" "c++-header" "{{[^"]*}}MacHeaders.h"
+// CXX: "-include-pch"
@@ -0,0 +1,21 @@
+// Check that -moutline enables the MachineOutliner on 32-bit PowerPC and M68k,
+// and is still ignored for the PowerPC targets it doesn't support.
+
+// RUN: %clang --target=powerpc-unknown-linux-gnu -moutline -c %s -### 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=ON
+// RUN: %clang --target=powerpc-apple-classic -moutline -c %s -### 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=ON
+// RUN: %clang --target=m68k-unknown-linux-gnu -moutline -c %s -### 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=ON
+// ON: "-mllvm" "-enable-machine-outliner"
+
+// RUN: %clang --target=powerpc-unknown-linux-gnu -moutline -mno-outline -c %s \
+// RUN:   -### 2>&1 | FileCheck %s --check-prefix=OFF
+// OFF: "-mllvm" "-enable-machine-outliner=never"
+
+// RUN: %clang --target=powerpc64-unknown-linux-gnu -moutline -c %s -### 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=WARN
+// RUN: %clang --target=powerpc-ibm-aix -moutline -c %s -### 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=WARN
+// WARN: warning: '{{powerpc|powerpc64}}' does not support '-moutline'; flag ignored
+// WARN-NOT: "-enable-machine-outliner"
@@ -0,0 +1,28 @@
+// RUN: rm -rf %t && split-file %s %t
+
+// RUN: not %clang -### -fparallel-jobs=many -fsyntax-only %t/a.c 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=INVALID
+// INVALID: error: invalid integral value 'many' in '-fparallel-jobs=many'
+
+// Output of jobs running in parallel is printed per job, in job order.
+// RUN: %clang -fparallel-jobs=2 -fsyntax-only %t/a.c %t/b.c %t/c.c 2>&1 \
+// RUN:   | FileCheck %s
+// CHECK: a.c:1:2: warning: first
+// CHECK: b.c:1:2: warning: second
+// CHECK: c.c:1:2: warning: third
+
+// A failing job does not stop the independent ones.
+// RUN: not %clang -fparallel-jobs=0 -fsyntax-only %t/a.c %t/bad.c %t/c.c \
+// RUN:   2>&1 | FileCheck %s --check-prefix=FAIL
+// FAIL: a.c:1:2: warning: first
+// FAIL: bad.c:1:2: error: broken
+// FAIL: c.c:1:2: warning: third
+
+//--- a.c
+#warning first
+//--- b.c
+#warning second
+//--- c.c
+#warning third
+//--- bad.c
+#error broken
@@ -0,0 +1,40 @@
+// REQUIRES: zstd
+//
+// RUN: rm -rf %t
+// RUN: split-file %s %t
+//
+// Explicitly built modules are written compressed and can be imported.
+// RUN: %clang_cc1 -fmodules -fcompress-modules -fmodule-name=a -x c++ \
+// RUN:   -emit-module %t/module.modulemap -o %t/a.pcm
+// RUN: head -c 4 %t/a.pcm | FileCheck --check-prefix=MAGIC %s
+// MAGIC: CPCZ
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -I %t \
+// RUN:   -fmodule-file=%t/a.pcm -fsyntax-only -verify %t/use.cpp
+//
+// So are implicitly built ones.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -fcompress-modules -I %t \
+// RUN:   -fmodules-cache-path=%t/cache -fsyntax-only -verify %t/use.cpp
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -I %t \
+// RUN:   -fmodules-cache-path=%t/cache -fsyntax-only -verify %t/use.cpp
+//
+// And precompiled headers.
+// RUN: %clang_cc1 -fcompress-modules -x c++-header -emit-pch %t/a.h \
+// RUN:   -o %t/a.h.pch
+// RUN: head -c 4 %t/a.h.pch | FileCheck --check-prefix=MAGIC %s
+// RUN: %clang_cc1 -include-pch %t/a.h.pch -fsyntax-only -verify %t/use-pch.cpp
+
+//--- module.modulemap
+module a { header "a.h" }
+
+//--- a.h
+template <typename T> struct Box { T Value; };
+inline int answer() { return Box<int>{42}.Value; }
+
+//--- use.cpp
+// expected-no-diagnostics
+#include "a.h"
+int x = answer();
+
+//--- use-pch.cpp
+// expected-no-diagnostics
+int x = answer();
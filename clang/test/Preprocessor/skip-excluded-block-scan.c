@@ -0,0 +1,59 @@
+// RUN: %clang_cc1 -E %s | FileCheck %s
+// RUN: %clang_cc1 -E -x c++ -std=c++14 %s | FileCheck %s --check-prefixes=CHECK,CXX
+
+// Check that lines which only look like directives are not taken as such
+// while skipping excluded blocks.
+
+#if 0
+/*
+#else
+bad
+*/
+// line comment \
+#else
+"string \
+#else"
+'#' "#else" #else
+  /* comment */ # /* comment */ else
+ok1
+#endif
+// CHECK-NOT: bad
+// CHECK: ok1
+
+#if 0
+"/*"
+#else
+ok2
+#endif
+// CHECK: ok2
+
+#if 0
+/* comment \
+*/ x /*
+#else
+bad
+*/
+#elif 1
+ok3
+#endif
+// CHECK: ok3
+
+#if __cplusplus >= 201402L
+#if 0
+x = 1'000'000; /*
+#else
+bad
+*/
+#else
+ok4
+#endif
+#endif
+// CHECK-NOT: bad
+// CXX: ok4
+
+#if 0
+#\
+else
+ok5
+#endif
+// CHECK: ok5
@@ -10,6 +10,7 @@
 #include "clang/Basic/FileSystemOptions.h"
 #include "clang/Basic/FileSystemStatCache.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Testing/Support/Error.h"
@@ -578,4 +579,37 @@ TEST_F(FileManagerTest, getBypassFile) {
   EXPECT_EQ(&FE, &SearchRef->getFileEntry());
 }
 
+TEST_F(FileManagerTest, cachedDirListingsSkipStatsOfMissingFiles) {
+  auto InMemFS = makeIntrusiveRefCnt<vfs::InMemoryFileSystem>();
+  InMemFS->addFile("/inc/a.h", 0, MemoryBuffer::getMemBuffer(""));
+  InMemFS->addFile("/inc/sys/b.h", 0, MemoryBuffer::getMemBuffer(""));
+  auto FS = makeIntrusiveRefCnt<vfs::TracingFileSystem>(InMemFS);
+
+  FileSystemOptions Opts;
+  Opts.CacheDirectoryListings = true;
+  FileManager Manager(Opts, FS);
+
+  ASSERT_TRUE(Manager.getOptionalFileRef("/inc/a.h"));
+  EXPECT_EQ(FS->NumDirBeginCalls, 1u);
+  std::size_t NumStatusCalls = FS->NumStatusCalls;
+
+  // Files and directories missing from the listing of /inc are not stat'ed.
+  EXPECT_FALSE(Manager.getOptionalFileRef("/inc/missing.h"));
+  EXPECT_FALSE(Manager.getOptionalFileRef("/inc/none/c.h"));
+  EXPECT_EQ(FS->NumStatusCalls, NumStatusCalls);
+  EXPECT_EQ(FS->NumDirBeginCalls, 1u);
+
+  // Names that differ only in case are stat'ed.
+  EXPECT_FALSE(Manager.getOptionalFileRef("/inc/A.h"));
+  EXPECT_GT(FS->NumStatusCalls, NumStatusCalls);
+
+  ASSERT_TRUE(Manager.getOptionalFileRef("/inc/sys/b.h"));
+  EXPECT_EQ(FS->NumDirBeginCalls, 2u);
+
+  // Lookups that do not cache failures see files added after the listing.
+  InMemFS->addFile("/inc/new.h", 0, MemoryBuffer::getMemBuffer(""));
+  EXPECT_TRUE(Manager.getOptionalFileRef("/inc/new.h", /*OpenFile=*/false,
+                                         /*CacheFailure=*/false));
+}
+
 } // anonymous namespace
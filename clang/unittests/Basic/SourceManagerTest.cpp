@@ -244,6 +244,34 @@ TEST_F(SourceManagerTest, isBeforeInTranslationUnitWithTokenSplit) {
   EXPECT_FALSE(SourceMgr.isBeforeInTranslationUnit(Greater2, Greater1));
 }
 
+TEST_F(SourceManagerTest, getFileIDForManyExpansions) {
+  std::string Main(5000, 'x');
+  FileID MainFileID =
+      SourceMgr.createFileID(llvm::MemoryBuffer::getMemBuffer(Main));
+  SourceMgr.setMainFileID(MainFileID);
+  SourceLocation Spelling = SourceMgr.getLocForStartOfFile(MainFileID);
+
+  // Expansions of varying lengths, some spanning several index pages.
+  std::vector<std::pair<SourceLocation, unsigned>> Expansions;
+  for (unsigned I = 0; I < 3000; ++I) {
+    unsigned Length = (I * 37) % 101 + (I % 500 == 0 ? 3000 : 0);
+    SourceLocation Loc = SourceMgr.createExpansionLoc(Spelling, Spelling,
+                                                      Spelling, Length);
+    Expansions.emplace_back(Loc, Length);
+  }
+
+  int FirstExpansionID = SourceMgr.local_sloc_entry_size() - Expansions.size();
+  // Look the locations up back to front, to avoid the one-entry cache.
+  for (unsigned I = Expansions.size(); I-- > 0;) {
+    FileID Expected =
+        SourceManagerTestHelper::makeFileID(FirstExpansionID + int(I));
+    auto [Loc, Length] = Expansions[I];
+    EXPECT_EQ(SourceMgr.getFileID(Loc), Expected);
+    EXPECT_EQ(SourceMgr.getFileID(Loc.getLocWithOffset(Length)), Expected);
+  }
+  EXPECT_EQ(SourceMgr.getFileID(Spelling.getLocWithOffset(4000)), MainFileID);
+}
+
 TEST_F(SourceManagerTest, getColumnNumber) {
   const char *Source =
     "int x;\n"
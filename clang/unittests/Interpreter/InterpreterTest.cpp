@@ -21,10 +21,15 @@
 #include "clang/Interpreter/Value.h"
 #include "clang/Sema/Lookup.h"
 #include "clang/Sema/Sema.h"
+#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+#include <mutex>
+#include <set>
+
 using namespace clang;
 
 int Global = 42;
@@ -381,6 +386,57 @@ TEST_F(InterpreterTest, Value) {
   EXPECT_TRUE(V9.isManuallyAlloc());
 }
 
+TEST_F(InterpreterTest, LazyCompilation) {
+  auto CB = clang::IncrementalCompilerBuilder();
+  CB.SetCompilerArgs({"-Xclang", "-emit-llvm-only"});
+  auto CI = cantFail(CB.CreateCpp());
+  JITConfig Config;
+  Config.LazyCompilation = true;
+  Config.NumCompileThreads = 2;
+  std::unique_ptr<Interpreter> Interp =
+      cantFail(clang::Interpreter::create(std::move(CI), Config));
+
+  // Record the functions whose bodies the JIT compiled.
+  std::mutex CompiledMutex;
+  std::set<std::string> Compiled;
+  auto IsCompiled = [&](llvm::StringRef Name) {
+    std::lock_guard<std::mutex> Lock(CompiledMutex);
+    return Compiled.count(Name.str()) != 0;
+  };
+  llvm::orc::LLJIT &JIT = cantFail(Interp->getExecutionEngine());
+  JIT.getIRCompileLayer().setNotifyCompiled(
+      [&](llvm::orc::MaterializationResponsibility &,
+          llvm::orc::ThreadSafeModule TSM) {
+        TSM.withModuleDo([&](llvm::Module &M) {
+          std::lock_guard<std::mutex> Lock(CompiledMutex);
+          for (const llvm::Function &F : M)
+            if (!F.isDeclaration())
+              Compiled.insert(F.getName().str());
+        });
+      });
+
+  llvm::cantFail(
+      Interp->ParseAndExecute("extern \"C\" int square(int x) { return x * x; }"
+                              "extern \"C\" int unused() { return 0; }"));
+  llvm::cantFail(Interp->ParseAndExecute(
+      "extern \"C\" int twice(int x) { return x + x; }"));
+  EXPECT_FALSE(IsCompiled("square"));
+  EXPECT_FALSE(IsCompiled("twice"));
+
+  Value V;
+  llvm::cantFail(Interp->ParseAndExecute("square(twice(3))", &V));
+  EXPECT_TRUE(V.isValid());
+  EXPECT_EQ(V.getInt(), 36);
+  EXPECT_TRUE(IsCompiled("square"));
+  EXPECT_TRUE(IsCompiled("twice"));
+  // A function that was never called has not been compiled.
+  EXPECT_FALSE(IsCompiled("unused"));
+
+  llvm::cantFail(Interp->ParseAndExecute("unused()", &V));
+  EXPECT_EQ(V.getInt(), 0);
+  EXPECT_TRUE(IsCompiled("unused"));
+}
+
 TEST_F(InterpreterTest, TranslationUnit_CanonicalDecl) {
   std::vector<const char *> Args;
   std::unique_ptr<Interpreter> Interp = createInterpreter(Args);
@@ -403,6 +403,7 @@ struct Config {
   llvm::CodeGenOptLevel ltoCgo;
   unsigned optimize;
   StringRef thinLTOJobs;
+  int64_t thinLTOCacheMemoryLimit;
   unsigned timeTraceGranularity;
   int32_t splitStackAdjustSize;
   SmallVector<uint8_t, 0> packageMetadata;
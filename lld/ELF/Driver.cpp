@@ -1450,6 +1450,8 @@ static void readConfigs(Ctx &ctx, opt::InputArgList &args) {
   ctx.arg.target1Rel = args.hasFlag(OPT_target1_rel, OPT_target1_abs, false);
   ctx.arg.target2 = getTarget2(ctx, args);
   ctx.arg.thinLTOCacheDir = args.getLastArgValue(OPT_thinlto_cache_dir);
+  ctx.arg.thinLTOCacheMemoryLimit =
+      args::getInteger(args, OPT_thinlto_cache_memory_limit, 0);
   ctx.arg.thinLTOCachePolicy = CHECK(
       parseCachePruningPolicy(args.getLastArgValue(OPT_thinlto_cache_policy)),
       "--thinlto-cache-policy: invalid cache policy");
@@ -1716,6 +1718,8 @@ static void readConfigs(Ctx &ctx, opt::InputArgList &args) {
 
   if (ctx.arg.splitStackAdjustSize < 0)
     ErrAlways(ctx) << "--split-stack-adjust-size: size must be >= 0";
+  if (ctx.arg.thinLTOCacheMemoryLimit < 0)
+    ErrAlways(ctx) << "--thinlto-cache-memory-limit: size must be >= 0";
 
   // The text segment is traditionally the first segment, whose address equals
   // the base address. However, lld places the R PT_LOAD first. -Ttext-segment
@@ -317,15 +317,19 @@ SmallVector<std::unique_ptr<InputFile>, 0> BitcodeCompiler::compile() {
 
   // The --thinlto-cache-dir option specifies the path to a directory in which
   // to cache native object files for ThinLTO incremental builds. If a path was
-  // specified, configure LTO to use it as the cache directory.
+  // specified, configure LTO to use it as the cache directory. With
+  // --thinlto-cache-memory-limit, entries are also kept in memory so that
+  // tasks sharing a cache key don't read them back from the directory.
   FileCache cache;
   if (!ctx.arg.thinLTOCacheDir.empty())
-    cache = check(localCache("ThinLTO", "Thin", ctx.arg.thinLTOCacheDir,
-                             [&](size_t task, const Twine &moduleName,
-                                 std::unique_ptr<MemoryBuffer> mb) {
-                               files[task] = std::move(mb);
-                               filenames[task] = moduleName.str();
-                             }));
+    cache = check(localCache(
+        "ThinLTO", "Thin", ctx.arg.thinLTOCacheDir,
+        [&](size_t task, const Twine &moduleName,
+            std::unique_ptr<MemoryBuffer> mb) {
+          files[task] = std::move(mb);
+          filenames[task] = moduleName.str();
+        },
+        ctx.arg.thinLTOCacheMemoryLimit));
 
   if (!ctx.bitcodeFiles.empty())
     checkError(ctx.e, ltoObj->run(
@@ -35,6 +35,9 @@ struct Config {
   bool verbose = false;
   bool allowUndefined = false;
   bool exportDynamic = false;  // Export symbols from executables
+
+  // Merged codegen data output path
+  llvm::StringRef codegenDataGeneratePath;
 };
 
 // The global configuration
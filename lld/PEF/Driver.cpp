@@ -22,6 +22,8 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/BinaryFormat/PEF.h"
+#include "llvm/CGData/CodeGenDataReader.h"
+#include "llvm/CGData/CodeGenDataWriter.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/CommandLine.h"
@@ -29,6 +31,7 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/TimeProfiler.h"
 
 using namespace llvm;
 using namespace llvm::opt;
@@ -140,6 +143,10 @@ static void parseArgs(CommonLinkerContext &ctx, const InputArgList &args) {
   for (const Arg *arg : args.filtered(OPT_weak_l))
     config->weakLibraries.push_back(arg->getValue());
 
+  // Codegen data
+  config->codegenDataGeneratePath =
+      args.getLastArgValue(OPT_codegen_data_generate_path);
+
   // Input files (positional arguments)
   for (const Arg *arg : args.filtered(OPT_INPUT))
     config->inputFiles.push_back(arg->getValue());
@@ -209,6 +216,44 @@ static std::string searchLibrary(StringRef name) {
   return ""; // Not found
 }
 
+// Merge the codegen data sections (outlined hash trees and stable function
+// maps) of all input objects into a single .cgdata file. The sections are not
+// instantiated, so they never reach the output image.
+static void codegenDataGenerate(ArrayRef<InputFile *> files) {
+  TimeTraceScope timeScope("Generating codegen data");
+
+  OutlinedHashTreeRecord globalOutlineRecord;
+  StableFunctionMapRecord globalMergeRecord;
+  for (InputFile *file : files) {
+    auto *obj = dyn_cast<ObjFile>(file);
+    if (!obj || !obj->getPEFObj())
+      continue;
+    if (Error e = CodeGenDataReader::mergeFromObjectFile(
+            obj->getPEFObj(), globalOutlineRecord, globalMergeRecord))
+      error("fail to read CGData from " + obj->getName() + ": " +
+            toString(std::move(e)));
+  }
+
+  globalMergeRecord.finalize();
+
+  CodeGenDataWriter writer;
+  if (!globalOutlineRecord.empty())
+    writer.addRecord(globalOutlineRecord);
+  if (!globalMergeRecord.empty())
+    writer.addRecord(globalMergeRecord);
+
+  std::error_code ec;
+  StringRef fileName = config->codegenDataGeneratePath;
+  raw_fd_ostream output(fileName, ec, fs::OF_None);
+  if (ec) {
+    error("fail to create " + fileName + ": " + ec.message());
+    return;
+  }
+
+  if (Error e = writer.write(output))
+    error("fail to write CGData: " + toString(std::move(e)));
+}
+
 bool link(ArrayRef<const char *> argsArr, llvm::raw_ostream &stdoutOS,
           llvm::raw_ostream &stderrOS, bool exitEarly, bool disableOutput) {
   // This driver-specific context will be freed later by unsafeLldMain().
@@ -522,6 +567,9 @@ bool link(ArrayRef<const char *> argsArr, llvm::raw_ostream &stdoutOS,
     writeResult(outputSections);
   }
 
+  if (errorCount() == 0 && !config->codegenDataGeneratePath.empty())
+    codegenDataGenerate(files);
+
   return errorCount() == 0;
 }
 
@@ -66,8 +66,15 @@ struct CompileUnitIdentifiers {
   const char *DWOName = "";
 };
 
+/// Merge \p Inputs into a DWARF package emitted to \p Out. Inputs are read,
+/// decompressed and have their strings hashed on \p NumThreads threads (0
+/// selects one per hardware thread), a bounded number of inputs ahead of the
+/// one being merged. Merging itself is sequential, so the output does not
+/// depend on the number of threads. Memory use is still proportional to the
+/// size of the package: \p Out holds the emitted sections until it is
+/// finished, and the string pool keeps a copy of every unique string.
 Error write(MCStreamer &Out, ArrayRef<std::string> Inputs,
-            OnCuIndexOverflow OverflowOptValue);
+            OnCuIndexOverflow OverflowOptValue, unsigned NumThreads = 1);
 
 unsigned getContributionIndex(DWARFSectionKind Kind, uint32_t IndexVersion);
 
@@ -76,8 +83,7 @@ Error handleSection(
     const MCSection *StrSection, const MCSection *StrOffsetSection,
     const MCSection *TypesSection, const MCSection *CUIndexSection,
     const MCSection *TUIndexSection, const MCSection *InfoSection,
-    const object::SectionRef &Section, MCStreamer &Out,
-    std::deque<SmallString<32>> &UncompressedSections,
+    StringRef Name, StringRef Contents, MCStreamer &Out,
     uint32_t (&ContributionOffsets)[8], UnitIndexEntry &CurEntry,
     StringRef &CurStrSection, StringRef &CurStrOffsetSection,
     std::vector<StringRef> &CurTypesSection,
@@ -92,6 +98,14 @@ void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
                             StringRef CurStrSection,
                             StringRef CurStrOffsetSection, uint16_t Version);
 
+/// Like above, but takes the strings of \p CurStrSection, in order, with their
+/// hashes already computed.
+void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
+                            MCSection *StrOffsetSection,
+                            StringRef CurStrSection,
+                            ArrayRef<CachedHashStringRef> CurStrings,
+                            StringRef CurStrOffsetSection, uint16_t Version);
+
 Error buildDuplicateError(const std::pair<uint64_t, UnitIndexEntry> &PrevE,
                           const CompileUnitIdentifiers &ID, StringRef DWPName);
 
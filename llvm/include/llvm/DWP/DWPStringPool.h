@@ -1,54 +1,48 @@
 #ifndef LLVM_DWP_DWPSTRINGPOOL_H
 #define LLVM_DWP_DWPSTRINGPOOL_H
 
+#include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/MC/MCSection.h"
 #include "llvm/MC/MCStreamer.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
 #include <cassert>
 
 namespace llvm {
 class DWPStringPool {
-
-  struct CStrDenseMapInfo {
-    static inline const char *getEmptyKey() {
-      return reinterpret_cast<const char *>(~static_cast<uintptr_t>(0));
-    }
-    static inline const char *getTombstoneKey() {
-      return reinterpret_cast<const char *>(~static_cast<uintptr_t>(1));
-    }
-    static unsigned getHashValue(const char *Val) {
-      assert(Val != getEmptyKey() && "Cannot hash the empty key!");
-      assert(Val != getTombstoneKey() && "Cannot hash the tombstone key!");
-      return (unsigned)hash_value(StringRef(Val));
-    }
-    static bool isEqual(const char *LHS, const char *RHS) {
-      if (RHS == getEmptyKey())
-        return LHS == getEmptyKey();
-      if (RHS == getTombstoneKey())
-        return LHS == getTombstoneKey();
-      return strcmp(LHS, RHS) == 0;
-    }
-  };
-
   MCStreamer &Out;
   MCSection *Sec;
-  DenseMap<const char *, uint32_t, CStrDenseMapInfo> Pool;
+  // The pool keeps its own copy of every string so that inputs can be released
+  // once they have been merged.
+  BumpPtrAllocator Alloc;
+  StringSaver Saver{Alloc};
+  DenseMap<CachedHashStringRef, uint32_t> Pool;
   uint32_t Offset = 0;
 
 public:
   DWPStringPool(MCStreamer &Out, MCSection *Sec) : Out(Out), Sec(Sec) {}
 
+  /// Returns the offset of \p Str, which excludes the null terminator, in the
+  /// output string section, emitting it if it is new. The hash of \p Str may
+  /// have been computed ahead of time, e.g. on another thread.
+  uint32_t getOffset(CachedHashStringRef Str) {
+    auto It = Pool.find(Str);
+    if (It != Pool.end())
+      return It->second;
+
+    StringRef Saved = Saver.save(Str.val());
+    Pool.try_emplace(CachedHashStringRef(Saved, Str.hash()), Offset);
+    Out.switchSection(Sec);
+    Out.emitBytes(StringRef(Saved.data(), Saved.size() + 1));
+    uint32_t Result = Offset;
+    Offset += Saved.size() + 1;
+    return Result;
+  }
+
   uint32_t getOffset(const char *Str, unsigned Length) {
     assert(strlen(Str) + 1 == Length && "Ensure length hint is correct");
-
-    auto Pair = Pool.insert(std::make_pair(Str, Offset));
-    if (Pair.second) {
-      Out.switchSection(Sec);
-      Out.emitBytes(StringRef(Str, Length));
-      Offset += Length;
-    }
-
-    return Pair.first->second;
+    return getOffset(CachedHashStringRef(StringRef(Str, Length - 1)));
   }
 };
 } // namespace llvm
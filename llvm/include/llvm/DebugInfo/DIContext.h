@@ -209,6 +209,9 @@ struct DIDumpOptions {
   bool IsEH = false;
   bool DumpNonSkeleton = false;
   bool ShowAggregateErrors = false;
+  /// Number of threads verification may use; 0 means one per hardware thread.
+  /// Only takes effect if the DWARFContext is thread-safe.
+  unsigned NumThreads = 1;
   std::string JsonErrSummaryFile;
   std::function<llvm::StringRef(uint64_t DwarfRegNum, bool IsEH)>
       GetNameForDWARFReg;
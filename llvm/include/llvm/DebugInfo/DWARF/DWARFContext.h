@@ -146,6 +146,10 @@ public:
 
   const DWARFObject &getDWARFObj() const { return *DObj; }
 
+  /// Returns true if the context was created with ThreadSafe set, in which
+  /// case its lazily built state may be queried from several threads.
+  bool isThreadSafe() const { return State->isThreadSafe(); }
+
   static bool classof(const DIContext *DICtx) {
     return DICtx->getKind() == CK_DWARF;
   }
@@ -14,8 +14,10 @@
 #include "llvm/DebugInfo/DWARF/DWARFAddressRange.h"
 #include "llvm/DebugInfo/DWARF/DWARFDie.h"
 #include "llvm/DebugInfo/DWARF/DWARFUnitIndex.h"
+#include <atomic>
 #include <cstdint>
 #include <map>
+#include <mutex>
 #include <set>
 
 namespace llvm {
@@ -32,6 +34,7 @@ struct DWARFSection;
 
 class OutputCategoryAggregator {
 private:
+  std::mutex Mutex;
   std::map<std::string, unsigned> Aggregation;
   bool IncludeDetail;
 
@@ -98,18 +101,40 @@ private:
   raw_ostream &OS;
   DWARFContext &DCtx;
   DIDumpOptions DumpOpts;
-  uint32_t NumDebugLineErrors = 0;
+  std::atomic<uint32_t> NumDebugLineErrors = 0;
   OutputCategoryAggregator ErrorCategory;
   // Used to relax some checks that do not currently work portably
   bool IsObjectFile;
   bool IsMachOObject;
+  bool UnitsExtracted = false;
+  bool SplitUnitsExtracted = false;
   using ReferenceMap = std::map<uint64_t, std::set<uint64_t>>;
 
+  /// Returns the stream verification output goes to: the buffer of the task
+  /// running on the current thread, if any, or OS.
+  raw_ostream &out() const;
   raw_ostream &error() const;
   raw_ostream &warn() const;
   raw_ostream &note() const;
   raw_ostream &dump(const DWARFDie &Die, unsigned indent = 0) const;
 
+  /// Returns true if independent checks may run on a thread pool. This
+  /// requires more than one thread in DumpOpts and a thread-safe context.
+  bool isParallel() const;
+
+  /// Runs \p Task for every index in [0, \p NumTasks), on a thread pool if
+  /// isParallel(). The output of each task is buffered and written to OS in
+  /// index order, so it does not depend on scheduling.
+  ///
+  /// \returns The sum of the error counts returned by the tasks.
+  unsigned runTasks(size_t NumTasks, function_ref<unsigned(size_t)> Task);
+
+  /// DWARFUnit parses its DIEs lazily and is not thread-safe, and checks of one
+  /// unit may follow references into others. Before running checks in
+  /// parallel, extract the DIEs of every unit and, if \p ResolveSplitUnits is
+  /// set, load the split units that skeleton units refer to.
+  void extractUnitsForTasks(bool ResolveSplitUnits);
+
   /// Verifies the abbreviations section.
   ///
   /// This function currently checks that:
@@ -1083,11 +1083,16 @@ class MDNode : public Metadata {
   /// Explicity set alignment because bitfields by default have an
   /// alignment of 1 on z/OS.
   struct alignas(alignof(size_t)) Header {
+    // The flags share a single word with NumUnresolved so that the header of
+    // a small uniqued node, such as a DILocation, takes 8 bytes rather than 16.
     bool IsResizable : 1;
     bool IsLarge : 1;
-    size_t SmallSize : 4;
-    size_t SmallNumOps : 4;
-    size_t : sizeof(size_t) * CHAR_BIT - 10;
+    /// Set when the node was allocated from the context's metadata arena; its
+    /// memory is released with the context instead of on deletion.
+    bool IsArenaAllocated : 1;
+    unsigned SmallSize : 4;
+    unsigned SmallNumOps : 4;
+    unsigned : 32 - 11;
 
     unsigned NumUnresolved = 0;
     using LargeStorageVector = SmallVector<MDOperand, 0>;
@@ -1189,6 +1194,11 @@ protected:
   ~MDNode() = default;
 
   void *operator new(size_t Size, size_t NumOps, StorageType Storage);
+  /// Allocate a node, placing it in \p Context's metadata arena if it is
+  /// uniqued. Meant for the small, immutable debug-info nodes that are created
+  /// in bulk and are practically never freed before the context.
+  void *operator new(size_t Size, size_t NumOps, StorageType Storage,
+                     LLVMContext &Context);
   void operator delete(void *Mem);
 
   /// Required by std, but never called.
@@ -1201,6 +1211,11 @@ protected:
     llvm_unreachable("Constructor throws?");
   }
 
+  /// Required by std, but never called.
+  void operator delete(void *, size_t, StorageType, LLVMContext &) {
+    llvm_unreachable("Constructor throws?");
+  }
+
   void dropAllReferences();
 
   MDOperand *mutable_begin() { return getHeader().operands().begin(); }
@@ -86,6 +86,13 @@ private:
   /// By default it's 0, which means bundling is disabled.
   unsigned BundleAlignSize = 0;
 
+  /// Sections that have been relaxed to a fixed point at least once.
+  SmallPtrSet<const MCSection *, 16> RelaxedSections;
+
+  /// Sections holding fragments whose size can depend on the layout of other
+  /// sections. Only these are revisited once they have reached a fixed point.
+  SmallPtrSet<const MCSection *, 16> CrossSectionDependent;
+
   /// Evaluate a fixup to a relocatable expression and the value which should be
   /// placed into the fixup.
   ///
@@ -115,6 +122,13 @@ private:
   /// were adjusted.
   bool layoutOnce();
 
+  /// Relax the fragments of \p Sec in order, keeping its layout current as
+  /// fragments grow. If \p From is set, it is the first fragment that changed
+  /// in the previous sweep, and the fragments before it are only relaxed again
+  /// if they refer to later ones. Returns the first fragment that changed, or
+  /// null if none did.
+  MCFragment *relaxSection(MCSection &Sec, MCFragment *From = nullptr);
+
   /// Perform relaxation on a single fragment - returns true if the fragment
   /// changes as a result of relaxation.
   bool relaxFragment(MCFragment &F);
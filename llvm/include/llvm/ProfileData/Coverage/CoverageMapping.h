@@ -992,17 +992,23 @@ class CoverageMapping {
       ArrayRef<std::unique_ptr<CoverageMappingReader>> CoverageReaders,
       IndexedInstrProfReader &ProfileReader, CoverageMapping &Coverage);
 
-  // Load coverage records from file.
+  // Load coverage records from files, \p Arches holding the architecture of
+  // each file. The files are decoded on up to \p NumThreads threads, and their
+  // records are added in file order.
   static Error
-  loadFromFile(StringRef Filename, StringRef Arch, StringRef CompilationDir,
-               IndexedInstrProfReader &ProfileReader, CoverageMapping &Coverage,
-               bool &DataFound,
-               SmallVectorImpl<object::BuildID> *FoundBinaryIDs = nullptr);
+  loadFromFiles(ArrayRef<StringRef> Filenames, ArrayRef<StringRef> Arches,
+                StringRef CompilationDir, IndexedInstrProfReader &ProfileReader,
+                CoverageMapping &Coverage, bool &DataFound, unsigned NumThreads,
+                SmallVectorImpl<object::BuildID> *FoundBinaryIDs = nullptr);
 
   /// Add a function record corresponding to \p Record.
   Error loadFunctionRecord(const CoverageMappingRecord &Record,
                            IndexedInstrProfReader &ProfileReader);
 
+  /// Add \p Function, unless a record for the same function and files has
+  /// already been added.
+  void addFunctionRecord(FunctionRecord &&Function);
+
   /// Look up the indices for function records which are at least partially
   /// defined in the specified file. This is guaranteed to return a superset of
   /// such records: extra records not in the file may be included if there is
@@ -1022,12 +1028,15 @@ public:
   /// Load the coverage mapping from the given object files and profile. If
   /// \p Arches is non-empty, it must specify an architecture for each object.
   /// Ignores non-instrumented object files unless all are not instrumented.
+  /// Up to \p NumThreads object files are decoded in parallel; 0 uses one
+  /// thread per object file, up to the number of hardware cores. The result
+  /// does not depend on the number of threads.
   static Expected<std::unique_ptr<CoverageMapping>>
   load(ArrayRef<StringRef> ObjectFilenames, StringRef ProfileFilename,
        vfs::FileSystem &FS, ArrayRef<StringRef> Arches = {},
        StringRef CompilationDir = "",
        const object::BuildIDFetcher *BIDFetcher = nullptr,
-       bool CheckBinaryIDs = false);
+       bool CheckBinaryIDs = false, unsigned NumThreads = 1);
 
   /// The number of functions that couldn't have their profiles mapped.
   ///
@@ -81,6 +81,17 @@ Expected<CachePruningPolicy> parseCachePruningPolicy(StringRef PolicyStr);
 /// pattern "llvmcache-*".
 bool pruneCache(StringRef Path, CachePruningPolicy Policy,
                 const std::vector<std::unique_ptr<MemoryBuffer>> &Files = {});
+
+/// Record that the cache entry \p EntryName, of \p Size bytes, was created or
+/// used just now. The record is appended to the access index of the cache
+/// directory \p Path, which pruneCache() consults instead of calling stat() on
+/// every entry. Appends are single writes to a file opened in append mode, so
+/// concurrent processes can record accesses without locking. Entries missing
+/// from the index, e.g. ones written by older tools, are still stat()'ed, as
+/// are indexed entries before they are pruned, so that uses by tools that
+/// don't update the index are not missed. The index is compacted each time the
+/// cache is pruned, and by this function once it grows past a few megabytes.
+void recordCacheAccess(StringRef Path, StringRef EntryName, uint64_t Size);
 } // namespace llvm
 
 #endif
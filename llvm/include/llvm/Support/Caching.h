@@ -96,11 +96,18 @@ using AddBufferFn = std::function<void(unsigned Task, const Twine &ModuleName,
 /// done lazily the first time a file is added.  The cache name appears in error
 /// messages for errors during caching. The temporary file prefix is used in the
 /// temporary file naming scheme used when writing files atomically.
+///
+/// Every entry that is found or added is recorded in the access index of the
+/// cache directory (see recordCacheAccess()). If \p MemoryLimitBytes is
+/// non-zero, up to that many bytes of entries are also kept in memory for the
+/// lifetime of the returned FileCache, and further requests for the same keys
+/// are served without touching the file system.
 Expected<FileCache> localCache(
     const Twine &CacheNameRef, const Twine &TempFilePrefixRef,
     const Twine &CacheDirectoryPathRef,
     AddBufferFn AddBuffer = [](size_t Task, const Twine &ModuleName,
-                               std::unique_ptr<MemoryBuffer> MB) {});
+                               std::unique_ptr<MemoryBuffer> MB) {},
+    uint64_t MemoryLimitBytes = 0);
 } // namespace llvm
 
 #endif
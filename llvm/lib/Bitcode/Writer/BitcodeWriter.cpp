@@ -69,6 +69,8 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SHA1.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TargetParser/Triple.h"
 #include <algorithm>
@@ -94,6 +96,17 @@ static cl::opt<uint32_t> FlushThreshold(
     "bitcode-flush-threshold", cl::Hidden, cl::init(512),
     cl::desc("The threshold (unit M) for flushing LLVM bitcode."));
 
+static cl::opt<unsigned> FunctionBlockThreads(
+    "bitcode-function-block-threads", cl::Hidden, cl::init(1),
+    cl::desc("Number of threads used to encode function blocks (0 uses all "
+             "available hardware threads, at most 8). Each thread holds its "
+             "own copy of the module's value numbering. The output is "
+             "identical to the single-threaded writer."));
+
+/// Upper bound on the threads encoding function blocks, which bounds the
+/// number of per-thread ValueEnumerators alive at once.
+static constexpr unsigned MaxFunctionBlockThreads = 8;
+
 static cl::opt<bool> WriteRelBFToSummary(
     "write-relbf-to-summary", cl::Hidden, cl::init(false),
     cl::desc("Write relative block frequency to function summary "));
@@ -416,6 +429,9 @@ private:
   void
   writeFunction(const Function &F,
                 DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
+  void writeFunctionsInParallel(
+      ArrayRef<const Function *> Functions, unsigned NumThreads,
+      DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
   void writeBlockInfo();
   void writeModuleHash(StringRef View);
 
@@ -3757,6 +3773,83 @@ void ModuleBitcodeWriter::writeFunction(
   Stream.ExitBlock();
 }
 
+/// Encode the function blocks for \p Functions on \p NumThreads threads and
+/// splice them into the module block in order.
+///
+/// The functions are split into contiguous shards of roughly equal
+/// instruction count. Each shard gets its own ModuleBitcodeWriter over a
+/// scratch stream: value numbering is a pure function of the module, and the
+/// scratch stream replays the block info so that the same abbreviation IDs are
+/// in scope. The shard's blocks are then copied word by word into the main
+/// stream, which must be word aligned, and their VST offsets are rebased onto
+/// the position they land at.
+void ModuleBitcodeWriter::writeFunctionsInParallel(
+    ArrayRef<const Function *> Functions, unsigned NumThreads,
+    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex) {
+  assert(Stream.GetCurrentBitNo() % 32 == 0 &&
+         "Function blocks must start on a word boundary");
+
+  struct Shard {
+    ArrayRef<const Function *> Functions;
+    SmallVector<char, 0> Buffer;
+    uint64_t StartBit = 0;
+    uint64_t EndBit = 0;
+    DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
+  };
+
+  uint64_t TotalInsts = 0;
+  for (const Function *F : Functions)
+    TotalInsts += F->getInstructionCount();
+  unsigned NumShards = std::min<size_t>(NumThreads, Functions.size());
+  uint64_t InstsPerShard = std::max<uint64_t>(1, TotalInsts / NumShards);
+
+  std::vector<Shard> Shards;
+  size_t Begin = 0;
+  uint64_t ShardInsts = 0;
+  for (size_t I = 0, E = Functions.size(); I != E; ++I) {
+    ShardInsts += Functions[I]->getInstructionCount();
+    if (I + 1 == E ||
+        (ShardInsts >= InstsPerShard && Shards.size() + 1 < NumShards)) {
+      Shards.emplace_back();
+      Shards.back().Functions = Functions.slice(Begin, I + 1 - Begin);
+      Begin = I + 1;
+      ShardInsts = 0;
+    }
+  }
+
+  {
+    DefaultThreadPool Pool(hardware_concurrency(Shards.size()));
+    for (Shard &S : Shards)
+      Pool.async([&] {
+        BitstreamWriter ShardStream(S.Buffer);
+        StringTableBuilder ShardStrtab(StringTableBuilder::RAW);
+        ModuleBitcodeWriter Writer(M, ShardStrtab, ShardStream,
+                                   /*ShouldPreserveUseListOrder=*/false,
+                                   /*Index=*/nullptr, /*GenerateHash=*/false);
+        ShardStream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
+        Writer.writeBlockInfo();
+        S.StartBit = ShardStream.GetCurrentBitNo();
+        for (const Function *F : S.Functions)
+          Writer.writeFunction(*F, S.FunctionToBitcodeIndex);
+        S.EndBit = ShardStream.GetCurrentBitNo();
+        ShardStream.ExitBlock();
+      });
+    Pool.wait();
+  }
+
+  for (Shard &S : Shards) {
+    assert(S.StartBit % 32 == 0 && S.EndBit % 32 == 0 &&
+           "Function blocks must end on a word boundary");
+    uint64_t Base = Stream.GetCurrentBitNo();
+    for (const auto &[F, BitNo] : S.FunctionToBitcodeIndex)
+      FunctionToBitcodeIndex[F] = Base + (BitNo - S.StartBit);
+    const char *Ptr = S.Buffer.data();
+    for (uint64_t Byte = S.StartBit / 8, End = S.EndBit / 8; Byte != End;
+         Byte += 4)
+      Stream.Emit(support::endian::read32le(Ptr + Byte), 32);
+  }
+}
+
 // Emit blockinfo, which defines the standard abbreviations etc.
 void ModuleBitcodeWriter::writeBlockInfo() {
   // We only want to emit block info records for blocks that have multiple
@@ -5171,9 +5264,33 @@ void ModuleBitcodeWriter::write() {
 
   // Emit function bodies.
   DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
+  SmallVector<const Function *, 0> Functions;
   for (const Function &F : M)
     if (!F.isDeclaration())
-      writeFunction(F, FunctionToBitcodeIndex);
+      Functions.push_back(&F);
+
+  // Function blocks are encoded in parallel only when every block starts on a
+  // word boundary, since the padding after a block header depends on it. Each
+  // block ends with a flush to a word boundary, so emitting the first one
+  // serially is enough to get there. Use-list orders are consumed in order
+  // from a stack shared with the module-level block, so that mode stays
+  // serial.
+  unsigned NumThreads = std::min(
+      hardware_concurrency(FunctionBlockThreads).compute_thread_count(),
+      MaxFunctionBlockThreads);
+  ArrayRef<const Function *> Remaining = Functions;
+  if (NumThreads > 1 && !VE.shouldPreserveUseListOrder()) {
+    while (!Remaining.empty() && Stream.GetCurrentBitNo() % 32 != 0) {
+      writeFunction(*Remaining.front(), FunctionToBitcodeIndex);
+      Remaining = Remaining.drop_front();
+    }
+    if (Remaining.size() > 1) {
+      writeFunctionsInParallel(Remaining, NumThreads, FunctionToBitcodeIndex);
+      Remaining = {};
+    }
+  }
+  for (const Function *F : Remaining)
+    writeFunction(*F, FunctionToBitcodeIndex);
 
   // Need to write after the above call to WriteFunction which populates
   // the summary information in the index.
@@ -20,6 +20,7 @@
 #include "llvm/BinaryFormat/Dwarf.h"
 #include "llvm/BinaryFormat/ELF.h"
 #include "llvm/BinaryFormat/MachO.h"
+#include "llvm/BinaryFormat/PEF.h"
 #include "llvm/BinaryFormat/Wasm.h"
 #include "llvm/CodeGen/BasicBlockSectionUtils.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
@@ -50,6 +51,7 @@
 #include "llvm/MC/MCSectionELF.h"
 #include "llvm/MC/MCSectionGOFF.h"
 #include "llvm/MC/MCSectionMachO.h"
+#include "llvm/MC/MCSectionPEF.h"
 #include "llvm/MC/MCSectionWasm.h"
 #include "llvm/MC/MCSectionXCOFF.h"
 #include "llvm/MC/MCStreamer.h"
@@ -2393,6 +2395,13 @@ MCSection *TargetLoweringObjectFileXCOFF::getExplicitSectionGlobal(
 
   StringRef SectionName = GO->getSection();
 
+  // Classic Mac OS objects are written as PEF, which keeps section names.
+  // Excluded payloads such as codegen data become non-instantiated sections
+  // that the linker reads by name and leaves out of the image.
+  if (Kind.isExclude() && TM.getTargetTriple().isMacOSClassic())
+    return getContext().getPEFSection(SectionName, Kind,
+                                      PEF::kPEFDebugSection);
+
   // Handle the XCOFF::TD case first, then deal with the rest.
   if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(GO))
     if (GVar->hasAttribute("toc-data"))
@@ -11,6 +11,7 @@
 //
 //===----------------------------------------------------------------------===//
 #include "llvm/DWP/DWP.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/DWP/DWPError.h"
 #include "llvm/MC/MCContext.h"
@@ -20,7 +21,9 @@
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include <limits>
+#include <optional>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -426,27 +429,103 @@ static void writeNewOffsetsTo(MCStreamer &Out, DataExtractor &Data,
   }
 }
 
+} // namespace llvm
+
+// Split a string section into its null-terminated strings and hash them.
+static std::vector<CachedHashStringRef> getSectionStrings(StringRef StrSection) {
+  std::vector<CachedHashStringRef> Strings;
+  DataExtractor Data(StrSection, true, 0);
+  uint64_t LocalOffset = 0;
+  uint64_t PrevOffset = 0;
+  while (const char *S = Data.getCStr(&LocalOffset)) {
+    Strings.emplace_back(StringRef(S, LocalOffset - PrevOffset - 1));
+    PrevOffset = LocalOffset;
+  }
+  return Strings;
+}
+
+namespace {
+/// An input file prepared for merging: its sections have been read and
+/// decompressed and the strings of its string section have been hashed. This
+/// is the part of the work that is independent between inputs.
+struct LoadedInput {
+  OwningBinary<object::ObjectFile> Obj;
+  std::deque<SmallString<32>> UncompressedSections;
+  /// The name and contents of each section with contents, in file order.
+  std::vector<std::pair<StringRef, StringRef>> Sections;
+  StringRef StrSection;
+  std::vector<CachedHashStringRef> Strings;
+  /// The result of loading, set once the input has been loaded.
+  std::optional<Error> Err;
+};
+} // anonymous namespace
+
+static Error loadInput(StringRef Input, LoadedInput &Loaded) {
+  auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
+  if (!ErrOrObj) {
+    return handleErrors(ErrOrObj.takeError(),
+                        [&](std::unique_ptr<ECError> EC) -> Error {
+                          return createFileError(Input, Error(std::move(EC)));
+                        });
+  }
+  Loaded.Obj = std::move(*ErrOrObj);
+
+  for (const SectionRef &Section : Loaded.Obj.getBinary()->sections()) {
+    if (Section.isBSS() || Section.isVirtual())
+      continue;
+
+    Expected<StringRef> NameOrErr = Section.getName();
+    if (!NameOrErr)
+      return NameOrErr.takeError();
+    StringRef Name = *NameOrErr;
+
+    Expected<StringRef> ContentsOrErr = Section.getContents();
+    if (!ContentsOrErr)
+      return ContentsOrErr.takeError();
+    StringRef Contents = *ContentsOrErr;
+
+    if (auto Err = handleCompressedSection(Loaded.UncompressedSections,
+                                           Section, Name, Contents))
+      return Err;
+
+    Loaded.Sections.emplace_back(Name, Contents);
+    // handleSection() keeps the last string section of a file.
+    if (Name.substr(Name.find_first_not_of("._")) == "debug_str.dwo")
+      Loaded.StrSection = Contents;
+  }
+
+  Loaded.Strings = getSectionStrings(Loaded.StrSection);
+  return Error::success();
+}
+
+namespace llvm {
 void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
                             MCSection *StrOffsetSection,
                             StringRef CurStrSection,
                             StringRef CurStrOffsetSection, uint16_t Version) {
+  if (CurStrSection.empty() || CurStrOffsetSection.empty())
+    return;
+  writeStringsAndOffsets(Out, Strings, StrOffsetSection, CurStrSection,
+                         getSectionStrings(CurStrSection), CurStrOffsetSection,
+                         Version);
+}
+
+void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
+                            MCSection *StrOffsetSection,
+                            StringRef CurStrSection,
+                            ArrayRef<CachedHashStringRef> CurStrings,
+                            StringRef CurStrOffsetSection, uint16_t Version) {
   // Could possibly produce an error or warning if one of these was non-null but
   // the other was null.
   if (CurStrSection.empty() || CurStrOffsetSection.empty())
     return;
 
   DenseMap<uint64_t, uint32_t> OffsetRemapping;
+  for (CachedHashStringRef S : CurStrings)
+    OffsetRemapping[S.val().data() - CurStrSection.data()] =
+        Strings.getOffset(S);
 
-  DataExtractor Data(CurStrSection, true, 0);
-  uint64_t LocalOffset = 0;
-  uint64_t PrevOffset = 0;
-  while (const char *S = Data.getCStr(&LocalOffset)) {
-    OffsetRemapping[PrevOffset] =
-        Strings.getOffset(S, LocalOffset - PrevOffset);
-    PrevOffset = LocalOffset;
-  }
-
-  Data = DataExtractor(CurStrOffsetSection, true, 0);
+  DataExtractor Data(CurStrOffsetSection, true, 0);
 
   Out.switchSection(StrOffsetSection);
 
@@ -558,34 +637,13 @@ Error handleSection(
     const MCSection *StrSection, const MCSection *StrOffsetSection,
     const MCSection *TypesSection, const MCSection *CUIndexSection,
     const MCSection *TUIndexSection, const MCSection *InfoSection,
-    const SectionRef &Section, MCStreamer &Out,
-    std::deque<SmallString<32>> &UncompressedSections,
+    StringRef Name, StringRef Contents, MCStreamer &Out,
     uint32_t (&ContributionOffsets)[8], UnitIndexEntry &CurEntry,
     StringRef &CurStrSection, StringRef &CurStrOffsetSection,
     std::vector<StringRef> &CurTypesSection,
     std::vector<StringRef> &CurInfoSection, StringRef &AbbrevSection,
     StringRef &CurCUIndexSection, StringRef &CurTUIndexSection,
     std::vector<std::pair<DWARFSectionKind, uint32_t>> &SectionLength) {
-  if (Section.isBSS())
-    return Error::success();
-
-  if (Section.isVirtual())
-    return Error::success();
-
-  Expected<StringRef> NameOrErr = Section.getName();
-  if (!NameOrErr)
-    return NameOrErr.takeError();
-  StringRef Name = *NameOrErr;
-
-  Expected<StringRef> ContentsOrErr = Section.getContents();
-  if (!ContentsOrErr)
-    return ContentsOrErr.takeError();
-  StringRef Contents = *ContentsOrErr;
-
-  if (auto Err = handleCompressedSection(UncompressedSections, Section, Name,
-                                         Contents))
-    return Err;
-
   Name = Name.substr(Name.find_first_not_of("._"));
 
   auto SectionPair = KnownSections.find(Name);
@@ -623,7 +681,7 @@ Error handleSection(
 }
 
 Error write(MCStreamer &Out, ArrayRef<std::string> Inputs,
-            OnCuIndexOverflow OverflowOptValue) {
+            OnCuIndexOverflow OverflowOptValue, unsigned NumThreads) {
   const auto &MCOFI = *Out.getContext().getObjectFileInfo();
   MCSection *const StrSection = MCOFI.getDwarfStrDWOSection();
   MCSection *const StrOffsetSection = MCOFI.getDwarfStrOffDWOSection();
@@ -657,22 +715,46 @@ Error write(MCStreamer &Out, ArrayRef<std::string> Inputs,
 
   DWPStringPool Strings(Out, StrSection);
 
-  SmallVector<OwningBinary<object::ObjectFile>, 128> Objects;
-  Objects.reserve(Inputs.size());
-
-  std::deque<SmallString<32>> UncompressedSections;
-
-  for (const auto &Input : Inputs) {
-    auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
-    if (!ErrOrObj) {
-      return handleErrors(ErrOrObj.takeError(),
-                          [&](std::unique_ptr<ECError> EC) -> Error {
-                            return createFileError(Input, Error(std::move(EC)));
-                          });
+  // Inputs are loaded on the thread pool one batch ahead of the batch being
+  // merged. A batch is released as soon as the following one starts to be
+  // merged, so at most two batches of inputs are held in memory. The pool is
+  // declared after the batches so that pending loads finish before the
+  // batches are destroyed.
+  std::deque<LoadedInput> CurrentBatch, NextBatch;
+  DefaultThreadPool Pool(hardware_concurrency(NumThreads));
+  const size_t BatchSize = 4 * Pool.getMaxConcurrency();
+  auto LoadBatch = [&](size_t Begin) {
+    NextBatch.clear();
+    for (size_t I = Begin, E = std::min(Begin + BatchSize, Inputs.size());
+         I != E; ++I) {
+      LoadedInput &Loaded = NextBatch.emplace_back();
+      Pool.async([&Loaded, Input = StringRef(Inputs[I])] {
+        Loaded.Err = loadInput(Input, Loaded);
+      });
     }
-
-    auto &Obj = *ErrOrObj->getBinary();
-    Objects.push_back(std::move(*ErrOrObj));
+  };
+  LoadBatch(0);
+  // If merging fails, the inputs loaded ahead of the failure are dropped
+  // along with their errors.
+  auto DropLoadedInputs = make_scope_exit([&] {
+    Pool.wait();
+    for (std::deque<LoadedInput> *Batch : {&CurrentBatch, &NextBatch})
+      for (LoadedInput &Loaded : *Batch)
+        if (Loaded.Err)
+          consumeError(std::move(*Loaded.Err));
+  });
+
+  for (size_t InputIndex = 0; InputIndex != Inputs.size(); ++InputIndex) {
+    if (InputIndex % BatchSize == 0) {
+      Pool.wait();
+      std::swap(CurrentBatch, NextBatch);
+      LoadBatch(InputIndex + BatchSize);
+    }
+    const std::string &Input = Inputs[InputIndex];
+    LoadedInput &Loaded = CurrentBatch[InputIndex % BatchSize];
+    if (Error Err = std::move(*Loaded.Err))
+      return Err;
+    auto &Obj = *Loaded.Obj.getBinary();
 
     UnitIndexEntry CurEntry = {};
 
@@ -689,14 +771,13 @@ Error write(MCStreamer &Out, ArrayRef<std::string> Inputs,
     // i.e. offset and length, of each compile/type unit to a section.
     std::vector<std::pair<DWARFSectionKind, uint32_t>> SectionLength;
 
-    for (const auto &Section : Obj.sections())
+    for (const auto &[Name, Contents] : Loaded.Sections)
       if (auto Err = handleSection(
               KnownSections, StrSection, StrOffsetSection, TypesSection,
-              CUIndexSection, TUIndexSection, InfoSection, Section, Out,
-              UncompressedSections, ContributionOffsets, CurEntry,
-              CurStrSection, CurStrOffsetSection, CurTypesSection,
-              CurInfoSection, AbbrevSection, CurCUIndexSection,
-              CurTUIndexSection, SectionLength))
+              CUIndexSection, TUIndexSection, InfoSection, Name, Contents, Out,
+              ContributionOffsets, CurEntry, CurStrSection, CurStrOffsetSection,
+              CurTypesSection, CurInfoSection, AbbrevSection,
+              CurCUIndexSection, CurTUIndexSection, SectionLength))
         return Err;
 
     if (CurInfoSection.empty())
@@ -716,7 +797,7 @@ Error write(MCStreamer &Out, ArrayRef<std::string> Inputs,
     }
 
     writeStringsAndOffsets(Out, Strings, StrOffsetSection, CurStrSection,
-                           CurStrOffsetSection, Header.Version);
+                           Loaded.Strings, CurStrOffsetSection, Header.Version);
 
     for (auto Pair : SectionLength) {
       auto Index = getContributionIndex(Pair.first, IndexVersion);
@@ -33,8 +33,11 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
+#include <future>
 #include <map>
 #include <set>
 #include <vector>
@@ -274,7 +277,7 @@ unsigned DWARFVerifier::verifyUnitContents(DWARFUnit &Unit,
           Die.getFirstChild().getTag() == DW_TAG_null) {
         warn() << dwarf::TagString(Die.getTag())
                << " has DW_CHILDREN_yes but DIE has no children: ";
-        Die.dump(OS);
+        Die.dump(out());
       }
     }
 
@@ -334,7 +337,7 @@ unsigned DWARFVerifier::verifyDebugInfoCallSite(const DWARFDie &Die) {
       ErrorCategory.Report(
           "Call site nested entry within inlined subroutine", [&]() {
             error() << "Call site entry nested within inlined subroutine:";
-            Curr.dump(OS);
+            Curr.dump(out());
           });
       return 1;
     }
@@ -344,7 +347,7 @@ unsigned DWARFVerifier::verifyDebugInfoCallSite(const DWARFDie &Die) {
     ErrorCategory.Report(
         "Call site entry not nested within valid subprogram", [&]() {
           error() << "Call site entry not nested within a valid subprogram:";
-          Die.dump(OS);
+          Die.dump(out());
         });
     return 1;
   }
@@ -358,8 +361,8 @@ unsigned DWARFVerifier::verifyDebugInfoCallSite(const DWARFDie &Die) {
         "Subprogram with call site entry has no DW_AT_call attribute", [&]() {
           error()
               << "Subprogram with call site entry has no DW_AT_call attribute:";
-          Curr.dump(OS);
-          Die.dump(OS, /*indent*/ 1);
+          Curr.dump(out());
+          Die.dump(out(), /*indent*/ 1);
         });
     return 1;
   }
@@ -391,7 +394,7 @@ unsigned DWARFVerifier::verifyAbbrevSection(const DWARFDebugAbbrev *Abbrev) {
             "Abbreviation declartion contains multiple attributes", [&]() {
               error() << "Abbreviation declaration contains multiple "
                       << AttributeString(Attribute.Attr) << " attributes.\n";
-              AbbrDecl.dump(OS);
+              AbbrDecl.dump(out());
             });
         ++NumErrors;
       }
@@ -414,23 +417,30 @@ bool DWARFVerifier::handleDebugAbbrev() {
 }
 
 unsigned DWARFVerifier::verifyUnits(const DWARFUnitVector &Units) {
-  unsigned NumDebugInfoErrors = 0;
-  ReferenceMap CrossUnitReferences;
-
-  unsigned Index = 1;
-  for (const auto &Unit : Units) {
-    OS << "Verifying unit: " << Index << " / " << Units.getNumUnits();
+  extractUnitsForTasks(/*ResolveSplitUnits=*/false);
+
+  // Each unit collects the references it makes into other units on its own,
+  // they are merged and checked once all units have been visited.
+  std::vector<ReferenceMap> UnitCrossReferences(Units.size());
+  unsigned NumDebugInfoErrors = runTasks(Units.size(), [&](size_t Index) {
+    DWARFUnit *Unit = Units[Index].get();
+    out() << "Verifying unit: " << Index + 1 << " / " << Units.getNumUnits();
     if (const char* Name = Unit->getUnitDIE(true).getShortName())
-      OS << ", \"" << Name << '\"';
-    OS << '\n';
-    OS.flush();
+      out() << ", \"" << Name << '\"';
+    out() << '\n';
+    out().flush();
     ReferenceMap UnitLocalReferences;
-    NumDebugInfoErrors +=
-        verifyUnitContents(*Unit, UnitLocalReferences, CrossUnitReferences);
-    NumDebugInfoErrors += verifyDebugInfoReferences(
-        UnitLocalReferences, [&](uint64_t Offset) { return Unit.get(); });
-    ++Index;
-  }
+    unsigned NumUnitErrors = verifyUnitContents(*Unit, UnitLocalReferences,
+                                                UnitCrossReferences[Index]);
+    NumUnitErrors += verifyDebugInfoReferences(
+        UnitLocalReferences, [&](uint64_t Offset) { return Unit; });
+    return NumUnitErrors;
+  });
+
+  ReferenceMap CrossUnitReferences;
+  for (const ReferenceMap &References : UnitCrossReferences)
+    for (const auto &[Offset, Referrers] : References)
+      CrossUnitReferences[Offset].insert(Referrers.begin(), Referrers.end());
 
   NumDebugInfoErrors += verifyDebugInfoReferences(
       CrossUnitReferences, [&](uint64_t Offset) -> DWARFUnit * {
@@ -857,7 +867,7 @@ unsigned DWARFVerifier::verifyDebugInfoForm(const DWARFDie &Die,
                   << format("0x%08" PRIx64, CUOffset)
                   << " is invalid (must be less than CU size of "
                   << format("0x%08" PRIx64, CUSize) << "):\n";
-          Die.dump(OS, 0, DumpOpts);
+          Die.dump(out(), 0, DumpOpts);
           dump(Die) << '\n';
         });
       } else {
@@ -932,7 +942,7 @@ unsigned DWARFVerifier::verifyDebugInfoReferences(
               << ". Offset is in between DIEs:\n";
       for (auto Offset : Pair.second)
         dump(GetDIEForOffset(Offset)) << '\n';
-      OS << "\n";
+      out() << "\n";
     });
   }
   return NumErrors;
@@ -986,13 +996,19 @@ void DWARFVerifier::verifyDebugLineStmtOffsets() {
 }
 
 void DWARFVerifier::verifyDebugLineRows() {
-  for (const auto &CU : DCtx.compile_units()) {
+  extractUnitsForTasks(/*ResolveSplitUnits=*/false);
+
+  SmallVector<DWARFUnit *, 0> CUs;
+  for (const auto &CU : DCtx.compile_units())
+    CUs.push_back(CU.get());
+  runTasks(CUs.size(), [&](size_t Index) -> unsigned {
+    DWARFUnit *CU = CUs[Index];
     auto Die = CU->getUnitDIE();
-    auto LineTable = DCtx.getLineTableForUnit(CU.get());
+    auto LineTable = DCtx.getLineTableForUnit(CU);
     // If there is no line table we will have created an error in the
     // .debug_info verifier or in verifyDebugLineStmtOffsets().
     if (!LineTable)
-      continue;
+      return 0;
 
     // Verify prologue.
     bool isDWARF5 = LineTable->Prologue.getVersion() >= 5;
@@ -1038,7 +1054,7 @@ void DWARFVerifier::verifyDebugLineRows() {
     // Nothing to verify in a line table with a single row containing the end
     // sequence.
     if (LineTable->Rows.size() == 1 && LineTable->Rows.front().EndSequence)
-      continue;
+      return 0;
 
     // Verify rows.
     uint64_t PrevAddress = 0;
@@ -1055,11 +1071,11 @@ void DWARFVerifier::verifyDebugLineRows() {
                       << "] row[" << RowIndex
                       << "] decreases in address from previous row:\n";
 
-              DWARFDebugLine::Row::dumpTableHeader(OS, 0);
+              DWARFDebugLine::Row::dumpTableHeader(out(), 0);
               if (RowIndex > 0)
-                LineTable->Rows[RowIndex - 1].dump(OS);
-              Row.dump(OS);
-              OS << '\n';
+                LineTable->Rows[RowIndex - 1].dump(out());
+              Row.dump(out());
+              out() << '\n';
             });
       }
 
@@ -1073,9 +1089,9 @@ void DWARFVerifier::verifyDebugLineRows() {
                   << " (valid values are [" << MinFileIndex << ','
                   << LineTable->Prologue.FileNames.size()
                   << (isDWARF5 ? ")" : "]") << "):\n";
-          DWARFDebugLine::Row::dumpTableHeader(OS, 0);
-          Row.dump(OS);
-          OS << '\n';
+          DWARFDebugLine::Row::dumpTableHeader(out(), 0);
+          Row.dump(out());
+          out() << '\n';
         });
       }
       if (Row.EndSequence)
@@ -1084,7 +1100,9 @@ void DWARFVerifier::verifyDebugLineRows() {
         PrevAddress = Row.Address.Address;
       ++RowIndex;
     }
-  }
+    // Errors are counted in NumDebugLineErrors.
+    return 0;
+  });
 }
 
 DWARFVerifier::DWARFVerifier(raw_ostream &S, DWARFContext &D,
@@ -1115,7 +1133,7 @@ unsigned DWARFVerifier::verifyAppleAccelTable(const DWARFSection *AccelSection,
                                       DCtx.isLittleEndian(), 0);
   AppleAcceleratorTable AccelTable(AccelSectionData, *StrData);
 
-  OS << "Verifying " << SectionName << "...\n";
+  out() << "Verifying " << SectionName << "...\n";
 
   // Verify that the fixed part of the header is not too short.
   if (!AccelSectionData.isValidOffset(AccelTable.getSizeHdr())) {
@@ -1981,32 +1999,57 @@ unsigned DWARFVerifier::verifyDebugNames(const DWARFSection &AccelSection,
   // Don't attempt Entry validation if any of the previous checks found errors
   if (NumErrors > 0)
     return NumErrors;
+
+  extractUnitsForTasks(/*ResolveSplitUnits=*/true);
+
+  // Verify the entries in batches of names, so that large indexes are split
+  // over several tasks.
+  constexpr uint32_t NamesPerTask = 1024;
+  struct NameRange {
+    const DWARFDebugNames::NameIndex *NI;
+    uint32_t First;
+    uint32_t Last;
+  };
+  std::vector<NameRange> NameRanges;
   for (const auto &NI : AccelTable)
-    for (const DWARFDebugNames::NameTableEntry &NTE : NI)
-      NumErrors += verifyNameIndexEntries(NI, NTE);
-
-  for (const std::unique_ptr<DWARFUnit> &U : DCtx.info_section_units()) {
-    if (const DWARFDebugNames::NameIndex *NI =
-            AccelTable.getCUOrTUNameIndex(U->getOffset())) {
-      DWARFCompileUnit *CU = dyn_cast<DWARFCompileUnit>(U.get());
-      if (CU) {
-        if (CU->getDWOId()) {
-          DWARFDie CUDie = CU->getUnitDIE(true);
-          DWARFDie NonSkeletonUnitDie =
-              CUDie.getDwarfUnit()->getNonSkeletonUnitDIE(false);
-          if (CUDie != NonSkeletonUnitDie) {
-            for (const DWARFDebugInfoEntry &Die :
-                 NonSkeletonUnitDie.getDwarfUnit()->dies())
-              NumErrors += verifyNameIndexCompleteness(
-                  DWARFDie(NonSkeletonUnitDie.getDwarfUnit(), &Die), *NI);
-          }
-        } else {
-          for (const DWARFDebugInfoEntry &Die : CU->dies())
-            NumErrors += verifyNameIndexCompleteness(DWARFDie(CU, &Die), *NI);
-        }
+    for (uint32_t First = 1; First <= NI.getNameCount(); First += NamesPerTask)
+      NameRanges.push_back(
+          {&NI, First,
+           std::min<uint32_t>(NI.getNameCount(), First + NamesPerTask - 1)});
+  NumErrors += runTasks(NameRanges.size(), [&](size_t Index) {
+    const NameRange &R = NameRanges[Index];
+    unsigned NumRangeErrors = 0;
+    for (uint32_t Name = R.First; Name <= R.Last; ++Name)
+      NumRangeErrors +=
+          verifyNameIndexEntries(*R.NI, R.NI->getNameTableEntry(Name));
+    return NumRangeErrors;
+  });
+
+  auto Units = DCtx.info_section_units();
+  NumErrors += runTasks(llvm::size(Units), [&](size_t Index) -> unsigned {
+    DWARFUnit *U = Units.begin()[Index].get();
+    const DWARFDebugNames::NameIndex *NI =
+        AccelTable.getCUOrTUNameIndex(U->getOffset());
+    DWARFCompileUnit *CU = dyn_cast<DWARFCompileUnit>(U);
+    if (!NI || !CU)
+      return 0;
+    unsigned NumUnitErrors = 0;
+    if (CU->getDWOId()) {
+      DWARFDie CUDie = CU->getUnitDIE(true);
+      DWARFDie NonSkeletonUnitDie =
+          CUDie.getDwarfUnit()->getNonSkeletonUnitDIE(false);
+      if (CUDie != NonSkeletonUnitDie) {
+        for (const DWARFDebugInfoEntry &Die :
+             NonSkeletonUnitDie.getDwarfUnit()->dies())
+          NumUnitErrors += verifyNameIndexCompleteness(
+              DWARFDie(NonSkeletonUnitDie.getDwarfUnit(), &Die), *NI);
       }
+    } else {
+      for (const DWARFDebugInfoEntry &Die : CU->dies())
+        NumUnitErrors += verifyNameIndexCompleteness(DWARFDie(CU, &Die), *NI);
     }
-  }
+    return NumUnitErrors;
+  });
   return NumErrors;
 }
 
@@ -2014,18 +2057,24 @@ bool DWARFVerifier::handleAccelTables() {
   const DWARFObject &D = DCtx.getDWARFObj();
   DataExtractor StrData(D.getStrSection(), DCtx.isLittleEndian(), 0);
   unsigned NumErrors = 0;
+  SmallVector<std::pair<const DWARFSection *, const char *>, 4> AppleTables;
   if (!D.getAppleNamesSection().Data.empty())
-    NumErrors += verifyAppleAccelTable(&D.getAppleNamesSection(), &StrData,
-                                       ".apple_names");
+    AppleTables.push_back({&D.getAppleNamesSection(), ".apple_names"});
   if (!D.getAppleTypesSection().Data.empty())
-    NumErrors += verifyAppleAccelTable(&D.getAppleTypesSection(), &StrData,
-                                       ".apple_types");
+    AppleTables.push_back({&D.getAppleTypesSection(), ".apple_types"});
   if (!D.getAppleNamespacesSection().Data.empty())
-    NumErrors += verifyAppleAccelTable(&D.getAppleNamespacesSection(), &StrData,
-                                       ".apple_namespaces");
+    AppleTables.push_back(
+        {&D.getAppleNamespacesSection(), ".apple_namespaces"});
   if (!D.getAppleObjCSection().Data.empty())
-    NumErrors += verifyAppleAccelTable(&D.getAppleObjCSection(), &StrData,
-                                       ".apple_objc");
+    AppleTables.push_back({&D.getAppleObjCSection(), ".apple_objc"});
+  if (!AppleTables.empty())
+    extractUnitsForTasks(/*ResolveSplitUnits=*/false);
+  NumErrors += runTasks(AppleTables.size(), [&](size_t Index) {
+    // Each table gets its own extractor, they are not safe to share.
+    DataExtractor TableStrData(D.getStrSection(), DCtx.isLittleEndian(), 0);
+    return verifyAppleAccelTable(AppleTables[Index].first, &TableStrData,
+                                 AppleTables[Index].second);
+  });
 
   if (!D.getNamesSection().Data.empty())
     NumErrors += verifyDebugNames(D.getNamesSection(), StrData);
@@ -2169,7 +2218,10 @@ bool DWARFVerifier::verifyDebugStrOffsets(
 
 void OutputCategoryAggregator::Report(
     StringRef s, std::function<void(void)> detailCallback) {
-  Aggregation[std::string(s)]++;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Aggregation[std::string(s)]++;
+  }
   if (IncludeDetail)
     detailCallback();
 }
@@ -2215,13 +2267,102 @@ void DWARFVerifier::summarize() {
   }
 }
 
-raw_ostream &DWARFVerifier::error() const { return WithColor::error(OS); }
+/// The buffer of the verification task running on this thread, if any.
+static LLVM_THREAD_LOCAL raw_ostream *TaskOS = nullptr;
+
+namespace {
+/// Buffers the output of a verification task until it is printed to another
+/// stream. The buffer reports the color support of that stream, so that
+/// WithColor colors the output of a task, DIE dumps included, as if it were
+/// printed directly.
+class TaskOutputStream : public raw_string_ostream {
+  bool HasColors;
 
-raw_ostream &DWARFVerifier::warn() const { return WithColor::warning(OS); }
+public:
+  TaskOutputStream(std::string &Buffer, bool HasColors, bool ColorsEnabled)
+      : raw_string_ostream(Buffer), HasColors(HasColors) {
+    enable_colors(ColorsEnabled);
+  }
 
-raw_ostream &DWARFVerifier::note() const { return WithColor::note(OS); }
+  bool has_colors() const override { return HasColors; }
+};
+} // namespace
+
+raw_ostream &DWARFVerifier::out() const { return TaskOS ? *TaskOS : OS; }
+
+raw_ostream &DWARFVerifier::error() const { return WithColor::error(out()); }
+
+raw_ostream &DWARFVerifier::warn() const { return WithColor::warning(out()); }
+
+raw_ostream &DWARFVerifier::note() const { return WithColor::note(out()); }
 
 raw_ostream &DWARFVerifier::dump(const DWARFDie &Die, unsigned indent) const {
-  Die.dump(OS, indent, DumpOpts);
-  return OS;
+  Die.dump(out(), indent, DumpOpts);
+  return out();
+}
+
+bool DWARFVerifier::isParallel() const {
+  return DumpOpts.NumThreads != 1 && DCtx.isThreadSafe();
+}
+
+unsigned DWARFVerifier::runTasks(size_t NumTasks,
+                                 function_ref<unsigned(size_t)> Task) {
+  unsigned NumErrors = 0;
+  if (!isParallel() || NumTasks < 2) {
+    for (size_t Index = 0; Index != NumTasks; ++Index)
+      NumErrors += Task(Index);
+    return NumErrors;
+  }
+
+  std::vector<std::string> Outputs(NumTasks);
+  std::vector<std::shared_future<unsigned>> Results;
+  Results.reserve(NumTasks);
+  // Query the color support of OS once: raw_fd_ostream computes it lazily.
+  const bool HasColors = OS.has_colors();
+  const bool ColorsEnabled = OS.colors_enabled();
+  DefaultThreadPool Pool(hardware_concurrency(DumpOpts.NumThreads));
+  for (size_t Index = 0; Index != NumTasks; ++Index)
+    Results.push_back(Pool.async([&, Index]() {
+      TaskOutputStream TaskStream(Outputs[Index], HasColors, ColorsEnabled);
+      TaskOS = &TaskStream;
+      unsigned NumTaskErrors = Task(Index);
+      TaskOS = nullptr;
+      return NumTaskErrors;
+    }));
+
+  // Print the output of each task as soon as it and all the tasks before it
+  // are done.
+  for (size_t Index = 0; Index != NumTasks; ++Index) {
+    NumErrors += Results[Index].get();
+    OS << Outputs[Index];
+    Outputs[Index] = std::string();
+  }
+  return NumErrors;
+}
+
+void DWARFVerifier::extractUnitsForTasks(bool ResolveSplitUnits) {
+  if (!isParallel())
+    return;
+  if (!UnitsExtracted) {
+    for (const auto &U : DCtx.normal_units())
+      U->getUnitDIE(/*ExtractUnitDIEOnly=*/false);
+    for (const auto &U : DCtx.dwo_units())
+      U->getUnitDIE(/*ExtractUnitDIEOnly=*/false);
+    UnitsExtracted = true;
+  }
+  if (!ResolveSplitUnits || SplitUnitsExtracted)
+    return;
+  for (const auto &U : DCtx.normal_units()) {
+    if (!U->getDWOId())
+      continue;
+    DWARFUnit *SplitUnit =
+        U->getNonSkeletonUnitDIE(/*ExtractUnitDIEOnly=*/false).getDwarfUnit();
+    if (!SplitUnit || SplitUnit == U.get())
+      continue;
+    // Foreign type unit entries are resolved to the type units of the split
+    // unit's context.
+    for (const auto &DWOUnit : SplitUnit->getContext().dwo_units())
+      DWOUnit->getUnitDIE(/*ExtractUnitDIEOnly=*/false);
+  }
+  SplitUnitsExtracted = true;
 }
@@ -99,7 +99,7 @@ DILocation *DILocation::getImpl(LLVMContext &Context, unsigned Line,
   Ops.push_back(Scope);
   if (InlinedAt)
     Ops.push_back(InlinedAt);
-  return storeImpl(new (Ops.size(), Storage) DILocation(
+  return storeImpl(new (Ops.size(), Storage, Context) DILocation(
                        Context, Storage, Line, Column, Ops, ImplicitCode),
                    Storage, Context.pImpl->DILocations);
 }
@@ -1319,7 +1319,9 @@ DILocalVariable::getImpl(LLVMContext &Context, Metadata *Scope, MDString *Name,
   DEFINE_GETIMPL_LOOKUP(DILocalVariable, (Scope, Name, File, Line, Type, Arg,
                                           Flags, AlignInBits, Annotations));
   Metadata *Ops[] = {Scope, Name, File, Type, Annotations};
-  DEFINE_GETIMPL_STORE(DILocalVariable, (Line, Arg, Flags, AlignInBits), Ops);
+  return storeImpl(new (std::size(Ops), Storage, Context) DILocalVariable(
+                       Context, Storage, Line, Arg, Flags, AlignInBits, Ops),
+                   Storage, Context.pImpl->DILocalVariables);
 }
 
 DIVariable::DIVariable(LLVMContext &C, unsigned ID, StorageType Storage,
@@ -1370,7 +1372,9 @@ DIExpression *DIExpression::getImpl(LLVMContext &Context,
                                     ArrayRef<uint64_t> Elements,
                                     StorageType Storage, bool ShouldCreate) {
   DEFINE_GETIMPL_LOOKUP(DIExpression, (Elements));
-  DEFINE_GETIMPL_STORE_NO_OPS(DIExpression, (Elements));
+  return storeImpl(new (0u, Storage, Context)
+                       DIExpression(Context, Storage, Elements),
+                   Storage, Context.pImpl->DIExpressions);
 }
 bool DIExpression::isEntryValue() const {
   if (auto singleLocElts = getSingleLocationExpressionElements()) {
@@ -1606,6 +1606,11 @@ public:
   SpecificBumpPtrAllocator<ConstantRangeAttributeImpl>
       ConstantRangeAttributeAlloc;
 
+  /// Backing storage for uniqued debug-info nodes (DILocation,
+  /// DILocalVariable and DIExpression) and their operands. Deleting such a node
+  /// runs its destructor but leaves the memory here until the context dies.
+  BumpPtrAllocator MDNodeAlloc;
+
   DenseMap<unsigned, IntegerType *> IntegerTypes;
 
   using FunctionTypeSet = DenseSet<FunctionType *, FunctionTypeKeyInfo>;
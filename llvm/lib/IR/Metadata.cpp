@@ -640,11 +640,30 @@ void *MDNode::operator new(size_t Size, size_t NumOps, StorageType Storage) {
   return reinterpret_cast<void *>(H + 1);
 }
 
+void *MDNode::operator new(size_t Size, size_t NumOps, StorageType Storage,
+                           LLVMContext &Context) {
+  // Temporary and distinct nodes can be resized or freed individually; only
+  // uniqued nodes, whose operand count is fixed, go into the arena.
+  if (Storage != Uniqued)
+    return operator new(Size, NumOps, Storage);
+
+  size_t AllocSize =
+      alignTo(Header::getAllocSize(Storage, NumOps), alignof(uint64_t));
+  char *Mem = reinterpret_cast<char *>(Context.pImpl->MDNodeAlloc.Allocate(
+      AllocSize + Size, alignof(uint64_t)));
+  Header *H = new (Mem + AllocSize - sizeof(Header)) Header(NumOps, Storage);
+  H->IsArenaAllocated = true;
+  return reinterpret_cast<void *>(H + 1);
+}
+
 void MDNode::operator delete(void *N) {
   Header *H = reinterpret_cast<Header *>(N) - 1;
   void *Mem = H->getAllocation();
+  bool IsArenaAllocated = H->IsArenaAllocated;
   H->~Header();
-  ::operator delete(Mem);
+  // Arena memory is reclaimed when the owning context is destroyed.
+  if (!IsArenaAllocated)
+    ::operator delete(Mem);
 }
 
 MDNode::MDNode(LLVMContext &Context, unsigned ID, StorageType Storage,
@@ -678,6 +697,7 @@ TempMDNode MDNode::clone() const {
 MDNode::Header::Header(size_t NumOps, StorageType Storage) {
   IsLarge = isLarge(NumOps);
   IsResizable = isResizable(Storage);
+  IsArenaAllocated = false;
   SmallSize = getSmallSize(NumOps, IsResizable, IsLarge);
   if (IsLarge) {
     SmallNumOps = 0;
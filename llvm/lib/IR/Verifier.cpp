@@ -119,6 +119,8 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/ModRef.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -135,6 +137,11 @@ static cl::opt<bool> VerifyNoAliasScopeDomination(
     cl::desc("Ensure that llvm.experimental.noalias.scope.decl for identical "
              "scopes are not dominating"));
 
+static cl::opt<unsigned> VerifierThreads(
+    "verify-threads", cl::Hidden, cl::init(1),
+    cl::desc("Number of threads used to verify the functions of a module "
+             "(0 uses all available hardware threads)"));
+
 namespace llvm {
 
 struct VerifierSupport {
@@ -398,6 +405,13 @@ public:
 
   bool hasBrokenDebugInfo() const { return BrokenDebugInfo; }
 
+  /// Fold the cross-function state that \p Shard collected while verifying a
+  /// subset of this module's functions into this verifier, so that verify()
+  /// sees the whole module. Returns false if this exposes a problem that no
+  /// single shard could see, such as a DISubprogram attached to functions in
+  /// two different shards.
+  bool mergeFunctionState(const Verifier &Shard);
+
   bool verify(const Function &F) {
     assert(F.getParent() == &M &&
            "An instance of this class only works with a specific module!");
@@ -7184,6 +7198,31 @@ void Verifier::verifyCompileUnits() {
   CUVisited.clear();
 }
 
+bool Verifier::mergeFunctionState(const Verifier &Shard) {
+  Broken = false;
+
+  for (const auto &[F, Counts] : Shard.FrameEscapeInfo) {
+    auto &Entry = FrameEscapeInfo[F];
+    Entry.first = std::max(Entry.first, Counts.first);
+    Entry.second = std::max(Entry.second, Counts.second);
+  }
+
+  for (const auto &[SP, F] : Shard.DISubprogramAttachments) {
+    const Function *&AttachedTo = DISubprogramAttachments[SP];
+    if (AttachedTo && AttachedTo != F)
+      DebugInfoCheckFailed("DISubprogram attached to more than one function",
+                           SP, F);
+    AttachedTo = F;
+  }
+
+  CUVisited.insert(Shard.CUVisited.begin(), Shard.CUVisited.end());
+  // Nodes the shards already checked don't need another look from the
+  // module-level checks.
+  MDNodes.insert(Shard.MDNodes.begin(), Shard.MDNodes.end());
+  BrokenDebugInfo |= Shard.BrokenDebugInfo;
+  return !Broken;
+}
+
 void Verifier::verifyDeoptimizeCallingConvs() {
   if (DeoptimizeDeclarations.empty())
     return;
@@ -7312,14 +7351,109 @@ bool llvm::verifyFunction(const Function &f, raw_ostream *OS) {
   return !V.verify(F);
 }
 
+/// Verify the functions of \p M on \p NumThreads threads and fold what the
+/// module-level checks need into \p V.
+///
+/// The functions are split into contiguous shards of similar size, each
+/// checked by its own Verifier into a private buffer. The buffers are written
+/// to \p OS in module order, so the output reads as it would from a serial
+/// run, except that a broken metadata node reachable from several shards is
+/// reported once per shard. Returns true if any function is broken.
+static bool verifyFunctionsInParallel(Verifier &V, const Module &M,
+                                      raw_ostream *OS,
+                                      bool TreatBrokenDebugInfoAsError,
+                                      unsigned NumThreads) {
+  // Checking a call to an intrinsic may create the types in its signature and
+  // unique its mangled name, and checking EH pads materializes 'none'. None of
+  // that is safe to do concurrently, so do it once up front and let the shards
+  // only look the results up.
+  ConstantTokenNone::get(M.getContext());
+  for (const Function &F : M) {
+    Intrinsic::ID ID = F.getIntrinsicID();
+    if (ID == Intrinsic::not_intrinsic || F.use_empty())
+      continue;
+    FunctionType *FTy = F.getFunctionType();
+    SmallVector<Intrinsic::IITDescriptor, 8> Table;
+    getIntrinsicInfoTableEntries(ID, Table);
+    ArrayRef<Intrinsic::IITDescriptor> TableRef = Table;
+    SmallVector<Type *, 4> ArgTys;
+    if (Intrinsic::matchIntrinsicSignature(FTy, TableRef, ArgTys) ==
+            Intrinsic::MatchIntrinsicTypes_Match &&
+        !Intrinsic::matchIntrinsicVarArg(FTy->isVarArg(), TableRef) &&
+        TableRef.empty())
+      (void)Intrinsic::getName(ID, ArgTys, const_cast<Module *>(&M), FTy);
+  }
+
+  struct Shard {
+    ArrayRef<const Function *> Functions;
+    std::string Diagnostics;
+    std::unique_ptr<raw_string_ostream> OS;
+    std::unique_ptr<Verifier> V;
+    bool Broken = false;
+  };
+
+  SmallVector<const Function *, 0> Functions;
+  uint64_t TotalInsts = 0;
+  for (const Function &F : M) {
+    Functions.push_back(&F);
+    TotalInsts += F.getInstructionCount();
+  }
+  unsigned NumShards = std::min<size_t>(NumThreads, Functions.size());
+  uint64_t InstsPerShard = std::max<uint64_t>(1, TotalInsts / NumShards);
+
+  std::vector<Shard> Shards;
+  size_t Begin = 0;
+  uint64_t ShardInsts = 0;
+  for (size_t I = 0, E = Functions.size(); I != E; ++I) {
+    ShardInsts += Functions[I]->getInstructionCount();
+    if (I + 1 == E ||
+        (ShardInsts >= InstsPerShard && Shards.size() + 1 < NumShards)) {
+      Shards.emplace_back();
+      Shards.back().Functions =
+          ArrayRef(Functions).slice(Begin, I + 1 - Begin);
+      Begin = I + 1;
+      ShardInsts = 0;
+    }
+  }
+
+  {
+    DefaultThreadPool Pool(hardware_concurrency(Shards.size()));
+    for (Shard &S : Shards)
+      Pool.async([&] {
+        if (OS)
+          S.OS = std::make_unique<raw_string_ostream>(S.Diagnostics);
+        S.V = std::make_unique<Verifier>(S.OS.get(),
+                                         TreatBrokenDebugInfoAsError, M);
+        for (const Function *F : S.Functions)
+          S.Broken |= !S.V->verify(*F);
+      });
+    Pool.wait();
+  }
+
+  bool Broken = false;
+  for (Shard &S : Shards) {
+    if (OS)
+      *OS << S.Diagnostics;
+    Broken |= S.Broken;
+    Broken |= !V.mergeFunctionState(*S.V);
+  }
+  return Broken;
+}
+
 bool llvm::verifyModule(const Module &M, raw_ostream *OS,
                         bool *BrokenDebugInfo) {
   // Don't use a raw_null_ostream.  Printing IR is expensive.
   Verifier V(OS, /*ShouldTreatBrokenDebugInfoAsError=*/!BrokenDebugInfo, M);
 
   bool Broken = false;
-  for (const Function &F : M)
-    Broken |= !V.verify(F);
+  unsigned NumThreads =
+      hardware_concurrency(VerifierThreads).compute_thread_count();
+  if (NumThreads > 1 && M.size() > 1)
+    Broken |= verifyFunctionsInParallel(
+        V, M, OS, /*TreatBrokenDebugInfoAsError=*/!BrokenDebugInfo, NumThreads);
+  else
+    for (const Function &F : M)
+      Broken |= !V.verify(F);
 
   Broken |= !V.verify();
   if (BrokenDebugInfo)
@@ -65,6 +65,12 @@ STATISTIC(EmittedOrgFragments, "Number of emitted assembler fragments - org");
 STATISTIC(evaluateFixup, "Number of evaluated fixups");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
+STATISTIC(SectionRelaxationSweeps,
+          "Number of sweeps over a section's fragments during relaxation");
+STATISTIC(SkippedSectionRelaxations,
+          "Number of relaxed sections not revisited by a layout step");
+STATISTIC(SkippedFragmentRelaxations,
+          "Number of fragments before the first change not relaxed again");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
 
 } // end namespace stats
@@ -90,6 +96,8 @@ void MCAssembler::reset() {
   Symbols.clear();
   ThumbFuncs.clear();
   BundleAlignSize = 0;
+  RelaxedSections.clear();
+  CrossSectionDependent.clear();
 
   // reset objects owned by us
   if (getBackendPtr())
@@ -920,16 +928,12 @@ void MCAssembler::layout() {
     }
   }
 
-  // Layout until everything fits.
+  // Layout until everything fits. Sections keep their layout current while
+  // they are relaxed, so nothing needs to be invalidated between steps.
   this->HasLayout = true;
   while (layoutOnce()) {
     if (getContext().hadError())
       return;
-    // Size of fragments in one section can depend on the size of fragments in
-    // another. If any fragment has changed size, we have to re-layout (and
-    // as a result possibly further relax) all.
-    for (MCSection &Sec : *this)
-      Sec.setHasLayout(false);
   }
 
   DEBUG_WITH_TYPE("mc-dump", {
@@ -1290,14 +1294,188 @@ bool MCAssembler::relaxFragment(MCFragment &F) {
   }
 }
 
+// Whether the value of \p E can change when a section other than \p Sec is
+// laid out again: it refers to a label defined in another section, or to a
+// variable symbol, whose value may be defined in terms of labels anywhere in
+// the object.
+static bool refersOutsideSection(const MCExpr &E, const MCSection &Sec) {
+  switch (E.getKind()) {
+  case MCExpr::Constant:
+    return false;
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(E).getSymbol();
+    if (Sym.isVariable())
+      return true;
+    return Sym.isInSection() && &Sym.getSection() != &Sec;
+  }
+  case MCExpr::Unary:
+    return refersOutsideSection(*cast<MCUnaryExpr>(E).getSubExpr(), Sec);
+  case MCExpr::Binary: {
+    const auto &BE = cast<MCBinaryExpr>(E);
+    return refersOutsideSection(*BE.getLHS(), Sec) ||
+           refersOutsideSection(*BE.getRHS(), Sec);
+  }
+  case MCExpr::Target:
+    return true;
+  }
+  llvm_unreachable("Invalid assembly expression kind!");
+}
+
+// Whether the size of \p F can change when another section is laid out again.
+// A relaxable instruction depends on another section when one of its fixups
+// does, e.g. an immediate that is the difference of two labels elsewhere.
+static bool dependsOnOtherSections(const MCFragment &F) {
+  switch (F.getKind()) {
+  case MCFragment::FT_Align:
+  case MCFragment::FT_BoundaryAlign:
+  case MCFragment::FT_Data:
+  case MCFragment::FT_Nops:
+  case MCFragment::FT_SymbolId:
+  case MCFragment::FT_Dummy:
+    return false;
+  case MCFragment::FT_Relaxable: {
+    const MCSection &Sec = *F.getParent();
+    return any_of(cast<MCRelaxableFragment>(F).getFixups(),
+                  [&](const MCFixup &Fixup) {
+                    return refersOutsideSection(*Fixup.getValue(), Sec);
+                  });
+  }
+  default:
+    return true;
+  }
+}
+
+// Whether the value of \p E can change when the fragments from \p From onwards
+// move: it refers to a label defined in one of them, or to a variable symbol.
+static bool refersAtOrAfter(const MCExpr &E, const MCFragment &From) {
+  switch (E.getKind()) {
+  case MCExpr::Constant:
+    return false;
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(E).getSymbol();
+    if (Sym.isVariable())
+      return true;
+    return Sym.isInSection() && &Sym.getSection() == From.getParent() &&
+           Sym.getFragment()->getLayoutOrder() >= From.getLayoutOrder();
+  }
+  case MCExpr::Unary:
+    return refersAtOrAfter(*cast<MCUnaryExpr>(E).getSubExpr(), From);
+  case MCExpr::Binary: {
+    const auto &BE = cast<MCBinaryExpr>(E);
+    return refersAtOrAfter(*BE.getLHS(), From) ||
+           refersAtOrAfter(*BE.getRHS(), From);
+  }
+  case MCExpr::Target:
+    return true;
+  }
+  llvm_unreachable("Invalid assembly expression kind!");
+}
+
+// Whether the size of \p F, which precedes \p From and keeps its offset, can
+// change when the fragments from \p From onwards move. A relaxable instruction
+// only looks at them through its fixups, e.g. a forward branch across them.
+static bool dependsOnLaterFragments(const MCFragment &F,
+                                    const MCFragment &From) {
+  switch (F.getKind()) {
+  case MCFragment::FT_Align:
+  case MCFragment::FT_Data:
+  case MCFragment::FT_Nops:
+  case MCFragment::FT_SymbolId:
+  case MCFragment::FT_Dummy:
+    return false;
+  case MCFragment::FT_Relaxable:
+    return any_of(cast<MCRelaxableFragment>(F).getFixups(),
+                  [&](const MCFixup &Fixup) {
+                    return refersAtOrAfter(*Fixup.getValue(), From);
+                  });
+  default:
+    return true;
+  }
+}
+
+MCFragment *MCAssembler::relaxSection(MCSection &Sec, MCFragment *From) {
+  ++stats::SectionRelaxationSweeps;
+
+  // Place every fragment right after its predecessor's current size before
+  // relaxing it, so a fragment that grows shifts the ones behind it without a
+  // separate layout pass. A fixup pointing past a fragment that grew in this
+  // sweep still sees the old target offset, which the next sweep corrects.
+  //
+  // The fragments before From, the first one that changed in the previous
+  // sweep, have kept their offsets. Only those that look at the fragments
+  // behind them are relaxed again, and the layout is redone from From or
+  // from the first of them that changes, whichever comes first.
+  ensureValid(Sec);
+  bool FullSweep = !From;
+  bool Moved = FullSweep;
+  bool DependsOnOthers = false;
+  MCFragment *FirstChanged = nullptr;
+  MCFragment *Prev = nullptr;
+  uint64_t Offset = 0;
+  for (MCFragment &F : Sec) {
+    if (!Moved && &F == From) {
+      Moved = true;
+      Offset = F.Offset;
+    }
+    if (Moved) {
+      F.Offset = Offset;
+      if (isBundlingEnabled() && F.hasInstructions()) {
+        layoutBundle(Prev, &F);
+        Offset = F.Offset;
+      }
+    }
+    if (Moved || dependsOnLaterFragments(F, *From)) {
+      if (relaxFragment(F) && !FirstChanged) {
+        FirstChanged = &F;
+        if (!Moved) {
+          Moved = true;
+          Offset = F.Offset;
+        }
+      }
+    } else {
+      ++stats::SkippedFragmentRelaxations;
+    }
+    // Relaxation doesn't change what a fragment refers to, so the first sweep
+    // tells whether the section depends on others.
+    if (FullSweep)
+      DependsOnOthers |= dependsOnOtherSections(F);
+    if (Moved)
+      Offset += computeFragmentSize(F);
+    Prev = &F;
+  }
+
+  if (FullSweep) {
+    if (DependsOnOthers)
+      CrossSectionDependent.insert(&Sec);
+    else
+      CrossSectionDependent.erase(&Sec);
+  }
+  return FirstChanged;
+}
+
 bool MCAssembler::layoutOnce() {
   ++stats::RelaxationSteps;
 
   bool Changed = false;
-  for (MCSection &Sec : *this)
-    for (MCFragment &Frag : Sec)
-      if (relaxFragment(Frag))
-        Changed = true;
+  for (MCSection &Sec : *this) {
+    // Once a section has reached a fixed point it can only change again
+    // through fragments that look at other sections.
+    if (!RelaxedSections.insert(&Sec).second &&
+        !CrossSectionDependent.contains(&Sec)) {
+      ++stats::SkippedSectionRelaxations;
+      continue;
+    }
+
+    // Relax the section until it stops changing. This only re-walks the one
+    // section instead of re-laying out every section for every step, and each
+    // sweep after the first starts at the first fragment that changed.
+    MCFragment *From = nullptr;
+    while ((From = relaxSection(Sec, From))) {
+      Changed = true;
+      if (getContext().hadError())
+        return true;
+    }
+  }
   return Changed;
 }
 
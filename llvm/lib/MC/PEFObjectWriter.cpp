@@ -24,6 +24,7 @@
 #include "llvm/MC/MCFragment.h"
 #include "llvm/MC/MCObjectWriter.h"
 #include "llvm/MC/MCSection.h"
+#include "llvm/MC/MCSectionPEF.h"
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/MC/MCValue.h"
 #include "llvm/Support/Alignment.h"
@@ -213,6 +214,12 @@ void PEFWriter::collectSections(MCAssembler &Asm,
       Entry.SectionKind = PEF::kPEFUnpackedDataSection;
     }
 
+    // Sections that are only read by tools (e.g. codegen data) are not
+    // instantiated, so the linker leaves them out of the image.
+    if (auto *PEFSec = dyn_cast<MCSectionPEF>(&Sec))
+      if (PEFSec->getSectionType() == PEF::kPEFDebugSection)
+        Entry.SectionKind = PEF::kPEFDebugSection;
+
     // Get section alignment
     Entry.Alignment = Log2(Sec.getAlign());
 
@@ -281,6 +288,10 @@ void PEFWriter::collectSymbols(MCAssembler &Asm) {
     if (SectionIndex == -1)
       continue;
 
+    // Labels in non-instantiated sections have no address in the image.
+    if (Sections[SectionIndex].SectionKind == PEF::kPEFDebugSection)
+      continue;
+
     uint64_t Address = Asm.getSymbolOffset(Sym);
     // Export symbols that are not temporary (local labels start with .L)
     bool IsExported = !Sym.isTemporary();
@@ -27,15 +27,19 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <deque>
 #include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <stack>
 #include <string>
@@ -821,9 +825,23 @@ public:
 
 } // namespace
 
-Error CoverageMapping::loadFunctionRecord(
-    const CoverageMappingRecord &Record,
-    IndexedInstrProfReader &ProfileReader) {
+using HashMismatchList = std::vector<std::pair<std::string, uint64_t>>;
+using RecordProvenanceMap = DenseMap<size_t, DenseSet<size_t>>;
+
+/// Build the function record for \p Record, with the counts and bitmap read
+/// from \p ProfileReader. The profile reader is only used with \p ProfileLock
+/// held, so records can be built on several threads.
+///
+/// Returns std::nullopt if the record is to be ignored, including when
+/// \p RecordProvenance shows that a record for the same function and files
+/// was already loaded. Functions whose hash does not match the profile are
+/// appended to \p HashMismatches.
+static Expected<std::optional<FunctionRecord>>
+buildFunctionRecord(const CoverageMappingRecord &Record,
+                    IndexedInstrProfReader &ProfileReader,
+                    std::mutex &ProfileLock,
+                    const RecordProvenanceMap &RecordProvenance,
+                    HashMismatchList &HashMismatches) {
   StringRef OrigFuncName = Record.FunctionName;
   if (OrigFuncName.empty())
     return make_error<CoverageMapError>(coveragemap_error::malformed,
@@ -836,14 +854,15 @@ Error CoverageMapping::loadFunctionRecord(
 
   CounterMappingContext Ctx(Record.Expressions);
 
+  std::unique_lock<std::mutex> Lock(ProfileLock);
   std::vector<uint64_t> Counts;
   if (Error E = ProfileReader.getFunctionCounts(Record.FunctionName,
                                                 Record.FunctionHash, Counts)) {
     instrprof_error IPE = std::get<0>(InstrProfError::take(std::move(E)));
     if (IPE == instrprof_error::hash_mismatch) {
-      FuncHashMismatches.emplace_back(std::string(Record.FunctionName),
-                                      Record.FunctionHash);
-      return Error::success();
+      HashMismatches.emplace_back(std::string(Record.FunctionName),
+                                  Record.FunctionHash);
+      return std::nullopt;
     }
     if (IPE != instrprof_error::unknown_function)
       return make_error<InstrProfError>(IPE);
@@ -859,14 +878,15 @@ Error CoverageMapping::loadFunctionRecord(
                                                 Record.FunctionHash, Bitmap)) {
     instrprof_error IPE = std::get<0>(InstrProfError::take(std::move(E)));
     if (IPE == instrprof_error::hash_mismatch) {
-      FuncHashMismatches.emplace_back(std::string(Record.FunctionName),
-                                      Record.FunctionHash);
-      return Error::success();
+      HashMismatches.emplace_back(std::string(Record.FunctionName),
+                                  Record.FunctionHash);
+      return std::nullopt;
     }
     if (IPE != instrprof_error::unknown_function)
       return make_error<InstrProfError>(IPE);
     Bitmap = BitVector(getMaxBitmapSize(Record, IsVersion11));
   }
+  Lock.unlock();
   Ctx.setBitmap(std::move(Bitmap));
 
   assert(!Record.MappingRegions.empty() && "Function has no regions");
@@ -878,7 +898,16 @@ Error CoverageMapping::loadFunctionRecord(
   // when they have non-zero counts in the profile).
   if (Record.MappingRegions.size() == 1 &&
       Record.MappingRegions[0].Count.isZero() && Counts[0] > 0)
-    return Error::success();
+    return std::nullopt;
+
+  // The same function is usually present in many binaries, e.g. when it is
+  // defined in a header. Once a record for it has been loaded, any further
+  // record would be dropped by addFunctionRecord(), so don't build it.
+  auto Provenance = RecordProvenance.find(
+      hash_combine_range(Record.Filenames.begin(), Record.Filenames.end()));
+  if (Provenance != RecordProvenance.end() &&
+      Provenance->second.contains(hash_value(OrigFuncName)))
+    return std::nullopt;
 
   MCDCDecisionRecorder MCDCDecisions;
   FunctionRecord Function(OrigFuncName, Record.Filenames);
@@ -892,12 +921,12 @@ Error CoverageMapping::loadFunctionRecord(
     Expected<int64_t> ExecutionCount = Ctx.evaluate(Region.Count);
     if (auto E = ExecutionCount.takeError()) {
       consumeError(std::move(E));
-      return Error::success();
+      return std::nullopt;
     }
     Expected<int64_t> AltExecutionCount = Ctx.evaluate(Region.FalseCount);
     if (auto E = AltExecutionCount.takeError()) {
       consumeError(std::move(E));
-      return Error::success();
+      return std::nullopt;
     }
     Function.pushRegion(Region, *ExecutionCount, *AltExecutionCount);
 
@@ -925,18 +954,37 @@ Error CoverageMapping::loadFunctionRecord(
         Ctx.evaluateMCDCRegion(*MCDCDecision, MCDCBranches, IsVersion11);
     if (auto E = Record.takeError()) {
       consumeError(std::move(E));
-      return Error::success();
+      return std::nullopt;
     }
 
     // Save the MC/DC Record so that it can be visualized later.
     Function.pushMCDCRecord(std::move(*Record));
   }
 
+  return std::move(Function);
+}
+
+Error CoverageMapping::loadFunctionRecord(
+    const CoverageMappingRecord &Record,
+    IndexedInstrProfReader &ProfileReader) {
+  std::mutex ProfileLock;
+  Expected<std::optional<FunctionRecord>> Function = buildFunctionRecord(
+      Record, ProfileReader, ProfileLock, RecordProvenance, FuncHashMismatches);
+  if (!Function)
+    return Function.takeError();
+  if (*Function)
+    addFunctionRecord(std::move(**Function));
+  return Error::success();
+}
+
+void CoverageMapping::addFunctionRecord(FunctionRecord &&Function) {
   // Don't create records for (filenames, function) pairs we've already seen.
-  auto FilenamesHash = hash_combine_range(Record.Filenames.begin(),
-                                          Record.Filenames.end());
-  if (!RecordProvenance[FilenamesHash].insert(hash_value(OrigFuncName)).second)
-    return Error::success();
+  // The hashes of the std::string file names match those of the StringRefs
+  // buildFunctionRecord() looks up.
+  auto FilenamesHash = hash_combine_range(Function.Filenames.begin(),
+                                          Function.Filenames.end());
+  if (!RecordProvenance[FilenamesHash].insert(hash_value(Function.Name)).second)
+    return;
 
   Functions.push_back(std::move(Function));
 
@@ -944,7 +992,7 @@ Error CoverageMapping::loadFunctionRecord(
   // which correspond to each filename. This can be used to substantially speed
   // up queries for coverage info in a file.
   unsigned RecordIndex = Functions.size() - 1;
-  for (StringRef Filename : Record.Filenames) {
+  for (StringRef Filename : Functions.back().Filenames) {
     auto &RecordIndices = FilenameHash2RecordIndices[hash_value(Filename)];
     // Note that there may be duplicates in the filename set for a function
     // record, because of e.g. macro expansions in the function in which both
@@ -952,8 +1000,6 @@ Error CoverageMapping::loadFunctionRecord(
     if (RecordIndices.empty() || RecordIndices.back() != RecordIndex)
       RecordIndices.push_back(RecordIndex);
   }
-
-  return Error::success();
 }
 
 // This function is for memory optimization by shortening the lifetimes
@@ -995,10 +1041,27 @@ static Error handleMaybeNoDataFoundError(Error E) {
       });
 }
 
-Error CoverageMapping::loadFromFile(
-    StringRef Filename, StringRef Arch, StringRef CompilationDir,
-    IndexedInstrProfReader &ProfileReader, CoverageMapping &Coverage,
-    bool &DataFound, SmallVectorImpl<object::BuildID> *FoundBinaryIDs) {
+namespace {
+/// The function records decoded from one object file.
+struct DecodedObject {
+  std::vector<FunctionRecord> Functions;
+  HashMismatchList HashMismatches;
+  SmallVector<object::BuildID> BinaryIDs;
+  bool DataFound = false;
+  /// The result of decoding, set once the object file has been decoded.
+  std::optional<Error> Err;
+};
+} // namespace
+
+/// Read the coverage mapping of \p Filename and build its function records.
+/// Only the records are kept, the object file and its readers are released
+/// before returning.
+static Error decodeObject(StringRef Filename, StringRef Arch,
+                          StringRef CompilationDir,
+                          IndexedInstrProfReader &ProfileReader,
+                          std::mutex &ProfileLock,
+                          const RecordProvenanceMap &RecordProvenance,
+                          bool WantBinaryIDs, DecodedObject &Decoded) {
   auto CovMappingBufOrErr = MemoryBuffer::getFileOrSTDIN(
       Filename, /*IsText=*/false, /*RequiresNullTerminator=*/false);
   if (std::error_code EC = CovMappingBufOrErr.getError())
@@ -1010,7 +1073,7 @@ Error CoverageMapping::loadFromFile(
   SmallVector<object::BuildIDRef> BinaryIDs;
   auto CoverageReadersOrErr = BinaryCoverageReader::create(
       CovMappingBufRef, Arch, Buffers, CompilationDir,
-      FoundBinaryIDs ? &BinaryIDs : nullptr);
+      WantBinaryIDs ? &BinaryIDs : nullptr);
   if (Error E = CoverageReadersOrErr.takeError()) {
     E = handleMaybeNoDataFoundError(std::move(E));
     if (E)
@@ -1018,25 +1081,99 @@ Error CoverageMapping::loadFromFile(
     return E;
   }
 
-  SmallVector<std::unique_ptr<CoverageMappingReader>, 4> Readers;
-  for (auto &Reader : CoverageReadersOrErr.get())
-    Readers.push_back(std::move(Reader));
-  if (FoundBinaryIDs && !Readers.empty()) {
-    llvm::append_range(*FoundBinaryIDs,
+  auto &Readers = CoverageReadersOrErr.get();
+  if (WantBinaryIDs && !Readers.empty()) {
+    llvm::append_range(Decoded.BinaryIDs,
                        llvm::map_range(BinaryIDs, [](object::BuildIDRef BID) {
                          return object::BuildID(BID);
                        }));
   }
-  DataFound |= !Readers.empty();
-  if (Error E = loadFromReaders(Readers, ProfileReader, Coverage))
-    return createFileError(Filename, std::move(E));
+  Decoded.DataFound = !Readers.empty();
+  for (const auto &Reader : Readers) {
+    for (auto RecordOrErr : *Reader) {
+      if (Error E = RecordOrErr.takeError())
+        return createFileError(Filename, std::move(E));
+      Expected<std::optional<FunctionRecord>> Function =
+          buildFunctionRecord(*RecordOrErr, ProfileReader, ProfileLock,
+                              RecordProvenance, Decoded.HashMismatches);
+      if (!Function)
+        return createFileError(Filename, Function.takeError());
+      if (*Function)
+        Decoded.Functions.push_back(std::move(**Function));
+    }
+  }
+  return Error::success();
+}
+
+Error CoverageMapping::loadFromFiles(
+    ArrayRef<StringRef> Filenames, ArrayRef<StringRef> Arches,
+    StringRef CompilationDir, IndexedInstrProfReader &ProfileReader,
+    CoverageMapping &Coverage, bool &DataFound, unsigned NumThreads,
+    SmallVectorImpl<object::BuildID> *FoundBinaryIDs) {
+  assert(Filenames.size() == Arches.size() && "One architecture per file");
+  assert(!Coverage.SingleByteCoverage ||
+         *Coverage.SingleByteCoverage == ProfileReader.hasSingleByteCoverage());
+  Coverage.SingleByteCoverage = ProfileReader.hasSingleByteCoverage();
+  ThreadPoolStrategy S = hardware_concurrency(NumThreads);
+  if (NumThreads == 0) {
+    // If NumThreads is not specified, create one thread for each input, up to
+    // the number of hardware cores.
+    S = heavyweight_hardware_concurrency(Filenames.size());
+    S.Limit = true;
+  }
+
+  // Files are decoded in batches. The records of a batch are only added to
+  // Coverage once the whole batch is decoded, in file order, so the result
+  // does not depend on the number of threads. Decoding only reads
+  // Coverage.RecordProvenance, to skip functions loaded by earlier batches.
+  std::mutex ProfileLock;
+  std::deque<DecodedObject> Batch;
+  std::optional<DefaultThreadPool> Pool;
+  if (S.compute_thread_count() > 1 && Filenames.size() > 1)
+    Pool.emplace(S);
+  const size_t BatchSize = Pool ? 4 * Pool->getMaxConcurrency() : 1;
+  for (size_t Begin = 0; Begin < Filenames.size(); Begin += BatchSize) {
+    Batch.clear();
+    for (size_t I = Begin, E = std::min(Begin + BatchSize, Filenames.size());
+         I != E; ++I) {
+      DecodedObject &Decoded = Batch.emplace_back();
+      auto Decode = [&, I] {
+        Decoded.Err = decodeObject(Filenames[I], Arches[I], CompilationDir,
+                                   ProfileReader, ProfileLock,
+                                   Coverage.RecordProvenance,
+                                   FoundBinaryIDs != nullptr, Decoded);
+      };
+      if (Pool)
+        Pool->async(Decode);
+      else
+        Decode();
+    }
+    if (Pool)
+      Pool->wait();
+
+    for (DecodedObject &Decoded : Batch) {
+      if (Error E = std::move(*Decoded.Err)) {
+        // The files of the batch decoded after the failing one are dropped.
+        for (DecodedObject &Dropped : Batch)
+          consumeError(std::move(*Dropped.Err));
+        return E;
+      }
+      DataFound |= Decoded.DataFound;
+      if (FoundBinaryIDs)
+        llvm::append_range(*FoundBinaryIDs, Decoded.BinaryIDs);
+      llvm::append_range(Coverage.FuncHashMismatches, Decoded.HashMismatches);
+      for (FunctionRecord &Function : Decoded.Functions)
+        Coverage.addFunctionRecord(std::move(Function));
+    }
+  }
   return Error::success();
 }
 
 Expected<std::unique_ptr<CoverageMapping>> CoverageMapping::load(
     ArrayRef<StringRef> ObjectFilenames, StringRef ProfileFilename,
     vfs::FileSystem &FS, ArrayRef<StringRef> Arches, StringRef CompilationDir,
-    const object::BuildIDFetcher *BIDFetcher, bool CheckBinaryIDs) {
+    const object::BuildIDFetcher *BIDFetcher, bool CheckBinaryIDs,
+    unsigned NumThreads) {
   auto ProfileReaderOrErr = IndexedInstrProfReader::create(ProfileFilename, FS);
   if (Error E = ProfileReaderOrErr.takeError())
     return createFileError(ProfileFilename, std::move(E));
@@ -1052,13 +1189,14 @@ Expected<std::unique_ptr<CoverageMapping>> CoverageMapping::load(
     return Arches[Idx];
   };
 
+  SmallVector<StringRef> ObjectArches;
+  for (size_t Idx = 0; Idx != ObjectFilenames.size(); ++Idx)
+    ObjectArches.push_back(GetArch(Idx));
   SmallVector<object::BuildID> FoundBinaryIDs;
-  for (const auto &File : llvm::enumerate(ObjectFilenames)) {
-    if (Error E =
-            loadFromFile(File.value(), GetArch(File.index()), CompilationDir,
-                         *ProfileReader, *Coverage, DataFound, &FoundBinaryIDs))
-      return std::move(E);
-  }
+  if (Error E = loadFromFiles(ObjectFilenames, ObjectArches, CompilationDir,
+                              *ProfileReader, *Coverage, DataFound, NumThreads,
+                              &FoundBinaryIDs))
+    return std::move(E);
 
   if (BIDFetcher) {
     std::vector<object::BuildID> ProfileBinaryIDs;
@@ -1078,14 +1216,11 @@ Expected<std::unique_ptr<CoverageMapping>> CoverageMapping::load(
           std::inserter(BinaryIDsToFetch, BinaryIDsToFetch.end()), Compare);
     }
 
+    std::vector<std::string> FetchedPaths;
     for (object::BuildIDRef BinaryID : BinaryIDsToFetch) {
       std::optional<std::string> PathOpt = BIDFetcher->fetch(BinaryID);
       if (PathOpt) {
-        std::string Path = std::move(*PathOpt);
-        StringRef Arch = Arches.size() == 1 ? Arches.front() : StringRef();
-        if (Error E = loadFromFile(Path, Arch, CompilationDir, *ProfileReader,
-                                  *Coverage, DataFound))
-          return std::move(E);
+        FetchedPaths.push_back(std::move(*PathOpt));
       } else if (CheckBinaryIDs) {
         return createFileError(
             ProfileFilename,
@@ -1094,6 +1229,16 @@ Expected<std::unique_ptr<CoverageMapping>> CoverageMapping::load(
                                   llvm::toHex(BinaryID, /*LowerCase=*/true)));
       }
     }
+
+    SmallVector<StringRef> FetchedFilenames(FetchedPaths.begin(),
+                                            FetchedPaths.end());
+    SmallVector<StringRef> FetchedArches(
+        FetchedPaths.size(),
+        Arches.size() == 1 ? Arches.front() : StringRef());
+    if (Error E = loadFromFiles(FetchedFilenames, FetchedArches,
+                                CompilationDir, *ProfileReader, *Coverage,
+                                DataFound, NumThreads))
+      return std::move(E);
   }
 
   if (!DataFound)
@@ -11,11 +11,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/CachePruning.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Chrono.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LineIterator.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
@@ -24,6 +28,8 @@
 
 #include <set>
 #include <system_error>
+#include <tuple>
+#include <vector>
 
 using namespace llvm;
 
@@ -32,6 +38,8 @@ struct FileInfo {
   sys::TimePoint<> Time;
   uint64_t Size;
   std::string Path;
+  /// Whether Time comes from the access index rather than the file status.
+  bool FromIndex = false;
 
   /// Used to determine which files to prune first. Also used to determine
   /// set membership, so must take into account all fields.
@@ -40,8 +48,130 @@ struct FileInfo {
            std::tie(Other.Time, Size, Other.Path);
   }
 };
+
+/// What the access index knows about a cache entry.
+struct IndexEntry {
+  sys::TimePoint<> Time;
+  uint64_t Size;
+};
 } // anonymous namespace
 
+/// Name of the access index within the cache directory. It does not start with
+/// "llvmcache-", so the pruner never treats it as a cache entry.
+static constexpr StringLiteral CacheIndexName = "llvmcache.index";
+
+/// Size above which recordCacheAccess() compacts the access index. Compaction
+/// keeps at most half as many bytes of records, so it happens at most once
+/// every MaxCacheIndexSize / 2 bytes of appended records.
+static constexpr uint64_t MaxCacheIndexSize = 4 * 1024 * 1024;
+
+/// Read the access index of a cache. Each record is a line of the form
+/// "<time_t> <size> <entry file name>"; later records for an entry supersede
+/// earlier ones. Malformed records are ignored, which leaves the corresponding
+/// entries to be stat()'ed.
+static StringMap<IndexEntry> readCacheIndex(StringRef IndexFile) {
+  StringMap<IndexEntry> Entries;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(IndexFile, /*IsText=*/false,
+                            /*RequiresNullTerminator=*/false);
+  if (!MBOrErr)
+    return Entries;
+
+  for (line_iterator Line(**MBOrErr, /*SkipBlanks=*/true); !Line.is_at_eof();
+       ++Line) {
+    auto [TimeStr, Rest] = Line->split(' ');
+    auto [SizeStr, Name] = Rest.split(' ');
+    int64_t Time;
+    uint64_t Size;
+    if (TimeStr.getAsInteger(10, Time) || SizeStr.getAsInteger(10, Size) ||
+        Name.empty())
+      continue;
+    Entries[Name] = {sys::toTimePoint(static_cast<std::time_t>(Time)), Size};
+  }
+  return Entries;
+}
+
+/// Replace the access index with \p Records. The new index is published with a
+/// single rename. Records appended by other processes after the index was read
+/// are lost, and the entries they describe are stat()'ed again at the next
+/// pruning.
+static void
+writeCacheIndex(StringRef Path, StringRef IndexFile,
+                ArrayRef<std::pair<StringRef, IndexEntry>> Records) {
+  SmallString<128> TempFileModel(Path);
+  sys::path::append(TempFileModel, Twine(CacheIndexName) + "-%%%%%%.tmp");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(TempFileModel);
+  if (!Temp) {
+    LLVM_DEBUG(dbgs() << "Can't compact the cache index: "
+                      << toString(Temp.takeError()) << "\n");
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    for (const auto &[Name, Entry] : Records)
+      OS << sys::toTimeT(Entry.Time) << ' ' << Entry.Size << ' ' << Name
+         << '\n';
+  }
+
+  if (Error E = Temp->keep(IndexFile))
+    LLVM_DEBUG(dbgs() << "Can't compact the cache index: "
+                      << toString(std::move(E)) << "\n");
+}
+
+/// Compact an access index that has grown past MaxCacheIndexSize: keep one
+/// record per entry, and only the most recently used entries that fit in half
+/// of that size. Entries that are dropped are stat()'ed by the pruner again.
+static void compactCacheIndex(StringRef Path, StringRef IndexFile) {
+  StringMap<IndexEntry> Index = readCacheIndex(IndexFile);
+  std::vector<std::pair<StringRef, IndexEntry>> Records;
+  Records.reserve(Index.size());
+  for (const auto &Entry : Index)
+    Records.push_back({Entry.getKey(), Entry.getValue()});
+  llvm::sort(Records, [](const auto &L, const auto &R) {
+    return std::tie(R.second.Time, L.first) < std::tie(L.second.Time, R.first);
+  });
+
+  uint64_t Size = 0;
+  size_t NumKept = 0;
+  for (const auto &[Name, Entry] : Records) {
+    // "<time_t> <size> <name>\n", with generous room for the numbers.
+    Size += Name.size() + 42;
+    if (Size > MaxCacheIndexSize / 2)
+      break;
+    ++NumKept;
+  }
+  Records.resize(NumKept);
+  writeCacheIndex(Path, IndexFile, Records);
+}
+
+void llvm::recordCacheAccess(StringRef Path, StringRef EntryName,
+                             uint64_t Size) {
+  SmallString<128> IndexFile(Path);
+  sys::path::append(IndexFile, CacheIndexName);
+
+  // Format the record up front so that it is appended with a single write.
+  SmallString<128> Record;
+  raw_svector_ostream(Record)
+      << sys::toTimeT(std::chrono::system_clock::now()) << ' ' << Size << ' '
+      << EntryName << '\n';
+
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(IndexFile, EC, sys::fs::OF_Append);
+    // The index only speeds up pruning, so failing to update it is harmless.
+    if (EC)
+      return;
+    OS << Record;
+  }
+
+  // Caches that are never pruned would otherwise keep growing their index.
+  uint64_t IndexSize;
+  if (!sys::fs::file_size(IndexFile, IndexSize) &&
+      IndexSize > MaxCacheIndexSize)
+    compactCacheIndex(Path, IndexFile);
+}
+
 /// Write a new timestamp file with the given path. This is used for the pruning
 /// interval option.
 static void writeTimestampFile(StringRef TimestampFile) {
@@ -206,6 +336,11 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
   std::set<FileInfo> FileInfos;
   uint64_t TotalSize = 0;
 
+  // Entries recorded in the access index don't need to be stat()'ed.
+  SmallString<128> IndexFile(Path);
+  sys::path::append(IndexFile, CacheIndexName);
+  StringMap<IndexEntry> Index = readCacheIndex(IndexFile);
+
   // Walk the entire directory cache, looking for unused files.
   std::error_code EC;
   SmallString<128> CachePathNative;
@@ -221,17 +356,37 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
     if (!filename.starts_with("llvmcache-") && !filename.starts_with("Thin-"))
       continue;
 
-    // Look at this file. If we can't stat it, there's nothing interesting
-    // there.
-    ErrorOr<sys::fs::basic_file_status> StatusOrErr = File->status();
-    if (!StatusOrErr) {
-      LLVM_DEBUG(dbgs() << "Ignore " << File->path() << " (can't stat)\n");
-      continue;
+    sys::TimePoint<> FileAccessTime;
+    uint64_t FileSize;
+    auto Indexed = Index.find(filename);
+    bool FromIndex = Indexed != Index.end();
+    if (FromIndex) {
+      FileAccessTime = Indexed->second.Time;
+      FileSize = Indexed->second.Size;
+    } else {
+      // Look at this file. If we can't stat it, there's nothing interesting
+      // there.
+      ErrorOr<sys::fs::basic_file_status> StatusOrErr = File->status();
+      if (!StatusOrErr) {
+        LLVM_DEBUG(dbgs() << "Ignore " << File->path() << " (can't stat)\n");
+        continue;
+      }
+      FileAccessTime = StatusOrErr->getLastAccessedTime();
+      FileSize = StatusOrErr->getSize();
     }
 
-    // If the file hasn't been used recently enough, delete it
-    const auto FileAccessTime = StatusOrErr->getLastAccessedTime();
+    // If the file hasn't been used recently enough, delete it. Tools that
+    // don't update the index may have used it since, so check its access time
+    // before trusting an expired index record.
     auto FileAge = CurrentTime - FileAccessTime;
+    if (Policy.Expiration != seconds(0) && FileAge > Policy.Expiration &&
+        FromIndex) {
+      FromIndex = false;
+      if (ErrorOr<sys::fs::basic_file_status> StatusOrErr = File->status())
+        FileAccessTime =
+            std::max(FileAccessTime, StatusOrErr->getLastAccessedTime());
+      FileAge = CurrentTime - FileAccessTime;
+    }
     if (Policy.Expiration != seconds(0) && FileAge > Policy.Expiration) {
       LLVM_DEBUG(dbgs() << "Remove " << File->path() << " ("
                         << duration_cast<seconds>(FileAge).count()
@@ -241,14 +396,29 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
     }
 
     // Leave it here for now, but add it to the list of size-based pruning.
-    TotalSize += StatusOrErr->getSize();
-    FileInfos.insert({FileAccessTime, StatusOrErr->getSize(), File->path()});
+    TotalSize += FileSize;
+    FileInfos.insert({FileAccessTime, FileSize, File->path(), FromIndex});
   }
 
   auto FileInfo = FileInfos.begin();
   size_t NumFiles = FileInfos.size();
 
   auto RemoveCacheFile = [&]() {
+    // Before evicting a file on the word of the index, check whether it was
+    // used since by a tool that doesn't update the index. If so, put it back
+    // in line according to its access time.
+    if (FileInfo->FromIndex) {
+      sys::fs::file_status Status;
+      if (!sys::fs::status(FileInfo->Path, Status) &&
+          Status.getLastAccessedTime() > FileInfo->Time) {
+        struct FileInfo Refreshed = *FileInfo;
+        Refreshed.Time = Status.getLastAccessedTime();
+        Refreshed.FromIndex = false;
+        FileInfo = FileInfos.erase(FileInfo);
+        FileInfos.insert(std::move(Refreshed));
+        return;
+      }
+    }
     // Remove the file.
     sys::fs::remove(FileInfo->Path);
     // Update size
@@ -315,5 +485,11 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy,
     while (TotalSize > TotalSizeTarget && FileInfo != FileInfos.end())
       RemoveCacheFile();
   }
+
+  // Rewrite the index with one record per entry left in the cache.
+  std::vector<std::pair<StringRef, IndexEntry>> Records;
+  for (const struct FileInfo &FI : make_range(FileInfo, FileInfos.end()))
+    Records.push_back({sys::path::filename(FI.Path), {FI.Time, FI.Size}});
+  writeCacheIndex(Path, IndexFile, Records);
   return true;
 }
@@ -13,10 +13,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Caching.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include <mutex>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -26,10 +29,44 @@
 
 using namespace llvm;
 
+namespace {
+/// The in-memory tier of a local cache. It keeps copies of the entries read or
+/// written through one FileCache, up to a byte budget, so that keys requested
+/// again are served without opening the cache file.
+class MemoryTier {
+  std::mutex Mutex;
+  StringMap<std::unique_ptr<MemoryBuffer>> Buffers;
+  uint64_t Limit;
+  uint64_t Size = 0;
+
+public:
+  explicit MemoryTier(uint64_t Limit) : Limit(Limit) {}
+
+  std::unique_ptr<MemoryBuffer> lookup(StringRef Key) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto I = Buffers.find(Key);
+    if (I == Buffers.end())
+      return nullptr;
+    return MemoryBuffer::getMemBufferCopy(I->second->getBuffer(),
+                                          I->second->getBufferIdentifier());
+  }
+
+  void insert(StringRef Key, const MemoryBuffer &MB) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (Size + MB.getBufferSize() > Limit || Buffers.contains(Key))
+      return;
+    Size += MB.getBufferSize();
+    Buffers[Key] = MemoryBuffer::getMemBufferCopy(MB.getBuffer(),
+                                                  MB.getBufferIdentifier());
+  }
+};
+} // end anonymous namespace
+
 Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
                                      const Twine &TempFilePrefixRef,
                                      const Twine &CacheDirectoryPathRef,
-                                     AddBufferFn AddBuffer) {
+                                     AddBufferFn AddBuffer,
+                                     uint64_t MemoryLimitBytes) {
 
   // Create local copies which are safely captured-by-copy in lambdas
   SmallString<64> CacheName, TempFilePrefix, CacheDirectoryPath;
@@ -37,8 +74,19 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
   TempFilePrefixRef.toVector(TempFilePrefix);
   CacheDirectoryPathRef.toVector(CacheDirectoryPath);
 
+  std::shared_ptr<MemoryTier> Memory;
+  if (MemoryLimitBytes)
+    Memory = std::make_shared<MemoryTier>(MemoryLimitBytes);
+
   auto Func = [=](unsigned Task, StringRef Key,
                   const Twine &ModuleName) -> Expected<AddStreamFn> {
+    if (Memory) {
+      if (std::unique_ptr<MemoryBuffer> MB = Memory->lookup(Key)) {
+        AddBuffer(Task, ModuleName, std::move(MB));
+        return AddStreamFn();
+      }
+    }
+
     // This choice of file name allows the cache to be pruned (see pruneCache()
     // in include/llvm/Support/CachePruning.h).
     SmallString<64> EntryPath;
@@ -55,6 +103,10 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
                                     /*RequiresNullTerminator=*/false);
       sys::fs::closeFile(*FDOrErr);
       if (MBOrErr) {
+        recordCacheAccess(CacheDirectoryPath, sys::path::filename(EntryPath),
+                          (*MBOrErr)->getBufferSize());
+        if (Memory)
+          Memory->insert(Key, **MBOrErr);
         AddBuffer(Task, ModuleName, std::move(*MBOrErr));
         return AddStreamFn();
       }
@@ -80,13 +132,20 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
       sys::fs::TempFile TempFile;
       std::string ModuleName;
       unsigned Task;
+      std::string CacheDirectoryPath;
+      std::string Key;
+      std::shared_ptr<MemoryTier> Memory;
 
       CacheStream(std::unique_ptr<raw_pwrite_stream> OS, AddBufferFn AddBuffer,
                   sys::fs::TempFile TempFile, std::string EntryPath,
-                  std::string ModuleName, unsigned Task)
+                  std::string ModuleName, unsigned Task,
+                  std::string CacheDirectoryPath, std::string Key,
+                  std::shared_ptr<MemoryTier> Memory)
           : CachedFileStream(std::move(OS), std::move(EntryPath)),
             AddBuffer(std::move(AddBuffer)), TempFile(std::move(TempFile)),
-            ModuleName(ModuleName), Task(Task) {}
+            ModuleName(ModuleName), Task(Task),
+            CacheDirectoryPath(std::move(CacheDirectoryPath)),
+            Key(std::move(Key)), Memory(std::move(Memory)) {}
 
       ~CacheStream() {
         // TODO: Manually commit rather than using non-trivial destructor,
@@ -105,40 +164,58 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
                              TempFile.TmpName + ": " +
                              MBOrErr.getError().message() + "\n");
 
-        // On POSIX systems, this will atomically replace the destination if
-        // it already exists. We try to emulate this on Windows, but this may
-        // fail with a permission denied error (for example, if the destination
-        // is currently opened by another process that does not give us the
-        // sharing permissions we need). Since the existing file should be
-        // semantically equivalent to the one we are trying to write, we give
-        // AddBuffer a copy of the bytes we wrote in that case. We do this
-        // instead of just using the existing file, because the pruner might
-        // delete the file before we get a chance to use it.
-        Error E = TempFile.keep(ObjectPathName);
-        E = handleErrors(std::move(E), [&](const ECError &E) -> Error {
-          std::error_code EC = E.convertToErrorCode();
-          if (EC != errc::permission_denied)
-            return errorCodeToError(EC);
-
+        // Since an existing file should be semantically equivalent to the one
+        // we are trying to write, we give AddBuffer a copy of the bytes we
+        // wrote and discard the temporary file when we can't, or needn't,
+        // rename it into place. We do this instead of just using the existing
+        // file, because the pruner might delete the file before we get a
+        // chance to use it.
+        auto DiscardTempFile = [&]() {
           auto MBCopy = MemoryBuffer::getMemBufferCopy((*MBOrErr)->getBuffer(),
                                                        ObjectPathName);
           MBOrErr = std::move(MBCopy);
 
           // FIXME: should we consume the discard error?
           consumeError(TempFile.discard());
-
-          return Error::success();
-        });
-
-        if (E)
-          report_fatal_error(Twine("Failed to rename temporary file ") +
-                             TempFile.TmpName + " to " + ObjectPathName + ": " +
-                             toString(std::move(E)) + "\n");
-
+        };
+
+        // When several links produce the same entry concurrently, only the
+        // first one to finish publishes it. The others skip the rename, which
+        // would only replace the entry with identical contents.
+        if (sys::fs::exists(ObjectPathName)) {
+          DiscardTempFile();
+        } else {
+          // On POSIX systems, this will atomically replace the destination if
+          // it already exists. We try to emulate this on Windows, but this may
+          // fail with a permission denied error (for example, if the
+          // destination is currently opened by another process that does not
+          // give us the sharing permissions we need).
+          Error E = TempFile.keep(ObjectPathName);
+          E = handleErrors(std::move(E), [&](const ECError &E) -> Error {
+            std::error_code EC = E.convertToErrorCode();
+            if (EC != errc::permission_denied)
+              return errorCodeToError(EC);
+            DiscardTempFile();
+            return Error::success();
+          });
+
+          if (E)
+            report_fatal_error(Twine("Failed to rename temporary file ") +
+                               TempFile.TmpName + " to " + ObjectPathName +
+                               ": " + toString(std::move(E)) + "\n");
+        }
+
+        recordCacheAccess(CacheDirectoryPath,
+                          sys::path::filename(ObjectPathName),
+                          (*MBOrErr)->getBufferSize());
+        if (Memory)
+          Memory->insert(Key, **MBOrErr);
         AddBuffer(Task, ModuleName, std::move(*MBOrErr));
       }
     };
 
+    // The key may not outlive this call, so the stream callback keeps a copy.
+    std::string KeyStr = Key.str();
     return [=](size_t Task, const Twine &ModuleName)
                -> Expected<std::unique_ptr<CachedFileStream>> {
       // Create the cache directory if not already done. Doing this lazily
@@ -164,7 +241,7 @@ Expected<FileCache> llvm::localCache(const Twine &CacheNameRef,
       return std::make_unique<CacheStream>(
           std::make_unique<raw_fd_ostream>(Temp->FD, /* ShouldClose */ false),
           AddBuffer, std::move(*Temp), std::string(EntryPath), ModuleName.str(),
-          Task);
+          Task, std::string(CacheDirectoryPath), KeyStr, Memory);
     };
   };
   return FileCache(Func, CacheDirectoryPathRef.str());
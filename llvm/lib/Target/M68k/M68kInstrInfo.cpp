@@ -26,6 +26,7 @@
 #include "llvm/CodeGen/MachineOperand.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGenTypes/MachineValueType.h"
+#include "llvm/IR/Module.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Regex.h"
@@ -924,6 +925,151 @@ M68kInstrInfo::getSerializableDirectMachineOperandTargetFlags() const {
   return ArrayRef(TargetFlags);
 }
 
+unsigned M68kInstrInfo::getInstSizeInBytes(const MachineInstr &MI) const {
+  if (MI.isMetaInstruction())
+    return 0;
+
+  if (MI.isInlineAsm()) {
+    const MachineFunction &MF = *MI.getMF();
+    return getInlineAsmLength(MI.getOperand(0).getSymbolName(),
+                              *MF.getTarget().getMCAsmInfo());
+  }
+
+  // The instruction descriptions don't carry a size, so estimate one: every
+  // instruction has a 16-bit operation word, followed by one extension word
+  // per 16-bit immediate or displacement and two per 32-bit value or symbol.
+  unsigned Size = 2;
+  for (const MachineOperand &MO : MI.explicit_uses()) {
+    if (MO.isImm())
+      Size += isInt<16>(MO.getImm()) ? 2 : 4;
+    else if (!MO.isReg())
+      Size += 4;
+  }
+  return Size;
+}
+
+bool M68kInstrInfo::isFunctionSafeToOutlineFrom(
+    MachineFunction &MF, bool OutlineFromLinkOnceODRs) const {
+  const Function &F = MF.getFunction();
+
+  // Can F be deduplicated by the linker? If it can, don't outline from it.
+  if (!OutlineFromLinkOnceODRs && F.hasLinkOnceODRLinkage())
+    return false;
+
+  // Don't outline from functions with section markings; the program could
+  // expect that all the code is in the named section.
+  if (F.hasSection())
+    return false;
+
+  // Interrupt handlers return with 'rte' and must not touch the stack below
+  // the exception frame.
+  if (F.getCallingConv() == CallingConv::M68k_INTR)
+    return false;
+
+  return true;
+}
+
+bool M68kInstrInfo::shouldOutlineFromFunctionByDefault(
+    MachineFunction &MF) const {
+  return MF.getFunction().hasMinSize();
+}
+
+// Enum values indicating how an outlined call should be constructed.
+enum MachineOutlinerConstructionID {
+  MachineOutlinerTailCall, // Branch with 'bra', the sequence ends in 'rts'.
+  MachineOutlinerDefault   // Call with 'jsr', the sequence doesn't use SP.
+};
+
+std::optional<std::unique_ptr<outliner::OutlinedFunction>>
+M68kInstrInfo::getOutliningCandidateInfo(
+    const MachineModuleInfo &MMI,
+    std::vector<outliner::Candidate> &RepeatedSequenceLocs,
+    unsigned MinRepeats) const {
+  // Each RepeatedSequenceLoc is identical.
+  outliner::Candidate &Candidate = RepeatedSequenceLocs[0];
+  const TargetRegisterInfo &TRI = getRegisterInfo();
+
+  unsigned CallOverhead = 0, FrameOverhead = 0;
+  MachineOutlinerConstructionID MOCI = MachineOutlinerDefault;
+  if (Candidate.back().isReturn()) {
+    MOCI = MachineOutlinerTailCall;
+    // bra.w = 4 bytes; the 'rts' moves from the caller to the callee.
+    CallOverhead = 4;
+    FrameOverhead = 0;
+  } else {
+    // 'jsr' pushes the return address, which shifts every SP-relative access
+    // in the outlined body by 4 bytes. Only outline sequences that don't
+    // touch SP at all.
+    if (!Candidate.isAvailableInsideSeq(M68k::SP, TRI))
+      return std::nullopt;
+    // jsr (d16,%pc) = 4 bytes, jsr abs.l = 6 bytes.
+    CallOverhead = Subtarget.isPositionIndependent() ? 4 : 6;
+    // rts = 2 bytes.
+    FrameOverhead = 2;
+  }
+
+  for (auto &C : RepeatedSequenceLocs)
+    C.setCallInfo(MOCI, CallOverhead);
+
+  unsigned SequenceSize = 0;
+  for (auto &MI : Candidate)
+    SequenceSize += getInstSizeInBytes(MI);
+
+  return std::make_unique<outliner::OutlinedFunction>(
+      RepeatedSequenceLocs, SequenceSize, FrameOverhead, MOCI);
+}
+
+outliner::InstrType
+M68kInstrInfo::getOutliningTypeImpl(const MachineModuleInfo &MMI,
+                                    MachineBasicBlock::iterator &MBBI,
+                                    unsigned Flags) const {
+  MachineInstr &MI = *MBBI;
+  const Function &F = MI.getMF()->getFunction();
+
+  // We can manually strip out CFI instructions later, unless the unwinder
+  // needs them.
+  if (MI.isCFIInstruction())
+    return F.needsUnwindTableEntry() ? outliner::InstrType::Illegal
+                                     : outliner::InstrType::Invisible;
+
+  return outliner::InstrType::Legal;
+}
+
+void M68kInstrInfo::buildOutlinedFrame(
+    MachineBasicBlock &MBB, MachineFunction &MF,
+    const outliner::OutlinedFunction &OF) const {
+  // Strip out any CFI instructions.
+  for (MachineInstr &MI : llvm::make_early_inc_range(MBB))
+    if (MI.isCFIInstruction())
+      MI.eraseFromParent();
+
+  if (OF.FrameConstructionID == MachineOutlinerTailCall)
+    return;
+
+  // Return to the address pushed by the 'jsr' at the call site.
+  MBB.insert(MBB.end(), BuildMI(MF, DebugLoc(), get(M68k::RTS)));
+}
+
+MachineBasicBlock::iterator M68kInstrInfo::insertOutlinedCall(
+    Module &M, MachineBasicBlock &MBB, MachineBasicBlock::iterator &It,
+    MachineFunction &MF, outliner::Candidate &C) const {
+  // The outlined function is local, so it is always reached directly, the
+  // same way the call lowering reaches other DSO-local functions.
+  const GlobalValue *Callee = M.getNamedValue(MF.getName());
+
+  if (C.CallConstructionID == MachineOutlinerTailCall) {
+    It = MBB.insert(It, BuildMI(MF, DebugLoc(), get(M68k::TAILJMPq))
+                            .addGlobalAddress(Callee));
+    return It;
+  }
+
+  unsigned CallOpc =
+      Subtarget.isPositionIndependent() ? M68k::CALLq : M68k::CALLb;
+  It = MBB.insert(It, BuildMI(MF, DebugLoc(), get(CallOpc))
+                          .addGlobalAddress(Callee));
+  return It;
+}
+
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "m68k-create-global-base-reg"
 
@@ -106,6 +106,11 @@ M68kTargetMachine::M68kTargetMachine(const Target &T, const Triple &TT,
       TLOF(std::make_unique<M68kELFTargetObjectFile>()),
       Subtarget(TT, CPU, FS, *this) {
   initAsmInfo();
+
+  // M68k supports the MachineOutliner. Only classic Mac OS, where code size
+  // matters most, outlines minsize functions by default.
+  setMachineOutliner(true);
+  setSupportsDefaultOutlining(TT.isMacOSClassic());
 }
 
 M68kTargetMachine::~M68kTargetMachine() {}
@@ -3001,6 +3001,233 @@ PPCInstrInfo::getSerializableDirectMachineOperandTargetFlags() const {
   return ArrayRef(TargetFlags);
 }
 
+bool PPCInstrInfo::isFunctionSafeToOutlineFrom(
+    MachineFunction &MF, bool OutlineFromLinkOnceODRs) const {
+  const PPCSubtarget &STI = MF.getSubtarget<PPCSubtarget>();
+  const Function &F = MF.getFunction();
+
+  // Outlining is only implemented for the 32-bit SVR4 and classic Mac OS
+  // ABIs. The 64-bit and AIX ABIs would need TOC save/restore around the
+  // outlined calls.
+  if (STI.isPPC64() || STI.isAIXABI())
+    return false;
+
+  // Can F be deduplicated by the linker? If it can, don't outline from it.
+  if (!OutlineFromLinkOnceODRs && F.hasLinkOnceODRLinkage())
+    return false;
+
+  // Don't outline from functions with section markings; the program could
+  // expect that all the code is in the named section.
+  if (F.hasSection())
+    return false;
+
+  return true;
+}
+
+bool PPCInstrInfo::shouldOutlineFromFunctionByDefault(
+    MachineFunction &MF) const {
+  return MF.getFunction().hasMinSize();
+}
+
+// Enum values indicating how an outlined call should be constructed.
+enum MachineOutlinerConstructionID {
+  MachineOutlinerTailCall, // Branch with 'b', the sequence ends in a return.
+  MachineOutlinerDefault,  // Call with 'bl', LR is dead across the call.
+  MachineOutlinerRegSave   // Call with 'bl', LR is kept in a spare GPR.
+};
+
+static bool isMIReadsLR(const MachineInstr &MI, const TargetRegisterInfo *TRI) {
+  return MI.readsRegister(PPC::LR, TRI) ||
+         MI.getDesc().hasImplicitUseOfPhysReg(PPC::LR);
+}
+
+static bool isMIModifiesLR(const MachineInstr &MI,
+                           const TargetRegisterInfo *TRI) {
+  return MI.modifiesRegister(PPC::LR, TRI) ||
+         MI.getDesc().hasImplicitDefOfPhysReg(PPC::LR);
+}
+
+// LR liveness isn't tracked through block live-ins on PowerPC, so work it out
+// locally: LR is dead after the candidate if the rest of the block redefines
+// it before reading it, or if the block falls through into code that can only
+// reach the return after reloading the LR saved by a non-shrink-wrapped
+// prologue.
+static bool isLRDeadAfterCandidate(outliner::Candidate &C,
+                                   const TargetRegisterInfo *TRI) {
+  MachineBasicBlock *MBB = C.getMBB();
+  for (MachineInstr &MI : make_range(C.end(), MBB->end())) {
+    if (isMIReadsLR(MI, TRI))
+      return false;
+    if (isMIModifiesLR(MI, TRI))
+      return true;
+  }
+
+  const MachineFunction &MF = *C.getMF();
+  const MachineFrameInfo &MFI = MF.getFrameInfo();
+  return MF.getInfo<PPCFunctionInfo>()->mustSaveLR() && !MFI.getSavePoint() &&
+         !MFI.getRestorePoint() && !MBB->isReturnBlock();
+}
+
+// Find a GPR that can hold LR across a 'bl' to the outlined function.
+static Register findRegisterToSaveLRTo(outliner::Candidate &C,
+                                       const TargetRegisterInfo &TRI) {
+  const MachineRegisterInfo &MRI = C.getMF()->getRegInfo();
+  for (MCPhysReg Reg : PPC::GPRCRegClass) {
+    if (Reg == PPC::FP || Reg == PPC::BP || MRI.isReserved(Reg))
+      continue;
+    if (C.isAvailableAcrossAndOutOfSeq(Reg, TRI) &&
+        C.isAvailableInsideSeq(Reg, TRI))
+      return Reg;
+  }
+  return Register();
+}
+
+std::optional<std::unique_ptr<outliner::OutlinedFunction>>
+PPCInstrInfo::getOutliningCandidateInfo(
+    const MachineModuleInfo &MMI,
+    std::vector<outliner::Candidate> &RepeatedSequenceLocs,
+    unsigned MinRepeats) const {
+  const TargetRegisterInfo *TRI = &getRegisterInfo();
+
+  // Each RepeatedSequenceLoc is identical, so if one ends in a return they
+  // all do and every candidate can be reached with a plain branch.
+  if (RepeatedSequenceLocs[0].back().isReturn()) {
+    for (auto &C : RepeatedSequenceLocs)
+      C.setCallInfo(MachineOutlinerTailCall, 4);
+  } else {
+    // The outlined function returns through LR, so the sequence itself must
+    // leave LR alone and must not make calls of its own.
+    outliner::Candidate &Candidate = RepeatedSequenceLocs[0];
+    if (std::any_of(Candidate.begin(), Candidate.end(),
+                    [TRI](const MachineInstr &MI) {
+                      return MI.isCall() || isMIReadsLR(MI, TRI) ||
+                             isMIModifiesLR(MI, TRI);
+                    }))
+      return std::nullopt;
+
+    // Use a bare 'bl' where LR is dead, otherwise park LR in a spare GPR
+    // around the call. Drop the candidates that can do neither.
+    llvm::erase_if(RepeatedSequenceLocs, [&](outliner::Candidate &C) {
+      if (isLRDeadAfterCandidate(C, TRI)) {
+        C.setCallInfo(MachineOutlinerDefault, 4);
+        return false;
+      }
+      if (findRegisterToSaveLRTo(C, *TRI)) {
+        // mflr + bl + mtlr.
+        C.setCallInfo(MachineOutlinerRegSave, 12);
+        return false;
+      }
+      return true;
+    });
+  }
+
+  // If the sequence doesn't have enough candidates left, then we're done.
+  if (RepeatedSequenceLocs.size() < MinRepeats)
+    return std::nullopt;
+
+  unsigned SequenceSize = 0;
+  for (auto &MI : RepeatedSequenceLocs[0])
+    SequenceSize += getInstSizeInBytes(MI);
+
+  // A tail-called sequence brings its own 'blr'; otherwise one is added.
+  unsigned FrameID = RepeatedSequenceLocs[0].back().isReturn()
+                         ? MachineOutlinerTailCall
+                         : MachineOutlinerDefault;
+  unsigned FrameOverhead = FrameID == MachineOutlinerTailCall ? 0 : 4;
+
+  return std::make_unique<outliner::OutlinedFunction>(
+      RepeatedSequenceLocs, SequenceSize, FrameOverhead, FrameID);
+}
+
+outliner::InstrType
+PPCInstrInfo::getOutliningTypeImpl(const MachineModuleInfo &MMI,
+                                   MachineBasicBlock::iterator &MBBI,
+                                   unsigned Flags) const {
+  MachineInstr &MI = *MBBI;
+  const Function &F = MI.getMF()->getFunction();
+
+  // We can manually strip out CFI instructions later, unless the unwinder
+  // needs them.
+  if (MI.isCFIInstruction())
+    return F.needsUnwindTableEntry() ? outliner::InstrType::Illegal
+                                     : outliner::InstrType::Invisible;
+
+  switch (MI.getOpcode()) {
+  // These materialize the function's PIC base, which is tied to a label in
+  // the function itself.
+  case PPC::MovePCtoLR:
+  case PPC::MoveGOTtoLR:
+  case PPC::UpdateGBR:
+    return outliner::InstrType::Illegal;
+  default:
+    break;
+  }
+
+  // Likewise, operands relative to the PIC base label can't move into a
+  // different function.
+  for (const MachineOperand &MO : MI.operands()) {
+    unsigned TF = MO.getTargetFlags();
+    if (TF == PPCII::MO_PIC_FLAG || TF == PPCII::MO_PIC_HA_FLAG ||
+        TF == PPCII::MO_PIC_LO_FLAG)
+      return outliner::InstrType::Illegal;
+  }
+
+  return outliner::InstrType::Legal;
+}
+
+void PPCInstrInfo::buildOutlinedFrame(
+    MachineBasicBlock &MBB, MachineFunction &MF,
+    const outliner::OutlinedFunction &OF) const {
+  // Strip out any CFI instructions.
+  for (MachineInstr &MI : llvm::make_early_inc_range(MBB))
+    if (MI.isCFIInstruction())
+      MI.eraseFromParent();
+
+  if (OF.FrameConstructionID == MachineOutlinerTailCall)
+    return;
+
+  // Return through the LR set up by the 'bl' at the call site.
+  MBB.addLiveIn(PPC::LR);
+  MBB.insert(MBB.end(), BuildMI(MF, DebugLoc(), get(PPC::BLR)));
+}
+
+MachineBasicBlock::iterator PPCInstrInfo::insertOutlinedCall(
+    Module &M, MachineBasicBlock &MBB, MachineBasicBlock::iterator &It,
+    MachineFunction &MF, outliner::Candidate &C) const {
+  // The outlined function is internal to this module, so it is always in the
+  // same TOC / code fragment as the caller and needs no TOC restore or glue.
+  const GlobalValue *Callee = M.getNamedValue(MF.getName());
+
+  if (C.CallConstructionID == MachineOutlinerTailCall) {
+    It = MBB.insert(
+        It, BuildMI(MF, DebugLoc(), get(PPC::TAILB)).addGlobalAddress(Callee));
+    return It;
+  }
+
+  // Insert the call.
+  MachineInstr *Call =
+      BuildMI(MF, DebugLoc(), get(PPC::BL)).addGlobalAddress(Callee);
+  if (C.CallConstructionID == MachineOutlinerDefault) {
+    It = MBB.insert(It, Call);
+    return It;
+  }
+
+  // Keep the caller's LR in a spare register across the call.
+  Register Reg = findRegisterToSaveLRTo(C, getRegisterInfo());
+  assert(Reg && "No register available to save LR to?");
+  MachineInstr *Save = BuildMI(MF, DebugLoc(), get(PPC::MFLR), Reg);
+  MachineInstr *Restore =
+      BuildMI(MF, DebugLoc(), get(PPC::MTLR)).addReg(Reg, RegState::Kill);
+
+  It = MBB.insert(It, Save);
+  It++;
+  It = MBB.insert(It, Call);
+  MachineBasicBlock::iterator CallPt = It;
+  It++;
+  It = MBB.insert(It, Restore);
+  return CallPt;
+}
+
 // Expand VSX Memory Pseudo instruction to either a VSX or a FP instruction.
 // The VSX versions have the advantage of a full 64-register target whereas
 // the FP ones have the advantage of lower latency and higher throughput. So
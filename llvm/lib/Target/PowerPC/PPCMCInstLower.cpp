@@ -48,11 +48,13 @@ static MCSymbol *GetSymbolFromOperand(const MachineOperand &MO,
       const MachineInstr *MI = MO.getParent();
       if (MI) {
         unsigned Opcode = MI->getOpcode();
-        // Check for branch and link instructions (both 32-bit and 64-bit)
+        // Check for branch and link instructions (both 32-bit and 64-bit),
+        // and for the direct tail branches the MachineOutliner emits.
         bool isBranchAndLink = (Opcode == PPC::BL || Opcode == PPC::BL8 ||
                                 Opcode == PPC::BL_NOP || Opcode == PPC::BL8_NOP ||
                                 Opcode == PPC::BL_TLS || Opcode == PPC::BL8_TLS ||
-                                Opcode == PPC::BL8_NOP_TLS || Opcode == PPC::BL8_TLS_);
+                                Opcode == PPC::BL8_NOP_TLS || Opcode == PPC::BL8_TLS_ ||
+                                Opcode == PPC::TAILB);
 
         // For intra-module function calls, use the function entry point symbol
         // (code symbol) instead of the descriptor symbol.
@@ -39,6 +39,7 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Target/CGPassBuilderOption.h"
 #include "llvm/Target/TargetLoweringObjectFile.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/TargetParser/Triple.h"
@@ -109,6 +110,11 @@ static cl::opt<bool>
     EnableGlobalMerge("ppc-global-merge", cl::Hidden, cl::init(false),
                       cl::desc("Enable the global merge pass"));
 
+static cl::opt<bool> EnableGlobalMergeFunc(
+    "ppc-global-merge-func", cl::Hidden,
+    cl::desc("Merge near-identical functions, using codegen data when "
+             "available (on by default for Classic Mac OS)"));
+
 static cl::opt<unsigned>
     GlobalMergeMaxOffset("ppc-global-merge-max-offset", cl::Hidden,
                          cl::init(0x7fff),
@@ -372,6 +378,14 @@ PPCTargetMachine::PPCTargetMachine(const Target &T, const Triple &TT,
       TargetABI(computeTargetABI(TT, Options)),
       Endianness(isLittleEndianTriple(TT) ? Endian::LITTLE : Endian::BIG) {
   initAsmInfo();
+
+  // The MachineOutliner supports 32-bit SVR4 and classic Mac OS targets.
+  // Only classic Mac OS, where code size matters most, outlines minsize
+  // functions by default; elsewhere it takes -enable-machine-outliner.
+  if (!TT.isPPC64() && !TT.isOSAIX()) {
+    setMachineOutliner(true);
+    setSupportsDefaultOutlining(TT.isMacOSClassic());
+  }
 }
 
 PPCTargetMachine::~PPCTargetMachine() = default;
@@ -505,6 +519,17 @@ void PPCPassConfig::addIRPasses() {
   }
 
   TargetPassConfig::addIRPasses();
+
+  // Code size is the main constraint on Classic Mac OS, so merge similar
+  // functions there by default. The generic -enable-global-merge-func option
+  // already adds the pass from TargetPassConfig.
+  if ((EnableGlobalMergeFunc.getNumOccurrences() > 0)
+          ? EnableGlobalMergeFunc
+          : TM->getTargetTriple().isMacOSClassic() &&
+                getOptLevel() != CodeGenOptLevel::None) {
+    if (!getCGPassBuilderOption().EnableGlobalMergeFunc)
+      addPass(createGlobalMergeFuncPass());
+  }
 }
 
 bool PPCPassConfig::addPreISel() {
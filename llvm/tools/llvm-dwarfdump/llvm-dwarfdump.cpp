@@ -37,6 +37,7 @@
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TargetParser/Triple.h"
+#include <atomic>
 #include <cstdlib>
 
 using namespace llvm;
@@ -304,6 +305,12 @@ static opt<std::string> JsonErrSummaryFile(
     value_desc("filename.json"), cat(DwarfDumpCategory));
 static opt<bool> Quiet("quiet", desc("Use with -verify to not emit to STDOUT."),
                        cat(DwarfDumpCategory));
+static opt<unsigned>
+    NumThreads("num-threads", init(1),
+               desc("Number of threads to use with --verify. The output is "
+                    "the same for any number of threads. 0 uses one thread "
+                    "per hardware thread."),
+               value_desc("n"), cat(DwarfDumpCategory));
 static opt<bool> DumpUUID("uuid", desc("Show the UUID for each architecture."),
                           cat(DwarfDumpCategory));
 static alias DumpUUIDAlias("u", desc("Alias for --uuid."), aliasopt(DumpUUID),
@@ -357,6 +364,7 @@ static DIDumpOptions getDumpOpts(DWARFContext &C) {
     DumpOpts.ShowAggregateErrors = ErrorDetails != OnlyDetailsNoSummary &&
                                    ErrorDetails != NoDetailsOnlySummary;
     DumpOpts.JsonErrSummaryFile = JsonErrSummaryFile;
+    DumpOpts.NumThreads = NumThreads;
     return DumpOpts.noImplicitRecursion();
   }
   return DumpOpts;
@@ -766,16 +774,21 @@ static bool handleBuffer(StringRef Filename, MemoryBufferRef Buffer,
   Expected<std::unique_ptr<Binary>> BinOrErr = object::createBinary(Buffer);
   error(Filename, BinOrErr.takeError());
 
-  bool Result = true;
+  // Parallel verification may report errors from several threads.
+  std::atomic<bool> Result = true;
   auto RecoverableErrorHandler = [&](Error E) {
     Result = false;
     WithColor::defaultErrorHandler(std::move(E));
   };
+  // Verifying with several threads needs a context whose lazily parsed state
+  // can be shared between them.
+  const bool ThreadSafe = Verify && NumThreads != 1;
   if (auto *Obj = dyn_cast<ObjectFile>(BinOrErr->get())) {
     if (filterArch(*Obj)) {
       std::unique_ptr<DWARFContext> DICtx = DWARFContext::create(
           *Obj, DWARFContext::ProcessDebugRelocations::Process, nullptr, "",
-          RecoverableErrorHandler);
+          RecoverableErrorHandler, WithColor::defaultWarningHandler,
+          ThreadSafe);
       DICtx->setParseCUTUIndexManually(ManuallyGenerateUnitIndex);
       if (!HandleObj(*Obj, *DICtx, Filename, OS))
         Result = false;
@@ -789,7 +802,8 @@ static bool handleBuffer(StringRef Filename, MemoryBufferRef Buffer,
         if (filterArch(Obj)) {
           std::unique_ptr<DWARFContext> DICtx = DWARFContext::create(
               Obj, DWARFContext::ProcessDebugRelocations::Process, nullptr, "",
-              RecoverableErrorHandler);
+              RecoverableErrorHandler, WithColor::defaultWarningHandler,
+              ThreadSafe);
           if (!HandleObj(Obj, *DICtx, ObjName, OS))
             Result = false;
         }
@@ -0,0 +1,368 @@
+//===----------------------- ProfileRegionGenerator.cpp ---------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the profile reader and the region builder used by
+/// llvm-mca to analyze the hottest code of a binary.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ProfileRegionGenerator.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/MC/MCDisassembler/MCDisassembler.h"
+#include "llvm/MC/MCInstrAnalysis.h"
+#include "llvm/MC/MCInstrInfo.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/raw_ostream.h"
+#include <map>
+
+namespace llvm {
+namespace mca {
+
+Expected<FdataProfile> FdataProfile::parse(StringRef Buffer) {
+  FdataProfile Profile;
+  unsigned LineNo = 0;
+  bool SeenRecord = false;
+
+  while (!Buffer.empty()) {
+    StringRef Line;
+    std::tie(Line, Buffer) = Buffer.split('\n');
+    ++LineNo;
+    Line = Line.trim();
+    if (Line.empty())
+      continue;
+
+    auto Malformed = [&](const Twine &Why) {
+      return createStringError(inconvertibleErrorCode(),
+                               "line " + Twine(LineNo) + ": " + Why);
+    };
+
+    SmallVector<StringRef, 8> Fields;
+    SplitString(Line, Fields);
+    if (Fields[0] == "boltedcollection")
+      continue;
+    if (Fields[0] == "no_lbr") {
+      if (SeenRecord)
+        return Malformed("'no_lbr' must precede all records");
+      Profile.HasBranches = false;
+      continue;
+    }
+    SeenRecord = true;
+
+    auto ParseLocation = [&](StringRef IsSym, StringRef Name, StringRef Offset,
+                             ProfileLocation &Loc) -> Expected<bool> {
+      unsigned Kind;
+      if (IsSym.getAsInteger(10, Kind))
+        return Malformed("invalid location kind '" + IsSym + "'");
+      if (Offset.getAsInteger(16, Loc.Offset))
+        return Malformed("invalid offset '" + Offset + "'");
+      Loc.Symbol = Name.str();
+      return Kind == 1;
+    };
+
+    uint64_t Count;
+    if (Profile.HasBranches) {
+      if (Fields.size() != 8)
+        return Malformed("expected 8 fields in a branch record");
+      Branch B;
+      Expected<bool> FromIsSym =
+          ParseLocation(Fields[0], Fields[1], Fields[2], B.From);
+      if (!FromIsSym)
+        return FromIsSym.takeError();
+      Expected<bool> ToIsSym =
+          ParseLocation(Fields[3], Fields[4], Fields[5], B.To);
+      if (!ToIsSym)
+        return ToIsSym.takeError();
+      uint64_t Mispreds;
+      if (Fields[6].getAsInteger(10, Mispreds))
+        return Malformed("invalid misprediction count '" + Fields[6] + "'");
+      if (Fields[7].getAsInteger(10, Count))
+        return Malformed("invalid count '" + Fields[7] + "'");
+      B.Count = Count;
+      if (*FromIsSym && *ToIsSym && Count)
+        Profile.Branches.push_back(std::move(B));
+      continue;
+    }
+
+    if (Fields.size() != 4)
+      return Malformed("expected 4 fields in a sample record");
+    Sample S;
+    Expected<bool> IsSym =
+        ParseLocation(Fields[0], Fields[1], Fields[2], S.Location);
+    if (!IsSym)
+      return IsSym.takeError();
+    if (Fields[3].getAsInteger(10, Count))
+      return Malformed("invalid count '" + Fields[3] + "'");
+    S.Count = Count;
+    if (*IsSym && Count)
+      Profile.Samples.push_back(std::move(S));
+  }
+  return std::move(Profile);
+}
+
+uint64_t FdataProfile::getTotalCount() const {
+  uint64_t Total = 0;
+  for (const Branch &B : Branches)
+    Total += B.Count;
+  for (const Sample &S : Samples)
+    Total += S.Count;
+  return Total;
+}
+
+std::string ProfiledRegion::getDescription() const {
+  if (IsLoop)
+    return formatv("{0}+{1:x}..{2:x} (loop)", Function, StartOffset,
+                   EndOffset);
+  return formatv("{0}+{1:x}", Function, StartOffset);
+}
+
+namespace {
+
+struct DecodedInst {
+  uint64_t Offset;
+  uint64_t Size;
+  MCInst Inst;
+  bool Valid;
+};
+
+/// The decoded body of a profiled function and the profile counts attributed
+/// to its blocks and loops.
+struct FunctionCode {
+  uint64_t Address = 0;
+  uint64_t Size = 0;
+  object::SectionRef Section;
+  std::vector<DecodedInst> Insts;
+  /// Sorted offsets of the first instruction of each basic block.
+  SmallVector<uint64_t, 32> Leaders;
+  /// Block leader to block weight.
+  std::map<uint64_t, uint64_t> BlockWeights;
+  /// Loop (header offset, back edge offset) to number of back edges taken.
+  std::map<std::pair<uint64_t, uint64_t>, uint64_t> LoopWeights;
+
+  /// Returns the index of the instruction covering \p Offset, or Insts.size().
+  size_t findInst(uint64_t Offset) const {
+    auto It = partition_point(
+        Insts, [&](const DecodedInst &I) { return I.Offset + I.Size <= Offset; });
+    return It - Insts.begin();
+  }
+
+  /// Returns the leader of the block covering \p Offset.
+  uint64_t findBlock(uint64_t Offset) const {
+    return *std::prev(upper_bound(Leaders, Offset));
+  }
+};
+
+struct Candidate {
+  StringRef Function;
+  const FunctionCode *Code;
+  size_t FirstInst;
+  size_t LastInst;
+  uint64_t Weight;
+  bool IsLoop;
+};
+
+} // end anonymous namespace
+
+/// Profiles may name local symbols as "name/file/N"; fall back to the plain
+/// name when the qualified one is not found.
+static StringMap<FunctionCode>::iterator
+lookupFunction(StringMap<FunctionCode> &Functions, StringRef Name) {
+  auto It = Functions.find(Name);
+  if (It == Functions.end())
+    It = Functions.find(Name.split('/').first);
+  return It;
+}
+
+static bool endsBlock(const MCInstrInfo &MCII, const MCInst &Inst) {
+  const MCInstrDesc &Desc = MCII.get(Inst.getOpcode());
+  return Desc.isBranch() || Desc.isReturn() || Desc.isTerminator() ||
+         Desc.isBarrier();
+}
+
+Expected<std::vector<ProfiledRegion>>
+ProfileRegionGenerator::generate(const FdataProfile &Profile,
+                                 unsigned MaxRegions) const {
+  StringMap<FunctionCode> Functions;
+  for (const auto &[Sym, Size] : object::computeSymbolSizes(Obj)) {
+    std::optional<object::SymbolRef::Type> Type =
+        expectedToOptional(Sym.getType());
+    if (!Type || *Type != object::SymbolRef::ST_Function || !Size)
+      continue;
+    std::optional<StringRef> Name = expectedToOptional(Sym.getName());
+    std::optional<uint64_t> Address = expectedToOptional(Sym.getAddress());
+    std::optional<object::section_iterator> Section =
+        expectedToOptional(Sym.getSection());
+    if (!Name || !Address || !Section || *Section == Obj.section_end())
+      continue;
+    FunctionCode Code;
+    Code.Address = *Address;
+    Code.Size = Size;
+    Code.Section = **Section;
+    Functions.try_emplace(*Name, std::move(Code));
+  }
+
+  // Find the profiled functions, in the order the profile first names them so
+  // that ties between equally hot regions are broken deterministically.
+  MapVector<StringRef, FunctionCode *> Profiled;
+  auto Note = [&](const ProfileLocation &Loc) -> FunctionCode * {
+    auto It = lookupFunction(Functions, Loc.Symbol);
+    if (It == Functions.end() || Loc.Offset >= It->second.Size)
+      return nullptr;
+    Profiled.insert({It->first(), &It->second});
+    return &It->second;
+  };
+  for (const FdataProfile::Branch &B : Profile.branches()) {
+    Note(B.From);
+    if (FunctionCode *Code = Note(B.To))
+      Code->Leaders.push_back(B.To.Offset);
+  }
+  for (const FdataProfile::Sample &S : Profile.samples())
+    Note(S.Location);
+
+  // Decode each profiled function and split it into basic blocks.
+  for (auto &[Name, Code] : Profiled) {
+    Expected<StringRef> Contents = Code->Section.getContents();
+    if (!Contents)
+      return Contents.takeError();
+    uint64_t SectionAddress = Code->Section.getAddress();
+    if (Code->Address < SectionAddress ||
+        Code->Address - SectionAddress + Code->Size > Contents->size())
+      continue;
+    ArrayRef<uint8_t> Bytes = arrayRefFromStringRef(
+        Contents->substr(Code->Address - SectionAddress, Code->Size));
+
+    Code->Leaders.push_back(0);
+    for (uint64_t Offset = 0; Offset < Bytes.size();) {
+      DecodedInst I;
+      I.Offset = Offset;
+      I.Valid = Disassembler.getInstruction(I.Inst, I.Size, Bytes.slice(Offset),
+                                            Code->Address + Offset, nulls()) ==
+                MCDisassembler::Success;
+      I.Size = std::max<uint64_t>(I.Size, 1);
+      Offset += I.Size;
+
+      uint64_t Target;
+      if (!I.Valid) {
+        Code->Leaders.push_back(I.Offset);
+      } else if (MCIA && MCIA->evaluateBranch(I.Inst, Code->Address + I.Offset,
+                                             I.Size, Target) &&
+                 Target >= Code->Address &&
+                 Target < Code->Address + Code->Size) {
+        Code->Leaders.push_back(Target - Code->Address);
+      }
+      if (!I.Valid || endsBlock(MCII, I.Inst))
+        Code->Leaders.push_back(Offset);
+      Code->Insts.push_back(std::move(I));
+    }
+    llvm::sort(Code->Leaders);
+    Code->Leaders.erase(llvm::unique(Code->Leaders), Code->Leaders.end());
+  }
+
+  // Attribute the profile counts.
+  for (const FdataProfile::Branch &B : Profile.branches()) {
+    auto To = lookupFunction(Functions, B.To.Symbol);
+    if (To == Functions.end() || To->second.Insts.empty() ||
+        B.To.Offset >= To->second.Size)
+      continue;
+    FunctionCode &Code = To->second;
+    Code.BlockWeights[Code.findBlock(B.To.Offset)] += B.Count;
+
+    // A backward branch within a function closes a loop.
+    auto From = lookupFunction(Functions, B.From.Symbol);
+    if (From == To && B.To.Offset <= B.From.Offset &&
+        B.From.Offset < Code.Size)
+      Code.LoopWeights[{B.To.Offset, B.From.Offset}] += B.Count;
+  }
+  for (const FdataProfile::Sample &S : Profile.samples()) {
+    auto It = lookupFunction(Functions, S.Location.Symbol);
+    if (It == Functions.end() || It->second.Insts.empty() ||
+        S.Location.Offset >= It->second.Size)
+      continue;
+    FunctionCode &Code = It->second;
+    Code.BlockWeights[Code.findBlock(S.Location.Offset)] += S.Count;
+  }
+
+  // Collect the candidate regions, skipping any that contain undecodable
+  // bytes.
+  std::vector<Candidate> Candidates;
+  auto AddCandidate = [&](StringRef Name, const FunctionCode &Code,
+                          size_t First, size_t Last, uint64_t Weight,
+                          bool IsLoop) {
+    if (First > Last || Last >= Code.Insts.size())
+      return;
+    for (size_t I = First; I <= Last; ++I)
+      if (!Code.Insts[I].Valid)
+        return;
+    Candidates.push_back({Name, &Code, First, Last, Weight, IsLoop});
+  };
+  for (const auto &[Name, Code] : Profiled) {
+    for (const auto &[Leader, Weight] : Code->BlockWeights) {
+      auto Next = upper_bound(Code->Leaders, Leader);
+      uint64_t End = Next == Code->Leaders.end() ? Code->Size : *Next;
+      AddCandidate(Name, *Code, Code->findInst(Leader),
+                   Code->findInst(End - 1), Weight, /*IsLoop=*/false);
+    }
+    for (const auto &[Range, Weight] : Code->LoopWeights)
+      AddCandidate(Name, *Code, Code->findInst(Range.first),
+                   Code->findInst(Range.second), Weight, /*IsLoop=*/true);
+  }
+
+  llvm::stable_sort(Candidates, [](const Candidate &A, const Candidate &B) {
+    if (A.Weight != B.Weight)
+      return A.Weight > B.Weight;
+    return A.IsLoop && !B.IsLoop;
+  });
+
+  // A block inside a selected loop is reported as part of the loop. The loop
+  // may sort after its own blocks, since the entries into its header add to
+  // the header's weight, so selecting it drops the blocks it contains and
+  // frees their slots.
+  auto Contains = [](const Candidate &Loop, const Candidate &Block) {
+    return Loop.Code == Block.Code && Loop.FirstInst <= Block.FirstInst &&
+           Block.LastInst <= Loop.LastInst;
+  };
+  std::vector<const Candidate *> Selected;
+  for (const Candidate &C : Candidates) {
+    if (C.IsLoop) {
+      auto Inner = [&](const Candidate *S) {
+        return !S->IsLoop && Contains(C, *S);
+      };
+      if (MaxRegions &&
+          Selected.size() - count_if(Selected, Inner) >= MaxRegions)
+        continue;
+      erase_if(Selected, Inner);
+    } else if ((MaxRegions && Selected.size() >= MaxRegions) ||
+               any_of(Selected, [&](const Candidate *S) {
+                 return S->IsLoop && Contains(*S, C);
+               })) {
+      continue;
+    }
+    Selected.push_back(&C);
+  }
+
+  std::vector<ProfiledRegion> Regions;
+  for (const Candidate *C : Selected) {
+    ProfiledRegion &R = Regions.emplace_back();
+    R.Function = C->Function.str();
+    R.StartOffset = C->Code->Insts[C->FirstInst].Offset;
+    R.EndOffset = C->Code->Insts[C->LastInst].Offset;
+    R.Weight = C->Weight;
+    R.IsLoop = C->IsLoop;
+    for (size_t I = C->FirstInst; I <= C->LastInst; ++I)
+      R.Instructions.push_back(C->Code->Insts[I].Inst);
+  }
+  return std::move(Regions);
+}
+
+} // namespace mca
+} // namespace llvm
@@ -0,0 +1,127 @@
+//===----------------------- ProfileRegionGenerator.h -----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file declares the classes used by llvm-mca to analyze a whole binary
+/// guided by an execution profile. The profile is read in the BOLT fdata
+/// format, and the hottest basic blocks and loops it names are disassembled
+/// from the binary into regions that llvm-mca can simulate.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_PROFILEREGIONGENERATOR_H
+#define LLVM_TOOLS_LLVM_MCA_PROFILEREGIONGENERATOR_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/MC/MCInst.h"
+#include "llvm/Support/Error.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class MCDisassembler;
+class MCInstrAnalysis;
+class MCInstrInfo;
+
+namespace object {
+class ObjectFile;
+} // namespace object
+
+namespace mca {
+
+/// A code address in a profile, expressed as an offset into a symbol.
+struct ProfileLocation {
+  std::string Symbol;
+  uint64_t Offset = 0;
+};
+
+/// An execution profile in the BOLT fdata format.
+///
+/// Two flavors are understood:
+///  - branch profiles, one taken branch per line:
+///      <is_sym> <from> <offset> <is_sym> <to> <offset> <mispreds> <count>
+///  - sample profiles, introduced by a "no_lbr" header line:
+///      <is_sym> <symbol> <offset> <count>
+/// Offsets are hexadecimal. Records whose locations are not symbol-relative
+/// (is_sym other than 1) cannot be mapped back to the binary and are ignored.
+class FdataProfile {
+public:
+  struct Branch {
+    ProfileLocation From;
+    ProfileLocation To;
+    uint64_t Count;
+  };
+
+  struct Sample {
+    ProfileLocation Location;
+    uint64_t Count;
+  };
+
+private:
+  bool HasBranches = true;
+  std::vector<Branch> Branches;
+  std::vector<Sample> Samples;
+
+public:
+  static Expected<FdataProfile> parse(StringRef Buffer);
+
+  /// Returns true for branch (LBR) profiles, false for sample profiles.
+  bool hasBranches() const { return HasBranches; }
+  ArrayRef<Branch> branches() const { return Branches; }
+  ArrayRef<Sample> samples() const { return Samples; }
+
+  /// Returns the sum of the counts of all records.
+  uint64_t getTotalCount() const;
+};
+
+/// A hot basic block or loop body taken from a binary.
+struct ProfiledRegion {
+  /// The function containing the region.
+  std::string Function;
+  /// Offsets of the first and of the last instruction of the region.
+  uint64_t StartOffset = 0;
+  uint64_t EndOffset = 0;
+  /// Execution count of the region: the number of times the block was
+  /// entered, the number of times the loop back edge was taken, or the number
+  /// of samples that hit the block.
+  uint64_t Weight = 0;
+  bool IsLoop = false;
+  SmallVector<MCInst, 16> Instructions;
+
+  /// Returns a name such as "foo+0x40" or "foo+0x40..0x5c (loop)".
+  std::string getDescription() const;
+};
+
+/// Builds the hottest regions of a binary from a profile.
+class ProfileRegionGenerator {
+  const object::ObjectFile &Obj;
+  const MCDisassembler &Disassembler;
+  const MCInstrInfo &MCII;
+  const MCInstrAnalysis *MCIA;
+
+public:
+  ProfileRegionGenerator(const object::ObjectFile &Obj,
+                         const MCDisassembler &Disassembler,
+                         const MCInstrInfo &MCII, const MCInstrAnalysis *MCIA)
+      : Obj(Obj), Disassembler(Disassembler), MCII(MCII), MCIA(MCIA) {}
+
+  /// Returns at most \p MaxRegions regions, hottest first, or all of them if
+  /// \p MaxRegions is 0. Blocks that are part of a selected loop are not
+  /// reported separately, even if they are hotter than the loop.
+  Expected<std::vector<ProfiledRegion>> generate(const FdataProfile &Profile,
+                                                 unsigned MaxRegions) const;
+};
+
+} // namespace mca
+} // namespace llvm
+
+#endif // LLVM_TOOLS_LLVM_MCA_PROFILEREGIONGENERATOR_H
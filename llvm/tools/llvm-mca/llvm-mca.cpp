@@ -23,6 +23,7 @@
 #include "CodeRegion.h"
 #include "CodeRegionGenerator.h"
 #include "PipelinePrinter.h"
+#include "ProfileRegionGenerator.h"
 #include "Views/BottleneckAnalysis.h"
 #include "Views/DispatchStatistics.h"
 #include "Views/InstructionInfoView.h"
@@ -36,6 +37,7 @@
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCCodeEmitter.h"
 #include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCDisassembler/MCDisassembler.h"
 #include "llvm/MC/MCObjectFileInfo.h"
 #include "llvm/MC/MCRegisterInfo.h"
 #include "llvm/MC/MCSubtargetInfo.h"
@@ -49,6 +51,7 @@
 #include "llvm/MCA/Stages/EntryStage.h"
 #include "llvm/MCA/Stages/InstructionTables.h"
 #include "llvm/MCA/Support.h"
+#include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ErrorOr.h"
@@ -57,6 +60,8 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/TargetParser/Host.h"
@@ -110,6 +115,24 @@ static cl::opt<bool>
     PrintImmHex("print-imm-hex", cl::cat(ToolOptions), cl::init(false),
                 cl::desc("Prefer hex format when printing immediate values"));
 
+static cl::opt<std::string> ProfileFilename(
+    "profile",
+    cl::desc("Treat the input as a binary and analyze the hottest blocks and "
+             "loops named by this profile (BOLT fdata format)"),
+    cl::value_desc("filename"), cl::cat(ToolOptions));
+
+static cl::opt<unsigned>
+    HotRegions("hot-regions",
+               cl::desc("Maximum number of regions to analyze with -profile "
+                        "(0 means all)"),
+               cl::cat(ToolOptions), cl::init(20));
+
+static cl::opt<unsigned>
+    Jobs("j",
+         cl::desc("Number of regions to analyze in parallel with -profile "
+                  "(0 means all available cores)"),
+         cl::value_desc("jobs"), cl::cat(ToolOptions), cl::init(0));
+
 static cl::opt<unsigned> Iterations("iterations",
                                     cl::desc("Number of iterations to run"),
                                     cl::cat(ToolOptions), cl::init(0));
@@ -347,13 +370,273 @@ static bool runPipeline(mca::Pipeline &P) {
   return true;
 }
 
+namespace {
+/// The outcome of simulating one region of a profiled binary.
+struct ProfiledRegionResult {
+  const mca::ProfiledRegion *Region = nullptr;
+  unsigned NumInstructions = 0;
+  unsigned NumSkipped = 0;
+  unsigned NumIterations = 0;
+  uint64_t TotalCycles = 0;
+  double IPC = 0.0;
+  double BlockRThroughput = 0.0;
+  std::string Bottleneck;
+  std::string Error;
+
+  double getCyclesPerIteration() const {
+    return NumIterations ? (double)TotalCycles / NumIterations : 0.0;
+  }
+  /// The share of the profiled execution time attributed to this region.
+  double getEstimatedCycles() const {
+    return getCyclesPerIteration() * Region->Weight;
+  }
+};
+} // end of anonymous namespace
+
+/// Simulates \p Region with a pipeline of its own, so that several regions can
+/// be analyzed concurrently.
+static void simulateProfiledRegion(const Target &TheTarget,
+                                   const MCSubtargetInfo &STI,
+                                   const MCInstrInfo &MCII,
+                                   const MCRegisterInfo &MRI,
+                                   const mca::PipelineOptions &PO,
+                                   ProfiledRegionResult &Result) {
+  const MCSchedModel &SM = STI.getSchedModel();
+  std::unique_ptr<MCInstrAnalysis> MCIA(TheTarget.createMCInstrAnalysis(&MCII));
+
+  std::unique_ptr<mca::InstrumentManager> IM;
+  if (!DisableInstrumentManager)
+    IM = std::unique_ptr<mca::InstrumentManager>(
+        TheTarget.createInstrumentManager(STI, MCII));
+  if (!IM)
+    IM = std::make_unique<mca::InstrumentManager>(STI, MCII);
+
+  std::unique_ptr<mca::InstrPostProcess> IPP;
+  if (!DisableCustomBehaviour)
+    IPP = std::unique_ptr<mca::InstrPostProcess>(
+        TheTarget.createInstrPostProcess(STI, MCII));
+  if (!IPP)
+    IPP = std::make_unique<mca::InstrPostProcess>(STI, MCII);
+
+  mca::InstrBuilder IB(STI, MCII, MRI, MCIA.get(), *IM, CallLatency);
+
+  // Lower the region, dropping the instructions without scheduling
+  // information: a real binary almost always contains some.
+  SmallVector<uint64_t> ProcResourceMasks(SM.getNumProcResourceKinds());
+  SmallVector<unsigned> ResIdx2ProcResID(SM.getNumProcResourceKinds());
+  mca::computeProcResourceMasks(SM, ProcResourceMasks);
+  for (unsigned I = 1, E = SM.getNumProcResourceKinds(); I < E; ++I)
+    ResIdx2ProcResID[mca::getResourceStateIndex(ProcResourceMasks[I])] = I;
+  SmallVector<unsigned> ProcResourceUsage(SM.getNumProcResourceKinds());
+  unsigned NumMicroOps = 0;
+
+  SmallVector<std::unique_ptr<mca::Instruction>> LoweredSequence;
+  for (const MCInst &MCI : Result.Region->Instructions) {
+    Expected<std::unique_ptr<mca::Instruction>> Inst =
+        IB.createInstruction(MCI, {});
+    if (!Inst) {
+      consumeError(Inst.takeError());
+      ++Result.NumSkipped;
+      continue;
+    }
+    IPP->postProcessInstruction(Inst.get(), MCI);
+
+    const mca::InstrDesc &Desc = (*Inst)->getDesc();
+    NumMicroOps += Desc.NumMicroOps;
+    for (const std::pair<uint64_t, mca::ResourceUsage> &RU : Desc.Resources)
+      if (RU.second.size())
+        ProcResourceUsage[ResIdx2ProcResID[mca::getResourceStateIndex(
+            RU.first)]] += RU.second.size();
+    LoweredSequence.emplace_back(std::move(Inst.get()));
+  }
+
+  Result.NumInstructions = LoweredSequence.size();
+  if (LoweredSequence.empty()) {
+    Result.Error = "no supported instructions";
+    return;
+  }
+
+  mca::CircularSourceMgr S(LoweredSequence, Iterations);
+  std::unique_ptr<mca::CustomBehaviour> CB;
+  if (!DisableCustomBehaviour)
+    CB = std::unique_ptr<mca::CustomBehaviour>(
+        TheTarget.createCustomBehaviour(STI, S, MCII));
+  if (!CB)
+    CB = std::make_unique<mca::CustomBehaviour>(STI, S, MCII);
+
+  mca::Context MCA(MRI, STI);
+  auto P = MCA.createDefaultPipeline(PO, S, *CB);
+  Expected<unsigned> Cycles = P->run();
+  if (!Cycles) {
+    Result.Error = toString(Cycles.takeError());
+    return;
+  }
+
+  unsigned Width = DispatchWidth ? DispatchWidth : SM.IssueWidth;
+  Result.NumIterations = S.getNumIterations();
+  Result.TotalCycles = *Cycles;
+  Result.IPC = *Cycles ? (double)Result.NumInstructions *
+                             Result.NumIterations / *Cycles
+                       : 0.0;
+  Result.BlockRThroughput =
+      mca::computeBlockRThroughput(SM, Width, NumMicroOps, ProcResourceUsage);
+
+  // Name the most contended resource, or the dispatch width if no resource
+  // limits the throughput more than it does.
+  double MaxPressure = Width ? (double)NumMicroOps / Width : 0.0;
+  Result.Bottleneck = "Dispatch";
+  for (unsigned I = 1, E = SM.getNumProcResourceKinds(); I < E; ++I) {
+    const MCProcResourceDesc &PRD = *SM.getProcResource(I);
+    if (!ProcResourceUsage[I] || !PRD.NumUnits)
+      continue;
+    double Pressure = (double)ProcResourceUsage[I] / PRD.NumUnits;
+    if (Pressure > MaxPressure) {
+      MaxPressure = Pressure;
+      Result.Bottleneck = PRD.Name;
+    }
+  }
+}
+
+/// Implements -profile: finds the hottest regions of the input binary,
+/// simulates them in parallel and prints them ranked by their estimated share
+/// of the execution time.
+static int analyzeProfiledBinary(const Target &TheTarget,
+                                 const object::ObjectFile &Obj,
+                                 const MCSubtargetInfo &STI,
+                                 const MCInstrInfo &MCII,
+                                 const MCRegisterInfo &MRI,
+                                 const MCAsmInfo &MAI,
+                                 const MCInstrAnalysis *MCIA) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> ProfileBuffer =
+      MemoryBuffer::getFile(ProfileFilename, /*IsText=*/true);
+  if (std::error_code EC = ProfileBuffer.getError()) {
+    WithColor::error() << ProfileFilename << ": " << EC.message() << '\n';
+    return 1;
+  }
+  Expected<mca::FdataProfile> Profile =
+      mca::FdataProfile::parse((*ProfileBuffer)->getBuffer());
+  if (!Profile) {
+    WithColor::error() << ProfileFilename << ": "
+                       << toString(Profile.takeError()) << '\n';
+    return 1;
+  }
+
+  MCContext Ctx(Triple(TripleName), &MAI, &MRI, &STI);
+  std::unique_ptr<MCDisassembler> Disassembler(
+      TheTarget.createMCDisassembler(STI, Ctx));
+  if (!Disassembler) {
+    WithColor::error() << "no disassembler for target " << TripleName << '\n';
+    return 1;
+  }
+
+  mca::ProfileRegionGenerator PRG(Obj, *Disassembler, MCII, MCIA);
+  Expected<std::vector<mca::ProfiledRegion>> Regions =
+      PRG.generate(*Profile, HotRegions);
+  if (!Regions) {
+    WithColor::error() << InputFilename << ": "
+                       << toString(Regions.takeError()) << '\n';
+    return 1;
+  }
+  if (Regions->empty()) {
+    WithColor::error() << "no profiled code found in " << InputFilename
+                       << ".\n";
+    return 1;
+  }
+
+  auto OF = getOutputStream();
+  if (std::error_code EC = OF.getError()) {
+    WithColor::error() << EC.message() << '\n';
+    return 1;
+  }
+  std::unique_ptr<ToolOutputFile> TOF = std::move(*OF);
+
+  // The regions are independent; each one gets its own instruction builder,
+  // context and pipeline.
+  mca::PipelineOptions PO(MicroOpQueue, DecoderThroughput, DispatchWidth,
+                          RegisterFileSize, LoadQueueSize, StoreQueueSize,
+                          AssumeNoAlias, /*ShouldEnableBottleneckAnalysis=*/false);
+  std::vector<ProfiledRegionResult> Results(Regions->size());
+  {
+    DefaultThreadPool Pool(hardware_concurrency(Jobs));
+    for (size_t I = 0, E = Regions->size(); I != E; ++I) {
+      Results[I].Region = &(*Regions)[I];
+      Pool.async([&, I] {
+        simulateProfiledRegion(TheTarget, STI, MCII, MRI, PO, Results[I]);
+      });
+    }
+    Pool.wait();
+  }
+
+  unsigned NumSkipped = 0;
+  for (const ProfiledRegionResult &R : Results) {
+    NumSkipped += R.NumSkipped;
+    if (!R.Error.empty())
+      WithColor::warning() << R.Region->getDescription() << ": " << R.Error
+                           << '\n';
+  }
+  if (NumSkipped)
+    WithColor::note() << NumSkipped
+                      << " instructions without scheduling information were "
+                         "skipped, accuracy will be impacted.\n";
+
+  llvm::erase_if(Results,
+                 [](const ProfiledRegionResult &R) { return !R.Error.empty(); });
+  llvm::stable_sort(Results, [](const ProfiledRegionResult &A,
+                                const ProfiledRegionResult &B) {
+    return A.getEstimatedCycles() > B.getEstimatedCycles();
+  });
+
+  raw_ostream &OS = TOF->os();
+  if (PrintJson) {
+    json::Array JSONRegions;
+    for (const ProfiledRegionResult &R : Results)
+      JSONRegions.push_back(json::Object(
+          {{"Function", R.Region->Function},
+           {"StartOffset", R.Region->StartOffset},
+           {"EndOffset", R.Region->EndOffset},
+           {"IsLoop", R.Region->IsLoop},
+           {"Weight", R.Region->Weight},
+           {"Instructions", R.NumInstructions},
+           {"SkippedInstructions", R.NumSkipped},
+           {"Iterations", R.NumIterations},
+           {"TotalCycles", R.TotalCycles},
+           {"CyclesPerIteration", R.getCyclesPerIteration()},
+           {"EstimatedCycles", R.getEstimatedCycles()},
+           {"IPC", R.IPC},
+           {"BlockRThroughput", R.BlockRThroughput},
+           {"Bottleneck", R.Bottleneck}}));
+    OS << formatv("{0:2}",
+                  json::Value(json::Object(
+                      {{"ProfiledRegions", std::move(JSONRegions)}})))
+       << "\n";
+  } else {
+    OS << "Profile:           " << ProfileFilename << '\n';
+    OS << "Total Count:       " << Profile->getTotalCount() << '\n';
+    OS << "Regions:           " << Results.size() << "\n\n";
+    OS << formatv("{0,4}  {1,12}  {2,14}  {3,9}  {4,6}  {5,11}  {6,-16}  {7}\n",
+                  "Rank", "Weight", "Est. Cycles", "Cyc/Iter", "IPC",
+                  "RThroughput", "Bottleneck", "Region");
+    unsigned Rank = 0;
+    for (const ProfiledRegionResult &R : Results)
+      OS << formatv("{0,4}  {1,12}  {2,14:f0}  {3,9:f2}  {4,6:f2}  {5,11:f1}  "
+                    "{6,-16}  {7}\n",
+                    ++Rank, R.Region->Weight, R.getEstimatedCycles(),
+                    R.getCyclesPerIteration(), R.IPC, R.BlockRThroughput,
+                    R.Bottleneck, R.Region->getDescription());
+  }
+
+  TOF->keep();
+  return 0;
+}
+
 int main(int argc, char **argv) {
   InitLLVM X(argc, argv);
 
-  // Initialize targets and assembly parsers.
+  // Initialize targets, assembly parsers and disassemblers.
   InitializeAllTargetInfos();
   InitializeAllTargetMCs();
   InitializeAllAsmParsers();
+  InitializeAllDisassemblers();
   InitializeAllTargetMCAs();
 
   // Register the Target and CPU printer for --version.
@@ -372,6 +655,23 @@ int main(int argc, char **argv) {
   // the default triple for the host. If the triple doesn't correspond to any
   // registered target, then exit with an error message.
   const char *ProgName = argv[0];
+
+  // With -profile the input is a binary. Unless a target is given, analyze it
+  // for the target it was built for.
+  object::OwningBinary<object::ObjectFile> ProfiledBinary;
+  if (!ProfileFilename.empty()) {
+    Expected<object::OwningBinary<object::ObjectFile>> ObjOrErr =
+        object::ObjectFile::createObjectFile(InputFilename);
+    if (!ObjOrErr) {
+      WithColor::error() << InputFilename << ": "
+                         << toString(ObjOrErr.takeError()) << '\n';
+      return 1;
+    }
+    ProfiledBinary = std::move(*ObjOrErr);
+    if (TripleName.empty() && ArchName.empty())
+      TripleName = ProfiledBinary.getBinary()->makeTriple().str();
+  }
+
   const Target *TheTarget = getTarget(ProgName);
   if (!TheTarget)
     return 1;
@@ -443,6 +743,10 @@ int main(int argc, char **argv) {
   std::unique_ptr<MCInstrAnalysis> MCIA(
       TheTarget->createMCInstrAnalysis(MCII.get()));
 
+  if (ProfiledBinary.getBinary())
+    return analyzeProfiledBinary(*TheTarget, *ProfiledBinary.getBinary(), *STI,
+                                 *MCII, *MRI, *MAI, MCIA.get());
+
   // Need to initialize an MCInstPrinter as it is
   // required for initializing the MCTargetStreamer
   // which needs to happen within the CRG.parseAnalysisRegions() call below.
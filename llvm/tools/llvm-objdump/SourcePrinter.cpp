@@ -16,6 +16,7 @@
 #include "llvm-objdump.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/DebugInfo/DWARF/DWARFExpression.h"
+#include "llvm/DebugInfo/Symbolize/SymbolizableObjectFile.h"
 #include "llvm/Support/FormatVariadic.h"
 
 #define DEBUG_TYPE "objdump"
@@ -367,6 +368,37 @@ bool SourcePrinter::cacheSource(const DILineInfo &LineInfo) {
   return true;
 }
 
+// Applies --prefix and --prefix-strip to the file name of LineInfo.
+static void applyPrefix(DILineInfo &LineInfo) {
+  if (objdump::Prefix.empty() || !sys::path::is_absolute_gnu(LineInfo.FileName))
+    return;
+
+  // FileName has at least one character since is_absolute_gnu is false for
+  // an empty string.
+  assert(!LineInfo.FileName.empty());
+  if (PrefixStrip > 0) {
+    uint32_t Level = 0;
+    auto StrippedNameStart = LineInfo.FileName.begin();
+
+    // Path.h iterator skips extra separators. Therefore it cannot be used
+    // here to keep compatibility with GNU Objdump.
+    for (auto Pos = StrippedNameStart + 1, End = LineInfo.FileName.end();
+         Pos != End && Level < PrefixStrip; ++Pos) {
+      if (sys::path::is_separator(*Pos)) {
+        StrippedNameStart = Pos;
+        ++Level;
+      }
+    }
+
+    LineInfo.FileName = std::string(StrippedNameStart, LineInfo.FileName.end());
+  }
+
+  SmallString<128> FilePath;
+  sys::path::append(FilePath, Prefix, LineInfo.FileName);
+
+  LineInfo.FileName = std::string(FilePath);
+}
+
 void SourcePrinter::printSourceLine(formatted_raw_ostream &OS,
                                     object::SectionedAddress Address,
                                     StringRef ObjectFilename,
@@ -376,52 +408,127 @@ void SourcePrinter::printSourceLine(formatted_raw_ostream &OS,
     return;
 
   DILineInfo LineInfo = DILineInfo();
-  Expected<DILineInfo> ExpectedLineInfo =
-      Symbolizer->symbolizeCode(*Obj, Address);
-  std::string ErrorMessage;
-  if (ExpectedLineInfo) {
-    LineInfo = *ExpectedLineInfo;
-  } else if (!WarnedInvalidDebugInfo) {
-    WarnedInvalidDebugInfo = true;
-    // TODO Untested.
-    reportWarning("failed to parse debug information: " +
-                      toString(ExpectedLineInfo.takeError()),
-                  ObjectFilename);
+  if (ConcurrentModule) {
+    LineInfo = getLineInfoConcurrently(Address);
+  } else {
+    Expected<DILineInfo> ExpectedLineInfo =
+        Symbolizer->symbolizeCode(*Obj, Address);
+    if (ExpectedLineInfo) {
+      LineInfo = *ExpectedLineInfo;
+    } else if (!WarnedInvalidDebugInfo) {
+      WarnedInvalidDebugInfo = true;
+      // TODO Untested.
+      reportWarning("failed to parse debug information: " +
+                        toString(ExpectedLineInfo.takeError()),
+                    ObjectFilename);
+    }
   }
 
-  if (!objdump::Prefix.empty() &&
-      sys::path::is_absolute_gnu(LineInfo.FileName)) {
-    // FileName has at least one character since is_absolute_gnu is false for
-    // an empty string.
-    assert(!LineInfo.FileName.empty());
-    if (PrefixStrip > 0) {
-      uint32_t Level = 0;
-      auto StrippedNameStart = LineInfo.FileName.begin();
-
-      // Path.h iterator skips extra separators. Therefore it cannot be used
-      // here to keep compatibility with GNU Objdump.
-      for (auto Pos = StrippedNameStart + 1, End = LineInfo.FileName.end();
-           Pos != End && Level < PrefixStrip; ++Pos) {
-        if (sys::path::is_separator(*Pos)) {
-          StrippedNameStart = Pos;
-          ++Level;
-        }
-      }
+  applyPrefix(LineInfo);
+  printLineInfo(OS, LineInfo, ObjectFilename, LVP, Delimiter);
+}
+
+void SourcePrinter::printLineInfo(formatted_raw_ostream &OS,
+                                  const DILineInfo &LineInfo,
+                                  StringRef ObjectFilename,
+                                  LiveVariablePrinter &LVP,
+                                  StringRef Delimiter) {
+  if (PrintLines)
+    printLines(OS, LineInfo, Delimiter, LVP);
+  if (PrintSource)
+    printSources(OS, LineInfo, ObjectFilename, Delimiter, LVP);
+  OldLineInfo = LineInfo;
+}
 
-      LineInfo.FileName =
-          std::string(StrippedNameStart, LineInfo.FileName.end());
+bool SourcePrinter::enableConcurrentLookups() {
+  if (ConcurrentModule)
+    return true;
+  // BPF objects without DWARF are symbolized from their BTF sections, which
+  // have no thread-safe context.
+  if (!Symbolizer || Obj->makeTriple().isBPF())
+    return false;
+
+  std::unique_ptr<DWARFContext> Context = DWARFContext::create(
+      *Obj, DWARFContext::ProcessDebugRelocations::Process, nullptr, "",
+      WithColor::defaultErrorHandler, WithColor::defaultWarningHandler,
+      /*ThreadSafe=*/true);
+  // The context only guards its own state. Units extract their DIEs, load
+  // their split units and build their address maps lazily, so do all of that
+  // here, along with parsing the line tables, before any lookup can race on
+  // it. This also reports problems with the debug info up front.
+  Context->getDebugAranges();
+  for (const std::unique_ptr<DWARFUnit> &U : Context->normal_units()) {
+    U->getUnitDIE(/*ExtractUnitDIEOnly=*/false);
+    U->getBaseAddress();
+    if (DWARFDie Die = U->getNonSkeletonUnitDIE(/*ExtractUnitDIEOnly=*/false)) {
+      DWARFUnit *NonSkeleton = Die.getDwarfUnit();
+      NonSkeleton->getBaseAddress();
+      NonSkeleton->getSubroutineForAddress(0);
+      NonSkeleton->getContext().getLineTableForUnit(NonSkeleton);
     }
+    Context->getLineTableForUnit(U.get());
+  }
 
-    SmallString<128> FilePath;
-    sys::path::append(FilePath, Prefix, LineInfo.FileName);
+  auto ModuleOrErr = symbolize::SymbolizableObjectFile::create(
+      Obj, std::move(Context), /*UntagAddresses=*/false);
+  if (!ModuleOrErr) {
+    consumeError(ModuleOrErr.takeError());
+    return false;
+  }
+  ConcurrentModule = std::move(*ModuleOrErr);
+  return true;
+}
+
+DILineInfo
+SourcePrinter::getLineInfoConcurrently(object::SectionedAddress Address) const {
+  assert(ConcurrentModule && "concurrent lookups are not enabled");
+  // Match the lookups of the symbolizer created in the constructor.
+  DILineInfoSpecifier Spec(
+      DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath,
+      DILineInfoSpecifier::FunctionNameKind::LinkageName);
+  DILineInfo LineInfo =
+      ConcurrentModule->symbolizeCode(Address, Spec, /*UseSymbolTable=*/true);
+  if (Demangle)
+    LineInfo.FunctionName = symbolize::LLVMSymbolizer::DemangleName(
+        LineInfo.FunctionName, ConcurrentModule.get());
+  return LineInfo;
+}
 
-    LineInfo.FileName = std::string(FilePath);
+void SourcePrinter::printChunk(raw_ostream &OS, const ChunkSourcePrinter &Chunk,
+                               StringRef ObjectFilename,
+                               LiveVariablePrinter &LVP) {
+  StringRef Buffer = Chunk.Buffer;
+  if (!Chunk.FirstLineInfo) {
+    OS << Buffer;
+    return;
   }
 
-  if (PrintLines)
-    printLines(OS, LineInfo, Delimiter, LVP);
-  if (PrintSource)
-    printSources(OS, LineInfo, ObjectFilename, Delimiter, LVP);
+  OS << Buffer.take_front(Chunk.FirstLineOffset);
+  {
+    formatted_raw_ostream FOS(OS);
+    printLineInfo(FOS, *Chunk.FirstLineInfo, ObjectFilename, LVP,
+                  Chunk.FirstLineDelimiter);
+  }
+  OS << Buffer.drop_front(Chunk.FirstLineOffset);
+  OldLineInfo = Chunk.OldLineInfo;
+}
+
+void ChunkSourcePrinter::printSourceLine(formatted_raw_ostream &OS,
+                                         object::SectionedAddress Address,
+                                         StringRef ObjectFilename,
+                                         LiveVariablePrinter &LVP,
+                                         StringRef Delimiter) {
+  DILineInfo LineInfo = Parent.getLineInfoConcurrently(Address);
+  applyPrefix(LineInfo);
+  if (FirstLineInfo) {
+    printLineInfo(OS, LineInfo, ObjectFilename, LVP, Delimiter);
+    return;
+  }
+
+  OS.flush();
+  FirstLineInfo = LineInfo;
+  FirstLineOffset = Buffer.size();
+  FirstLineDelimiter = Delimiter.str();
   OldLineInfo = LineInfo;
 }
 
@@ -12,10 +12,13 @@
 #include "llvm/ADT/IndexedMap.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/DebugInfo/Symbolize/Symbolize.h"
 #include "llvm/MC/MCRegisterInfo.h"
 #include "llvm/MC/MCSubtargetInfo.h"
 #include "llvm/Support/FormattedStream.h"
+#include <optional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -127,11 +130,17 @@ public:
   void printAfterInst(formatted_raw_ostream &OS);
 };
 
+class ChunkSourcePrinter;
+
 class SourcePrinter {
 protected:
   DILineInfo OldLineInfo;
   const object::ObjectFile *Obj = nullptr;
   std::unique_ptr<symbolize::LLVMSymbolizer> Symbolizer;
+  // Set by enableConcurrentLookups(). Backed by a thread-safe DWARF context,
+  // so that chunks of disassembly produced on several threads can look up
+  // their lines at the same time.
+  std::unique_ptr<symbolize::SymbolizableModule> ConcurrentModule;
   // File name to file contents of source.
   std::unordered_map<std::string, std::unique_ptr<MemoryBuffer>> SourceCache;
   // Mark the line endings of the cached source.
@@ -155,6 +164,13 @@ private:
   // Returns empty string if source code cannot be found.
   StringRef getLine(const DILineInfo &LineInfo, StringRef ObjectFilename);
 
+protected:
+  // Prints LineInfo as requested by --line-numbers and --source, and makes it
+  // the line that the next one is compared against.
+  void printLineInfo(formatted_raw_ostream &OS, const DILineInfo &LineInfo,
+                     StringRef ObjectFilename, LiveVariablePrinter &LVP,
+                     StringRef Delimiter);
+
 public:
   SourcePrinter() = default;
   SourcePrinter(const object::ObjectFile *Obj, StringRef DefaultArch);
@@ -164,6 +180,45 @@ public:
                                StringRef ObjectFilename,
                                LiveVariablePrinter &LVP,
                                StringRef Delimiter = "; ");
+
+  /// Switches line lookups to a thread-safe DWARF context, after which
+  /// getLineInfoConcurrently() may be called from several threads. Returns
+  /// false if the debug info of the object cannot be read that way.
+  bool enableConcurrentLookups();
+
+  /// Returns the line info for \p Address. Requires a successful call to
+  /// enableConcurrentLookups().
+  DILineInfo getLineInfoConcurrently(object::SectionedAddress Address) const;
+
+  /// Writes out a chunk of disassembly printed with \p Chunk, as if it had
+  /// been printed with this printer.
+  void printChunk(raw_ostream &OS, const ChunkSourcePrinter &Chunk,
+                  StringRef ObjectFilename, LiveVariablePrinter &LVP);
+};
+
+/// Prints the source lines of a chunk of disassembly that is produced into a
+/// buffer on a worker thread. Whether the first line of the chunk is printed
+/// depends on the last line of the preceding chunk, which is not known yet, so
+/// that line is only recorded here and printed by SourcePrinter::printChunk()
+/// once the chunks are written out in address order.
+class ChunkSourcePrinter : public SourcePrinter {
+  friend class SourcePrinter;
+
+  const SourcePrinter &Parent;
+  const std::string &Buffer;
+  std::optional<DILineInfo> FirstLineInfo;
+  // Where the first line belongs in Buffer.
+  size_t FirstLineOffset = 0;
+  std::string FirstLineDelimiter;
+
+public:
+  ChunkSourcePrinter(const SourcePrinter &Parent, const std::string &Buffer)
+      : Parent(Parent), Buffer(Buffer) {}
+
+  void printSourceLine(formatted_raw_ostream &OS,
+                       object::SectionedAddress Address,
+                       StringRef ObjectFilename, LiveVariablePrinter &LVP,
+                       StringRef Delimiter = "; ") override;
 };
 
 } // namespace objdump
@@ -71,14 +71,18 @@
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/LLVMDriver.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/TargetParser/Host.h"
 #include "llvm/TargetParser/Triple.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstring>
 #include <optional>
@@ -322,6 +326,7 @@ bool objdump::SectionContents;
 static std::vector<std::string> InputFilenames;
 bool objdump::PrintLines;
 static bool MachOOpt;
+static unsigned NumThreads = 1;
 std::string objdump::MCPU;
 std::vector<std::string> objdump::MAttrs;
 bool objdump::ShowRawInsn;
@@ -1376,7 +1381,7 @@ static uint64_t dumpARMELFData(uint64_t SectionAddr, uint64_t Index,
 }
 
 static void dumpELFData(uint64_t SectionAddr, uint64_t Index, uint64_t End,
-                        ArrayRef<uint8_t> Bytes) {
+                        ArrayRef<uint8_t> Bytes, raw_ostream &OS) {
   // print out data up to 8 bytes at a time in hex and ascii
   uint8_t AsciiData[9] = {'\0'};
   uint8_t Byte;
@@ -1384,9 +1389,9 @@ static void dumpELFData(uint64_t SectionAddr, uint64_t Index, uint64_t End,
 
   for (; Index < End; ++Index) {
     if (NumBytes == 0)
-      outs() << format("%8" PRIx64 ":", SectionAddr + Index);
+      OS << format("%8" PRIx64 ":", SectionAddr + Index);
     Byte = Bytes.slice(Index)[0];
-    outs() << format(" %02x", Byte);
+    OS << format(" %02x", Byte);
     AsciiData[NumBytes] = isPrint(Byte) ? Byte : '.';
 
     uint8_t IndentOffset = 0;
@@ -1401,9 +1406,9 @@ static void dumpELFData(uint64_t SectionAddr, uint64_t Index, uint64_t End,
     }
     if (NumBytes == 8) {
       AsciiData[8] = '\0';
-      outs() << std::string(IndentOffset, ' ') << "         ";
-      outs() << reinterpret_cast<char *>(AsciiData);
-      outs() << '\n';
+      OS << std::string(IndentOffset, ' ') << "         ";
+      OS << reinterpret_cast<char *>(AsciiData);
+      OS << '\n';
       NumBytes = 0;
     }
   }
@@ -1661,12 +1666,36 @@ fetchBinaryByBuildID(const ObjectFile &Obj) {
   return std::move(*DebugBinary);
 }
 
+namespace {
+/// A chunk of code between two points where at least one symbol is defined,
+/// selected for disassembly.
+struct SymbolChunk {
+  /// The symbols defined at the start of the chunk, the names to print them
+  /// with and whether to print them.
+  ArrayRef<SymbolInfoTy> Symbols;
+  std::vector<std::string> SymNames;
+  std::vector<bool> SymsToPrint;
+  bool DisassembleAsELFData;
+  /// Whether this is the first chunk printed for its section.
+  bool PrintSectionHeader;
+  /// The section offsets of the chunk.
+  uint64_t Start;
+  uint64_t End;
+};
+} // namespace
+
+using RelocIterator = std::vector<RelocationRef>::const_iterator;
+
+// The amount of code disassembled in parallel before the output is printed.
+// Bounds the memory held by the text of the disassembly.
+static constexpr uint64_t ParallelBatchSize = 4 << 20;
+
 static void
 disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
                   DisassemblerTarget &PrimaryTarget,
                   std::optional<DisassemblerTarget> &SecondaryTarget,
                   SourcePrinter &SP, bool InlineRelocs) {
-  DisassemblerTarget *DT = &PrimaryTarget;
+  DisassemblerTarget *CurrentTarget = &PrimaryTarget;
   bool PrimaryIsThumb = false;
   SmallVector<std::pair<uint64_t, uint64_t>, 0> CHPECodeMap;
 
@@ -1829,7 +1858,8 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
   llvm::stable_sort(AbsoluteSymbols);
 
   std::unique_ptr<DWARFContext> DICtx;
-  LiveVariablePrinter LVP(*DT->Context->getRegisterInfo(), *DT->SubtargetInfo);
+  LiveVariablePrinter LVP(*CurrentTarget->Context->getRegisterInfo(),
+                          *CurrentTarget->SubtargetInfo);
 
   if (DbgVariables != DVDisabled) {
     DICtx = DWARFContext::create(DbgObj);
@@ -1873,6 +1903,44 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
       WithColor::defaultErrorHandler(std::move(E));
   }
 
+  // Chunks of code are disassembled on a thread pool, each thread with
+  // disassemblers of its own, and printed in address order. That requires
+  // the output of a chunk not to depend on state carried over from the
+  // chunks before it, which rules out switching instruction sets,
+  // relocations, variable locations, source text and AMDGPU labels. Line
+  // numbers are looked up through a thread-safe DWARF context. Code that fits
+  // in a single batch is disassembled serially, as the thread pool and the
+  // DWARF parsed up front would only slow it down.
+  unsigned ThreadCount =
+      hardware_concurrency(NumThreads).compute_thread_count();
+  bool DisassembleInParallel =
+      ThreadCount > 1 && !SecondaryTarget && !InlineRelocs &&
+      !Obj.isXCOFF() && DbgVariables == DVDisabled && !PrintSource &&
+      Obj.getArch() != Triple::amdgcn &&
+      !(PrimaryTarget.InstPrinter->getUseColor() &&
+        sys::Process::ColorNeedsFlush());
+  if (DisassembleInParallel) {
+    uint64_t SelectedSize = 0;
+    for (const SectionRef &Section : ToolSectionFilter(Obj)) {
+      if (FilterSections.empty() && !DisassembleAll &&
+          (!Section.isText() || Section.isVirtual()))
+        continue;
+      uint64_t SectionAddr = Section.getAddress();
+      uint64_t Start = std::max(SectionAddr, StartAddress);
+      uint64_t End = std::min(SectionAddr + Section.getSize(), StopAddress);
+      if (Start < End)
+        SelectedSize += End - Start;
+    }
+    DisassembleInParallel = SelectedSize > ParallelBatchSize;
+  }
+  if (DisassembleInParallel && PrintLines)
+    DisassembleInParallel = SP.enableConcurrentLookups();
+  std::vector<std::unique_ptr<DisassemblerTarget>> ThreadTargets;
+  std::optional<DefaultThreadPool> Pool;
+  if (DisassembleInParallel)
+    Pool.emplace(hardware_concurrency(ThreadCount));
+  bool UseColors = outs().colors_enabled();
+
   for (const SectionRef &Section : ToolSectionFilter(Obj)) {
     if (FilterSections.empty() && !DisassembleAll &&
         (!Section.isText() || Section.isVirtual()))
@@ -1899,8 +1967,9 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
     std::vector<std::unique_ptr<std::string>> SynthesizedLabelNames;
     if (Obj.isELF() && Obj.getArch() == Triple::amdgcn) {
       // AMDGPU disassembler uses symbolizer for printing labels
-      addSymbolizer(*DT->Context, DT->TheTarget, TripleName, DT->DisAsm.get(),
-                    SectionAddr, Bytes, Symbols, SynthesizedLabelNames);
+      addSymbolizer(*CurrentTarget->Context, CurrentTarget->TheTarget,
+                    TripleName, CurrentTarget->DisAsm.get(), SectionAddr, Bytes,
+                    Symbols, SynthesizedLabelNames);
     }
 
     StringRef SegmentName = getSegmentName(MachO, Section);
@@ -1928,9 +1997,6 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
         Symbols.insert(llvm::lower_bound(Symbols, Sym), Sym);
     }
 
-    SmallString<40> Comments;
-    raw_svector_ostream CommentStream(Comments);
-
     uint64_t VMAAdjustment = 0;
     if (shouldAdjustVA(Section))
       VMAAdjustment = AdjustVMA;
@@ -1939,163 +2005,59 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
     // Subtract SectionAddr from the r_offset field of a relocation to get
     // the section offset.
     uint64_t RelAdjustment = Obj.isRelocatableObject() ? 0 : SectionAddr;
-    uint64_t Size;
-    uint64_t Index;
     bool PrintedSection = false;
     std::vector<RelocationRef> Rels = RelocMap[Section];
-    std::vector<RelocationRef>::const_iterator RelCur = Rels.begin();
-    std::vector<RelocationRef>::const_iterator RelEnd = Rels.end();
-
-    // Loop over each chunk of code between two points where at least
-    // one symbol is defined.
-    for (size_t SI = 0, SE = Symbols.size(); SI != SE;) {
-      // Advance SI past all the symbols starting at the same address,
-      // and make an ArrayRef of them.
-      unsigned FirstSI = SI;
-      uint64_t Start = Symbols[SI].Addr;
-      ArrayRef<SymbolInfoTy> SymbolsHere;
-      while (SI != SE && Symbols[SI].Addr == Start)
-        ++SI;
-      SymbolsHere = ArrayRef<SymbolInfoTy>(&Symbols[FirstSI], SI - FirstSI);
-
-      // Get the demangled names of all those symbols. We end up with a vector
-      // of StringRef that holds the names we're going to use, and a vector of
-      // std::string that stores the new strings returned by demangle(), if
-      // any. If we don't call demangle() then that vector can stay empty.
-      std::vector<StringRef> SymNamesHere;
-      std::vector<std::string> DemangledSymNamesHere;
-      if (Demangle) {
-        // Fetch the demangled names and store them locally.
-        for (const SymbolInfoTy &Symbol : SymbolsHere)
-          DemangledSymNamesHere.push_back(demangle(Symbol.Name));
-        // Now we've finished modifying that vector, it's safe to make
-        // a vector of StringRefs pointing into it.
-        SymNamesHere.insert(SymNamesHere.begin(), DemangledSymNamesHere.begin(),
-                            DemangledSymNamesHere.end());
-      } else {
-        for (const SymbolInfoTy &Symbol : SymbolsHere)
-          SymNamesHere.push_back(Symbol.Name);
-      }
-
-      // Distinguish ELF data from code symbols, which will be used later on to
-      // decide whether to 'disassemble' this chunk as a data declaration via
-      // dumpELFData(), or whether to treat it as code.
-      //
-      // If data _and_ code symbols are defined at the same address, the code
-      // takes priority, on the grounds that disassembling code is our main
-      // purpose here, and it would be a worse failure to _not_ interpret
-      // something that _was_ meaningful as code than vice versa.
-      //
-      // Any ELF symbol type that is not clearly data will be regarded as code.
-      // In particular, one of the uses of STT_NOTYPE is for branch targets
-      // inside functions, for which STT_FUNC would be inaccurate.
-      //
-      // So here, we spot whether there's any non-data symbol present at all,
-      // and only set the DisassembleAsELFData flag if there isn't. Also, we use
-      // this distinction to inform the decision of which symbol to print at
-      // the head of the section, so that if we're printing code, we print a
-      // code-related symbol name to go with it.
-      bool DisassembleAsELFData = false;
-      size_t DisplaySymIndex = SymbolsHere.size() - 1;
-      if (Obj.isELF() && !DisassembleAll && Section.isText()) {
-        DisassembleAsELFData = true; // unless we find a code symbol below
-
-        for (size_t i = 0; i < SymbolsHere.size(); ++i) {
-          uint8_t SymTy = SymbolsHere[i].Type;
-          if (SymTy != ELF::STT_OBJECT && SymTy != ELF::STT_COMMON) {
-            DisassembleAsELFData = false;
-            DisplaySymIndex = i;
-          }
-        }
-      }
-
-      // Decide which symbol(s) from this collection we're going to print.
-      std::vector<bool> SymsToPrint(SymbolsHere.size(), false);
-      // If the user has given the --disassemble-symbols option, then we must
-      // display every symbol in that set, and no others.
-      if (!DisasmSymbolSet.empty()) {
-        bool FoundAny = false;
-        for (size_t i = 0; i < SymbolsHere.size(); ++i) {
-          if (DisasmSymbolSet.count(SymNamesHere[i])) {
-            SymsToPrint[i] = true;
-            FoundAny = true;
-          }
-        }
-
-        // And if none of the symbols here is one that the user asked for, skip
-        // disassembling this entire chunk of code.
-        if (!FoundAny)
-          continue;
-      } else if (!SymbolsHere[DisplaySymIndex].IsMappingSymbol) {
-        // Otherwise, print whichever symbol at this location is last in the
-        // Symbols array, because that array is pre-sorted in a way intended to
-        // correlate with priority of which symbol to display.
-        SymsToPrint[DisplaySymIndex] = true;
-      }
-
-      // Now that we know we're disassembling this section, override the choice
-      // of which symbols to display by printing _all_ of them at this address
-      // if the user asked for all symbols.
-      //
-      // That way, '--show-all-symbols --disassemble-symbol=foo' will print
-      // only the chunk of code headed by 'foo', but also show any other
-      // symbols defined at that address, such as aliases for 'foo', or the ARM
-      // mapping symbol preceding its code.
-      if (ShowAllSymbols) {
-        for (size_t i = 0; i < SymbolsHere.size(); ++i)
-          SymsToPrint[i] = true;
-      }
-
-      if (Start < SectionAddr || StopAddress <= Start)
-        continue;
-
-      for (size_t i = 0; i < SymbolsHere.size(); ++i)
-        FoundDisasmSymbolSet.insert(SymNamesHere[i]);
-
-      // The end is the section end, the beginning of the next symbol, or
-      // --stop-address.
-      uint64_t End = std::min<uint64_t>(SectionAddr + SectSize, StopAddress);
-      if (SI < SE)
-        End = std::min(End, Symbols[SI].Addr);
-      if (Start >= End || End <= StartAddress)
-        continue;
-      Start -= SectionAddr;
-      End -= SectionAddr;
-
-      if (!PrintedSection) {
-        PrintedSection = true;
-        outs() << "\nDisassembly of section ";
+    RelocIterator SectionRelCur = Rels.begin();
+    RelocIterator RelEnd = Rels.end();
+
+    // Disassemble a chunk of code to OS, starting with the target DT and
+    // leaving DT at the one the chunk ended with. RelCur is advanced past the
+    // relocations of the chunk.
+    auto DisassembleChunk = [&](const SymbolChunk &Chunk, raw_ostream &OS,
+                                DisassemblerTarget &Primary,
+                                DisassemblerTarget *&DT, SourcePrinter &ChunkSP,
+                                LiveVariablePrinter &ChunkLVP,
+                                RelocIterator &RelCur) {
+      uint64_t Start = Chunk.Start;
+      uint64_t End = Chunk.End;
+      uint64_t Size;
+      uint64_t Index;
+      SmallString<40> Comments;
+      raw_svector_ostream CommentStream(Comments);
+
+      if (Chunk.PrintSectionHeader) {
+        OS << "\nDisassembly of section ";
         if (!SegmentName.empty())
-          outs() << SegmentName << ",";
-        outs() << SectionName << ":\n";
+          OS << SegmentName << ",";
+        OS << SectionName << ":\n";
       }
 
       bool PrintedLabel = false;
-      for (size_t i = 0; i < SymbolsHere.size(); ++i) {
-        if (!SymsToPrint[i])
+      for (size_t i = 0; i < Chunk.Symbols.size(); ++i) {
+        if (!Chunk.SymsToPrint[i])
           continue;
 
-        const SymbolInfoTy &Symbol = SymbolsHere[i];
-        const StringRef SymbolName = SymNamesHere[i];
+        const SymbolInfoTy &Symbol = Chunk.Symbols[i];
+        const StringRef SymbolName = Chunk.SymNames[i];
 
         if (!PrintedLabel) {
-          outs() << '\n';
+          OS << '\n';
           PrintedLabel = true;
         }
         if (LeadingAddr)
-          outs() << format(Is64Bits ? "%016" PRIx64 " " : "%08" PRIx64 " ",
-                           SectionAddr + Start + VMAAdjustment);
+          OS << format(Is64Bits ? "%016" PRIx64 " " : "%08" PRIx64 " ",
+                       SectionAddr + Start + VMAAdjustment);
         if (Obj.isXCOFF() && SymbolDescription) {
-          outs() << getXCOFFSymbolDescription(Symbol, SymbolName) << ":\n";
+          OS << getXCOFFSymbolDescription(Symbol, SymbolName) << ":\n";
         } else
-          outs() << '<' << SymbolName << ">:\n";
+          OS << '<' << SymbolName << ">:\n";
       }
 
       // Don't print raw contents of a virtual section. A virtual section
       // doesn't have any contents in the file.
       if (Section.isVirtual()) {
-        outs() << "...\n";
-        continue;
+        OS << "...\n";
+        return;
       }
 
       // See if any of the symbols defined at this location triggers target-
@@ -2108,8 +2070,8 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
       // the object file is probably confused anyway, and it would make even
       // less sense to present the output of _both_ handlers, because that
       // would describe the same data twice.
-      for (size_t SHI = 0; SHI < SymbolsHere.size(); ++SHI) {
-        SymbolInfoTy Symbol = SymbolsHere[SHI];
+      for (size_t SHI = 0; SHI < Chunk.Symbols.size(); ++SHI) {
+        SymbolInfoTy Symbol = Chunk.Symbols[SHI];
 
         Expected<bool> RespondedOrErr = DT->DisAsm->onSymbolStart(
             Symbol, Size, Bytes.slice(Start, End - Start), SectionAddr + Start);
@@ -2131,17 +2093,17 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
           do {
             StringRef Line;
             std::tie(Line, ErrMsg) = ErrMsg.split('\n');
-            outs() << DT->Context->getAsmInfo()->getCommentString()
-                   << " error decoding " << SymNamesHere[SHI] << ": " << Line
-                   << '\n';
+            OS << DT->Context->getAsmInfo()->getCommentString()
+               << " error decoding " << Chunk.SymNames[SHI] << ": " << Line
+               << '\n';
           } while (!ErrMsg.empty());
 
           if (Size) {
-            outs() << DT->Context->getAsmInfo()->getCommentString()
-                   << " decoding failed region as bytes\n";
+            OS << DT->Context->getAsmInfo()->getCommentString()
+               << " decoding failed region as bytes\n";
             for (uint64_t I = 0; I < Size; ++I)
-              outs() << "\t.byte\t " << format_hex(Bytes[I], 1, /*Upper=*/true)
-                     << '\n';
+              OS << "\t.byte\t " << format_hex(Bytes[I], 1, /*Upper=*/true)
+                 << '\n';
           }
         }
 
@@ -2159,10 +2121,9 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
       if (SectionAddr < StartAddress)
         Index = std::max<uint64_t>(Index, StartAddress - SectionAddr);
 
-      if (DisassembleAsELFData) {
-        dumpELFData(SectionAddr, Index, End, Bytes);
-        Index = End;
-        continue;
+      if (Chunk.DisassembleAsELFData) {
+        dumpELFData(SectionAddr, Index, End, Bytes, OS);
+        return;
       }
 
       // Skip relocations from symbols that are not dumped.
@@ -2175,17 +2136,18 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
       bool DumpARMELFData = false;
       bool DumpTracebackTableForXCOFFFunction =
           Obj.isXCOFF() && Section.isText() && TracebackTable &&
-          Symbols[SI - 1].XCOFFSymInfo.StorageMappingClass &&
-          (*Symbols[SI - 1].XCOFFSymInfo.StorageMappingClass == XCOFF::XMC_PR);
+          Chunk.Symbols.back().XCOFFSymInfo.StorageMappingClass &&
+          (*Chunk.Symbols.back().XCOFFSymInfo.StorageMappingClass ==
+           XCOFF::XMC_PR);
 
-      formatted_raw_ostream FOS(outs());
+      formatted_raw_ostream FOS(OS);
 
       std::unordered_map<uint64_t, std::string> AllLabels;
       std::unordered_map<uint64_t, std::vector<BBAddrMapLabel>> BBAddrMapLabels;
       if (SymbolizeOperands) {
         collectLocalBranchTargets(Bytes, DT->InstrAnalysis.get(),
                                   DT->DisAsm.get(), DT->InstPrinter.get(),
-                                  PrimaryTarget.SubtargetInfo.get(),
+                                  Primary.SubtargetInfo.get(),
                                   SectionAddr, Index, End, AllLabels);
         collectBBAddrMapLabels(FullAddrMap, SectionAddr, Index, End,
                                BBAddrMapLabels);
@@ -2206,9 +2168,9 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
           DumpARMELFData = Kind == 'd';
           if (SecondaryTarget) {
             if (Kind == 'a') {
-              DT = PrimaryIsThumb ? &*SecondaryTarget : &PrimaryTarget;
+              DT = PrimaryIsThumb ? &*SecondaryTarget : &Primary;
             } else if (Kind == 't') {
-              DT = PrimaryIsThumb ? &PrimaryTarget : &*SecondaryTarget;
+              DT = PrimaryIsThumb ? &Primary : &*SecondaryTarget;
             }
           }
         } else if (!CHPECodeMap.empty()) {
@@ -2221,7 +2183,7 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
           if (It != CHPECodeMap.begin() && Address < (It - 1)->second) {
             DT = &*SecondaryTarget;
           } else {
-            DT = &PrimaryTarget;
+            DT = &Primary;
             // X64 disassembler range may have left Index unaligned, so
             // make sure that it's aligned when we switch back to ARM64
             // code.
@@ -2308,8 +2270,9 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
                 ThisBytes.size(),
                 DT->DisAsm->suggestBytesToSkip(ThisBytes, ThisAddr));
 
-          LVP.update({Index, Section.getIndex()},
-                     {Index + Size, Section.getIndex()}, Index + Size != End);
+          ChunkLVP.update({Index, Section.getIndex()},
+                          {Index + Size, Section.getIndex()},
+                          Index + Size != End);
 
           DT->InstPrinter->setCommentStream(CommentStream);
 
@@ -2317,7 +2280,8 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
               *DT->InstPrinter, Disassembled ? &Inst : nullptr,
               Bytes.slice(Index, Size),
               {SectionAddr + Index + VMAAdjustment, Section.getIndex()}, FOS,
-              "", *DT->SubtargetInfo, &SP, Obj.getFileName(), &Rels, LVP);
+              "", *DT->SubtargetInfo, &ChunkSP, Obj.getFileName(), &Rels,
+              ChunkLVP);
 
           DT->InstPrinter->setCommentStream(llvm::nulls());
 
@@ -2374,7 +2338,9 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
                     TargetSecAddr = It->first;
                   if (It->first != TargetSecAddr)
                     break;
-                  TargetSectionSymbols.push_back(&AllSymbols[It->second]);
+                  auto SecSyms = AllSymbols.find(It->second);
+                  if (SecSyms != AllSymbols.end())
+                    TargetSectionSymbols.push_back(&SecSyms->second);
                 }
               } else {
                 TargetSectionSymbols.push_back(&Symbols);
@@ -2501,11 +2467,12 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
 
         assert(DT->Context->getAsmInfo());
         emitPostInstructionInfo(FOS, *DT->Context->getAsmInfo(),
-                                *DT->SubtargetInfo, CommentStream.str(), LVP);
+                                *DT->SubtargetInfo, CommentStream.str(),
+                                ChunkLVP);
         Comments.clear();
 
         if (BTF)
-          printBTFRelocation(FOS, *BTF, {Index, Section.getIndex()}, LVP);
+          printBTFRelocation(FOS, *BTF, {Index, Section.getIndex()}, ChunkLVP);
 
         // Hexagon handles relocs in pretty printer
         if (InlineRelocs && Obj.getArch() != Triple::hexagon) {
@@ -2521,14 +2488,181 @@ disassembleObject(ObjectFile &Obj, const ObjectFile &DbgObj,
 
             printRelocation(FOS, Obj.getFileName(), *RelCur,
                             SectionAddr + RelOffset, Is64Bits);
-            LVP.printAfterOtherLine(FOS, true);
+            ChunkLVP.printAfterOtherLine(FOS, true);
             ++RelCur;
           }
         }
 
         Index += Size;
       }
+    };
+
+    // Chunks to be disassembled in parallel, and the size of their code.
+    std::vector<SymbolChunk> Batch;
+    uint64_t BatchSize = 0;
+
+    // Disassemble the chunks of Batch on the thread pool, each thread with
+    // disassemblers of its own, and print them in address order.
+    auto DisassembleBatch = [&]() {
+      size_t NumWorkers = std::min<size_t>(ThreadCount, Batch.size());
+      while (ThreadTargets.size() < NumWorkers) {
+        SubtargetFeatures Features(
+            PrimaryTarget.SubtargetInfo->getFeatureString());
+        auto &Target = ThreadTargets.emplace_back(
+            std::make_unique<DisassemblerTarget>(PrimaryTarget.TheTarget, Obj,
+                                                 TripleName, MCPU, Features));
+        // The options were checked when they were applied to PrimaryTarget.
+        for (StringRef Opt : DisassemblerOptions)
+          Target->InstPrinter->applyTargetSpecificCLOption(Opt);
+      }
+
+      std::vector<std::string> Texts(Batch.size());
+      std::vector<std::unique_ptr<ChunkSourcePrinter>> ChunkSPs;
+      for (const std::string &Text : Texts)
+        ChunkSPs.push_back(std::make_unique<ChunkSourcePrinter>(SP, Text));
+      std::atomic<size_t> NextChunk(0);
+      for (size_t W = 0; W != NumWorkers; ++W) {
+        Pool->async([&, Target = ThreadTargets[W].get()] {
+          for (size_t I = NextChunk++; I < Batch.size(); I = NextChunk++) {
+            raw_string_ostream OS(Texts[I]);
+            OS.enable_colors(UseColors);
+            DisassemblerTarget *DT = Target;
+            LiveVariablePrinter ChunkLVP(*Target->Context->getRegisterInfo(),
+                                         *Target->SubtargetInfo);
+            RelocIterator RelCur = RelEnd;
+            DisassembleChunk(Batch[I], OS, *Target, DT, *ChunkSPs[I], ChunkLVP,
+                             RelCur);
+          }
+        });
+      }
+      Pool->wait();
+
+      for (const std::unique_ptr<ChunkSourcePrinter> &ChunkSP : ChunkSPs)
+        SP.printChunk(outs(), *ChunkSP, Obj.getFileName(), LVP);
+      Batch.clear();
+      BatchSize = 0;
+    };
+
+    // Loop over each chunk of code between two points where at least
+    // one symbol is defined.
+    for (size_t SI = 0, SE = Symbols.size(); SI != SE;) {
+      // Advance SI past all the symbols starting at the same address,
+      // and make an ArrayRef of them.
+      unsigned FirstSI = SI;
+      uint64_t Start = Symbols[SI].Addr;
+      ArrayRef<SymbolInfoTy> SymbolsHere;
+      while (SI != SE && Symbols[SI].Addr == Start)
+        ++SI;
+      SymbolsHere = ArrayRef<SymbolInfoTy>(&Symbols[FirstSI], SI - FirstSI);
+
+      // Get the names of all those symbols, demangled if requested. The chunk
+      // keeps them, as it may be disassembled after the loop has moved on.
+      std::vector<std::string> SymNamesHere;
+      for (const SymbolInfoTy &Symbol : SymbolsHere)
+        SymNamesHere.push_back(Demangle ? demangle(Symbol.Name)
+                                        : Symbol.Name.str());
+
+      // Distinguish ELF data from code symbols, which will be used later on to
+      // decide whether to 'disassemble' this chunk as a data declaration via
+      // dumpELFData(), or whether to treat it as code.
+      //
+      // If data _and_ code symbols are defined at the same address, the code
+      // takes priority, on the grounds that disassembling code is our main
+      // purpose here, and it would be a worse failure to _not_ interpret
+      // something that _was_ meaningful as code than vice versa.
+      //
+      // Any ELF symbol type that is not clearly data will be regarded as code.
+      // In particular, one of the uses of STT_NOTYPE is for branch targets
+      // inside functions, for which STT_FUNC would be inaccurate.
+      //
+      // So here, we spot whether there's any non-data symbol present at all,
+      // and only set the DisassembleAsELFData flag if there isn't. Also, we use
+      // this distinction to inform the decision of which symbol to print at
+      // the head of the section, so that if we're printing code, we print a
+      // code-related symbol name to go with it.
+      bool DisassembleAsELFData = false;
+      size_t DisplaySymIndex = SymbolsHere.size() - 1;
+      if (Obj.isELF() && !DisassembleAll && Section.isText()) {
+        DisassembleAsELFData = true; // unless we find a code symbol below
+
+        for (size_t i = 0; i < SymbolsHere.size(); ++i) {
+          uint8_t SymTy = SymbolsHere[i].Type;
+          if (SymTy != ELF::STT_OBJECT && SymTy != ELF::STT_COMMON) {
+            DisassembleAsELFData = false;
+            DisplaySymIndex = i;
+          }
+        }
+      }
+
+      // Decide which symbol(s) from this collection we're going to print.
+      std::vector<bool> SymsToPrint(SymbolsHere.size(), false);
+      // If the user has given the --disassemble-symbols option, then we must
+      // display every symbol in that set, and no others.
+      if (!DisasmSymbolSet.empty()) {
+        bool FoundAny = false;
+        for (size_t i = 0; i < SymbolsHere.size(); ++i) {
+          if (DisasmSymbolSet.count(SymNamesHere[i])) {
+            SymsToPrint[i] = true;
+            FoundAny = true;
+          }
+        }
+
+        // And if none of the symbols here is one that the user asked for, skip
+        // disassembling this entire chunk of code.
+        if (!FoundAny)
+          continue;
+      } else if (!SymbolsHere[DisplaySymIndex].IsMappingSymbol) {
+        // Otherwise, print whichever symbol at this location is last in the
+        // Symbols array, because that array is pre-sorted in a way intended to
+        // correlate with priority of which symbol to display.
+        SymsToPrint[DisplaySymIndex] = true;
+      }
+
+      // Now that we know we're disassembling this section, override the choice
+      // of which symbols to display by printing _all_ of them at this address
+      // if the user asked for all symbols.
+      //
+      // That way, '--show-all-symbols --disassemble-symbol=foo' will print
+      // only the chunk of code headed by 'foo', but also show any other
+      // symbols defined at that address, such as aliases for 'foo', or the ARM
+      // mapping symbol preceding its code.
+      if (ShowAllSymbols) {
+        for (size_t i = 0; i < SymbolsHere.size(); ++i)
+          SymsToPrint[i] = true;
+      }
+
+      if (Start < SectionAddr || StopAddress <= Start)
+        continue;
+
+      for (size_t i = 0; i < SymbolsHere.size(); ++i)
+        FoundDisasmSymbolSet.insert(SymNamesHere[i]);
+
+      // The end is the section end, the beginning of the next symbol, or
+      // --stop-address.
+      uint64_t End = std::min<uint64_t>(SectionAddr + SectSize, StopAddress);
+      if (SI < SE)
+        End = std::min(End, Symbols[SI].Addr);
+      if (Start >= End || End <= StartAddress)
+        continue;
+      Start -= SectionAddr;
+      End -= SectionAddr;
+
+      SymbolChunk Chunk{SymbolsHere, std::move(SymNamesHere),
+                        std::move(SymsToPrint), DisassembleAsELFData,
+                        /*PrintSectionHeader=*/!PrintedSection, Start, End};
+      PrintedSection = true;
+      if (!DisassembleInParallel) {
+        DisassembleChunk(Chunk, outs(), PrimaryTarget, CurrentTarget, SP, LVP,
+                         SectionRelCur);
+        continue;
+      }
+      BatchSize += End - Start;
+      Batch.push_back(std::move(Chunk));
+      if (BatchSize >= ParallelBatchSize)
+        DisassembleBatch();
     }
+    if (!Batch.empty())
+      DisassembleBatch();
   }
   StringSet<> MissingDisasmSymbolSet =
       set_difference(DisasmSymbolSet, FoundDisasmSymbolSet);
@@ -3543,6 +3677,7 @@ static void parseObjdumpOptions(const llvm::opt::InputArgList &InputArgs) {
   MAttrs = commaSeparatedValues(InputArgs, OBJDUMP_mattr_EQ);
   ShowRawInsn = !InputArgs.hasArg(OBJDUMP_no_show_raw_insn);
   LeadingAddr = !InputArgs.hasArg(OBJDUMP_no_leading_addr);
+  parseIntArg(InputArgs, OBJDUMP_num_threads_EQ, NumThreads);
   RawClangAST = InputArgs.hasArg(OBJDUMP_raw_clang_ast);
   Relocations = InputArgs.hasArg(OBJDUMP_reloc);
   PrintImmHex =
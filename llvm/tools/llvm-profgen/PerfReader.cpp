@@ -11,6 +11,7 @@
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 
 #define DEBUG_TYPE "perf-reader"
@@ -47,6 +48,17 @@ static cl::opt<int> CSProfMaxUnsymbolizedCtxDepth(
     cl::desc("Keep the last K contexts while merging unsymbolized profile. -1 "
              "means no depth limit."));
 
+static cl::opt<unsigned> NumThreads(
+    "num-threads", cl::init(1),
+    cl::desc("Number of threads used to parse chunks of the perf script and "
+             "to unwind hybrid samples (default = 1, 0 = one per hardware "
+             "thread)"));
+
+static cl::opt<unsigned> TraceChunkLines(
+    "trace-chunk-lines", cl::init(16384), cl::Hidden,
+    cl::desc("Number of perf script lines parsed by one task when "
+             "--num-threads is not 1, rounded up to the end of a sample"));
+
 extern cl::opt<std::string> PerfTraceFilename;
 extern cl::opt<bool> ShowDisassemblyOnly;
 extern cl::opt<bool> ShowSourceLocations;
@@ -203,6 +215,8 @@ void VirtualUnwinder::collectSamplesFromFrame(UnwindState::ProfiledFrame *Cur,
   if (Key == nullptr)
     return;
   auto Ret = CtxCounterMap->emplace(Hashable<ContextKey>(Key), SampleCounter());
+  if (Ret.second && NewContexts)
+    NewContexts->push_back(&*Ret.first);
   SampleCounter &SCounter = Ret.first->second;
   for (auto &I : Cur->RangeSamples)
     SCounter.recordRangeCount(std::get<0>(I), std::get<1>(I), std::get<2>(I));
@@ -532,11 +546,76 @@ static std::string getContextKeyStr(ContextKey *K,
   }
 }
 
+void HybridPerfReader::unwindSamplesInParallel(VirtualUnwinder &Unwinder,
+                                               unsigned NumSlices) {
+  std::vector<const AggregatedCounter::value_type *> Samples;
+  Samples.reserve(AggregatedSamples.size());
+  for (const auto &Item : AggregatedSamples)
+    Samples.push_back(&Item);
+
+  // Each slice of consecutive samples is unwound into its own counters, and
+  // the contexts are merged slice by slice in the order they were created so
+  // that the counter map ends up as if the samples were unwound in one go.
+  struct UnwoundSlice {
+    ContextSampleCounterMap Counters;
+    std::vector<ContextSampleCounterMap::value_type *> NewContexts;
+    std::unique_ptr<VirtualUnwinder> Unwinder;
+  };
+  NumSlices = std::min<size_t>(NumSlices, Samples.size());
+  std::vector<UnwoundSlice> Slices(NumSlices);
+  DefaultThreadPool Pool(hardware_concurrency(NumThreads));
+  for (unsigned I = 0; I < NumSlices; ++I) {
+    Pool.async([&, I]() {
+      UnwoundSlice &Slice = Slices[I];
+      Slice.Unwinder =
+          std::make_unique<VirtualUnwinder>(&Slice.Counters, Binary);
+      Slice.Unwinder->NewContexts = &Slice.NewContexts;
+      size_t Begin = Samples.size() * I / NumSlices;
+      size_t End = Samples.size() * (I + 1) / NumSlices;
+      for (size_t J = Begin; J < End; ++J)
+        Slice.Unwinder->unwind(Samples[J]->first.getPtr(), Samples[J]->second);
+    });
+  }
+  Pool.wait();
+
+  for (UnwoundSlice &Slice : Slices) {
+    for (auto *Item : Slice.NewContexts) {
+      SampleCounter &SCounter =
+          SampleCounters.emplace(Item->first, SampleCounter()).first->second;
+      for (const auto &Range : Item->second.RangeCounter)
+        SCounter.RangeCounter[Range.first] += Range.second;
+      for (const auto &Branch : Item->second.BranchCounter)
+        SCounter.BranchCounter[Branch.first] += Branch.second;
+    }
+    VirtualUnwinder &SliceUnwinder = *Slice.Unwinder;
+    Unwinder.getUntrackedCallsites().insert(
+        SliceUnwinder.getUntrackedCallsites().begin(),
+        SliceUnwinder.getUntrackedCallsites().end());
+    Unwinder.NumTotalBranches += SliceUnwinder.NumTotalBranches;
+    Unwinder.NumExtCallBranch += SliceUnwinder.NumExtCallBranch;
+    Unwinder.NumMissingExternalFrame += SliceUnwinder.NumMissingExternalFrame;
+    Unwinder.NumMismatchedProEpiBranch +=
+        SliceUnwinder.NumMismatchedProEpiBranch;
+    Unwinder.NumMismatchedExtCallBranch +=
+        SliceUnwinder.NumMismatchedExtCallBranch;
+    Unwinder.NumUnpairedExtAddr += SliceUnwinder.NumUnpairedExtAddr;
+    Unwinder.NumPairedExtAddr += SliceUnwinder.NumPairedExtAddr;
+  }
+}
+
 void HybridPerfReader::unwindSamples() {
   VirtualUnwinder Unwinder(&SampleCounters, Binary);
-  for (const auto &Item : AggregatedSamples) {
-    const PerfSample *Sample = Item.first.getPtr();
-    Unwinder.unwind(Sample, Item.second);
+  // Without pseudo probes, unwinding symbolizes addresses to split ranges by
+  // inline context, which goes through caches of the binary that are not
+  // thread-safe. Unwinding with pseudo probes only reads the binary.
+  unsigned Threads = hardware_concurrency(NumThreads).compute_thread_count();
+  if (Threads > 1 && Binary->usePseudoProbes()) {
+    unwindSamplesInParallel(Unwinder, Threads * 4);
+  } else {
+    for (const auto &Item : AggregatedSamples) {
+      const PerfSample *Sample = Item.first.getPtr();
+      Unwinder.unwind(Sample, Item.second);
+    }
   }
 
   // Warn about untracked frames due to missing probes.
@@ -577,17 +656,18 @@ void HybridPerfReader::unwindSamples() {
 }
 
 bool PerfScriptReader::extractLBRStack(TraceStream &TraceIt,
-                                       SmallVectorImpl<LBREntry> &LBRStack) {
+                                       SmallVectorImpl<LBREntry> &LBRStack,
+                                       SampleAggregation &Aggregation) {
   // The raw format of LBR stack is like:
   // 0x4005c8/0x4005dc/P/-/-/0 0x40062f/0x4005b0/P/-/-/0 ...
   //                           ... 0x4005c8/0x4005dc/P/-/-/0
   // It's in FIFO order and separated by whitespace.
   SmallVector<StringRef, 32> Records;
   TraceIt.getCurrentLine().rtrim().split(Records, " ", -1, false);
-  auto WarnInvalidLBR = [](TraceStream &TraceIt) {
-    WithColor::warning() << "Invalid address in LBR record at line "
-                         << TraceIt.getLineNumber() << ": "
-                         << TraceIt.getCurrentLine() << "\n";
+  auto WarnInvalidLBR = [&](TraceStream &TraceIt) {
+    Aggregation.warning() << "Invalid address in LBR record at line "
+                          << TraceIt.getLineNumber() << ": "
+                          << TraceIt.getCurrentLine() << "\n";
   };
 
   // Skip the leading instruction pointer.
@@ -642,7 +722,8 @@ bool PerfScriptReader::extractLBRStack(TraceStream &TraceIt,
 }
 
 bool PerfScriptReader::extractCallstack(TraceStream &TraceIt,
-                                        SmallVectorImpl<uint64_t> &CallStack) {
+                                        SmallVectorImpl<uint64_t> &CallStack,
+                                        SampleAggregation &Aggregation) {
   // The raw format of call stack is like:
   //            4005dc      # leaf frame
   //	          400634
@@ -665,7 +746,7 @@ bool PerfScriptReader::extractCallstack(TraceStream &TraceIt,
     // Currently intermixed frame from different binaries is not supported.
     if (!Binary->addressIsCode(FrameAddr)) {
       if (CallStack.empty())
-        NumLeafExternalFrame++;
+        Aggregation.NumLeafExternalFrame++;
       // Push a special value(ExternalAddr) for the external frames so that
       // unwinder can still work on this with artificial Call/Return branch.
       // After unwinding, the context will be truncated for external frame.
@@ -682,7 +763,7 @@ bool PerfScriptReader::extractCallstack(TraceStream &TraceIt,
         // Stop at an invalid return address caused by bad unwinding. This could
         // happen to frame-pointer-based unwinding and the callee functions that
         // do not have the frame pointer chain set up.
-        InvalidReturnAddresses.insert(FrameAddr);
+        Aggregation.InvalidReturnAddresses.insert(FrameAddr);
         break;
       }
       FrameAddr = CallAddr;
@@ -726,7 +807,29 @@ void PerfScriptReader::warnIfMissingMMap() {
   }
 }
 
-void HybridPerfReader::parseSample(TraceStream &TraceIt, uint64_t Count) {
+void PerfScriptReader::warnIfMissingMMap(SampleAggregation &Aggregation) {
+  if (!Aggregation.WarningOS) {
+    warnIfMissingMMap();
+    return;
+  }
+  if (!Aggregation.MissingMMapWarningPos)
+    Aggregation.MissingMMapWarningPos = Aggregation.WarningOS->tell();
+}
+
+void PerfScriptReader::SampleAggregation::addSample(
+    const std::shared_ptr<PerfSample> &Sample, uint64_t Count) {
+  auto Ret = Samples.try_emplace(Hashable<PerfSample>(Sample), 0);
+  Ret.first->second += Count;
+  if (Ret.second && TrackOrder)
+    SampleOrder.push_back(&*Ret.first);
+}
+
+raw_ostream &PerfScriptReader::SampleAggregation::warning() {
+  return WarningOS ? WithColor::warning(*WarningOS) : WithColor::warning();
+}
+
+void HybridPerfReader::parseSample(TraceStream &TraceIt, uint64_t Count,
+                                   SampleAggregation &Aggregation) {
   // The raw hybird sample started with call stack in FILO order and followed
   // intermediately by LBR sample
   // e.g.
@@ -741,18 +844,18 @@ void HybridPerfReader::parseSample(TraceStream &TraceIt, uint64_t Count) {
   Sample->Linenum = TraceIt.getLineNumber();
 #endif
   // Parsing call stack and populate into PerfSample.CallStack
-  if (!extractCallstack(TraceIt, Sample->CallStack)) {
+  if (!extractCallstack(TraceIt, Sample->CallStack, Aggregation)) {
     // Skip the next LBR line matched current call stack
     if (!TraceIt.isAtEoF() && TraceIt.getCurrentLine().starts_with(" 0x"))
       TraceIt.advance();
     return;
   }
 
-  warnIfMissingMMap();
+  warnIfMissingMMap(Aggregation);
 
   if (!TraceIt.isAtEoF() && TraceIt.getCurrentLine().starts_with(" 0x")) {
     // Parsing LBR stack and populate into PerfSample.LBRStack
-    if (extractLBRStack(TraceIt, Sample->LBRStack)) {
+    if (extractLBRStack(TraceIt, Sample->LBRStack, Aggregation)) {
       if (IgnoreStackSamples) {
         Sample->CallStack.clear();
       } else {
@@ -761,7 +864,7 @@ void HybridPerfReader::parseSample(TraceStream &TraceIt, uint64_t Count) {
         Sample->CallStack.front() = Sample->LBRStack[0].Target;
       }
       // Record samples by aggregation
-      AggregatedSamples[Hashable<PerfSample>(Sample)] += Count;
+      Aggregation.addSample(Sample, Count);
     }
   } else {
     // LBR sample is encoded in single line after stack sample
@@ -941,13 +1044,14 @@ void PerfScriptReader::computeCounterFromLBR(const PerfSample *Sample,
   }
 }
 
-void LBRPerfReader::parseSample(TraceStream &TraceIt, uint64_t Count) {
+void LBRPerfReader::parseSample(TraceStream &TraceIt, uint64_t Count,
+                                SampleAggregation &Aggregation) {
   std::shared_ptr<PerfSample> Sample = std::make_shared<PerfSample>();
   // Parsing LBR stack and populate into PerfSample.LBRStack
-  if (extractLBRStack(TraceIt, Sample->LBRStack)) {
-    warnIfMissingMMap();
+  if (extractLBRStack(TraceIt, Sample->LBRStack, Aggregation)) {
+    warnIfMissingMMap(Aggregation);
     // Record LBR only samples by aggregation
-    AggregatedSamples[Hashable<PerfSample>(Sample)] += Count;
+    Aggregation.addSample(Sample, Count);
   }
 }
 
@@ -974,11 +1078,12 @@ uint64_t PerfScriptReader::parseAggregatedCount(TraceStream &TraceIt) {
   return Count;
 }
 
-void PerfScriptReader::parseSample(TraceStream &TraceIt) {
-  NumTotalSample++;
+void PerfScriptReader::parseSample(TraceStream &TraceIt,
+                                   SampleAggregation &Aggregation) {
+  Aggregation.NumTotalSample++;
   uint64_t Count = parseAggregatedCount(TraceIt);
   assert(Count >= 1 && "Aggregated count should be >= 1!");
-  parseSample(TraceIt, Count);
+  parseSample(TraceIt, Count, Aggregation);
 }
 
 bool PerfScriptReader::extractMMapEventForBinary(ProfiledBinary *Binary,
@@ -1055,18 +1160,106 @@ void PerfScriptReader::parseMMapEvent(TraceStream &TraceIt) {
   TraceIt.advance();
 }
 
-void PerfScriptReader::parseEventOrSample(TraceStream &TraceIt) {
+void PerfScriptReader::parseEventOrSample(TraceStream &TraceIt,
+                                          SampleAggregation &Aggregation) {
   if (isMMapEvent(TraceIt.getCurrentLine()))
     parseMMapEvent(TraceIt);
   else
-    parseSample(TraceIt);
+    parseSample(TraceIt, Aggregation);
+}
+
+PerfScriptReader::TraceChunk
+PerfScriptReader::readTraceChunk(TraceStream &TraceIt) {
+  TraceChunk Chunk;
+  Chunk.FirstLineNumber = TraceIt.getLineNumber();
+  Chunk.Aggregation.TrackOrder = true;
+  bool EndsAtSample = readTraceLines(
+      TraceIt, [this](StringRef Line) { return isLastLineOfSample(Line); },
+      TraceChunkLines, Chunk.Lines);
+  Chunk.IsSerial =
+      !EndsAtSample || llvm::any_of(Chunk.Lines, [](const std::string &Line) {
+        return isMMapEvent(Line);
+      });
+  return Chunk;
+}
+
+void PerfScriptReader::parseTraceChunk(TraceChunk &Chunk) {
+  raw_string_ostream WarningOS(Chunk.Warnings);
+  Chunk.Aggregation.WarningOS = &WarningOS;
+  TraceStream TraceIt(Chunk.Lines, Chunk.FirstLineNumber);
+  while (!TraceIt.isAtEoF())
+    parseEventOrSample(TraceIt, Chunk.Aggregation);
+  Chunk.Aggregation.WarningOS = nullptr;
+}
+
+void PerfScriptReader::mergeAggregation(SampleAggregation &Aggregation,
+                                        StringRef Warnings) {
+  if (Aggregation.TrackOrder) {
+    for (auto *Item : Aggregation.SampleOrder)
+      AggregatedSamples[Item->first] += Item->second;
+  } else {
+    assert(AggregatedSamples.empty() &&
+           "Untracked samples must be the first to merge");
+    AggregatedSamples = std::move(Aggregation.Samples);
+  }
+  InvalidReturnAddresses.insert(Aggregation.InvalidReturnAddresses.begin(),
+                                Aggregation.InvalidReturnAddresses.end());
+  NumTotalSample += Aggregation.NumTotalSample;
+  NumLeafExternalFrame += Aggregation.NumLeafExternalFrame;
+
+  if (Aggregation.MissingMMapWarningPos) {
+    errs() << Warnings.take_front(*Aggregation.MissingMMapWarningPos);
+    Warnings = Warnings.drop_front(*Aggregation.MissingMMapWarningPos);
+    warnIfMissingMMap();
+  }
+  errs() << Warnings;
 }
 
 void PerfScriptReader::parseAndAggregateTrace() {
   // Trace line iterator
   TraceStream TraceIt(PerfTraceFile);
-  while (!TraceIt.isAtEoF())
-    parseEventOrSample(TraceIt);
+  ThreadPoolStrategy Strategy = hardware_concurrency(NumThreads);
+  if (Strategy.compute_thread_count() <= 1) {
+    SampleAggregation Aggregation;
+    while (!TraceIt.isAtEoF())
+      parseEventOrSample(TraceIt, Aggregation);
+    mergeAggregation(Aggregation);
+    return;
+  }
+
+  // Split the trace into chunks at sample boundaries and parse a batch of
+  // chunks concurrently. The chunks are merged in trace order, which gives
+  // the same samples, statistics and warnings as parsing them one by one.
+  DefaultThreadPool Pool(Strategy);
+  const size_t BatchSize = 4 * Pool.getMaxConcurrency();
+  std::vector<TraceChunk> Batch;
+  Batch.reserve(BatchSize);
+  auto ParseBatch = [&]() {
+    for (TraceChunk &Chunk : Batch)
+      Pool.async([this, &Chunk]() { parseTraceChunk(Chunk); });
+    Pool.wait();
+    for (TraceChunk &Chunk : Batch)
+      mergeAggregation(Chunk.Aggregation, Chunk.Warnings);
+    Batch.clear();
+  };
+
+  while (!TraceIt.isAtEoF()) {
+    TraceChunk Chunk = readTraceChunk(TraceIt);
+    if (!Chunk.IsSerial) {
+      Batch.push_back(std::move(Chunk));
+      if (Batch.size() == BatchSize)
+        ParseBatch();
+      continue;
+    }
+    // The samples after an mmap event depend on the base address it sets, so
+    // finish the chunks before it and parse this one here.
+    ParseBatch();
+    TraceStream ChunkIt(Chunk.Lines, Chunk.FirstLineNumber);
+    while (!ChunkIt.isAtEoF())
+      parseEventOrSample(ChunkIt, Chunk.Aggregation);
+    mergeAggregation(Chunk.Aggregation);
+  }
+  ParseBatch();
 }
 
 // A LBR sample is like:
@@ -10,6 +10,7 @@
 #define LLVM_TOOLS_LLVM_PROFGEN_PERFREADER_H
 #include "ErrorHandling.h"
 #include "ProfiledBinary.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Regex.h"
@@ -30,6 +31,11 @@ namespace sampleprof {
 class TraceStream {
   std::string CurrentLine;
   std::ifstream Fin;
+  // Lines already read into memory, used instead of the file when iterating
+  // over a chunk of a trace.
+  ArrayRef<std::string> Lines;
+  size_t NextLine = 0;
+  bool IsInMemory = false;
   bool IsAtEoF = false;
   uint64_t LineNumber = 0;
 
@@ -40,8 +46,16 @@ public:
     advance();
   }
 
+  // Iterate over a chunk of a trace whose first line is at \p FirstLineNumber.
+  TraceStream(ArrayRef<std::string> Lines, uint64_t FirstLineNumber)
+      : Lines(Lines), IsInMemory(true), LineNumber(FirstLineNumber - 1) {
+    advance();
+  }
+
   StringRef getCurrentLine() {
     assert(!IsAtEoF && "Line iterator reaches the End-of-File!");
+    if (IsInMemory)
+      return Lines[NextLine - 1];
     return CurrentLine;
   }
 
@@ -51,14 +65,35 @@ public:
 
   // Read the next line
   void advance() {
-    if (!std::getline(Fin, CurrentLine)) {
+    if (IsInMemory ? NextLine == Lines.size()
+                   : !std::getline(Fin, CurrentLine)) {
       IsAtEoF = true;
       return;
     }
+    if (IsInMemory)
+      NextLine++;
     LineNumber++;
   }
 };
 
+// Move lines from \p TraceIt to \p Lines until at least \p MinLines were
+// moved and the last one ends a sample, as told by \p IsLastLineOfSample.
+// Returns false if the trace ended first, in which case the last sample may be
+// incomplete.
+inline bool readTraceLines(TraceStream &TraceIt,
+                           function_ref<bool(StringRef)> IsLastLineOfSample,
+                           size_t MinLines, std::vector<std::string> &Lines) {
+  while (!TraceIt.isAtEoF()) {
+    StringRef Line = TraceIt.getCurrentLine();
+    bool IsLastLine = IsLastLineOfSample(Line);
+    Lines.push_back(Line.str());
+    TraceIt.advance();
+    if (IsLastLine && Lines.size() >= MinLines)
+      return true;
+  }
+  return false;
+}
+
 // The type of input format.
 enum PerfFormat {
   UnknownFormat = 0,
@@ -486,6 +521,10 @@ public:
   uint64_t NumUnpairedExtAddr = 0;
   uint64_t NumPairedExtAddr = 0;
 
+  // If set, the counters of contexts seen for the first time are appended to
+  // it in the order the contexts are created.
+  std::vector<ContextSampleCounterMap::value_type *> *NewContexts = nullptr;
+
 private:
   bool isSourceExternal(UnwindState &State) const {
     return State.getCurrentLBRSource() == ExternalAddr;
@@ -622,6 +661,42 @@ protected:
     StringRef BinaryPath;
   };
 
+  // Samples and statistics aggregated while parsing perf script lines. A
+  // chunk of the script parsed on a worker thread aggregates into its own
+  // instance, which is then merged into the reader in trace order.
+  struct SampleAggregation {
+    // Samples with the repeating time generated by the perf reader
+    AggregatedCounter Samples;
+    // Whether to keep the distinct samples in the order they are first seen,
+    // which is needed to merge them after the samples parsed earlier.
+    bool TrackOrder = false;
+    std::vector<AggregatedCounter::value_type *> SampleOrder;
+    // Keep track of all invalid return addresses
+    std::set<uint64_t> InvalidReturnAddresses;
+    uint64_t NumTotalSample = 0;
+    uint64_t NumLeafExternalFrame = 0;
+    // If set, warnings are buffered here instead of being printed.
+    raw_ostream *WarningOS = nullptr;
+    // Offset in the buffered warnings at which the missing mmap warning
+    // belongs, left to the merge since only the first one is printed.
+    std::optional<uint64_t> MissingMMapWarningPos;
+
+    void addSample(const std::shared_ptr<PerfSample> &Sample, uint64_t Count);
+    raw_ostream &warning();
+  };
+
+  // A range of perf script lines that ends with the last line of a sample.
+  struct TraceChunk {
+    std::vector<std::string> Lines;
+    uint64_t FirstLineNumber = 0;
+    // Chunks with mmap events update the binary's base address that the
+    // following samples depend on, and the last chunk may end in the middle
+    // of a sample. Both are parsed in order by the reader itself.
+    bool IsSerial = false;
+    SampleAggregation Aggregation;
+    std::string Warnings;
+  };
+
   // Check whether a given line is LBR sample
   static bool isLBRSample(StringRef Line);
   // Check whether a given line is MMAP event
@@ -636,27 +711,42 @@ protected:
   void parseMMapEvent(TraceStream &TraceIt);
   // Parse perf events/samples and do aggregation
   void parseAndAggregateTrace();
+  // Read the lines of the next chunk of the trace.
+  TraceChunk readTraceChunk(TraceStream &TraceIt);
+  // Parse a chunk without mmap events, safe to call concurrently.
+  void parseTraceChunk(TraceChunk &Chunk);
+  // Merge the samples parsed from the next range of the trace.
+  void mergeAggregation(SampleAggregation &Aggregation,
+                        StringRef Warnings = StringRef());
   // Parse either an MMAP event or a perf sample
-  void parseEventOrSample(TraceStream &TraceIt);
+  void parseEventOrSample(TraceStream &TraceIt,
+                          SampleAggregation &Aggregation);
+  // Whether a sample can end with the given line, where the trace can be
+  // split into chunks.
+  virtual bool isLastLineOfSample(StringRef Line) const { return false; }
   // Warn if the relevant mmap event is missing.
   void warnIfMissingMMap();
+  void warnIfMissingMMap(SampleAggregation &Aggregation);
   // Emit accumulate warnings.
   void warnTruncatedStack();
   // Warn if range is invalid.
   void warnInvalidRange();
   // Extract call stack from the perf trace lines
   bool extractCallstack(TraceStream &TraceIt,
-                        SmallVectorImpl<uint64_t> &CallStack);
+                        SmallVectorImpl<uint64_t> &CallStack,
+                        SampleAggregation &Aggregation);
   // Extract LBR stack from one perf trace line
   bool extractLBRStack(TraceStream &TraceIt,
-                       SmallVectorImpl<LBREntry> &LBRStack);
+                       SmallVectorImpl<LBREntry> &LBRStack,
+                       SampleAggregation &Aggregation);
   uint64_t parseAggregatedCount(TraceStream &TraceIt);
   // Parse one sample from multiple perf lines, override this for different
   // sample type
-  void parseSample(TraceStream &TraceIt);
+  void parseSample(TraceStream &TraceIt, SampleAggregation &Aggregation);
   // An aggregated count is given to indicate how many times the sample is
   // repeated.
-  virtual void parseSample(TraceStream &TraceIt, uint64_t Count){};
+  virtual void parseSample(TraceStream &TraceIt, uint64_t Count,
+                           SampleAggregation &Aggregation){};
   void computeCounterFromLBR(const PerfSample *Sample, uint64_t Repeat);
   // Post process the profile after trace aggregation, we will do simple range
   // overlap computation for AutoFDO, or unwind for CSSPGO(hybrid sample).
@@ -684,7 +774,16 @@ public:
                 std::optional<int32_t> PID)
       : PerfScriptReader(Binary, PerfTrace, PID) {};
   // Parse the LBR only sample.
-  void parseSample(TraceStream &TraceIt, uint64_t Count) override;
+  void parseSample(TraceStream &TraceIt, uint64_t Count,
+                   SampleAggregation &Aggregation) override;
+  // A sample is an optional count line followed by the LBR line.
+  static bool isLastLineOfLBRSample(StringRef Line) {
+    uint64_t Count;
+    return Line.getAsInteger(10, Count);
+  }
+  bool isLastLineOfSample(StringRef Line) const override {
+    return isLastLineOfLBRSample(Line);
+  }
 };
 
 /*
@@ -702,12 +801,23 @@ public:
                    std::optional<int32_t> PID)
       : PerfScriptReader(Binary, PerfTrace, PID) {};
   // Parse the hybrid sample including the call and LBR line
-  void parseSample(TraceStream &TraceIt, uint64_t Count) override;
+  void parseSample(TraceStream &TraceIt, uint64_t Count,
+                   SampleAggregation &Aggregation) override;
+  // A line with LBR entries always ends the sample it belongs to, even a
+  // malformed one.
+  static bool isLastLineOfHybridSample(StringRef Line) {
+    return Line.starts_with(" 0x");
+  }
+  bool isLastLineOfSample(StringRef Line) const override {
+    return isLastLineOfHybridSample(Line);
+  }
   void generateUnsymbolizedProfile() override;
 
 private:
   // Unwind the hybrid samples after aggregration
   void unwindSamples();
+  // Unwind slices of the samples concurrently, merging into \p Unwinder.
+  void unwindSamplesInParallel(VirtualUnwinder &Unwinder, unsigned NumSlices);
 };
 
 /*
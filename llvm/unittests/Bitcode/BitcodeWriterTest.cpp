@@ -0,0 +1,116 @@
+//===- llvm/unittest/Bitcode/BitcodeWriterTest.cpp - Tests for writer -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+std::unique_ptr<Module> parseAssembly(LLVMContext &Context,
+                                      StringRef Assembly) {
+  SMDiagnostic Error;
+  std::unique_ptr<Module> M = parseAssemblyString(Assembly, Error, Context);
+  std::string ErrMsg;
+  raw_string_ostream OS(ErrMsg);
+  Error.print("", OS);
+  if (!M)
+    report_fatal_error(Twine(ErrMsg));
+  return M;
+}
+
+// A module with enough functions of varying size to be split into several
+// shards, with calls, globals, constants and debug locations shared between
+// them.
+std::string makeModule() {
+  std::string IR = R"(
+@g = global i32 0
+@str = private constant [6 x i8] c"hello\00"
+
+declare i32 @ext(i32, ptr)
+)";
+  for (unsigned I = 0; I != 24; ++I) {
+    std::string N = std::to_string(I);
+    IR += "define i32 @f" + N + "(i32 %x) !dbg !" + std::to_string(I + 10) +
+          " {\nentry:\n";
+    for (unsigned J = 0; J != I % 5 + 1; ++J) {
+      std::string V = "%v" + std::to_string(J);
+      std::string Prev = J ? "%v" + std::to_string(J - 1) : "%x";
+      IR += "  " + V + " = add i32 " + Prev + ", " + std::to_string(I * J) +
+            ", !dbg !" + std::to_string(I + 100) + "\n";
+    }
+    IR += "  %l = load i32, ptr @g\n"
+          "  %c = call i32 @ext(i32 %l, ptr @str)\n"
+          "  ret i32 %c\n}\n";
+  }
+  IR += R"(
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "test", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "t.c", directory: "/")
+!2 = !DISubroutineType(types: !{})
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = !{i32 7, !"Dwarf Version", i32 5}
+)";
+  for (unsigned I = 0; I != 24; ++I) {
+    std::string N = std::to_string(I);
+    std::string Line = std::to_string(I + 1);
+    IR += "!" + std::to_string(I + 10) + " = distinct !DISubprogram(name: \"f" +
+          N + "\", scope: !1, file: !1, line: " + Line +
+          ", type: !2, spFlags: DISPFlagDefinition, unit: !0)\n";
+    IR += "!" + std::to_string(I + 100) + " = !DILocation(line: " + Line +
+          ", scope: !" + std::to_string(I + 10) + ")\n";
+  }
+  return IR;
+}
+
+SmallString<0> writeModule(const Module &M, unsigned Threads) {
+  auto *Opt = static_cast<cl::opt<unsigned> *>(
+      cl::getRegisteredOptions()["bitcode-function-block-threads"]);
+  EXPECT_TRUE(Opt);
+  *Opt = Threads;
+  SmallString<0> Buffer;
+  raw_svector_ostream OS(Buffer);
+  WriteBitcodeToFile(M, OS, /*ShouldPreserveUseListOrder=*/false,
+                     /*Index=*/nullptr, /*GenerateHash=*/true);
+  *Opt = 1;
+  return Buffer;
+}
+
+TEST(BitcodeWriterTest, ParallelFunctionBlocksMatchSerial) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseAssembly(Context, makeModule());
+
+  SmallString<0> Serial = writeModule(*M, 1);
+  for (unsigned Threads : {2, 3, 4, 8}) {
+    SmallString<0> Parallel = writeModule(*M, Threads);
+    EXPECT_EQ(Serial.str(), Parallel.str()) << Threads << " threads";
+  }
+
+  // The sharded output also reads back as the same module.
+  LLVMContext ReadContext;
+  Expected<std::unique_ptr<Module>> Read = parseBitcodeFile(
+      MemoryBufferRef(writeModule(*M, 4).str(), "parallel"), ReadContext);
+  ASSERT_TRUE(!!Read) << toString(Read.takeError());
+  (*Read)->setModuleIdentifier(M->getModuleIdentifier());
+  std::string Original, RoundTrip;
+  raw_string_ostream(Original) << *M;
+  raw_string_ostream(RoundTrip) << **Read;
+  EXPECT_EQ(Original, RoundTrip);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,176 @@
+//===- llvm/unittests/DWP/DWPTest.cpp -------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DWP/DWP.h"
+#include "llvm/ADT/CachedHashString.h"
+#include "llvm/MC/MCAsmBackend.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCCodeEmitter.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCInstrInfo.h"
+#include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCObjectWriter.h"
+#include "llvm/MC/MCRegisterInfo.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/MCTargetOptions.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetSelect.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class DWPStringsTest : public ::testing::Test {
+protected:
+  const char *TripleName = "x86_64-pc-linux";
+  const Target *TheTarget = nullptr;
+  std::unique_ptr<MCRegisterInfo> MRI;
+  std::unique_ptr<MCAsmInfo> MAI;
+  std::unique_ptr<MCSubtargetInfo> STI;
+  std::unique_ptr<MCInstrInfo> MII;
+
+  DWPStringsTest() {
+    InitializeAllTargetInfos();
+    InitializeAllTargetMCs();
+
+    std::string Error;
+    TheTarget = TargetRegistry::lookupTarget(TripleName, Error);
+    if (!TheTarget)
+      return;
+
+    MRI.reset(TheTarget->createMCRegInfo(TripleName));
+    MCTargetOptions MCOptions;
+    MAI.reset(TheTarget->createMCAsmInfo(*MRI, TripleName, MCOptions));
+    STI.reset(TheTarget->createMCSubtargetInfo(TripleName, "", ""));
+    MII.reset(TheTarget->createMCInstrInfo());
+  }
+
+  struct Input {
+    StringRef StrSection;
+    StringRef StrOffsetSection;
+  };
+
+  /// Merge the string sections of \p Inputs as llvm::write does, and return
+  /// the resulting .debug_str.dwo and .debug_str_offsets.dwo contents. If
+  /// \p Precompute is set, the strings of each input are split and hashed
+  /// ahead of time, as llvm::write does on its loading threads.
+  std::pair<std::string, std::string> merge(ArrayRef<Input> Inputs,
+                                            uint16_t Version,
+                                            bool Precompute) {
+    SmallString<0> Object;
+    {
+      raw_svector_ostream OS(Object);
+      MCContext Ctx(Triple(TripleName), MAI.get(), MRI.get(), STI.get());
+      std::unique_ptr<MCObjectFileInfo> MOFI(
+          TheTarget->createMCObjectFileInfo(Ctx, /*PIC=*/false));
+      Ctx.setObjectFileInfo(MOFI.get());
+      MCAsmBackend *MAB =
+          TheTarget->createMCAsmBackend(*STI, *MRI, MCTargetOptions());
+      std::unique_ptr<MCStreamer> Out(TheTarget->createMCObjectStreamer(
+          Triple(TripleName), Ctx, std::unique_ptr<MCAsmBackend>(MAB),
+          MAB->createObjectWriter(OS),
+          std::unique_ptr<MCCodeEmitter>(
+              TheTarget->createMCCodeEmitter(*MII, Ctx)),
+          *STI));
+
+      MCSection *StrSection = MOFI->getDwarfStrDWOSection();
+      MCSection *StrOffsetSection = MOFI->getDwarfStrOffDWOSection();
+      DWPStringPool Strings(*Out, StrSection);
+      for (const Input &In : Inputs) {
+        if (!Precompute) {
+          writeStringsAndOffsets(*Out, Strings, StrOffsetSection,
+                                 In.StrSection, In.StrOffsetSection, Version);
+          continue;
+        }
+        std::vector<CachedHashStringRef> CurStrings;
+        for (size_t Offset = 0; Offset < In.StrSection.size();) {
+          StringRef S(In.StrSection.data() + Offset);
+          CurStrings.emplace_back(S);
+          Offset += S.size() + 1;
+        }
+        writeStringsAndOffsets(*Out, Strings, StrOffsetSection, In.StrSection,
+                               CurStrings, In.StrOffsetSection, Version);
+      }
+      Out->finish();
+    }
+
+    std::unique_ptr<MemoryBuffer> MB =
+        MemoryBuffer::getMemBuffer(Object, "", /*RequiresNullTerminator=*/false);
+    Expected<std::unique_ptr<object::ObjectFile>> ObjOrErr =
+        object::ObjectFile::createObjectFile(MB->getMemBufferRef());
+    EXPECT_TRUE(bool(ObjOrErr));
+    if (!ObjOrErr) {
+      consumeError(ObjOrErr.takeError());
+      return {};
+    }
+    std::pair<std::string, std::string> Result;
+    for (const object::SectionRef &Section : (*ObjOrErr)->sections()) {
+      StringRef Name = cantFail(Section.getName());
+      if (Name == ".debug_str.dwo")
+        Result.first = cantFail(Section.getContents()).str();
+      else if (Name == ".debug_str_offsets.dwo")
+        Result.second = cantFail(Section.getContents()).str();
+    }
+    return Result;
+  }
+};
+
+} // end anonymous namespace
+
+TEST_F(DWPStringsTest, PrecomputedHashesDWARF4) {
+  if (!TheTarget)
+    GTEST_SKIP();
+
+  // Strings shared between inputs are emitted once, and the offsets of every
+  // input are rewritten to point into the merged section.
+  const char Str1[] = "a\0shared\0";
+  const char Offsets1[] = {0, 0, 0, 0, 2, 0, 0, 0};
+  const char Str2[] = "shared\0b\0";
+  const char Offsets2[] = {7, 0, 0, 0, 0, 0, 0, 0};
+  Input Inputs[] = {
+      {StringRef(Str1, sizeof(Str1) - 1), StringRef(Offsets1, sizeof(Offsets1))},
+      {StringRef(Str2, sizeof(Str2) - 1), StringRef(Offsets2, sizeof(Offsets2))}};
+
+  auto [StrSection, StrOffsetSection] =
+      merge(Inputs, /*Version=*/4, /*Precompute=*/true);
+  EXPECT_EQ(std::string("a\0shared\0b\0", 11), StrSection);
+  EXPECT_EQ(std::string("\0\0\0\0\2\0\0\0\x9\0\0\0\2\0\0\0", 16),
+            StrOffsetSection);
+
+  EXPECT_EQ(merge(Inputs, /*Version=*/4, /*Precompute=*/false),
+            std::make_pair(StrSection, StrOffsetSection));
+}
+
+TEST_F(DWPStringsTest, PrecomputedHashesDWARF5) {
+  if (!TheTarget)
+    GTEST_SKIP();
+
+  // DWARF v5 contributions start with a header that is copied as is.
+  const char Str1[] = "x\0y\0";
+  const char Offsets1[] = {12, 0, 0, 0, 5, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0};
+  const char Str2[] = "y\0z\0";
+  const char Offsets2[] = {12, 0, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0};
+  Input Inputs[] = {
+      {StringRef(Str1, sizeof(Str1) - 1), StringRef(Offsets1, sizeof(Offsets1))},
+      {StringRef(Str2, sizeof(Str2) - 1), StringRef(Offsets2, sizeof(Offsets2))}};
+
+  auto [StrSection, StrOffsetSection] =
+      merge(Inputs, /*Version=*/5, /*Precompute=*/true);
+  EXPECT_EQ(std::string("x\0y\0z\0", 6), StrSection);
+  EXPECT_EQ(std::string("\xc\0\0\0\5\0\0\0\2\0\0\0\0\0\0\0"
+                        "\xc\0\0\0\5\0\0\0\2\0\0\0\4\0\0\0",
+                        32),
+            StrOffsetSection);
+
+  EXPECT_EQ(merge(Inputs, /*Version=*/5, /*Precompute=*/false),
+            std::make_pair(StrSection, StrOffsetSection));
+}
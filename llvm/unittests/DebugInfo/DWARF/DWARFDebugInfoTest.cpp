@@ -27,6 +27,7 @@
 #include "llvm/ObjectYAML/DWARFEmitter.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/TargetParser/Triple.h"
 #include "llvm/Testing/Support/Error.h"
@@ -1466,6 +1467,82 @@ TEST(DWARFDebugInfo, TestEmptyChildren) {
   EXPECT_EQ(CUDie.begin(), CUDie.end());
 }
 
+TEST(DWARFDebugInfo, TestParallelVerifyOutputIsOrdered) {
+  // Every unit holds a reference past its end, so that each verification
+  // task reports an error. Verifying with several threads must produce the
+  // same output as verifying with one.
+  std::string yamldata = "debug_abbrev:\n"
+                         "  - Table:\n"
+                         "      - Code:            0x00000001\n"
+                         "        Tag:             DW_TAG_compile_unit\n"
+                         "        Children:        DW_CHILDREN_yes\n"
+                         "      - Code:            0x00000002\n"
+                         "        Tag:             DW_TAG_variable\n"
+                         "        Children:        DW_CHILDREN_no\n"
+                         "        Attributes:\n"
+                         "          - Attribute:       DW_AT_type\n"
+                         "            Form:            DW_FORM_ref4\n"
+                         "debug_info:\n";
+  for (unsigned I = 0; I < 8; ++I)
+    yamldata += "  - Version:         4\n"
+                "    AddrSize:        8\n"
+                "    Entries:\n"
+                "      - AbbrCode:        0x00000001\n"
+                "      - AbbrCode:        0x00000002\n"
+                "        Values:\n"
+                "          - Value:           0x0000" +
+                utohexstr(0x1000 + I) +
+                "\n"
+                "      - AbbrCode:        0x00000000\n";
+
+  auto ErrOrSections = DWARFYAML::emitDebugSections(StringRef(yamldata));
+  ASSERT_TRUE((bool)ErrOrSections);
+
+  // A string stream that claims to be a color terminal.
+  struct ColoredStringOStream : raw_string_ostream {
+    ColoredStringOStream(std::string &Str) : raw_string_ostream(Str) {
+      enable_colors(true);
+    }
+    bool has_colors() const override { return true; }
+  };
+
+  auto Verify = [&](unsigned NumThreads, bool Colors, std::string &Output) {
+    std::unique_ptr<DWARFContext> DwarfContext = DWARFContext::create(
+        *ErrOrSections, 8, sys::IsLittleEndianHost,
+        WithColor::defaultErrorHandler, WithColor::defaultWarningHandler,
+        /*ThreadSafe=*/true);
+    EXPECT_TRUE(DwarfContext->isThreadSafe());
+    DIDumpOptions DumpOpts;
+    DumpOpts.NumThreads = NumThreads;
+    if (Colors) {
+      ColoredStringOStream OS(Output);
+      return DwarfContext->verify(OS, DumpOpts.noImplicitRecursion());
+    }
+    raw_string_ostream OS(Output);
+    return DwarfContext->verify(OS, DumpOpts.noImplicitRecursion());
+  };
+
+  std::string SerialOutput;
+  EXPECT_FALSE(Verify(1, /*Colors=*/false, SerialOutput));
+  EXPECT_NE(SerialOutput.find("Verifying unit: 8 / 8"), std::string::npos);
+  EXPECT_NE(SerialOutput.find("0x00001007"), std::string::npos);
+
+  std::string ParallelOutput;
+  EXPECT_FALSE(Verify(4, /*Colors=*/false, ParallelOutput));
+  EXPECT_EQ(SerialOutput, ParallelOutput);
+
+  // Errors and DIE dumps are colored in the buffers of parallel tasks as they
+  // are when printed directly.
+  std::string ColoredSerialOutput;
+  EXPECT_FALSE(Verify(1, /*Colors=*/true, ColoredSerialOutput));
+  if (!sys::Process::ColorNeedsFlush())
+    EXPECT_NE(ColoredSerialOutput, SerialOutput);
+
+  std::string ColoredParallelOutput;
+  EXPECT_FALSE(Verify(4, /*Colors=*/true, ColoredParallelOutput));
+  EXPECT_EQ(ColoredSerialOutput, ColoredParallelOutput);
+}
+
 TEST(DWARFDebugInfo, TestAttributeIterators) {
   Triple Triple = getNormalizedDefaultTargetTriple();
   if (!isConfigurationSupported(Triple))
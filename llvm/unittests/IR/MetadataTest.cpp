@@ -1267,6 +1267,22 @@ TEST_F(DILocationTest, cloneTemporary) {
   EXPECT_TRUE(L2->isTemporary());
 }
 
+TEST_F(DILocationTest, uniquingCollision) {
+  // Uniqued locations live in the context's arena. Resolving the temporary
+  // scope makes L1 collide with L0, so L1 is deleted and replaced by L0.
+  DISubprogram *SP = getSubprogram();
+  auto Temp = MDTuple::getTemporary(Context, {});
+  DILocation *L0 = DILocation::get(Context, 2, 7, SP);
+  DILocation *L1 = DILocation::get(Context, 2, 7, Temp.get());
+  DILocation *L2 = DILocation::get(Context, 3, 1, Temp.get(), L1);
+  EXPECT_NE(L0, L1);
+  EXPECT_FALSE(L1->isResolved());
+
+  Temp->replaceAllUsesWith(SP);
+  EXPECT_EQ(L0, L2->getInlinedAt());
+  EXPECT_EQ(L0, DILocation::get(Context, 2, 7, SP));
+}
+
 TEST_F(DILocationTest, discriminatorEncoding) {
   EXPECT_EQ(0U, *DILocation::encodeDiscriminator(0, 0, 0));
 
@@ -18,6 +18,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -437,5 +438,42 @@ TEST(VerifierTest, DetectTaggedGlobalInSection) {
       << Error;
 }
 
+TEST(VerifierTest, ParallelMatchesSerial) {
+  LLVMContext C;
+  Module M("M", C);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(C), /*isVarArg=*/false);
+  Constant *Zero32 = ConstantInt::get(Type::getInt32Ty(C), 0);
+
+  // Every third function branches on an i32, which the verifier rejects.
+  for (unsigned I = 0; I != 16; ++I) {
+    Function *F = Function::Create(FTy, Function::ExternalLinkage,
+                                   "f" + Twine(I), M);
+    BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+    BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+    ReturnInst::Create(C, Exit);
+    BranchInst *BI =
+        BranchInst::Create(Exit, Exit, ConstantInt::getFalse(C), Entry);
+    if (I % 3 == 0)
+      BI->setOperand(0, Zero32);
+  }
+
+  auto *Threads = static_cast<cl::opt<unsigned> *>(
+      cl::getRegisteredOptions()["verify-threads"]);
+  ASSERT_TRUE(Threads);
+
+  std::string Serial;
+  raw_string_ostream SerialOS(Serial);
+  EXPECT_TRUE(verifyModule(M, &SerialOS));
+
+  *Threads = 4;
+  std::string Parallel;
+  raw_string_ostream ParallelOS(Parallel);
+  bool Broken = verifyModule(M, &ParallelOS);
+  *Threads = 1;
+
+  EXPECT_TRUE(Broken);
+  EXPECT_EQ(Serial, Parallel);
+}
+
 } // end anonymous namespace
 } // end namespace llvm
@@ -0,0 +1,213 @@
+//===- X86MCRelaxationTest.cpp - Tests for X86 MC relaxation --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/MC/MCAsmBackend.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCCodeEmitter.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCInstrInfo.h"
+#include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCObjectWriter.h"
+#include "llvm/MC/MCParser/MCAsmParser.h"
+#include "llvm/MC/MCParser/MCTargetAsmParser.h"
+#include "llvm/MC/MCRegisterInfo.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/MCTargetOptions.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class X86MCRelaxationTest : public ::testing::Test {
+protected:
+  static void SetUpTestCase() {
+    LLVMInitializeX86TargetInfo();
+    LLVMInitializeX86TargetMC();
+    LLVMInitializeX86AsmParser();
+  }
+
+  const char *TripleName = "x86_64-unknown-linux-gnu";
+
+  /// Assemble \p Asm to an ELF object and return the contents of \p Section,
+  /// or std::nullopt if assembly failed.
+  std::optional<std::vector<uint8_t>> assemble(StringRef Asm,
+                                               StringRef Section) {
+    std::string Error;
+    const Target *TheTarget = TargetRegistry::lookupTarget(TripleName, Error);
+    if (!TheTarget)
+      return std::nullopt;
+
+    MCTargetOptions MCOptions;
+    std::unique_ptr<MCRegisterInfo> MRI(TheTarget->createMCRegInfo(TripleName));
+    std::unique_ptr<MCAsmInfo> MAI(
+        TheTarget->createMCAsmInfo(*MRI, TripleName, MCOptions));
+    std::unique_ptr<MCSubtargetInfo> STI(
+        TheTarget->createMCSubtargetInfo(TripleName, "", ""));
+    std::unique_ptr<MCInstrInfo> MII(TheTarget->createMCInstrInfo());
+
+    SourceMgr SrcMgr;
+    SrcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Asm), SMLoc());
+    MCContext Ctx(Triple(TripleName), MAI.get(), MRI.get(), STI.get(),
+                  &SrcMgr, &MCOptions);
+    std::unique_ptr<MCObjectFileInfo> MOFI(
+        TheTarget->createMCObjectFileInfo(Ctx, /*PIC=*/false));
+    Ctx.setObjectFileInfo(MOFI.get());
+
+    SmallString<0> Object;
+    raw_svector_ostream OS(Object);
+    MCAsmBackend *MAB = TheTarget->createMCAsmBackend(*STI, *MRI, MCOptions);
+    std::unique_ptr<MCStreamer> Streamer(TheTarget->createMCObjectStreamer(
+        Triple(TripleName), Ctx, std::unique_ptr<MCAsmBackend>(MAB),
+        MAB->createObjectWriter(OS),
+        std::unique_ptr<MCCodeEmitter>(
+            TheTarget->createMCCodeEmitter(*MII, Ctx)),
+        *STI));
+
+    std::unique_ptr<MCAsmParser> Parser(
+        createMCAsmParser(SrcMgr, Ctx, *Streamer, *MAI));
+    std::unique_ptr<MCTargetAsmParser> TAP(
+        TheTarget->createMCAsmParser(*STI, *Parser, *MII, MCOptions));
+    Parser->setTargetParser(*TAP);
+    if (Parser->Run(/*NoInitialTextSection=*/false) || Ctx.hadError())
+      return std::nullopt;
+
+    Expected<std::unique_ptr<object::ObjectFile>> Obj =
+        object::ObjectFile::createObjectFile(
+            MemoryBufferRef(Object.str(), "object"));
+    if (!Obj) {
+      consumeError(Obj.takeError());
+      return std::nullopt;
+    }
+    for (const object::SectionRef &Sec : (*Obj)->sections()) {
+      Expected<StringRef> Name = Sec.getName();
+      if (!Name || *Name != Section)
+        continue;
+      Expected<StringRef> Contents = Sec.getContents();
+      if (!Contents)
+        return std::nullopt;
+      return std::vector<uint8_t>(Contents->bytes_begin(),
+                                  Contents->bytes_end());
+    }
+    return std::nullopt;
+  }
+};
+
+// The immediate is the difference of two labels in a later section, which
+// only crosses the imm8 range once a branch between the labels is relaxed.
+// The section holding the 'add' must be relaxed again after that.
+TEST_F(X86MCRelaxationTest, CrossSectionLabelDifference) {
+  std::optional<std::vector<uint8_t>> Text = assemble(R"(
+  .text
+  addl $(b-a), %ecx
+  ret
+
+  .section .text.other,"ax",@progbits
+a:
+  jmp d
+  .space 124
+b:
+  .space 200
+d:
+  ret
+)",
+                                                      ".text");
+  ASSERT_TRUE(Text);
+  // b - a is 124 + 5 = 129 with the relaxed jmp, so the add uses an imm32.
+  EXPECT_EQ(*Text, std::vector<uint8_t>(
+                       {0x81, 0xc1, 0x81, 0x00, 0x00, 0x00, 0xc3}));
+}
+
+// The same difference stays within imm8 range when the branch doesn't push
+// the labels far enough apart.
+TEST_F(X86MCRelaxationTest, CrossSectionLabelDifferenceInRange) {
+  std::optional<std::vector<uint8_t>> Text = assemble(R"(
+  .text
+  addl $(b-a), %ecx
+  ret
+
+  .section .text.other,"ax",@progbits
+a:
+  jmp d
+  .space 100
+b:
+  .space 200
+d:
+  ret
+)",
+                                                      ".text");
+  ASSERT_TRUE(Text);
+  // b - a is 100 + 5 = 105.
+  EXPECT_EQ(*Text, std::vector<uint8_t>({0x83, 0xc1, 0x69, 0xc3}));
+}
+
+// Growth propagates through a chain of sections: relaxing the branch in
+// .text.other grows the 'add' in .text.mid, which in turn pushes the labels
+// used by the 'add' in .text out of imm8 range.
+TEST_F(X86MCRelaxationTest, CrossSectionLabelDifferenceChain) {
+  std::optional<std::vector<uint8_t>> Text = assemble(R"(
+  .text
+  addl $(b-a), %ecx
+  ret
+
+  .section .text.mid,"ax",@progbits
+a:
+  addl $(d-c), %edx
+  .space 124
+b:
+  ret
+
+  .section .text.other,"ax",@progbits
+c:
+  jmp e
+  .space 124
+d:
+  .space 200
+e:
+  ret
+)",
+                                                      ".text");
+  ASSERT_TRUE(Text);
+  // b - a is 6 + 124 = 130 once the 'add' in .text.mid uses an imm32.
+  EXPECT_EQ(*Text, std::vector<uint8_t>(
+                       {0x81, 0xc1, 0x82, 0x00, 0x00, 0x00, 0xc3}));
+}
+
+// The backward jmp grows in the first sweep, after the forward jmp in front of
+// it was found to fit. The next sweep starts at the backward jmp but still has
+// to relax the forward one, whose target has moved past the imm8 range.
+TEST_F(X86MCRelaxationTest, ForwardBranchBeforeFirstChange) {
+  std::optional<std::vector<uint8_t>> Text = assemble(R"(
+  .text
+start:
+  .space 130
+  jmp end
+  .space 100
+  jmp start
+  .space 24
+end:
+  ret
+)",
+                                                      ".text");
+  ASSERT_TRUE(Text);
+  ASSERT_EQ(Text->size(), 265u);
+  // end is at 130 + 5 + 100 + 5 + 24 = 264, 129 bytes after the first jmp.
+  EXPECT_EQ(std::vector<uint8_t>(Text->begin() + 130, Text->begin() + 135),
+            std::vector<uint8_t>({0xe9, 0x81, 0x00, 0x00, 0x00}));
+  // The second jmp ends at 240.
+  EXPECT_EQ(std::vector<uint8_t>(Text->begin() + 235, Text->begin() + 240),
+            std::vector<uint8_t>({0xe9, 0x10, 0xff, 0xff, 0xff}));
+}
+
+} // namespace
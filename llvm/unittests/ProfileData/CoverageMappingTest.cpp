@@ -7,10 +7,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ProfileData/Coverage/CoverageMapping.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ProfileData/Coverage/CoverageMappingReader.h"
 #include "llvm/ProfileData/Coverage/CoverageMappingWriter.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/Support/Alignment.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Testing/Support/Error.h"
 #include "llvm/Testing/Support/SupportHelpers.h"
@@ -18,6 +22,7 @@
 
 #include <map>
 #include <ostream>
+#include <tuple>
 #include <utility>
 
 using namespace llvm;
@@ -1114,6 +1119,131 @@ TEST(CoverageMappingTest, filename_compilation_dir) {
   }
 }
 
+/// Write a file in the coverage mapping testing format with one function
+/// record per entry of \p Functions, each covering the single line of the
+/// file whose index in \p Filenames is paired with it.
+static void
+writeTestingFormatFile(StringRef Path, ArrayRef<std::string> Filenames,
+                       ArrayRef<std::tuple<std::string, uint64_t, unsigned>>
+                           Functions) {
+  std::vector<std::string> Names;
+  for (const auto &[Name, Hash, FileID] : Functions)
+    Names.push_back(Name);
+  std::string ProfileNames;
+  ASSERT_THAT_ERROR(collectGlobalObjectNameStrings(
+                        Names, /*doCompression=*/false, ProfileNames),
+                    Succeeded());
+
+  std::string EncodedFilenames;
+  {
+    raw_string_ostream OS(EncodedFilenames);
+    CoverageFilenamesSectionWriter(Filenames).write(OS, /*Compress=*/false);
+  }
+  std::string CoverageMappingData;
+  {
+    raw_string_ostream OS(CoverageMappingData);
+    support::endian::Writer W(OS, llvm::endianness::little);
+    W.write<uint32_t>(0); // NRecords
+    W.write<uint32_t>(EncodedFilenames.size());
+    W.write<uint32_t>(0); // CoverageSize
+    W.write<uint32_t>(CovMapVersion::CurrentVersion);
+    OS << EncodedFilenames;
+  }
+
+  std::string CoverageRecordsData;
+  {
+    raw_string_ostream OS(CoverageRecordsData);
+    support::endian::Writer W(OS, llvm::endianness::little);
+    for (const auto &[Name, Hash, FileID] : Functions) {
+      unsigned FileIDs[] = {FileID};
+      CounterMappingRegion Regions[] = {CounterMappingRegion::makeRegion(
+          Counter::getCounter(0), /*FileID=*/0, 1, 1, 2, 1)};
+      std::string Mapping;
+      {
+        raw_string_ostream MappingOS(Mapping);
+        CoverageMappingWriter(FileIDs, {}, Regions).write(MappingOS);
+      }
+      W.write<uint64_t>(IndexedInstrProf::ComputeHash(Name));
+      W.write<uint32_t>(Mapping.size());
+      W.write<uint64_t>(Hash);
+      W.write<uint64_t>(IndexedInstrProf::ComputeHash(EncodedFilenames));
+      OS << Mapping;
+      for (unsigned Pad = offsetToAlignment(OS.tell(), Align(8)); Pad; --Pad)
+        OS.write(uint8_t(0));
+    }
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC);
+  ASSERT_FALSE(EC);
+  TestingFormatWriter(/*ProfileNamesAddr=*/0, ProfileNames,
+                      CoverageMappingData, CoverageRecordsData)
+      .write(OS);
+}
+
+TEST(CoverageMappingTest, load_from_files_in_parallel) {
+  unittest::TempDir Dir("CoverageMappingTest", /*Unique=*/true);
+
+  InstrProfWriter ProfileWriter;
+  ProfileWriter.addRecord({"shared", 0x1, {5}}, Err);
+  ProfileWriter.addRecord({"stale", 0x3, {7}}, Err);
+
+  // Enough files for several batches of parallel decoding. Each one has a
+  // function of its own, a function shared with all the others, which is
+  // only loaded from the first file, and a function whose profile is stale.
+  std::vector<std::string> Paths;
+  for (unsigned I = 0; I != 40; ++I) {
+    std::string Func = "func" + utostr(I);
+    ProfileWriter.addRecord({Func, 0x2, {I + 1}}, Err);
+    SmallString<128> Path(Dir.path());
+    sys::path::append(Path, "file" + Twine(I) + ".covmapping");
+    writeTestingFormatFile(
+        Path, {"/cwd", "file" + utostr(I) + ".c", "shared.h"},
+        {{Func, 0x2, 1}, {"shared", 0x1, 2}, {"stale", 0x2, 1}});
+    Paths.push_back(std::string(Path));
+  }
+
+  SmallString<128> ProfilePath(Dir.path());
+  sys::path::append(ProfilePath, "default.profdata");
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(ProfilePath, EC);
+    ASSERT_FALSE(EC);
+    ASSERT_THAT_ERROR(ProfileWriter.write(OS), Succeeded());
+  }
+
+  auto Load = [&](unsigned NumThreads) {
+    SmallVector<StringRef> Objects(Paths.begin(), Paths.end());
+    auto CoverageOrErr = CoverageMapping::load(
+        Objects, ProfilePath, *vfs::getRealFileSystem(), /*Arches=*/{},
+        /*CompilationDir=*/"", /*BIDFetcher=*/nullptr,
+        /*CheckBinaryIDs=*/false, NumThreads);
+    EXPECT_THAT_EXPECTED(CoverageOrErr, Succeeded());
+    std::string Result;
+    if (!CoverageOrErr)
+      return Result;
+    raw_string_ostream OS(Result);
+    for (const FunctionRecord &Function :
+         (*CoverageOrErr)->getCoveredFunctions()) {
+      OS << Function.Name << ' ' << Function.ExecutionCount;
+      for (const std::string &Filename : Function.Filenames)
+        OS << ' ' << Filename;
+      OS << '\n';
+    }
+    for (const auto &[Name, Hash] : (*CoverageOrErr)->getHashMismatches())
+      OS << "mismatch " << Name << ' ' << Hash << '\n';
+    return Result;
+  };
+
+  std::string Serial = Load(1);
+  EXPECT_NE(Serial.find("func39 40 "), std::string::npos);
+  EXPECT_NE(Serial.find("shared 5 "), std::string::npos);
+  EXPECT_EQ(Serial.find("shared 5 "), Serial.rfind("shared 5 "));
+  EXPECT_NE(Serial.find("mismatch stale 2\n"), std::string::npos);
+  EXPECT_EQ(Serial, Load(4));
+  EXPECT_EQ(Serial, Load(0));
+}
+
 TEST(CoverageMappingTest, TVIdxBuilder) {
   // ((n0 && n3) || (n2 && n4) || (n1 && n5))
   static const std::array<mcdc::ConditionIDs, 6> Branches = {{
@@ -8,9 +8,16 @@
 
 #include "llvm/Support/CachePruning.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Testing/Support/SupportHelpers.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
+using llvm::unittest::TempDir;
 
 TEST(CachePruningPolicyParser, Empty) {
   auto P = parseCachePruningPolicy("");
@@ -94,3 +101,111 @@ TEST(CachePruningPolicyParser, Errors) {
   EXPECT_EQ("Unknown key: 'foo'",
             toString(parseCachePruningPolicy("foo=bar").takeError()));
 }
+
+static void writeFile(const Twine &Path, StringRef Contents) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path.str(), EC);
+  ASSERT_FALSE(EC);
+  OS << Contents;
+}
+
+/// Pretend that \p Path was last used in 1970.
+static void makeFileOld(const Twine &Path) {
+  int FD;
+  ASSERT_FALSE(sys::fs::openFileForWrite(Path, FD, sys::fs::CD_OpenExisting));
+  EXPECT_FALSE(
+      sys::fs::setLastAccessAndModificationTime(FD, sys::TimePoint<>()));
+  sys::Process::SafelyCloseFileDescriptor(FD);
+}
+
+TEST(CachePruning, UsesAccessIndex) {
+  TempDir Dir("CachePruningTest", /*Unique=*/true);
+  SmallString<128> Old(Dir.path()), New(Dir.path()), Index(Dir.path());
+  sys::path::append(Old, "llvmcache-old");
+  sys::path::append(New, "llvmcache-new");
+  sys::path::append(Index, "llvmcache.index");
+  writeFile(Old, "old");
+  writeFile(New, "new");
+  makeFileOld(Old);
+
+  // The index says that "old" was last used in 1970, and so does the file.
+  writeFile(Index, "0 3 llvmcache-old\n");
+  recordCacheAccess(Dir.path(), "llvmcache-new", 3);
+
+  CachePruningPolicy Policy;
+  Policy.Interval = std::chrono::seconds(0);
+  Policy.Expiration = std::chrono::hours(1);
+  Policy.MaxSizePercentageOfAvailableSpace = 0;
+  Policy.MaxSizeFiles = 0;
+  EXPECT_TRUE(pruneCache(Dir.path(), Policy));
+  EXPECT_FALSE(sys::fs::exists(Old));
+  EXPECT_TRUE(sys::fs::exists(New));
+
+  // The index was compacted to the surviving entry.
+  auto MBOrErr = MemoryBuffer::getFile(Index);
+  ASSERT_TRUE(bool(MBOrErr));
+  StringRef Contents = (*MBOrErr)->getBuffer();
+  EXPECT_FALSE(Contents.contains("llvmcache-old"));
+  EXPECT_TRUE(Contents.ends_with(" 3 llvmcache-new\n"));
+}
+
+TEST(CachePruning, ChecksAccessTimeOfExpiredIndexEntries) {
+  TempDir Dir("CachePruningTest", /*Unique=*/true);
+  SmallString<128> Entry(Dir.path()), Index(Dir.path());
+  sys::path::append(Entry, "llvmcache-entry");
+  sys::path::append(Index, "llvmcache.index");
+  writeFile(Entry, "entry");
+
+  // The index says that the entry was last used in 1970, but the file was just
+  // created by a tool that doesn't record accesses in the index, so it stays.
+  writeFile(Index, "0 5 llvmcache-entry\n");
+
+  CachePruningPolicy Policy;
+  Policy.Interval = std::chrono::seconds(0);
+  Policy.Expiration = std::chrono::hours(1);
+  Policy.MaxSizePercentageOfAvailableSpace = 0;
+  Policy.MaxSizeFiles = 0;
+  EXPECT_TRUE(pruneCache(Dir.path(), Policy));
+  EXPECT_TRUE(sys::fs::exists(Entry));
+
+  // The index now carries the access time of the file.
+  auto MBOrErr = MemoryBuffer::getFile(Index);
+  ASSERT_TRUE(bool(MBOrErr));
+  StringRef Contents = (*MBOrErr)->getBuffer();
+  EXPECT_FALSE(Contents.starts_with("0 "));
+  EXPECT_TRUE(Contents.ends_with(" 5 llvmcache-entry\n"));
+
+  // The same holds when the entry is only a candidate for size-based pruning.
+  writeFile(Index, "0 5 llvmcache-entry\n");
+  Policy.Expiration = std::chrono::seconds(0);
+  Policy.MaxSizeFiles = 1;
+  SmallString<128> Other(Dir.path());
+  sys::path::append(Other, "llvmcache-other");
+  writeFile(Other, "other");
+  makeFileOld(Other);
+  EXPECT_TRUE(pruneCache(Dir.path(), Policy));
+  EXPECT_TRUE(sys::fs::exists(Entry));
+  EXPECT_FALSE(sys::fs::exists(Other));
+}
+
+TEST(CachePruning, CompactsLargeAccessIndex) {
+  TempDir Dir("CachePruningTest", /*Unique=*/true);
+  SmallString<128> Index(Dir.path());
+  sys::path::append(Index, "llvmcache.index");
+
+  // A cache that is never pruned keeps appending to its index. Once the index
+  // grows past a few megabytes, recording an access compacts it.
+  std::string Records;
+  for (unsigned I = 0; I != 1 << 18; ++I)
+    Records += "1 3 llvmcache-a\n2 3 llvmcache-b\n";
+  writeFile(Index, Records);
+  recordCacheAccess(Dir.path(), "llvmcache-c", 3);
+
+  auto MBOrErr = MemoryBuffer::getFile(Index);
+  ASSERT_TRUE(bool(MBOrErr));
+  StringRef Contents = (*MBOrErr)->getBuffer();
+  EXPECT_EQ(3u, Contents.count('\n'));
+  EXPECT_TRUE(Contents.contains("2 3 llvmcache-b\n"));
+  EXPECT_TRUE(Contents.contains("1 3 llvmcache-a\n"));
+  EXPECT_TRUE(Contents.contains(" 3 llvmcache-c\n"));
+}
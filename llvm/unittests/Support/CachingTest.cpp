@@ -0,0 +1,117 @@
+//===- CachingTest.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Caching.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Testing/Support/Error.h"
+#include "llvm/Testing/Support/SupportHelpers.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using llvm::unittest::TempDir;
+
+namespace {
+
+struct CacheFixture {
+  TempDir Dir{"CachingTest", /*Unique=*/true};
+  std::vector<std::string> Added;
+
+  Expected<FileCache> create(uint64_t MemoryLimitBytes = 0) {
+    return localCache("Test", "Test", Dir.path(),
+                      [this](size_t Task, const Twine &ModuleName,
+                             std::unique_ptr<MemoryBuffer> MB) {
+                        Added.push_back(MB->getBuffer().str());
+                      },
+                      MemoryLimitBytes);
+  }
+
+  /// Looks \p Key up and, on a miss, produces \p Contents for it. Returns true
+  /// on a hit.
+  bool lookupOrAdd(FileCache &Cache, StringRef Key, StringRef Contents) {
+    Expected<AddStreamFn> AddStream = Cache(0, Key, "module");
+    EXPECT_THAT_EXPECTED(AddStream, Succeeded());
+    if (!*AddStream)
+      return true;
+    auto Stream = (*AddStream)(0, "module");
+    EXPECT_THAT_EXPECTED(Stream, Succeeded());
+    *(*Stream)->OS << Contents;
+    return false;
+  }
+
+  std::string path(StringRef Name) {
+    SmallString<128> Path(Dir.path());
+    sys::path::append(Path, Name);
+    return std::string(Path);
+  }
+};
+
+TEST(Caching, HitAfterMiss) {
+  CacheFixture F;
+  Expected<FileCache> Cache = F.create();
+  ASSERT_THAT_EXPECTED(Cache, Succeeded());
+
+  EXPECT_FALSE(F.lookupOrAdd(*Cache, "key", "contents"));
+  EXPECT_TRUE(sys::fs::exists(F.path("llvmcache-key")));
+  EXPECT_TRUE(F.lookupOrAdd(*Cache, "key", "other"));
+  EXPECT_EQ(std::vector<std::string>({"contents", "contents"}), F.Added);
+
+  // Both the insertion and the hit were recorded in the access index.
+  auto Index = MemoryBuffer::getFile(F.path("llvmcache.index"));
+  ASSERT_TRUE(bool(Index));
+  EXPECT_EQ(2u, (*Index)->getBuffer().count(" 8 llvmcache-key\n"));
+}
+
+TEST(Caching, ExistingEntryIsNotReplaced) {
+  CacheFixture F;
+  Expected<FileCache> Cache = F.create();
+  ASSERT_THAT_EXPECTED(Cache, Succeeded());
+
+  // Simulate another link publishing the entry while this one produces it.
+  Expected<AddStreamFn> AddStream = (*Cache)(0, "key", "module");
+  ASSERT_THAT_EXPECTED(AddStream, Succeeded());
+  ASSERT_TRUE(bool(*AddStream));
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(F.path("llvmcache-key"), EC);
+    ASSERT_FALSE(EC);
+    OS << "published";
+  }
+  {
+    auto Stream = (*AddStream)(0, "module");
+    ASSERT_THAT_EXPECTED(Stream, Succeeded());
+    *(*Stream)->OS << "mine";
+  }
+
+  EXPECT_EQ(std::vector<std::string>({"mine"}), F.Added);
+  auto Entry = MemoryBuffer::getFile(F.path("llvmcache-key"));
+  ASSERT_TRUE(bool(Entry));
+  EXPECT_EQ("published", (*Entry)->getBuffer());
+}
+
+TEST(Caching, MemoryTier) {
+  CacheFixture F;
+  Expected<FileCache> Cache = F.create(/*MemoryLimitBytes=*/8);
+  ASSERT_THAT_EXPECTED(Cache, Succeeded());
+
+  EXPECT_FALSE(F.lookupOrAdd(*Cache, "small", "contents"));
+  EXPECT_FALSE(F.lookupOrAdd(*Cache, "large", "too large"));
+  ASSERT_FALSE(sys::fs::remove(F.path("llvmcache-small")));
+  ASSERT_FALSE(sys::fs::remove(F.path("llvmcache-large")));
+
+  // Only the entry that fits in the budget is still served.
+  EXPECT_TRUE(F.lookupOrAdd(*Cache, "small", "other"));
+  EXPECT_FALSE(F.lookupOrAdd(*Cache, "large", "other"));
+  EXPECT_EQ(std::vector<std::string>({"contents", "too large", "contents",
+                                      "other"}),
+            F.Added);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,126 @@
+#include "MCTargetDesc/M68kMCTargetDesc.h"
+#include "llvm/CodeGen/MIRParser/MIRParser.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/TargetParser/Triple.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class MachineOutlinerTest : public ::testing::Test {
+protected:
+  static void SetUpTestCase() {
+    LLVMInitializeM68kTargetInfo();
+    LLVMInitializeM68kTarget();
+    LLVMInitializeM68kTargetMC();
+  }
+
+  static std::unique_ptr<TargetMachine> createTM(StringRef TT) {
+    Triple TheTriple(TT);
+    std::string Error;
+    const Target *TheTarget =
+        TargetRegistry::lookupTarget("", TheTriple, Error);
+    if (!TheTarget)
+      return nullptr;
+    TargetOptions Options;
+    return std::unique_ptr<TargetMachine>(TheTarget->createTargetMachine(
+        TheTriple.getTriple(), "", "", Options, std::nullopt, std::nullopt,
+        CodeGenOptLevel::Default));
+  }
+};
+
+TEST_F(MachineOutlinerTest, DefaultOnlyForClassicMacOS) {
+  for (StringRef TT : {"m68k-apple-classic", "m68k-unknown-linux-gnu",
+                       "m68k-unknown-unknown"}) {
+    std::unique_ptr<TargetMachine> TM = createTM(TT);
+    ASSERT_TRUE(TM) << TT;
+    EXPECT_TRUE(TM->Options.EnableMachineOutliner) << TT;
+    EXPECT_EQ(TM->Options.SupportsDefaultOutlining,
+              TM->getTargetTriple().isMacOSClassic())
+        << TT;
+  }
+  EXPECT_TRUE(createTM("m68k-apple-classic")->Options.SupportsDefaultOutlining);
+}
+
+// Two functions end in the same sequence, which is outlined into a function
+// that both reach with a tail branch.
+TEST_F(MachineOutlinerTest, OutlinesRepeatedTail) {
+  std::unique_ptr<TargetMachine> TM = createTM("m68k-unknown-linux-gnu");
+  ASSERT_TRUE(TM);
+
+  StringRef MIR = R"MIR(
+--- |
+  define i32 @f1(i32 %a, i32 %b) { ret i32 0 }
+  define i32 @f2(i32 %a, i32 %b) { ret i32 0 }
+...
+---
+name: f1
+tracksRegLiveness: true
+body: |
+  bb.0:
+    liveins: $d0, $d1
+    $d0 = ADD32dd $d0, $d1, implicit-def $ccr
+    $d0 = ADD32di $d0, 1000, implicit-def $ccr
+    $d0 = SUB32dd $d0, $d1, implicit-def $ccr
+    $d0 = ADD32di $d0, 100000, implicit-def $ccr
+    $d0 = OR32dd $d0, $d1, implicit-def $ccr
+    RTS implicit $d0
+...
+---
+name: f2
+tracksRegLiveness: true
+body: |
+  bb.0:
+    liveins: $d0, $d1
+    $d1 = ADD32di $d1, 1, implicit-def $ccr
+    $d0 = ADD32dd $d0, $d1, implicit-def $ccr
+    $d0 = ADD32di $d0, 1000, implicit-def $ccr
+    $d0 = SUB32dd $d0, $d1, implicit-def $ccr
+    $d0 = ADD32di $d0, 100000, implicit-def $ccr
+    $d0 = OR32dd $d0, $d1, implicit-def $ccr
+    RTS implicit $d0
+...
+)MIR";
+
+  LLVMContext Context;
+  std::unique_ptr<MIRParser> Parser =
+      createMIRParser(MemoryBuffer::getMemBuffer(MIR), Context);
+  ASSERT_TRUE(Parser);
+  std::unique_ptr<Module> M = Parser->parseIRModule();
+  ASSERT_TRUE(M);
+  M->setTargetTriple(TM->getTargetTriple().getTriple());
+  M->setDataLayout(TM->createDataLayout());
+
+  auto *MMIWP = new MachineModuleInfoWrapperPass(TM.get());
+  ASSERT_FALSE(Parser->parseMachineFunctions(*M, MMIWP->getMMI()));
+  legacy::PassManager PM;
+  PM.add(MMIWP);
+  PM.add(createMachineOutlinerPass(/*RunOnAllFunctions=*/true));
+  PM.run(*M);
+
+  MachineModuleInfo &MMI = MMIWP->getMMI();
+  Function *Outlined = M->getFunction("OUTLINED_FUNCTION_0");
+  ASSERT_TRUE(Outlined);
+  MachineFunction *OutlinedMF = MMI.getMachineFunction(*Outlined);
+  ASSERT_TRUE(OutlinedMF);
+  EXPECT_EQ(OutlinedMF->front().back().getOpcode(), M68k::RTS);
+
+  for (StringRef Name : {"f1", "f2"}) {
+    MachineFunction *MF = MMI.getMachineFunction(*M->getFunction(Name));
+    ASSERT_TRUE(MF) << Name;
+    const MachineInstr &Last = MF->front().back();
+    EXPECT_EQ(Last.getOpcode(), M68k::TAILJMPq) << Name;
+    EXPECT_EQ(Last.getOperand(0).getGlobal(), Outlined) << Name;
+  }
+}
+
+} // end of anonymous namespace
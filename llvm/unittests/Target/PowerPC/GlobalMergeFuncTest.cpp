@@ -0,0 +1,123 @@
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/TargetParser/Triple.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// Three functions that only differ in the global they load from and store
+// to, which is enough for the merged body to pay for the thunks.
+const char *SimilarFunctionsIR = R"(
+@g1 = global i32 0
+@g2 = global i32 0
+@g3 = global i32 0
+
+declare void @use(i32)
+
+define void @f1(i32 %x) {
+  %v = load i32, ptr @g1
+  %a = add i32 %v, %x
+  call void @use(i32 %a)
+  %b = mul i32 %a, %x
+  call void @use(i32 %b)
+  %c = sub i32 %b, %v
+  call void @use(i32 %c)
+  store i32 %c, ptr @g1
+  ret void
+}
+
+define void @f2(i32 %x) {
+  %v = load i32, ptr @g2
+  %a = add i32 %v, %x
+  call void @use(i32 %a)
+  %b = mul i32 %a, %x
+  call void @use(i32 %b)
+  %c = sub i32 %b, %v
+  call void @use(i32 %c)
+  store i32 %c, ptr @g2
+  ret void
+}
+
+define void @f3(i32 %x) {
+  %v = load i32, ptr @g3
+  %a = add i32 %v, %x
+  call void @use(i32 %a)
+  %b = mul i32 %a, %x
+  call void @use(i32 %b)
+  %c = sub i32 %b, %v
+  call void @use(i32 %c)
+  store i32 %c, ptr @g3
+  ret void
+}
+)";
+
+class GlobalMergeFuncTest : public ::testing::Test {
+protected:
+  static void SetUpTestCase() {
+    LLVMInitializePowerPCTargetInfo();
+    LLVMInitializePowerPCTarget();
+    LLVMInitializePowerPCTargetMC();
+  }
+
+  /// Run the code generation pipeline for \p TT on the similar functions and
+  /// return whether any of them was merged.
+  static bool mergesFunctions(StringRef TT, CodeGenOptLevel OL) {
+    Triple TheTriple(TT);
+    std::string Error;
+    const Target *TheTarget =
+        TargetRegistry::lookupTarget("", TheTriple, Error);
+    EXPECT_TRUE(TheTarget) << Error;
+    if (!TheTarget)
+      return false;
+    TargetOptions Options;
+    std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+        TheTriple.getTriple(), "", "", Options, std::nullopt, std::nullopt,
+        OL));
+
+    LLVMContext Ctx;
+    SMDiagnostic Err;
+    std::unique_ptr<Module> M =
+        parseAssemblyString(SimilarFunctionsIR, Err, Ctx);
+    EXPECT_TRUE(M);
+    if (!M)
+      return false;
+    M->setTargetTriple(TheTriple.getTriple());
+    M->setDataLayout(TM->createDataLayout());
+
+    legacy::PassManager PM;
+    raw_null_ostream OS;
+    EXPECT_FALSE(
+        TM->addPassesToEmitFile(PM, OS, nullptr, CodeGenFileType::Null));
+    PM.run(*M);
+
+    for (const Function &F : *M)
+      if (F.getName().ends_with(".Tgm"))
+        return true;
+    return false;
+  }
+};
+
+TEST_F(GlobalMergeFuncTest, DefaultForClassicMacOS) {
+  EXPECT_TRUE(
+      mergesFunctions("powerpc-apple-classic", CodeGenOptLevel::Default));
+}
+
+TEST_F(GlobalMergeFuncTest, NotAtO0) {
+  EXPECT_FALSE(mergesFunctions("powerpc-apple-classic", CodeGenOptLevel::None));
+}
+
+TEST_F(GlobalMergeFuncTest, NotDefaultElsewhere) {
+  EXPECT_FALSE(
+      mergesFunctions("powerpc-unknown-linux-gnu", CodeGenOptLevel::Default));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,138 @@
+#include "MCTargetDesc/PPCMCTargetDesc.h"
+#include "llvm/CodeGen/MIRParser/MIRParser.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/TargetParser/Triple.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class MachineOutlinerTest : public ::testing::Test {
+protected:
+  static void SetUpTestCase() {
+    LLVMInitializePowerPCTargetInfo();
+    LLVMInitializePowerPCTarget();
+    LLVMInitializePowerPCTargetMC();
+  }
+
+  static std::unique_ptr<TargetMachine> createTM(StringRef TT) {
+    Triple TheTriple(TT);
+    std::string Error;
+    const Target *TheTarget =
+        TargetRegistry::lookupTarget("", TheTriple, Error);
+    if (!TheTarget)
+      return nullptr;
+    TargetOptions Options;
+    return std::unique_ptr<TargetMachine>(TheTarget->createTargetMachine(
+        TheTriple.getTriple(), "", "", Options, std::nullopt, std::nullopt,
+        CodeGenOptLevel::Default));
+  }
+};
+
+TEST_F(MachineOutlinerTest, EnabledFor32BitTargets) {
+  for (StringRef TT : {"powerpc-unknown-linux-gnu", "powerpc-apple-classic"}) {
+    std::unique_ptr<TargetMachine> TM = createTM(TT);
+    ASSERT_TRUE(TM) << TT;
+    EXPECT_TRUE(TM->Options.EnableMachineOutliner) << TT;
+  }
+}
+
+TEST_F(MachineOutlinerTest, DefaultOnlyForClassicMacOS) {
+  EXPECT_TRUE(createTM("powerpc-apple-classic")
+                  ->Options.SupportsDefaultOutlining);
+  EXPECT_FALSE(createTM("powerpc-unknown-linux-gnu")
+                   ->Options.SupportsDefaultOutlining);
+}
+
+TEST_F(MachineOutlinerTest, DisabledFor64BitAndAIX) {
+  for (StringRef TT : {"powerpc64-unknown-linux-gnu",
+                       "powerpc64le-unknown-linux-gnu", "powerpc-ibm-aix"}) {
+    std::unique_ptr<TargetMachine> TM = createTM(TT);
+    ASSERT_TRUE(TM) << TT;
+    EXPECT_FALSE(TM->Options.EnableMachineOutliner) << TT;
+    EXPECT_FALSE(TM->Options.SupportsDefaultOutlining) << TT;
+  }
+}
+
+// Two functions end in the same sequence, which is outlined into a function
+// that both reach with a tail branch.
+TEST_F(MachineOutlinerTest, OutlinesRepeatedTail) {
+  std::unique_ptr<TargetMachine> TM = createTM("powerpc-apple-classic");
+  ASSERT_TRUE(TM);
+
+  StringRef MIR = R"MIR(
+--- |
+  define i32 @f1(i32 %a, i32 %b) { ret i32 0 }
+  define i32 @f2(i32 %a, i32 %b) { ret i32 0 }
+...
+---
+name: f1
+tracksRegLiveness: true
+body: |
+  bb.0:
+    liveins: $r3, $r4
+    $r5 = ADD4 $r3, $r4
+    $r5 = MULLW $r5, $r3
+    $r5 = SUBF $r4, $r5
+    $r6 = ADD4 $r5, $r5
+    $r3 = OR $r6, $r4
+    BLR implicit $lr, implicit $rm, implicit $r3
+...
+---
+name: f2
+tracksRegLiveness: true
+body: |
+  bb.0:
+    liveins: $r3, $r4
+    $r4 = ADDI $r4, 1
+    $r5 = ADD4 $r3, $r4
+    $r5 = MULLW $r5, $r3
+    $r5 = SUBF $r4, $r5
+    $r6 = ADD4 $r5, $r5
+    $r3 = OR $r6, $r4
+    BLR implicit $lr, implicit $rm, implicit $r3
+...
+)MIR";
+
+  LLVMContext Context;
+  std::unique_ptr<MIRParser> Parser =
+      createMIRParser(MemoryBuffer::getMemBuffer(MIR), Context);
+  ASSERT_TRUE(Parser);
+  std::unique_ptr<Module> M = Parser->parseIRModule();
+  ASSERT_TRUE(M);
+  M->setTargetTriple(TM->getTargetTriple().getTriple());
+  M->setDataLayout(TM->createDataLayout());
+
+  auto *MMIWP = new MachineModuleInfoWrapperPass(TM.get());
+  ASSERT_FALSE(Parser->parseMachineFunctions(*M, MMIWP->getMMI()));
+  legacy::PassManager PM;
+  PM.add(MMIWP);
+  PM.add(createMachineOutlinerPass(/*RunOnAllFunctions=*/true));
+  PM.run(*M);
+
+  MachineModuleInfo &MMI = MMIWP->getMMI();
+  Function *Outlined = M->getFunction("OUTLINED_FUNCTION_0");
+  ASSERT_TRUE(Outlined);
+  MachineFunction *OutlinedMF = MMI.getMachineFunction(*Outlined);
+  ASSERT_TRUE(OutlinedMF);
+  EXPECT_TRUE(OutlinedMF->front().back().isReturn());
+
+  for (StringRef Name : {"f1", "f2"}) {
+    MachineFunction *MF = MMI.getMachineFunction(*M->getFunction(Name));
+    ASSERT_TRUE(MF) << Name;
+    const MachineInstr &Last = MF->front().back();
+    EXPECT_EQ(Last.getOpcode(), PPC::TAILB) << Name;
+    EXPECT_EQ(Last.getOperand(0).getGlobal(), Outlined) << Name;
+  }
+}
+
+} // end of anonymous namespace
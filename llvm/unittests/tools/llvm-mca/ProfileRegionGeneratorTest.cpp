@@ -0,0 +1,62 @@
+#include "ProfileRegionGenerator.h"
+#include "llvm/Testing/Support/Error.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace mca;
+
+TEST(FdataProfileTest, ParseBranches) {
+  Expected<FdataProfile> Profile = FdataProfile::parse(
+      "1 main 1c 1 main 8 0 120\n"
+      "1 main 20 1 foo/bar.c/1 0 2 7\n"
+      "0 [unknown] 0 1 foo 4 0 9\n"
+      "1 main 24 1 bar 0 0 0\n");
+  ASSERT_THAT_EXPECTED(Profile, Succeeded());
+  EXPECT_TRUE(Profile->hasBranches());
+  ASSERT_EQ(Profile->branches().size(), 2u);
+  EXPECT_TRUE(Profile->samples().empty());
+
+  const FdataProfile::Branch &Back = Profile->branches()[0];
+  EXPECT_EQ(Back.From.Symbol, "main");
+  EXPECT_EQ(Back.From.Offset, 0x1cu);
+  EXPECT_EQ(Back.To.Offset, 0x8u);
+  EXPECT_EQ(Back.Count, 120u);
+  EXPECT_EQ(Profile->branches()[1].To.Symbol, "foo/bar.c/1");
+  EXPECT_EQ(Profile->getTotalCount(), 127u);
+}
+
+TEST(FdataProfileTest, ParseSamples) {
+  Expected<FdataProfile> Profile = FdataProfile::parse("no_lbr\n"
+                                                       "1 main 10 30\n"
+                                                       "\n"
+                                                       "1 main 3a 12\n");
+  ASSERT_THAT_EXPECTED(Profile, Succeeded());
+  EXPECT_FALSE(Profile->hasBranches());
+  ASSERT_EQ(Profile->samples().size(), 2u);
+  EXPECT_EQ(Profile->samples()[1].Location.Offset, 0x3au);
+  EXPECT_EQ(Profile->getTotalCount(), 42u);
+}
+
+TEST(FdataProfileTest, ParseErrors) {
+  EXPECT_THAT_EXPECTED(FdataProfile::parse("1 main 1c 1 main\n"),
+                       FailedWithMessage("line 1: expected 8 fields in a "
+                                         "branch record"));
+  EXPECT_THAT_EXPECTED(FdataProfile::parse("1 main 1c 1 main zz 0 1\n"),
+                       FailedWithMessage("line 1: invalid offset 'zz'"));
+  EXPECT_THAT_EXPECTED(FdataProfile::parse("no_lbr\n1 main 10\n"),
+                       FailedWithMessage("line 2: expected 4 fields in a "
+                                         "sample record"));
+  EXPECT_THAT_EXPECTED(FdataProfile::parse("1 main 10 1 main 0 0 1\nno_lbr\n"),
+                       FailedWithMessage("line 2: 'no_lbr' must precede all "
+                                         "records"));
+}
+
+TEST(ProfiledRegionTest, Description) {
+  ProfiledRegion Region;
+  Region.Function = "foo";
+  Region.StartOffset = 0x40;
+  Region.EndOffset = 0x5c;
+  EXPECT_EQ(Region.getDescription(), "foo+0x40");
+  Region.IsLoop = true;
+  EXPECT_EQ(Region.getDescription(), "foo+0x40..0x5c (loop)");
+}
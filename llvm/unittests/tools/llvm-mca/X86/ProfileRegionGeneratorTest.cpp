@@ -0,0 +1,69 @@
+#include "ProfileRegionGenerator.h"
+#include "X86TestBase.h"
+#include "llvm/MC/MCDisassembler/MCDisassembler.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/ObjectYAML/yaml2obj.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Testing/Support/Error.h"
+
+using namespace llvm;
+using namespace mca;
+
+// main:
+//   0: xorl %eax, %eax
+//   2: incl %eax        <- loop header
+//   4: cmpl $100, %eax
+//   7: jne  2
+//   9: retq
+static const char *LoopYAML = R"(
+--- !ELF
+FileHeader:
+  Class:   ELFCLASS64
+  Data:    ELFDATA2LSB
+  Type:    ET_REL
+  Machine: EM_X86_64
+Sections:
+  - Name:    .text
+    Type:    SHT_PROGBITS
+    Flags:   [ SHF_ALLOC, SHF_EXECINSTR ]
+    Content: 31C0FFC083F86475F9C3
+Symbols:
+  - Name:    main
+    Type:    STT_FUNC
+    Section: .text
+    Binding: STB_GLOBAL
+    Size:    10
+...
+)";
+
+TEST_F(X86TestBase, ProfileRegionsFoldLoopBlocks) {
+  LLVMInitializeX86Disassembler();
+  std::unique_ptr<MCDisassembler> Disassembler(
+      TheTarget->createMCDisassembler(*STI, *Ctx));
+  ASSERT_TRUE(Disassembler);
+
+  SmallString<0> Storage;
+  std::unique_ptr<object::ObjectFile> Obj = yaml::yaml2ObjectFile(
+      Storage, LoopYAML, [](const Twine &Err) { errs() << Err; });
+  ASSERT_TRUE(Obj);
+
+  // The back edge is taken 100 times and the loop is entered 5 times, so the
+  // header block weighs more than the loop and sorts ahead of it.
+  Expected<FdataProfile> Profile = FdataProfile::parse(
+      "1 main 7 1 main 2 0 100\n"
+      "1 main 0 1 main 2 0 5\n");
+  ASSERT_THAT_EXPECTED(Profile, Succeeded());
+
+  ProfileRegionGenerator Generator(*Obj, *Disassembler, *MCII, MCIA.get());
+  for (unsigned MaxRegions : {0u, 1u}) {
+    Expected<std::vector<ProfiledRegion>> Regions =
+        Generator.generate(*Profile, MaxRegions);
+    ASSERT_THAT_EXPECTED(Regions, Succeeded());
+    ASSERT_EQ(Regions->size(), 1u) << MaxRegions;
+    const ProfiledRegion &Loop = Regions->front();
+    EXPECT_TRUE(Loop.IsLoop);
+    EXPECT_EQ(Loop.getDescription(), "main+0x2..0x7 (loop)");
+    EXPECT_EQ(Loop.Weight, 100u);
+    EXPECT_EQ(Loop.Instructions.size(), 3u);
+  }
+}
@@ -0,0 +1,350 @@
+//===-- PerfReaderTest.cpp - Unit tests for perf script parsing -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "../../../tools/llvm-profgen/PerfReader.h"
+#include "../../../tools/llvm-profgen/ProfiledBinary.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/ObjectYAML/yaml2obj.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace sampleprof;
+
+namespace {
+
+struct Chunk {
+  std::vector<std::string> Lines;
+  uint64_t FirstLineNumber;
+  bool EndsAtSample;
+};
+
+// Split \p Trace the way the reader does, with small chunks so that every
+// sample boundary is exercised.
+std::vector<Chunk> splitTrace(ArrayRef<std::string> Trace,
+                              function_ref<bool(StringRef)> IsLastLineOfSample,
+                              size_t MinLines) {
+  std::vector<Chunk> Chunks;
+  TraceStream TraceIt(Trace, /*FirstLineNumber=*/1);
+  while (!TraceIt.isAtEoF()) {
+    Chunk C;
+    C.FirstLineNumber = TraceIt.getLineNumber();
+    C.EndsAtSample =
+        readTraceLines(TraceIt, IsLastLineOfSample, MinLines, C.Lines);
+    Chunks.push_back(std::move(C));
+  }
+  return Chunks;
+}
+
+void checkChunks(ArrayRef<std::string> Trace, ArrayRef<Chunk> Chunks,
+                 function_ref<bool(StringRef)> IsLastLineOfSample,
+                 size_t MinLines) {
+  std::vector<std::string> Joined;
+  uint64_t NextLineNumber = 1;
+  for (const Chunk &C : Chunks) {
+    ASSERT_FALSE(C.Lines.empty());
+    EXPECT_EQ(C.FirstLineNumber, NextLineNumber);
+    NextLineNumber += C.Lines.size();
+    if (C.EndsAtSample) {
+      EXPECT_GE(C.Lines.size(), MinLines);
+      EXPECT_TRUE(IsLastLineOfSample(C.Lines.back()));
+    }
+    llvm::append_range(Joined, C.Lines);
+  }
+  EXPECT_EQ(Joined, std::vector<std::string>(Trace.begin(), Trace.end()));
+}
+
+TEST(PerfReaderTest, SplitsHybridTraceAtSampleEnds) {
+  // Each hybrid sample is a call stack followed by a line of LBR entries.
+  std::vector<std::string> Trace;
+  for (unsigned I = 0; I < 10; ++I) {
+    for (unsigned Depth = 0; Depth <= I % 3; ++Depth)
+      Trace.push_back("\t           4005dc");
+    Trace.push_back(" 0x4005c8/0x4005dc/P/-/-/0  0x40062f/0x4005b0/P/-/-/0 ");
+  }
+  // A trailing partial sample is returned with the last chunk.
+  Trace.push_back("\t           4005dc");
+
+  auto IsLastLine = HybridPerfReader::isLastLineOfHybridSample;
+  for (size_t MinLines : {1, 3, 7, 1000}) {
+    std::vector<Chunk> Chunks = splitTrace(Trace, IsLastLine, MinLines);
+    checkChunks(Trace, Chunks, IsLastLine, MinLines);
+    EXPECT_FALSE(Chunks.back().EndsAtSample);
+    for (const Chunk &C : ArrayRef(Chunks).drop_back())
+      EXPECT_TRUE(C.EndsAtSample);
+  }
+}
+
+TEST(PerfReaderTest, SplitsLBRTraceAtSampleEnds) {
+  // LBR-only samples have an optional count line before the LBR line.
+  std::vector<std::string> Trace;
+  for (unsigned I = 0; I < 10; ++I) {
+    if (I % 2)
+      Trace.push_back(std::to_string(I + 1));
+    Trace.push_back(" 0x4005c8/0x4005dc/P/-/-/0  0x40062f/0x4005b0/P/-/-/0 ");
+  }
+
+  auto IsLastLine = LBRPerfReader::isLastLineOfLBRSample;
+  EXPECT_FALSE(IsLastLine("2"));
+  for (size_t MinLines : {1, 2, 5, 1000}) {
+    std::vector<Chunk> Chunks = splitTrace(Trace, IsLastLine, MinLines);
+    checkChunks(Trace, Chunks, IsLastLine, MinLines);
+    // The trace ends with a complete sample, so only a chunk cut short by the
+    // end of the trace is reported as such.
+    for (const Chunk &C : ArrayRef(Chunks).drop_back())
+      EXPECT_TRUE(C.EndsAtSample);
+    EXPECT_EQ(Chunks.back().EndsAtSample,
+              MinLines <= Chunks.back().Lines.size());
+  }
+}
+
+// main calls foo, which loops back to the branch at 0x401012 before it
+// returns.
+//   401000: push %rbp
+//   401001: call 401010 <foo>
+//   401006: jmp 401001
+//   401008: pop %rbp
+//   401009: ret
+//   401010: xor %eax,%eax
+//   401012: inc %eax
+//   401014: cmp $0x64,%eax
+//   401017: jne 401012
+//   401019: ret
+// The empty pseudo probe sections make the reader unwind with probes, which
+// is what it does in parallel.
+const char *BinaryYAML = R"(
+--- !ELF
+FileHeader:
+  Class:   ELFCLASS64
+  Data:    ELFDATA2LSB
+  Type:    ET_EXEC
+  Machine: EM_X86_64
+  Entry:   0x401000
+ProgramHeaders:
+  - Type:     PT_LOAD
+    Flags:    [ PF_X, PF_R ]
+    FirstSec: .text
+    LastSec:  .text
+    VAddr:    0x401000
+    Align:    0x1000
+    Offset:   0x1000
+Sections:
+  - Name:         .text
+    Type:         SHT_PROGBITS
+    Flags:        [ SHF_ALLOC, SHF_EXECINSTR ]
+    Address:      0x401000
+    AddressAlign: 0x1000
+    Offset:       0x1000
+    Content:      55E80A000000EBF95DC3CCCCCCCCCCCC31C0FFC083F86475F9C3
+  - Name: .pseudo_probe_desc
+    Type: SHT_PROGBITS
+  - Name: .pseudo_probe
+    Type: SHT_PROGBITS
+Symbols:
+  - Name:    main
+    Type:    STT_FUNC
+    Section: .text
+    Binding: STB_GLOBAL
+    Value:   0x401000
+    Size:    0x10
+  - Name:    foo
+    Type:    STT_FUNC
+    Section: .text
+    Binding: STB_GLOBAL
+    Value:   0x401010
+    Size:    0xA
+)";
+
+// A hybrid perf script with samples that exercise the statistics and the
+// warnings of the reader, and an mmap event for \p BinaryPath in the middle.
+std::string createHybridTrace(StringRef BinaryPath) {
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  for (unsigned I = 0; I < 240; ++I) {
+    if (I == 120)
+      OS << "       test     1 [000]     0.000000: PERF_RECORD_MMAP2 1/1: "
+            "[0x401000(0x1000) @ 0x1000 08:04 1 1]: r-xp "
+         << BinaryPath << "\n";
+    std::string Loops;
+    for (unsigned J = 0; J < I / 6 % 4; ++J)
+      Loops += "0x401017/0x401012/P/-/-/0 ";
+    switch (I % 6) {
+    case 5:
+      OS << "3\n";
+      [[fallthrough]];
+    case 0:
+      // In foo, called from main.
+      OS << "\t          401017\n\t          401006\n";
+      OS << " " << Loops << "0x401001/0x401010/P/-/-/0\n";
+      break;
+    case 1:
+      // In main, after foo returned.
+      OS << "\t          401008\n";
+      OS << " 0x401019/0x401006/P/-/-/0 " << Loops
+         << "0x401001/0x401010/P/-/-/0\n";
+      break;
+    case 2:
+      // 0x401014 is not a return address.
+      OS << "\t          401012\n\t          401014\n";
+      OS << " " << Loops << "0x401001/0x401010/P/-/-/0\n";
+      break;
+    case 3:
+      // The leaf frame is outside of the binary.
+      OS << "\t    7f0000001000\n\t          401006\n";
+      OS << " 0x7f0000001000/0x401010/P/-/-/0\n";
+      break;
+    case 4:
+      // A broken LBR record.
+      OS << "\t          401012\n\t          401006\n";
+      OS << " 0x40zz17/0x401012/P/-/-/0\n";
+      break;
+    }
+  }
+  return Trace;
+}
+
+// A hybrid reader that records the aggregated samples before they are
+// unwound and dropped.
+class RecordingPerfReader : public HybridPerfReader {
+public:
+  using HybridPerfReader::HybridPerfReader;
+
+  void generateUnsymbolizedProfile() override {
+    raw_string_ostream OS(Samples);
+    for (const auto &[Key, Count] : AggregatedSamples) {
+      const PerfSample *Sample = Key.getPtr();
+      OS << Count << ":";
+      for (uint64_t Address : Sample->CallStack)
+        OS << " " << Twine::utohexstr(Address);
+      OS << " |";
+      for (const LBREntry &LBR : Sample->LBRStack)
+        OS << " " << Twine::utohexstr(LBR.Source) << "/"
+           << Twine::utohexstr(LBR.Target);
+      OS << "\n";
+    }
+    for (uint64_t Address : InvalidReturnAddresses)
+      OS << "invalid return address " << Twine::utohexstr(Address) << "\n";
+    OS << "samples " << NumTotalSample << ", leaf external frames "
+       << NumLeafExternalFrame << "\n";
+    HybridPerfReader::generateUnsymbolizedProfile();
+  }
+
+  std::string Samples;
+};
+
+std::string printCounters(const ContextSampleCounterMap &Counters) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  for (const auto &[Key, Counter] : Counters) {
+    OS << "[";
+    for (uint64_t Address : cast<AddrBasedCtxKey>(Key.getPtr())->Context)
+      OS << " " << Twine::utohexstr(Address);
+    OS << " ]\n";
+    for (const auto &[Range, Count] : Counter.RangeCounter)
+      OS << "  " << Twine::utohexstr(Range.first) << "-"
+         << Twine::utohexstr(Range.second) << ":" << Count << "\n";
+    for (const auto &[Branch, Count] : Counter.BranchCounter)
+      OS << "  " << Twine::utohexstr(Branch.first) << "->"
+         << Twine::utohexstr(Branch.second) << ":" << Count << "\n";
+  }
+  return Str;
+}
+
+class PerfReaderParseTest : public testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    InitializeAllTargetInfos();
+    InitializeAllTargetMCs();
+    InitializeAllDisassemblers();
+  }
+
+  void SetUp() override {
+    std::string Error;
+    if (!TargetRegistry::lookupTarget("x86_64-unknown-linux-gnu", Error))
+      GTEST_SKIP();
+
+    int FD;
+    ASSERT_FALSE(
+        sys::fs::createTemporaryFile("profgen-binary", "elf", FD, BinaryPath));
+    BinaryRemover.setFile(BinaryPath);
+    {
+      raw_fd_ostream OS(FD, /*shouldClose=*/true);
+      yaml::Input YIn(BinaryYAML);
+      ASSERT_TRUE(yaml::convertYAML(YIn, OS, [](const Twine &Msg) {
+        ADD_FAILURE() << Msg.str();
+      }));
+    }
+
+    ASSERT_FALSE(
+        sys::fs::createTemporaryFile("profgen-trace", "txt", FD, TracePath));
+    TraceRemover.setFile(TracePath);
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << createHybridTrace(BinaryPath);
+  }
+
+  struct ParseResult {
+    std::string Samples;
+    std::string Counters;
+    std::string Warnings;
+  };
+
+  ParseResult parse(unsigned Threads, unsigned ChunkLines) {
+    StringMap<cl::Option *> &Opts = cl::getRegisteredOptions();
+    auto *NumThreads = static_cast<cl::opt<unsigned> *>(Opts["num-threads"]);
+    auto *TraceChunkLines =
+        static_cast<cl::opt<unsigned> *>(Opts["trace-chunk-lines"]);
+    *NumThreads = Threads;
+    *TraceChunkLines = ChunkLines;
+
+    // The binary keeps whether the missing mmap warning was printed and where
+    // it was loaded, so each parse starts with a fresh one.
+    ProfiledBinary Binary(BinaryPath, "");
+    EXPECT_TRUE(Binary.usePseudoProbes());
+    RecordingPerfReader Reader(&Binary, TracePath, std::nullopt);
+    testing::internal::CaptureStderr();
+    Reader.parsePerfTraces();
+    ParseResult Result;
+    Result.Warnings = testing::internal::GetCapturedStderr();
+    Result.Samples = Reader.Samples;
+    Result.Counters = printCounters(Reader.getSampleCounters());
+
+    *NumThreads = 1;
+    *TraceChunkLines = 16384;
+    return Result;
+  }
+
+  SmallString<128> BinaryPath;
+  SmallString<128> TracePath;
+  FileRemover BinaryRemover;
+  FileRemover TraceRemover;
+};
+
+TEST_F(PerfReaderParseTest, ParallelParseMatchesSerial) {
+  ParseResult Serial = parse(1, 16384);
+  EXPECT_NE(Serial.Samples.find("invalid return address 401014"),
+            std::string::npos);
+  EXPECT_NE(Serial.Counters.find("401012-401017"), std::string::npos);
+  EXPECT_NE(Serial.Warnings.find("No relevant mmap event"), std::string::npos);
+  EXPECT_NE(Serial.Warnings.find("Invalid address in LBR record at line"),
+            std::string::npos);
+
+  // Tiny chunks spread the samples over many tasks and batches, with the
+  // mmap event in a chunk of its own that is parsed in order.
+  for (unsigned ChunkLines : {1, 2, 7}) {
+    ParseResult Parallel = parse(4, ChunkLines);
+    EXPECT_EQ(Serial.Samples, Parallel.Samples) << ChunkLines;
+    EXPECT_EQ(Serial.Counters, Parallel.Counters) << ChunkLines;
+    EXPECT_EQ(Serial.Warnings, Parallel.Warnings) << ChunkLines;
+  }
+}
+
+} // namespace